@@ -0,0 +1,428 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+// ===============================
+//      ホスト用マイクロベンチマーク
+// ===============================
+// 画像・CSV・スクロール処理のホットパスを PC 上で計測する。
+// 実際の data/ ディレクトリを LittleFS の代わりに読み込み、
+// 1 回あたりの処理時間 (ns/op)・読み込みバイト数・メモリ確保回数を出力する。
+//
+// 使い方:
+//   bench [--data <dir>] [--filter <name>] [--min-time <ms>]
+//         [--write <baseline.json>] [--check <baseline.json>] [--tolerance <比率>]
+//
+// `--check` を指定した場合、ベースラインより遅い・読み込みが多い・確保が多い
+// ベンチマークがあれば終了コード 1 を返す。
+
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <new>
+
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "CSVReader.h"
+#include "drawBitmap.h"
+#include "AssetManifest.h"
+#include "PanelGeometry.h"
+#include "RouteGraph.h"
+#include "FrameGovernor.h"
+
+// ===============================
+//      src/ が参照するグローバル変数（本来は main.cpp で定義）
+// ===============================
+MatrixPanel_I2S_DMA *matrix;
+int panelWidth = 128;
+int panelHeight = 32;
+unsigned long previousToggleMillis = 0;
+unsigned long previousScrollMillis = 0;
+
+// ===============================
+//      メモリ確保回数のカウント
+// ===============================
+// glibc 環境では malloc 自体を差し替えて、drawBitmap.cpp の malloc と
+// String / std::vector の new の両方を数える。それ以外では new のみを数える。
+static unsigned long long allocCount = 0;
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+    if (!hostAllocPaused) allocCount++;
+    return __libc_malloc(size);
+}
+void *calloc(size_t n, size_t size) {
+    if (!hostAllocPaused) allocCount++;
+    return __libc_calloc(n, size);
+}
+void *realloc(void *ptr, size_t size) {
+    if (!hostAllocPaused) allocCount++;
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+void *operator new(size_t size) {
+    if (!hostAllocPaused) allocCount++;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+#endif
+
+// ===============================
+//      ベンチマークの定義と実行
+// ===============================
+
+/**
+ * @brief 1 つのベンチマークケース
+ *
+ * `op` を繰り返し実行して計測する。`op` の前後で仮想時計を進めたい場合は
+ * `op` の中で `hostClockMicros` を操作する。
+ */
+struct BenchCase {
+    const char *name;            // ベンチマーク名（ベースラインのキー）
+    std::function<void()> op;    // 計測対象の 1 回分の処理
+};
+
+/**
+ * @brief 1 つのベンチマークの計測結果
+ */
+struct BenchResult {
+    std::string name;
+    double nsPerOp = 0;        // 1 回あたりの処理時間（ナノ秒）
+    double bytesPerOp = 0;     // 1 回あたりのファイル読み込みバイト数
+    double allocsPerOp = 0;    // 1 回あたりのメモリ確保回数
+    unsigned long iterations = 0;
+};
+
+/**
+ * @brief ベンチマークを最低 `minTimeMs` ミリ秒実行し、平均値を求める
+ */
+static BenchResult runBench(const BenchCase &bench, double minTimeMs) {
+    using clock = std::chrono::steady_clock;
+
+    // 1. ウォームアップ（静的変数の初期化などを計測から除外）
+    bench.op();
+
+    // 2. 指定時間が経過するまで繰り返し実行
+    unsigned long long bytesBefore = hostFSBytesRead;
+    unsigned long long allocBefore = allocCount;
+    unsigned long iterations = 0;
+    auto start = clock::now();
+    double elapsedNs = 0;
+    do {
+        bench.op();
+        iterations++;
+        elapsedNs = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    } while (elapsedNs < minTimeMs * 1e6 || iterations < 10);
+
+    // 3. 1 回あたりの値に換算
+    BenchResult r;
+    r.name = bench.name;
+    r.iterations = iterations;
+    r.nsPerOp = elapsedNs / iterations;
+    r.bytesPerOp = (double)(hostFSBytesRead - bytesBefore) / iterations;
+    r.allocsPerOp = (double)(allocCount - allocBefore) / iterations;
+    return r;
+}
+
+// JSON の 1 行から `"key": 数値` を取り出す（ベースラインは 1 行 1 ベンチマーク）
+static bool jsonNumber(const std::string &line, const char *key, double &value) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) return false;
+    value = strtod(line.c_str() + pos + pattern.size(), nullptr);
+    return true;
+}
+
+// JSON の 1 行から `"name": "..."` を取り出す
+static bool jsonName(const std::string &line, std::string &name) {
+    const std::string pattern = "\"name\": \"";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) return false;
+    size_t end = line.find('"', pos + pattern.size());
+    if (end == std::string::npos) return false;
+    name = line.substr(pos + pattern.size(), end - pos - pattern.size());
+    return true;
+}
+
+/**
+ * @brief 計測結果をベースライン JSON として書き出す
+ */
+static bool writeBaseline(const std::string &path, const std::vector<BenchResult> &results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "{\n  \"version\": 1,\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "    {\"name\": \"%s\", \"ns_per_op\": %.1f, \"bytes_read_per_op\": %.1f, \"allocs_per_op\": %.2f}%s\n",
+                 r.name.c_str(), r.nsPerOp, r.bytesPerOp, r.allocsPerOp, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+/**
+ * @brief ベースラインと比較し、劣化したベンチマークの数を返す
+ *
+ * - 処理時間は `tolerance`（比率）を超えて遅くなったら劣化とみなす
+ * - 読み込みバイト数とメモリ確保回数は決定的なので、増えたら劣化とみなす
+ * - ベースラインにあるのに結果が無いベンチマーク（名前の変更・削除・途中で終了）も劣化とみなす（`filter` で除外したものは除く）
+ * - ベースラインから 1 件も読み取れない場合（空・壊れたファイル）は失敗とする
+ */
+static int checkBaseline(const std::string &path, const std::vector<BenchResult> &results, double tolerance,
+                         const std::string &filter) {
+    std::ifstream in(path);
+    if (!in) {
+        printf("ベースライン %s を開けませんでした。\n", path.c_str());
+        return 1;
+    }
+
+    int regressions = 0;
+    int entries = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string name;
+        double ns, bytes, allocs;
+        if (!jsonName(line, name) || !jsonNumber(line, "ns_per_op", ns) ||
+            !jsonNumber(line, "bytes_read_per_op", bytes) || !jsonNumber(line, "allocs_per_op", allocs)) {
+            continue;
+        }
+        entries++;
+        if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+
+        bool found = false;
+        for (const BenchResult &r : results) {
+            if (r.name != name) continue;
+            found = true;
+            if (r.nsPerOp > ns * (1.0 + tolerance)) {
+                printf("REGRESSION %-28s time   %12.1f -> %12.1f ns/op (%+.1f%%)\n",
+                       name.c_str(), ns, r.nsPerOp, (r.nsPerOp / ns - 1.0) * 100.0);
+                regressions++;
+            }
+            if (r.bytesPerOp > bytes + 0.5) {
+                printf("REGRESSION %-28s bytes  %12.1f -> %12.1f B/op\n", name.c_str(), bytes, r.bytesPerOp);
+                regressions++;
+            }
+            if (r.allocsPerOp > allocs + 0.05) {
+                printf("REGRESSION %-28s allocs %12.2f -> %12.2f /op\n", name.c_str(), allocs, r.allocsPerOp);
+                regressions++;
+            }
+        }
+        if (!found) {
+            printf("MISSING    %-28s ベースラインにあるベンチマークの結果がありません\n", name.c_str());
+            regressions++;
+        }
+    }
+    if (entries == 0) {
+        printf("ベースライン %s からベンチマークを読み取れませんでした。\n", path.c_str());
+        return 1;
+    }
+    return regressions;
+}
+
+int main(int argc, char **argv) {
+    // 1. コマンドライン引数の解析
+    std::string filter, writePath, checkPath;
+    double minTimeMs = 300;
+    double tolerance = 0.15;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--data" && hasValue) hostFSRoot = argv[++i];
+        else if (arg == "--filter" && hasValue) filter = argv[++i];
+        else if (arg == "--min-time" && hasValue) minTimeMs = atof(argv[++i]);
+        else if (arg == "--write" && hasValue) writePath = argv[++i];
+        else if (arg == "--check" && hasValue) checkPath = argv[++i];
+        else if (arg == "--tolerance" && hasValue) tolerance = atof(argv[++i]);
+        else if (arg == "--verbose") hostSerialVerbose = true;
+        else {
+            printf("usage: %s [--data dir] [--filter name] [--min-time ms] [--write file] [--check file] [--tolerance ratio] [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (!LittleFS.exists("/list/list_next.csv")) {
+        printf("data ディレクトリが見つかりません: %s (--data で指定してください)\n", hostFSRoot.c_str());
+        return 2;
+    }
+
+    // 2. パネルと CSV の準備（main.cpp と同じ構成）
+    HUB75_I2S_CFG mxconfig(64, 32, 2);
+    matrix = new MatrixPanel_I2S_DMA(mxconfig);
+    matrix->begin();
+    static std::vector<uint16_t> frameMirror((size_t)panelWidth * panelHeight, 0);
+    panelGeometry.setMirror(frameMirror.data()); // 表示中の内容の写し（ダブルバッファの書き写し用）
+
+    CSVReader typeReader("/list/list_type.csv");
+    CSVReader nextReader("/list/list_next.csv");
+
+    const String nextPath = "/img/Next80x16/Kibo_no_okaN_JP.bmp";
+
+    // 停車駅 12 駅分のスクロール画像リスト（drawMode3 と同じ構成）
+    std::vector<String> scrollPaths;
+    scrollPaths.emplace_back("/img/Scroll/ScrollStart.bmp");
+    for (int id = 2; id <= 13; id++) {
+        scrollPaths.emplace_back("/img/Scroll/touten.bmp");
+        scrollPaths.emplace_back(nextReader.getPath(id, "Scroll"));
+    }
+    scrollPaths.emplace_back("/img/Scroll/ScrollEnd2.bmp");
+
+    // 直通列車の途中駅（路線図から求める）
+    routeGraph.load();
+    std::vector<RouteStop> routeStops;
+
+    // 描画系ベンチマーク用のキャッシュ
+    static BMPData nextCache, scrollCache;
+    static BMPData typeJP, typeEN, destJP, destEN, nextJP, nextEN;
+    cacheBMPData(nextPath, nextCache);
+    cacheConcatenatedImages(scrollPaths, &scrollCache);
+    cacheBMPData("/img/Type48x32/YLocalJP.bmp", typeJP);
+    cacheBMPData("/img/Type48x32/YLocalEN.bmp", typeEN);
+    cacheBMPData("/img/DestS80x16/Kibo_no_okaS_JP.bmp", destJP);
+    cacheBMPData("/img/DestS80x16/Kibo_no_okaS_EN.bmp", destEN);
+    cacheBMPData("/img/Next80x16/Egao_no_machiN_JP.bmp", nextJP);
+    cacheBMPData("/img/Next80x16/Egao_no_machiN_EN.bmp", nextEN);
+
+    static std::vector<ToggleCacheBMPPart> toggleParts;
+    toggleParts.emplace_back(ToggleCacheBMPPart({&typeJP, &typeEN}, 0, 0));
+    toggleParts.emplace_back(ToggleCacheBMPPart({&destJP, &destEN}, 48, 0));
+    toggleParts.emplace_back(ToggleCacheBMPPart({&nextJP, &nextEN}, 48, 16));
+
+    // 128x32 を 2x2 段に折り返し配線した 256x64 のパネル（スクロール幅 208）
+    MatrixPanel_I2S_DMA *panel128x32 = matrix;
+    HUB75_I2S_CFG wideConfig(128, 32, 4);
+    MatrixPanel_I2S_DMA *panel256x64 = new MatrixPanel_I2S_DMA(wideConfig);
+    panel256x64->begin();
+    PanelGeometry defaultGeometry = panelGeometry;
+    PanelGeometry wideGeometry;
+    wideGeometry.setDefaults(128, 32, 2, 128);
+    wideGeometry.rows = 2;
+    wideGeometry.wiring = PANEL_WIRING_SERPENTINE;
+    wideGeometry.startBottom = true;
+    wideGeometry.updateMap();
+
+    // 3. ベンチマークの登録
+    std::vector<BenchCase> benches = {
+        {"CSVReader::getPath/first", [&]() {
+            nextReader.getPath(1, "JP");
+        }},
+        {"CSVReader::getPath/last", [&]() {
+            nextReader.getPath(118, "Scroll");
+        }},
+        {"RouteGraph::route/through", [&]() {
+            routeGraph.route(7, 113, routeStops); // 夢の森線 → 花霞線
+        }},
+        {"parseBMPHeader", [&]() {
+            File file = LittleFS.open(nextPath, "r");
+            int w, h, offset;
+            bool topDown;
+            parseBMPHeader(file, w, h, offset, topDown);
+            file.close();
+        }},
+        {"cacheBMPData", [&]() {
+            cacheBMPData(nextPath, nextCache);
+        }},
+        {"cacheConcatenatedImages/12st", [&]() {
+            cacheConcatenatedImages(scrollPaths, &scrollCache);
+        }},
+        {"drawBMPFromCache", [&]() {
+            drawBMPFromCache(&nextCache, 48, 16);
+        }},
+        {"updateScroll", [&]() {
+            hostClockMicros += 25 * 1000; // 毎回スクロールが 1 ピクセル進むように時計を進める（40 ピクセル/秒）
+            updateScroll(&scrollCache, 48, 16, 80, 16, 40);
+        }},
+        {"updateScroll/256x64/serpentine", [&]() {
+            hostClockMicros += 25 * 1000;
+            matrix = panel256x64;
+            panelGeometry = wideGeometry;
+            updateScroll(&scrollCache, 48, 48, 208, 16, 40); // 下段（チェーン先頭、折り返し前）
+            hostClockMicros += 25 * 1000;
+            updateScroll(&scrollCache, 48, 16, 208, 16, 40); // 上段（折り返し後、180 度回転）
+            matrix = panel128x32;
+            panelGeometry = defaultGeometry;
+        }},
+        {"toggleCacheBMP", [&]() {
+            hostClockMicros += 3000 * 1000; // 毎回トグルが切り替わるように時計を進める
+            frameGovernor.beginFrame();       // 描画ループと同じく 1 フレームの中で切り替える
+            toggleCacheBMP(toggleParts, 2, 3000);
+            frameGovernor.endFrame();
+        }},
+        {"transition/fade/80x16", [&]() {
+            // 切り替え 1 回分（最初のコマから最後のコマまで 65 回の描画）
+            TransitionStyle fade;
+            TransitionStyle::parse("fade:640", fade);
+            transitions.start(48, 16, &nextJP, fade);
+            for (int step = 0; step <= TRANSITION_STEPS; step++) {
+                hostClockMicros += 10 * 1000;
+                transitions.update();
+            }
+        }},
+        {"updateScroll/presentFrame", [&]() {
+            hostClockMicros += 25 * 1000;
+            updateScroll(&scrollCache, 48, 16, 80, 16, 40);
+            panelGeometry.presentFrame(matrix); // 切り替え後にスクロール領域を新しい裏画面へ書き写す
+        }},
+
+        // 以下はマニフェストを作成した状態で計測する（ヘッダー解析を省略）
+        {"AssetManifest::build", [&]() {
+            assetManifest.build();
+        }},
+        {"cacheBMPData/manifest", [&]() {
+            if (!assetManifest.isReady()) assetManifest.build();
+            cacheBMPData(nextPath, nextCache);
+        }},
+        {"cacheConcatenatedImages/12st/manifest", [&]() {
+            if (!assetManifest.isReady()) assetManifest.build();
+            cacheConcatenatedImages(scrollPaths, &scrollCache);
+        }},
+    };
+
+    // 4. 実行と結果表示
+    std::vector<BenchResult> results;
+    printf("%-38s %14s %14s %12s %10s\n", "benchmark", "ns/op", "bytes/op", "allocs/op", "iters");
+    for (const BenchCase &bench : benches) {
+        if (!filter.empty() && std::string(bench.name).find(filter) == std::string::npos) continue;
+        BenchResult r = runBench(bench, minTimeMs);
+        printf("%-38s %14.1f %14.1f %12.2f %10lu\n", r.name.c_str(), r.nsPerOp, r.bytesPerOp, r.allocsPerOp, r.iterations);
+        results.push_back(r);
+    }
+
+    // 5. ベースラインの書き出し / 比較
+    if (!writePath.empty()) {
+        if (!writeBaseline(writePath, results)) {
+            printf("ベースライン %s を書き込めませんでした。\n", writePath.c_str());
+            return 2;
+        }
+        printf("ベースラインを書き出しました: %s\n", writePath.c_str());
+    }
+    if (!checkPath.empty()) {
+        int regressions = checkBaseline(checkPath, results, tolerance, filter);
+        if (regressions > 0) {
+            printf("%d 件の劣化が見つかりました。\n", regressions);
+            return 1;
+        }
+        printf("ベースラインからの劣化はありません。\n");
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// ===============================
+//      ホスト (PC) 用 Arduino 互換レイヤー
+// ===============================
+// ベンチマークを PC 上で実行するための最小限の代替実装。
+// src/ のコードが使用している API だけを用意している。
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// ===============================
+//      数値ユーティリティ（Arduino 互換）
+// ===============================
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ===============================
+//      String クラス（Arduino 互換）
+// ===============================
+class String {
+public:
+    String() {}
+    String(const char *s) : str(s ? s : "") {}
+    String(const std::string &s) : str(s) {}
+    String(char c) : str(1, c) {}
+    String(int v) : str(std::to_string(v)) {}
+    String(unsigned int v) : str(std::to_string(v)) {}
+    String(long v) : str(std::to_string(v)) {}
+    String(unsigned long v) : str(std::to_string(v)) {}
+
+    unsigned int length() const { return (unsigned int)str.size(); }
+    const char *c_str() const { return str.c_str(); }
+    bool isEmpty() const { return str.empty(); }
+
+    int indexOf(char c, unsigned int from = 0) const { return find(str.find(c, from)); }
+    int indexOf(const char *s, unsigned int from = 0) const { return find(str.find(s, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return find(str.find(s.str, from)); }
+    int lastIndexOf(char c) const { return find(str.rfind(c)); }
+
+    String substring(unsigned int from) const {
+        return from >= str.size() ? String() : String(str.substr(from));
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= str.size()) return String();
+        return String(str.substr(from, to - from));
+    }
+
+    void trim() {
+        size_t b = 0, e = str.size();
+        while (b < e && isspace((unsigned char)str[b])) b++;
+        while (e > b && isspace((unsigned char)str[e - 1])) e--;
+        str = str.substr(b, e - b);
+    }
+
+    long toInt() const { return strtol(str.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(str.c_str(), nullptr); }
+    bool startsWith(const String &s) const { return str.compare(0, s.str.size(), s.str) == 0; }
+    bool endsWith(const String &s) const {
+        return str.size() >= s.str.size() && str.compare(str.size() - s.str.size(), s.str.size(), s.str) == 0;
+    }
+    void reserve(unsigned int n) { str.reserve(n); }
+
+    char operator[](unsigned int i) const { return i < str.size() ? str[i] : 0; }
+    char &operator[](unsigned int i) { return str[i]; }
+
+    String &operator+=(const String &s) { str += s.str; return *this; }
+    String &operator+=(const char *s) { str += s; return *this; }
+    String &operator+=(char c) { str += c; return *this; }
+    String &operator+=(int v) { str += std::to_string(v); return *this; }
+    String &operator+=(unsigned int v) { str += std::to_string(v); return *this; }
+    String &operator+=(unsigned long v) { str += std::to_string(v); return *this; }
+    bool concat(const String &s) { str += s.str; return true; }
+    bool concat(char c) { str += c; return true; }
+
+    bool operator==(const String &o) const { return str == o.str; }
+    bool operator==(const char *o) const { return str == o; }
+    bool operator!=(const String &o) const { return str != o.str; }
+    bool operator!=(const char *o) const { return str != o; }
+    bool operator<(const String &o) const { return str < o.str; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.str + b.str); }
+    friend String operator+(const String &a, const char *b) { return String(a.str + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.str); }
+    friend String operator+(const String &a, char b) { return String(a.str + b); }
+    friend String operator+(const String &a, int b) { return String(a.str + std::to_string(b)); }
+
+private:
+    std::string str;
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+};
+
+// ===============================
+//      ストリーム（シリアルポートの代役はこれを継承する）
+// ===============================
+class Stream {
+public:
+    virtual ~Stream() {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+};
+
+// ===============================
+//      シリアル出力（既定では抑制）
+// ===============================
+extern bool hostSerialVerbose; // true のときのみ stderr に出力
+
+class HostSerial : public Stream {
+public:
+    int available() override { return 0; }
+    int read() override { return -1; }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        return hostSerialVerbose ? fwrite(buffer, 1, size, stderr) : size;
+    }
+    void begin(unsigned long) {}
+    int printf(const char *fmt, ...) {
+        if (!hostSerialVerbose) return 0;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vfprintf(stderr, fmt, ap);
+        va_end(ap);
+        return n;
+    }
+    void print(const String &s) { if (hostSerialVerbose) fputs(s.c_str(), stderr); }
+    void print(const char *s) { if (hostSerialVerbose) fputs(s, stderr); }
+    void print(long v) { if (hostSerialVerbose) fprintf(stderr, "%ld", v); }
+    void println(const String &s) { if (hostSerialVerbose) fprintf(stderr, "%s\n", s.c_str()); }
+    void println(const char *s) { if (hostSerialVerbose) fprintf(stderr, "%s\n", s); }
+    void println(long v) { if (hostSerialVerbose) fprintf(stderr, "%ld\n", v); }
+    void println() { if (hostSerialVerbose) fputc('\n', stderr); }
+};
+extern HostSerial Serial;
+
+// ===============================
+//      時間管理（ベンチマーク側から進める仮想時計）
+// ===============================
+extern unsigned long long hostClockMicros; // 仮想時計（マイクロ秒）
+
+inline unsigned long millis() { return (unsigned long)(hostClockMicros / 1000); }
+inline unsigned long micros() { return (unsigned long)hostClockMicros; }
+inline void delay(unsigned long ms) { hostClockMicros += (unsigned long long)ms * 1000; }
+
+// ===============================
+//      FreeRTOS 互換（シングルスレッドとして扱う）
+// ===============================
+inline int xPortGetCoreID() { return 0; }
+
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffUL
+
+#define portTICK_PERIOD_MS 1
+inline void vTaskDelay(TickType_t) {}
+
+// タスクは作成できないものとして扱う（`DecodePool` は呼び出し元ですべて実行する）
+inline BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *, unsigned, TaskHandle_t *, BaseType_t) { return pdFAIL; }
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline const char *pcTaskGetName(TaskHandle_t) { return "main"; }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return nullptr; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdPASS; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdPASS; }
+
+#endif // HOST_ARDUINO_H
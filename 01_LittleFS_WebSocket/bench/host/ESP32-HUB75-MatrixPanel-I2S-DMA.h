@@ -0,0 +1,93 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef HOST_HUB75_DMA_H
+#define HOST_HUB75_DMA_H
+
+// ===============================
+//      ホスト (PC) 用 HUB75 パネル互換レイヤー
+// ===============================
+// 実機の DMA 出力の代わりに、メモリ上のフレームバッファへ書き込む。
+
+#include "Arduino.h"
+
+/**
+ * @brief Adafruit GFX の `GFXcanvas16` 互換キャンバス
+ */
+class GFXcanvas16 {
+public:
+    GFXcanvas16(int16_t w, int16_t h) : w(w), h(h), buffer((size_t)w * h, 0) {}
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) {
+        if (x < 0 || y < 0 || x >= w || y >= h) return;
+        buffer[(size_t)y * w + x] = color;
+    }
+    uint16_t getPixel(int16_t x, int16_t y) const {
+        if (x < 0 || y < 0 || x >= w || y >= h) return 0;
+        return buffer[(size_t)y * w + x];
+    }
+    void fillScreen(uint16_t color) { std::fill(buffer.begin(), buffer.end(), color); }
+    uint16_t *getBuffer() { return buffer.data(); }
+    int16_t width() const { return w; }
+    int16_t height() const { return h; }
+
+private:
+    int16_t w, h;
+    std::vector<uint16_t> buffer;
+};
+
+/**
+ * @brief HUB75 パネル設定（ホストでは寸法のみ使用）
+ */
+struct HUB75_I2S_CFG {
+    uint16_t mx_width;
+    uint16_t mx_height;
+    uint16_t chain_length;
+    bool double_buff = false;
+
+    HUB75_I2S_CFG(uint16_t w = 64, uint16_t h = 32, uint16_t chain = 1)
+        : mx_width(w), mx_height(h), chain_length(chain) {}
+};
+
+/**
+ * @brief `MatrixPanel_I2S_DMA` 互換クラス（描画内容はメモリに保持）
+ */
+class MatrixPanel_I2S_DMA {
+public:
+    explicit MatrixPanel_I2S_DMA(const HUB75_I2S_CFG &cfg)
+        : cfg(cfg), pixels((size_t)cfg.mx_width * cfg.chain_length * cfg.mx_height, 0) {}
+
+    bool begin() { return true; }
+    void setBrightness8(uint8_t) {}
+    void clearScreen() { std::fill(pixels.begin(), pixels.end(), 0); }
+    void flipDMABuffer() {}
+
+    static uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+        return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) {
+        if (x < 0 || y < 0 || x >= width() || y >= height()) return;
+        pixels[(size_t)y * width() + x] = color;
+    }
+
+    int16_t width() const { return cfg.mx_width * cfg.chain_length; }
+    int16_t height() const { return cfg.mx_height; }
+    const uint16_t *hostPixels() const { return pixels.data(); }
+
+private:
+    HUB75_I2S_CFG cfg;
+    std::vector<uint16_t> pixels;
+};
+
+#endif // HOST_HUB75_DMA_H
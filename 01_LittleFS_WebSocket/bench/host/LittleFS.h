@@ -0,0 +1,82 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+// ===============================
+//      ホスト (PC) 用 LittleFS 互換レイヤー
+// ===============================
+// LittleFS 上のパス（例: "/img/..."）を `hostFSRoot` 配下の実ファイルに対応付ける。
+// 読み込んだバイト数は `hostFSBytesRead` に積算され、ベンチマークの計測に使う。
+
+#include <memory>
+#include "Arduino.h"
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+extern std::string hostFSRoot;              // data/ ディレクトリの実パス
+extern unsigned long long hostFSBytesRead;  // ファイルから読み込んだ総バイト数
+extern int hostAllocPaused;                 // 0 以外の間はメモリ確保をカウントしない（互換レイヤー内部の確保を除外）
+
+struct HostFileHandle;
+
+/**
+ * @brief Arduino の `File` と同じ使い方ができるファイルハンドル
+ *
+ * コピーしても同じファイルを指す（Arduino 版と同じ共有ハンドル方式）。
+ */
+class File {
+public:
+    File() {}
+    explicit File(std::shared_ptr<HostFileHandle> h) : handle(h) {}
+
+    operator bool() const;
+    size_t read(uint8_t *buf, size_t size);
+    int read();
+    int available();
+    String readStringUntil(char terminator);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    size_t write(const uint8_t *buf, size_t size);
+    void close();
+    const char *name() const;
+    const char *path() const;
+    bool isDirectory() const;
+    File openNextFile();
+    time_t getLastWrite();
+
+private:
+    std::shared_ptr<HostFileHandle> handle;
+};
+
+class HostLittleFS {
+public:
+    bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+    File open(const char *path, const char *mode = "r");
+    File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char *path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    size_t totalBytes() { return 0; }
+    size_t usedBytes() { return 0; }
+};
+extern HostLittleFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
@@ -0,0 +1,172 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "Arduino.h"
+#include "LittleFS.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+bool hostSerialVerbose = false;
+HostSerial Serial;
+unsigned long long hostClockMicros = 0;
+std::string hostFSRoot = "data";
+unsigned long long hostFSBytesRead = 0;
+int hostAllocPaused = 0;
+HostLittleFS LittleFS;
+
+/**
+ * @brief ホスト側のファイル（またはディレクトリ）の実体
+ */
+struct HostFileHandle {
+    FILE *fp = nullptr;          // 通常ファイル
+    DIR *dir = nullptr;          // ディレクトリ
+    std::string fsPath;          // LittleFS 上のパス
+    std::string name;            // ファイル名（パスの末尾）
+    size_t fileSize = 0;         // ファイルサイズ
+    time_t lastWrite = 0;        // 最終更新時刻
+
+    ~HostFileHandle() {
+        if (fp) fclose(fp);
+        if (dir) closedir(dir);
+    }
+};
+
+// 互換レイヤー内部のメモリ確保をカウント対象から外す（実機には存在しない確保のため）
+struct AllocPause {
+    AllocPause() { hostAllocPaused++; }
+    ~AllocPause() { hostAllocPaused--; }
+};
+
+// LittleFS 上のパスをホストの実パスに変換する
+static std::string toHostPath(const char *path) {
+    std::string p = path ? path : "";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return hostFSRoot + p;
+}
+
+File::operator bool() const { return handle && (handle->fp || handle->dir); }
+
+size_t File::read(uint8_t *buf, size_t size) {
+    if (!handle || !handle->fp) return 0;
+    AllocPause pause; // stdio のバッファ確保を除外
+    size_t n = fread(buf, 1, size, handle->fp);
+    hostFSBytesRead += n;
+    return n;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::available() {
+    if (!handle || !handle->fp) return 0;
+    long pos = ftell(handle->fp);
+    return pos < 0 ? 0 : (int)(handle->fileSize - (size_t)pos);
+}
+
+String File::readStringUntil(char terminator) {
+    std::string out;
+    int c;
+    while ((c = read()) >= 0 && c != terminator) {
+        out += (char)c;
+    }
+    return String(out);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!handle || !handle->fp) return false;
+    AllocPause pause; // 最初の操作が seek の場合、stdio のバッファがここで確保される
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(handle->fp, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!handle || !handle->fp) return 0;
+    long pos = ftell(handle->fp);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const { return handle ? handle->fileSize : 0; }
+
+size_t File::write(const uint8_t *buf, size_t size) {
+    if (!handle || !handle->fp) return 0;
+    return fwrite(buf, 1, size, handle->fp);
+}
+
+void File::close() {
+    AllocPause pause;
+    handle.reset();
+}
+
+const char *File::name() const { return handle ? handle->name.c_str() : ""; }
+
+const char *File::path() const { return handle ? handle->fsPath.c_str() : ""; }
+
+bool File::isDirectory() const { return handle && handle->dir; }
+
+time_t File::getLastWrite() { return handle ? handle->lastWrite : 0; }
+
+File File::openNextFile() {
+    if (!handle || !handle->dir) return File();
+    AllocPause pause;
+    while (struct dirent *ent = readdir(handle->dir)) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        std::string child = handle->fsPath;
+        if (child.empty() || child.back() != '/') child += "/";
+        child += ent->d_name;
+        return LittleFS.open(child.c_str(), "r");
+    }
+    return File();
+}
+
+File HostLittleFS::open(const char *path, const char *mode) {
+    AllocPause pause;
+    std::string hostPath = toHostPath(path);
+    struct stat st;
+    bool exists = stat(hostPath.c_str(), &st) == 0;
+
+    auto h = std::make_shared<HostFileHandle>();
+    h->fsPath = path ? path : "";
+    size_t slash = h->fsPath.find_last_of('/');
+    h->name = slash == std::string::npos ? h->fsPath : h->fsPath.substr(slash + 1);
+
+    if (exists && S_ISDIR(st.st_mode)) {
+        h->dir = opendir(hostPath.c_str());
+        return h->dir ? File(h) : File();
+    }
+
+    const char *m = (mode && mode[0] == 'w') ? "wb" : (mode && mode[0] == 'a') ? "ab" : "rb";
+    h->fp = fopen(hostPath.c_str(), m);
+    if (!h->fp) return File();
+    h->fileSize = exists ? (size_t)st.st_size : 0;
+    h->lastWrite = exists ? st.st_mtime : 0;
+    return File(h);
+}
+
+bool HostLittleFS::exists(const char *path) {
+    struct stat st;
+    return stat(toHostPath(path).c_str(), &st) == 0;
+}
+
+bool HostLittleFS::remove(const char *path) { return ::remove(toHostPath(path).c_str()) == 0; }
+
+bool HostLittleFS::rename(const char *from, const char *to) {
+    return ::rename(toHostPath(from).c_str(), toHostPath(to).c_str()) == 0;
+}
+
+bool HostLittleFS::mkdir(const char *path) { return ::mkdir(toHostPath(path).c_str(), 0755) == 0; }
@@ -0,0 +1,171 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "AssetCache.h"
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+AssetCache assetCache;
+
+/**
+ * @brief 単独の画像の先読みを予約する（予約済み・先読み済みなら何もしない）
+ * @param path 画像のパス
+ */
+void AssetCache::enqueue(const String &path) {
+    if (path.length() == 0 || isKnown(path)) return;
+    Job job;
+    job.key = path;
+    job.paths.push_back(path);
+    jobs.push_back(job);
+}
+
+/**
+ * @brief 連結画像（スクロール用）の先読みを予約する
+ * @param paths 連結する画像のパスリスト（`cacheConcatenatedImages()` と同じ順）
+ */
+void AssetCache::enqueueStrip(const std::vector<String> &paths) {
+    if (paths.empty()) return;
+    String key = stripKey(paths);
+    if (isKnown(key)) return;
+    Job job;
+    job.key = key;
+    job.paths = paths;
+    job.strip = true;
+    jobs.push_back(job);
+}
+
+/**
+ * @brief 予約を 1 件だけ処理する（描画の合間に繰り返し呼ぶ）
+ * @return 処理した場合 true / 予約が無い場合 false
+ */
+bool AssetCache::pump() {
+    if (jobs.empty()) return false;
+    TRACE_SCOPE("preload", jobs.front().paths.front().c_str());
+
+    // 1. 最も古い予約を取り出す
+    Job job = jobs.front();
+    jobs.erase(jobs.begin());
+
+    // 2. 通常の読み込み処理で画像を読み込む
+    BMPData data;
+    if (job.strip) {
+        cacheConcatenatedImages(job.paths, &data);
+    } else {
+        cacheBMPData(job.key, data);
+    }
+
+    // 3. 読み込めた場合のみ保存
+    if (data.cache) {
+        store(job.key, data);
+    }
+    return true;
+}
+
+/**
+ * @brief 先読み済みの単独画像を受け取る
+ *
+ * 見つかった場合は `dest` の既存のキャッシュを解放し、先読みしたメモリの所有権を移す。
+ *
+ * @param path 画像のパス
+ * @param dest 受け取り先
+ * @return 先読み済みだった場合 true
+ */
+bool AssetCache::take(const String &path, BMPData &dest) {
+    if (entries.empty()) return false;
+    return takeEntry(path, dest);
+}
+
+/**
+ * @brief 先読み済みの連結画像を受け取る（`take()` の連結画像版）
+ */
+bool AssetCache::takeStrip(const std::vector<String> &paths, BMPData &dest) {
+    if (entries.empty() || paths.empty()) return false;
+    return takeEntry(stripKey(paths), dest);
+}
+
+/**
+ * @brief 予約と先読み済みの画像をすべて破棄する
+ */
+void AssetCache::clear() {
+    for (Entry &entry : entries) {
+        free(entry.data.cache);
+    }
+    entries.clear();
+    jobs.clear();
+    usedBytes = 0;
+}
+
+// 連結画像の識別子（パスを改行でつないだもの）
+String AssetCache::stripKey(const std::vector<String> &paths) {
+    String key;
+    for (const String &path : paths) {
+        key += path;
+        key += '\n';
+    }
+    return key;
+}
+
+// 予約済み、または先読み済みか
+bool AssetCache::isKnown(const String &key) const {
+    for (const Entry &entry : entries) {
+        if (entry.key == key) return true;
+    }
+    for (const Job &job : jobs) {
+        if (job.key == key) return true;
+    }
+    return false;
+}
+
+// 先読み済みの画像の所有権を dest に移す
+bool AssetCache::takeEntry(const String &key, BMPData &dest) {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].key != key) continue;
+
+        if (dest.cache) {
+            free(dest.cache);
+        }
+        dest = entries[i].data;
+        dest.offsetX = 0;
+        usedBytes -= (size_t)dest.width * dest.height * sizeof(uint16_t);
+        entries.erase(entries.begin() + i);
+        hits++;
+        return true;
+    }
+    return false;
+}
+
+// 読み込んだ画像を保存する（上限を超える場合は古いものから破棄）
+void AssetCache::store(const String &key, BMPData &data) {
+    size_t size = (size_t)data.width * data.height * sizeof(uint16_t);
+    while (!entries.empty() && usedBytes + size > ASSET_CACHE_MAX_BYTES) {
+        usedBytes -= (size_t)entries.front().data.width * entries.front().data.height * sizeof(uint16_t);
+        free(entries.front().data.cache);
+        entries.erase(entries.begin());
+        evictions++;
+    }
+    if (size > ASSET_CACHE_MAX_BYTES) {
+        free(data.cache); // 上限を超える画像は先読みしない
+        data.cache = nullptr;
+        evictions++;
+        return;
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.data = data;
+    data.cache = nullptr; // 所有権はエントリに移る
+    entries.push_back(entry);
+    usedBytes += size;
+}
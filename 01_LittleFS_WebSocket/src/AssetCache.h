@@ -0,0 +1,114 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>    // Arduino 環境の基本ライブラリ
+#include "drawBitmap.h" // BMPData / cacheBMPData / cacheConcatenatedImages
+#include <vector>       // 先読み済み画像・予約の一覧
+
+// ===============================
+//      先読みキャッシュの設定
+// ===============================
+#define ASSET_CACHE_MAX_BYTES (96 * 1024) // 先読みした画像に使うメモリの上限（超えた場合は古いものから破棄）
+
+// ===============================
+//      AssetCache クラスの定義
+// ===============================
+/**
+ * @brief 次に表示する画像を前もって読み込んでおくキャッシュ
+ *
+ * 時刻表の再生などで次の表示内容が分かっている場合に、画像（単独 / 連結）の読み込みを予約し、
+ * 描画の合間に `pump()` で 1 件ずつ読み込んでおく。
+ * `cacheBMPData()` / `cacheConcatenatedImages()` は先読み済みの画像があれば
+ * ファイルを読まずにそのメモリを受け取る（コピーせず所有権を移す）。
+ *
+ * パネル制御タスクからのみ使用する（排他制御は行わない）。
+ */
+class AssetCache {
+public:
+    /**
+     * @brief 単独の画像の先読みを予約する（予約済み・先読み済みなら何もしない）
+     * @param path 画像のパス
+     */
+    void enqueue(const String &path);
+
+    /**
+     * @brief 連結画像（スクロール用）の先読みを予約する
+     * @param paths 連結する画像のパスリスト（`cacheConcatenatedImages()` と同じ順）
+     */
+    void enqueueStrip(const std::vector<String> &paths);
+
+    /**
+     * @brief 予約を 1 件だけ処理する（描画の合間に繰り返し呼ぶ）
+     * @return 処理した場合 true / 予約が無い場合 false
+     */
+    bool pump();
+
+    /**
+     * @brief 先読み済みの単独画像を受け取る
+     *
+     * 見つかった場合は `dest` の既存のキャッシュを解放し、先読みしたメモリの所有権を移す。
+     *
+     * @param path 画像のパス
+     * @param dest 受け取り先
+     * @return 先読み済みだった場合 true
+     */
+    bool take(const String &path, BMPData &dest);
+
+    /**
+     * @brief 先読み済みの連結画像を受け取る（`take()` の連結画像版）
+     */
+    bool takeStrip(const std::vector<String> &paths, BMPData &dest);
+
+    /**
+     * @brief 予約と先読み済みの画像をすべて破棄する
+     */
+    void clear();
+
+    size_t pendingCount() const { return jobs.size(); } // 未処理の予約数
+    size_t size() const { return entries.size(); }      // 先読み済みの画像数
+    size_t bytes() const { return usedBytes; }          // 先読み済みの画像が使っているメモリ
+    unsigned long hitCount() const { return hits; }     // 先読みした画像を使った回数
+    unsigned long evictCount() const { return evictions; } // 使われずに破棄した回数
+
+private:
+    struct Entry {
+        String key;   // 画像のパス（連結画像は stripKey()）
+        BMPData data; // 読み込んだ画像
+    };
+    struct Job {
+        String key;                 // Entry::key と同じ
+        std::vector<String> paths;  // 読み込む画像（連結画像は複数）
+        bool strip = false;         // 連結画像なら true
+    };
+
+    std::vector<Entry> entries; // 先読み済み（古い順）
+    std::vector<Job> jobs;      // 予約（古い順）
+    size_t usedBytes = 0;
+    unsigned long hits = 0;
+    unsigned long evictions = 0;
+
+    static String stripKey(const std::vector<String> &paths);
+    bool isKnown(const String &key) const;
+    bool takeEntry(const String &key, BMPData &dest);
+    void store(const String &key, BMPData &data);
+};
+
+extern AssetCache assetCache; // 全体で共有する先読みキャッシュ
+
+#endif // ASSETCACHE_H
@@ -0,0 +1,252 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "AssetManifest.h"
+#include "Metrics.h"
+#include <algorithm>  // std::sort / std::lower_bound
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+AssetManifest assetManifest;
+
+/**
+ * @brief マニフェストを用意する（事前生成ファイル → 走査の順に試す）
+ * @return 1 件以上のエントリを用意できた場合 true
+ */
+bool AssetManifest::begin() {
+    if (LittleFS.exists(ASSET_MANIFEST_PATH) && load(ASSET_MANIFEST_PATH)) {
+        return true;
+    }
+    return build(ASSET_ROOT_DIR);
+}
+
+/**
+ * @brief 指定フォルダ以下の BMP を走査してマニフェストを作成する
+ * @param rootDir 走査するフォルダ
+ * @return 1 件以上の有効な画像が見つかった場合 true
+ */
+bool AssetManifest::build(const char *rootDir) {
+    clear();
+
+    // 1. フォルダを開く
+    File root = LittleFS.open(rootDir, "r");
+    if (!root || !root.isDirectory()) {
+        Serial.printf("画像フォルダ %s を開けませんでした。\n", rootDir);
+        return false;
+    }
+
+    // 2. サブフォルダを含めて走査し、パス順に並べる
+    scanDirectory(root);
+    root.close();
+    sortEntries();
+
+    Serial.printf("マニフェスト作成: 有効 %u 件 / 無効 %u 件\n", (unsigned)entries.size(), (unsigned)invalidAssets);
+    return !entries.empty();
+}
+
+// フォルダ内の BMP を再帰的に検証し、有効なものをエントリに追加する
+void AssetManifest::scanDirectory(File &dir) {
+    File file = dir.openNextFile();
+    while (file) {
+        if (file.isDirectory()) {
+            scanDirectory(file);
+        } else {
+            String path = file.path();
+            if (path.endsWith(".bmp")) {
+                AssetEntry entry;
+                if (readBMPInfo(file, entry.info)) {
+                    entry.path = path;
+                    entries.push_back(entry);
+                } else {
+                    Serial.printf("  無効な画像: %s\n", path.c_str());
+                    invalidAssets++;
+                }
+            }
+        }
+        file.close();
+        file = dir.openNextFile();
+    }
+}
+
+/**
+ * @brief 事前生成したマニフェスト（CSV）を読み込む
+ *
+ * 形式: `path,width,height,offset,bpp,compression,topdown,size,dib,colors`（1 行目は見出し）
+ * 値は `validateBMPInfo()` で画像を走査した場合と同じ範囲か確認し、外れた行は無効な画像として数える。
+ *
+ * @param manifestPath マニフェストのパス
+ * @return 読み込みに成功した場合 true
+ */
+bool AssetManifest::load(const char *manifestPath) {
+    clear();
+
+    // 1. マニフェストを開き、見出し行を読み飛ばす
+    File file = LittleFS.open(manifestPath, "r");
+    if (!file) {
+        return false;
+    }
+    String line = file.readStringUntil('\n');
+
+    // 2. 1 行ずつ読み取る
+    while (file.available()) {
+        line = file.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0) continue;
+
+        long fields[9];
+        int comma = line.indexOf(',');
+        if (comma <= 0) continue;
+        AssetEntry entry;
+        entry.path = line.substring(0, comma);
+
+        bool ok = true;
+        for (int i = 0; i < 9; i++) {
+            int start = comma + 1;
+            comma = line.indexOf(',', start);
+            if (comma == -1 && i < 8) { ok = false; break; }
+            fields[i] = (comma == -1 ? line.substring(start) : line.substring(start, comma)).toInt();
+        }
+        if (!ok) {
+            Serial.printf("マニフェストの行が不正です: %s\n", line.c_str());
+            continue;
+        }
+
+        entry.info.width = fields[0];
+        entry.info.height = fields[1];
+        entry.info.pixelDataOffset = fields[2];
+        entry.info.bitsPerPixel = fields[3];
+        entry.info.compression = fields[4];
+        entry.info.isTopDown = fields[5] != 0;
+        entry.info.fileSize = fields[6];
+        entry.info.headerSize = fields[7];
+        entry.info.paletteColors = fields[8];
+
+        // 3. 画像を走査した場合と同じ範囲か確認（壊れた・手で編集した値は使わない）
+        if (fields[0] <= 0 || fields[1] <= 0 || fields[2] < 0 || fields[3] < 0 || fields[3] > 32 ||
+            fields[4] < 0 || fields[6] <= 0 || fields[7] < 0 || fields[8] < 0 || fields[8] > 256 ||
+            !validateBMPInfo(entry.info)) {
+            Serial.printf("  マニフェストの値が不正です: %s\n", entry.path.c_str());
+            invalidAssets++;
+            continue;
+        }
+        entries.push_back(entry);
+    }
+    panelMetrics.addFlashRead(METRICS_SRC_CSV, file.position());
+    file.close();
+
+    // 4. パス順に並べる（ツールで並べ済みでも念のため）
+    sortEntries();
+    Serial.printf("マニフェスト読み込み: %u 件 / 無効 %u 件 (%s)\n",
+                  (unsigned)entries.size(), (unsigned)invalidAssets, manifestPath);
+    return !entries.empty();
+}
+
+/**
+ * @brief CSV カタログが参照している画像がすべてマニフェストにあるか確認する
+ * @param csvPath 確認する CSV ファイルのパス
+ * @return 見つからなかった画像の数
+ */
+size_t AssetManifest::verifyCatalog(const char *csvPath) const {
+    File file = LittleFS.open(csvPath, "r");
+    if (!file) {
+        Serial.printf("CSVファイル %s を開けませんでした。\n", csvPath);
+        return 0;
+    }
+
+    size_t missing = 0;
+    while (file.available()) {
+        String line = file.readStringUntil('\n');
+        line.trim();
+
+        // `/img/` で始まる列を画像パスとみなして確認する
+        int start = 0;
+        while (start <= (int)line.length()) {
+            int end = line.indexOf(',', start);
+            if (end == -1) end = line.length();
+            String field = line.substring(start, end);
+            if (field.startsWith("/img/") && !find(field)) {
+                Serial.printf("  %s: 画像が見つからないか無効です: %s\n", csvPath, field.c_str());
+                missing++;
+            }
+            start = end + 1;
+        }
+    }
+    file.close();
+    return missing;
+}
+
+/**
+ * @brief 画像の検証済みヘッダー情報を取得する（二分探索）
+ * @param path 画像のパス
+ * @return 見つかった場合はヘッダー情報 / 存在しない・無効な画像の場合は nullptr
+ */
+const BMPInfo *AssetManifest::find(const String &path) const {
+    size_t lo = 0, hi = entries.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(entries[mid].path.c_str(), path.c_str());
+        if (cmp == 0) return &entries[mid].info;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 画像 1 枚分のエントリを作り直す（アップロードなどでファイルを置き換えた後に呼ぶ）
+ *
+ * ヘッダーを読み直し、有効なら追加・更新し、削除された・無効な画像はエントリから取り除く。
+ * マニフェストが未作成の場合は何もしない（画像の読み込み時にヘッダーを都度解析するため）。
+ *
+ * @param path 画像のパス
+ */
+void AssetManifest::update(const String &path) {
+    if (!isReady()) return;
+
+    // 1. ヘッダーを読み直す
+    AssetEntry entry;
+    entry.path = path;
+    File file = LittleFS.open(path, "r");
+    bool valid = file && readBMPInfo(file, entry.info);
+    file.close();
+
+    // 2. パス順の位置を探し、置き換え・追加・削除
+    auto it = std::lower_bound(entries.begin(), entries.end(), path, [](const AssetEntry &a, const String &key) {
+        return strcmp(a.path.c_str(), key.c_str()) < 0;
+    });
+    bool exists = it != entries.end() && it->path == path;
+    if (valid && exists) {
+        it->info = entry.info;
+    } else if (valid) {
+        entries.insert(it, entry);
+    } else if (exists) {
+        entries.erase(it);
+    }
+}
+
+/**
+ * @brief マニフェストを破棄する
+ */
+void AssetManifest::clear() {
+    entries.clear();
+    entries.shrink_to_fit();
+    invalidAssets = 0;
+}
+
+// エントリをパス順に並べる
+void AssetManifest::sortEntries() {
+    std::sort(entries.begin(), entries.end(), [](const AssetEntry &a, const AssetEntry &b) {
+        return strcmp(a.path.c_str(), b.path.c_str()) < 0;
+    });
+}
@@ -0,0 +1,120 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef ASSETMANIFEST_H
+#define ASSETMANIFEST_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>   // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"  // ESP32 の LittleFS を使用するためのライブラリ
+#include "BMPDecoder.h" // BMP ヘッダーの検証（BMPInfo）
+#include <vector>      // マニフェストのエントリ一覧
+
+// ===============================
+//      マニフェスト設定
+// ===============================
+#define ASSET_ROOT_DIR "/img"                // 起動時に走査する画像フォルダ
+#define ASSET_MANIFEST_PATH "/manifest.csv"  // 事前生成したマニフェスト（tools/buildManifest.py で作成）
+
+/**
+ * @brief マニフェストの 1 エントリ（画像 1 枚分）
+ */
+struct AssetEntry {
+    String path;  // LittleFS 上のパス（例: /img/Next80x16/NoneN.bmp）
+    BMPInfo info; // 検証済みのヘッダー情報
+};
+
+// ===============================
+//      AssetManifest クラスの定義
+// ===============================
+/**
+ * @brief 画像ファイルのパスと検証済みヘッダー情報の対応表
+ *
+ * 起動時に 1 回だけ作成し、以降の画像読み込みではヘッダー解析を省略する。
+ * - `/manifest.csv` があればそれを読み込み、なければ `/img` 以下を走査して作成する
+ * - 存在しない・壊れている画像は起動時に判明する（`find()` が nullptr を返す）
+ * - 画像の幅・高さをフラッシュにアクセスせずに取得できる（レイアウト計算用）
+ *
+ * エントリはパス順に並べ、二分探索で検索する。
+ */
+class AssetManifest {
+public:
+    /**
+     * @brief マニフェストを用意する（事前生成ファイル → 走査の順に試す）
+     * @return 1 件以上のエントリを用意できた場合 true
+     */
+    bool begin();
+
+    /**
+     * @brief 指定フォルダ以下の BMP を走査してマニフェストを作成する
+     * @param rootDir 走査するフォルダ
+     * @return 1 件以上の有効な画像が見つかった場合 true
+     */
+    bool build(const char *rootDir = ASSET_ROOT_DIR);
+
+    /**
+     * @brief 事前生成したマニフェスト（CSV）を読み込む
+     * @param manifestPath マニフェストのパス
+     * @return 読み込みに成功した場合 true
+     */
+    bool load(const char *manifestPath = ASSET_MANIFEST_PATH);
+
+    /**
+     * @brief CSV カタログが参照している画像がすべてマニフェストにあるか確認する
+     *
+     * `/img/` で始まる列を画像パスとみなし、見つからないものをシリアル出力する。
+     *
+     * @param csvPath 確認する CSV ファイルのパス
+     * @return 見つからなかった画像の数
+     */
+    size_t verifyCatalog(const char *csvPath) const;
+
+    /**
+     * @brief 画像の検証済みヘッダー情報を取得する
+     * @param path 画像のパス
+     * @return 見つかった場合はヘッダー情報 / 存在しない・無効な画像の場合は nullptr
+     */
+    const BMPInfo *find(const String &path) const;
+
+    /**
+     * @brief 画像 1 枚分のエントリを作り直す（アップロードなどでファイルを置き換えた後に呼ぶ）
+     * @param path 画像のパス
+     */
+    void update(const String &path);
+
+    /**
+     * @brief マニフェストが用意済みか（未作成の場合は従来どおりヘッダーを都度解析する）
+     */
+    bool isReady() const { return !entries.empty(); }
+
+    size_t size() const { return entries.size(); }           // 有効な画像の数
+    size_t invalidCount() const { return invalidAssets; }    // 無効だった画像の数
+
+    /**
+     * @brief マニフェストを破棄する
+     */
+    void clear();
+
+private:
+    std::vector<AssetEntry> entries; // パス順に並べたエントリ
+    size_t invalidAssets = 0;        // 走査時に無効と判定した画像の数
+
+    void scanDirectory(File &dir);
+    void sortEntries();
+};
+
+extern AssetManifest assetManifest; // 全体で共有するマニフェスト
+
+#endif // ASSETMANIFEST_H
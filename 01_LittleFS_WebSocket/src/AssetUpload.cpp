@@ -0,0 +1,471 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "AssetUpload.h"
+#include "BMPDecoder.h"
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+AssetUpload assetUpload;
+
+// CRC32 の 4 ビット単位の表（多項式 0xEDB88320）
+static const uint32_t crcNibbleTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/**
+ * @brief ファイル 1 つの受信を開始する
+ * @param path 書き込み先のパス
+ * @param crcHex 送信側で計算した CRC32（16 進数の文字列、必須）
+ * @return 開始できた場合 true（CRC32 が無い・読めない場合は受信しない）
+ */
+bool AssetUpload::beginFile(const String &path, const String &crcHex) {
+    if (!start(false)) return false;
+    if (!isValidPath(path)) {
+        return fail("invalid path: " + path);
+    }
+    // 検証できないファイルは受け付けない（パックと同じく、壊れたファイルで置き換えないため）
+    char *end = nullptr;
+    uint32_t expectedCrc = strtoul(crcHex.c_str(), &end, 16);
+    if (crcHex.length() == 0 || crcHex.length() > 8 || *end != '\0') {
+        return fail("missing or invalid crc32: " + path);
+    }
+    return openStaged(path, 0, expectedCrc);
+}
+
+/**
+ * @brief パック（複数ファイル）の受信を開始する
+ * @return 開始できた場合 true
+ */
+bool AssetUpload::beginPack() {
+    return start(true);
+}
+
+/**
+ * @brief 受信したデータを書き込む（HTTP の受信単位ごとに呼ぶ）
+ * @param data 受信したデータ
+ * @param length バイト数
+ * @return 失敗した場合 false（以降のデータは無視する）
+ */
+bool AssetUpload::write(const uint8_t *data, size_t length) {
+    if (uploadState != UPLOAD_RECEIVING) return false;
+    receivedBytes += length;
+    return pack ? writePack(data, length) : writeStaged(data, length);
+}
+
+/**
+ * @brief 受信を終了し、すべてのファイルを検証する
+ * @return すべて正しく受信できた場合 true（`UPLOAD_STAGED` になる）
+ */
+bool AssetUpload::finish() {
+    if (uploadState != UPLOAD_RECEIVING) return false;
+
+    // 1. パックは最後のファイルまで受信できているか確認
+    if (pack && field != PACK_DONE) {
+        return fail("truncated pack");
+    }
+
+    // 2. 単独のファイルはここで閉じて検証（パックは 1 件ごとに検証済み）
+    if (!pack && !closeStaged()) {
+        return false;
+    }
+    free(chunk);
+    chunk = nullptr;
+    uploadState = UPLOAD_STAGED;
+    Serial.printf("アップロード: %u 件 / %u バイトを受信しました。\n", (unsigned)files.size(), (unsigned)receivedBytes);
+    return true;
+}
+
+/**
+ * @brief 受信を中止し、一時ファイルを削除する（受信中の場合のみ）
+ *
+ * 検証済み（`commit()` 待ち）のファイルはパネル制御タスクが扱うため、ここでは削除しない。
+ *
+ * @param reason 中止の理由（`error()` で取得）
+ */
+void AssetUpload::abort(const String &reason) {
+    if (uploadState == UPLOAD_RECEIVING) {
+        fail(reason);
+    }
+}
+
+/**
+ * @brief 検証済みのファイルをまとめて正式なパスへ置き換える（パネル制御タスクから呼ぶ）
+ *
+ * 1. 置き換えるファイルの一覧（書き込み先と退避先）を `UPLOAD_JOURNAL_PATH` に書く
+ * 2. 既存のファイルを一時フォルダへ退避する
+ * 3. 受信したファイルを正式なパスへ名前を変更する
+ * 4. 一覧を削除して確定し、退避したファイルを削除する
+ *
+ * 途中で失敗した場合は、置き換えたファイルを削除して退避したファイルを戻す（パックの一部だけが新しくならない）。
+ *
+ * @param committed 置き換えたファイルのパス（失敗した場合は空のまま）
+ * @return すべて置き換えた場合 true（false の場合は既存のファイルを元に戻し、1 つも置き換えない）
+ */
+bool AssetUpload::commit(std::vector<String> &committed) {
+    TRACE_SCOPE("uploadCommit");
+    if (uploadState != UPLOAD_STAGED) return false;
+
+    // 1. 置き換えるファイルの一覧を書く（退避先が空の行は、元のファイルが無かったことを表す）
+    std::vector<String> targets, backups;
+    bool ok = true;
+    File journal = LittleFS.open(UPLOAD_JOURNAL_PATH, "w");
+    for (const StagedFile &file : files) {
+        String backup = LittleFS.exists(file.path) ? file.stagingPath + ".old" : String("");
+        if (!ensureParentDirs(file.path)) ok = false;
+        String line = file.path + "," + backup + "\n";
+        if (journal && journal.write((const uint8_t *)line.c_str(), line.length()) != line.length()) ok = false;
+        targets.push_back(file.path);
+        backups.push_back(backup);
+    }
+    if (!journal) ok = false;
+    journal.close();
+
+    // 2. 既存のファイルを退避する（失敗した場合は、それまでに退避した分を戻す）
+    size_t moved = 0;
+    for (; ok && moved < files.size(); moved++) {
+        if (backups[moved].length() > 0 && !LittleFS.rename(targets[moved], backups[moved])) {
+            Serial.printf("アップロード: %s を退避できませんでした。\n", targets[moved].c_str());
+            ok = false;
+            break;
+        }
+    }
+
+    // 3. 受信したファイルを正式なパスへ
+    for (size_t i = 0; ok && i < files.size(); i++) {
+        if (!LittleFS.rename(files[i].stagingPath, files[i].path)) {
+            Serial.printf("アップロード: %s を置き換えられませんでした。\n", files[i].path.c_str());
+            ok = false;
+        }
+    }
+
+    // 4. 確定（一覧を削除）、または元に戻す
+    if (ok) {
+        LittleFS.remove(UPLOAD_JOURNAL_PATH);
+        committed.insert(committed.end(), targets.begin(), targets.end());
+    } else {
+        targets.resize(moved == files.size() ? files.size() : moved); // 退避まで済んだ分（置き換えを始めた場合はすべて）
+        backups.resize(targets.size());
+        rollback(targets, backups);
+        LittleFS.remove(UPLOAD_JOURNAL_PATH);
+        Serial.println("アップロード: 置き換えを中止し、既存のファイルを元に戻しました。");
+    }
+    for (size_t i = 0; i < files.size(); i++) {
+        LittleFS.remove(files[i].stagingPath);
+        LittleFS.remove(files[i].stagingPath + ".old");
+    }
+    files.clear();
+    uploadState = UPLOAD_IDLE;
+    return ok;
+}
+
+/**
+ * @brief 置き換えを元に戻す（新しいファイルを削除し、退避したファイルを戻す）
+ * @param targets 書き込み先のパス
+ * @param backups 退避先のパス（空の場合は元のファイルが無かった）
+ */
+void AssetUpload::rollback(const std::vector<String> &targets, const std::vector<String> &backups) {
+    for (size_t i = targets.size(); i-- > 0;) {
+        if (backups[i].length() == 0) {
+            LittleFS.remove(targets[i]); // 元は無かったファイル
+        } else if (LittleFS.exists(backups[i])) {
+            LittleFS.remove(targets[i]);
+            LittleFS.rename(backups[i], targets[i]);
+        }
+    }
+}
+
+/**
+ * @brief 検証済みのファイルに指定のパスが含まれるか（置き換え前に閉じておくファイルの確認用）
+ */
+bool AssetUpload::isStaged(const String &path) const {
+    if (uploadState != UPLOAD_STAGED) return false;
+    for (const StagedFile &file : files) {
+        if (file.path == path) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 前回の受信で残った一時ファイルを削除する（起動時に呼ぶ）
+ */
+void AssetUpload::cleanupStaging() {
+    // 1. 置き換えの途中で止まっていた場合は、一覧から元に戻す
+    File journal = LittleFS.open(UPLOAD_JOURNAL_PATH, "r");
+    if (journal) {
+        std::vector<String> targets, backups;
+        while (journal.available()) {
+            String line = journal.readStringUntil('\n');
+            int comma = line.indexOf(',');
+            if (comma <= 0) continue;
+            targets.push_back(line.substring(0, comma));
+            backups.push_back(line.substring(comma + 1));
+        }
+        journal.close();
+        rollback(targets, backups);
+        Serial.printf("アップロード: 前回の置き換えが途中で止まっていたため %u 件を元に戻しました。\n", (unsigned)targets.size());
+    }
+
+    // 2. 一時ファイルを削除
+    File dir = LittleFS.open(UPLOAD_STAGING_DIR, "r");
+    if (!dir || !dir.isDirectory()) return;
+    std::vector<String> leftovers;
+    File file = dir.openNextFile();
+    while (file) {
+        leftovers.push_back(String(UPLOAD_STAGING_DIR) + "/" + file.name());
+        file.close();
+        file = dir.openNextFile();
+    }
+    dir.close();
+    for (const String &path : leftovers) {
+        LittleFS.remove(path);
+    }
+}
+
+/**
+ * @brief 書き込み先として使えるパスか（`/` で始まり、`..` や一時フォルダを含まない）
+ */
+bool AssetUpload::isValidPath(const String &path) {
+    return path.startsWith("/") && !path.endsWith("/") &&
+           path.length() < UPLOAD_PATH_MAX &&
+           path.indexOf("..") == -1 && path.indexOf("//") == -1 &&
+           !path.startsWith(UPLOAD_STAGING_DIR);
+}
+
+/**
+ * @brief CRC32（zlib と同じ多項式・初期値）を計算する
+ * @param crc これまでの値（最初は 0）
+ * @param data データ
+ * @param length バイト数
+ * @return 続きを含めた CRC32
+ */
+uint32_t AssetUpload::crc32(uint32_t crc, const uint8_t *data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = crcNibbleTable[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = crcNibbleTable[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// 受信を開始する（前回の受信が残っていれば破棄する）
+bool AssetUpload::start(bool isPack) {
+    discard();
+    errorMessage = "";
+    receivedBytes = 0;
+    pack = isPack;
+    field = PACK_HEADER;
+    fieldUsed = 0;
+    chunkUsed = 0;
+    chunk = (uint8_t *)malloc(UPLOAD_WRITE_CHUNK);
+    if (!chunk) {
+        uploadState = UPLOAD_FAILED;
+        errorMessage = "out of memory";
+        return false;
+    }
+    if (!LittleFS.exists(UPLOAD_STAGING_DIR)) {
+        LittleFS.mkdir(UPLOAD_STAGING_DIR);
+    }
+    uploadState = UPLOAD_RECEIVING;
+    return true;
+}
+
+// パックを読み取りながら各ファイルを一時フォルダへ書き込む
+bool AssetUpload::writePack(const uint8_t *data, size_t length) {
+    while (length > 0 && uploadState == UPLOAD_RECEIVING) {
+        switch (field) {
+        case PACK_HEADER: {
+            // 1. ヘッダー（識別子とファイル数）
+            if (!collect(data, length, sizeof(UploadPackHeader))) break;
+            UploadPackHeader header;
+            memcpy(&header, fieldBuffer, sizeof(header));
+            if (memcmp(header.magic, "LPK1", 4) != 0 || header.fileCount == 0 || header.fileCount > UPLOAD_MAX_FILES) {
+                return fail("invalid pack header");
+            }
+            filesLeft = header.fileCount;
+            field = PACK_PATH_LENGTH;
+            break;
+        }
+        case PACK_PATH_LENGTH:
+            // 2. パスの長さ
+            if (!collect(data, length, 2)) break;
+            pathLength = fieldBuffer[0] | (fieldBuffer[1] << 8);
+            if (pathLength == 0 || pathLength >= UPLOAD_PATH_MAX) {
+                return fail("invalid path length");
+            }
+            field = PACK_PATH;
+            break;
+        case PACK_PATH: {
+            // 3. パス（サイズ・CRC32 を読み取るまで保持）
+            if (!collect(data, length, pathLength)) break;
+            fieldBuffer[pathLength] = '\0';
+            String path((const char *)fieldBuffer);
+            if (!isValidPath(path)) {
+                return fail("invalid path: " + path);
+            }
+            for (const StagedFile &file : files) {
+                if (file.path == path) return fail("duplicate path: " + path);
+            }
+            pendingPath = path;
+            field = PACK_SIZE_CRC;
+            break;
+        }
+        case PACK_SIZE_CRC: {
+            // 4. サイズと CRC32 を読み取り、一時ファイルを開く
+            if (!collect(data, length, 8)) break;
+            uint32_t size, crc;
+            memcpy(&size, fieldBuffer, 4);
+            memcpy(&crc, fieldBuffer + 4, 4);
+            if (!openStaged(pendingPath, size, crc)) return false;
+            field = PACK_DATA;
+            if (size == 0 && !closePackEntry()) return false; // 空のファイル
+            break;
+        }
+        case PACK_DATA: {
+            // 5. データを書き込み、最後まで受信したら検証
+            StagedFile &file = files.back();
+            size_t take = min((size_t)(file.size - file.written), length);
+            if (!writeStaged(data, take)) return false;
+            data += take;
+            length -= take;
+            if (file.written == file.size && !closePackEntry()) return false;
+            break;
+        }
+        case PACK_DONE:
+            return fail("unexpected data after pack");
+        }
+    }
+    return uploadState == UPLOAD_RECEIVING;
+}
+
+// パックの 1 ファイル分を閉じて検証し、次のファイル（または終端）へ進む
+bool AssetUpload::closePackEntry() {
+    if (!closeStaged()) return false;
+    field = (--filesLeft == 0) ? PACK_DONE : PACK_PATH_LENGTH;
+    return true;
+}
+
+// パックの項目を fieldBuffer に集める（集まった場合 true、data / length は読んだ分だけ進める）
+bool AssetUpload::collect(const uint8_t *&data, size_t &length, size_t needed) {
+    size_t take = min(needed - fieldUsed, length);
+    memcpy(fieldBuffer + fieldUsed, data, take);
+    fieldUsed += take;
+    data += take;
+    length -= take;
+    if (fieldUsed < needed) return false;
+    fieldUsed = 0;
+    return true;
+}
+
+// 一時ファイルを開き、受信するファイルとして登録する
+bool AssetUpload::openStaged(const String &path, uint32_t size, uint32_t expectedCrc) {
+    StagedFile file;
+    file.path = path;
+    file.stagingPath = String(UPLOAD_STAGING_DIR) + "/" + String((unsigned)files.size()) + ".part";
+    file.size = size;
+    file.expectedCrc = expectedCrc;
+    out = LittleFS.open(file.stagingPath, "w");
+    if (!out) {
+        return fail("cannot create " + file.stagingPath);
+    }
+    files.push_back(file);
+    chunkUsed = 0;
+    return true;
+}
+
+// 受信データを UPLOAD_WRITE_CHUNK 単位にまとめて一時ファイルへ書き込む
+bool AssetUpload::writeStaged(const uint8_t *data, size_t length) {
+    StagedFile &file = files.back();
+    file.crc = crc32(file.crc, data, length);
+    file.written += length;
+    while (length > 0) {
+        size_t take = min((size_t)UPLOAD_WRITE_CHUNK - chunkUsed, length);
+        memcpy(chunk + chunkUsed, data, take);
+        chunkUsed += take;
+        data += take;
+        length -= take;
+        if (chunkUsed == UPLOAD_WRITE_CHUNK) {
+            if (out.write(chunk, chunkUsed) != chunkUsed) {
+                return fail("write failed (no space?): " + file.path);
+            }
+            chunkUsed = 0;
+        }
+    }
+    return true;
+}
+
+// 残りのデータを書き込んで閉じ、CRC32 と BMP のヘッダーを検証する
+bool AssetUpload::closeStaged() {
+    StagedFile &file = files.back();
+    if (chunkUsed > 0 && out.write(chunk, chunkUsed) != chunkUsed) {
+        return fail("write failed (no space?): " + file.path);
+    }
+    chunkUsed = 0;
+    out.close();
+
+    // 1. CRC32
+    if (file.crc != file.expectedCrc) {
+        char message[96];
+        snprintf(message, sizeof(message), "crc mismatch: %s (expected %08x, got %08x)",
+                 file.path.c_str(), (unsigned)file.expectedCrc, (unsigned)file.crc);
+        return fail(message);
+    }
+
+    // 2. BMP は表示できる形式か（マニフェストと同じ条件）
+    if (file.path.endsWith(".bmp")) {
+        File staged = LittleFS.open(file.stagingPath, "r");
+        BMPInfo info;
+        bool valid = staged && readBMPInfo(staged, info);
+        staged.close();
+        if (!valid) {
+            return fail("invalid bmp: " + file.path);
+        }
+    }
+    return true;
+}
+
+// 受信を失敗として終了する（一時ファイルはすべて削除）
+bool AssetUpload::fail(const String &reason) {
+    Serial.printf("アップロードを中止しました: %s\n", reason.c_str());
+    discard();
+    errorMessage = reason;
+    uploadState = UPLOAD_FAILED;
+    return false;
+}
+
+// 一時ファイルと作業用のメモリを破棄する
+void AssetUpload::discard() {
+    if (out) out.close();
+    for (const StagedFile &file : files) {
+        LittleFS.remove(file.stagingPath);
+    }
+    files.clear();
+    free(chunk);
+    chunk = nullptr;
+    chunkUsed = 0;
+    uploadState = UPLOAD_IDLE;
+}
+
+// 書き込み先のフォルダが無ければ作成する（例: /font/default.lfn の /font）
+bool AssetUpload::ensureParentDirs(const String &path) {
+    for (int slash = path.indexOf('/', 1); slash != -1; slash = path.indexOf('/', slash + 1)) {
+        String dir = path.substring(0, slash);
+        if (!LittleFS.exists(dir) && !LittleFS.mkdir(dir)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,197 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef ASSETUPLOAD_H
+#define ASSETUPLOAD_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>    // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"   // ESP32 の LittleFS を使用するためのライブラリ
+#include <vector>       // 受信中・受信済みのファイル一覧
+
+// ===============================
+//      アップロードの設定
+// ===============================
+#define UPLOAD_STAGING_DIR "/.staging" // 受信中のファイルを置くフォルダ（起動時に中身を削除）
+#define UPLOAD_JOURNAL_PATH UPLOAD_STAGING_DIR "/commit.lst" // 置き換え中のファイルの一覧（途中で電源が切れた場合の復元用）
+#define UPLOAD_PATH_MAX 64             // 書き込み先のパスの最大長（終端を含む）
+#define UPLOAD_MAX_FILES 256           // 1 回のアップロード（パック）に含められるファイル数の上限
+#define UPLOAD_WRITE_CHUNK 4096        // LittleFS へ書き込む単位（受信データはこの大きさに貯めてから書き込む）
+
+/**
+ * @brief 複数ファイルをまとめたパック（tools/makePack.py で作成）のヘッダー（リトルエンディアン）
+ *
+ * ヘッダーの後に、各ファイルを `{ uint16 パスの長さ, パス, uint32 サイズ, uint32 CRC32, データ }` の形で
+ * `fileCount` 件続ける。
+ */
+struct __attribute__((packed)) UploadPackHeader {
+    char magic[4];       // "LPK1"
+    uint32_t fileCount;  // ファイル数
+};
+
+/**
+ * @brief アップロードの状態
+ */
+enum UploadState {
+    UPLOAD_IDLE = 0, // 受信していない
+    UPLOAD_RECEIVING, // 受信中（一時フォルダへ書き込み中）
+    UPLOAD_STAGED,    // すべて受信・検証済み（`commit()` 待ち）
+    UPLOAD_FAILED     // 失敗（一時ファイルは削除済み、`error()` に理由）
+};
+
+// ===============================
+//      AssetUpload クラスの定義
+// ===============================
+/**
+ * @brief 画像・CSV などを HTTP で受信して LittleFS に書き込むクラス
+ *
+ * 受信したデータは `UPLOAD_WRITE_CHUNK` 単位で一時フォルダのファイルへ書き込み、ファイル全体をメモリに置かない。
+ * 受信が終わったら CRC32（BMP の場合はヘッダーも）を検証し、すべて正しい場合のみ `commit()` で
+ * 正式なパスへ名前を変更する。パックはすべてのファイルを置き換えるか、1 つも置き換えないかのどちらかになる
+ * （既存のファイルを退避してから置き換え、失敗した場合は退避したファイルを戻す。
+ * 途中で電源が切れた場合は、起動時の `cleanupStaging()` が一覧（`UPLOAD_JOURNAL_PATH`）から元に戻す）。
+ *
+ * 受信は Web サーバーのタスク、`commit()` はパネル制御タスクで行う（描画中のファイルを置き換えないため）。
+ * 両者は同時に操作しない（サーバー側は `commit()` の完了を待ってから次の受信を始める）。
+ */
+class AssetUpload {
+public:
+    /**
+     * @brief ファイル 1 つの受信を開始する
+     * @param path 書き込み先のパス
+     * @param crcHex 送信側で計算した CRC32（16 進数の文字列、必須）
+     * @return 開始できた場合 true（CRC32 が無い・読めない場合は受信しない）
+     */
+    bool beginFile(const String &path, const String &crcHex);
+
+    /**
+     * @brief パック（複数ファイル）の受信を開始する
+     * @return 開始できた場合 true
+     */
+    bool beginPack();
+
+    /**
+     * @brief 受信したデータを書き込む（HTTP の受信単位ごとに呼ぶ）
+     * @param data 受信したデータ
+     * @param length バイト数
+     * @return 失敗した場合 false（以降のデータは無視する）
+     */
+    bool write(const uint8_t *data, size_t length);
+
+    /**
+     * @brief 受信を終了し、すべてのファイルを検証する
+     * @return すべて正しく受信できた場合 true（`UPLOAD_STAGED` になる）
+     */
+    bool finish();
+
+    /**
+     * @brief 受信を中止し、一時ファイルを削除する（受信中の場合のみ）
+     * @param reason 中止の理由（`error()` で取得）
+     */
+    void abort(const String &reason);
+
+    /**
+     * @brief 検証済みのファイルをまとめて正式なパスへ置き換える（パネル制御タスクから呼ぶ）
+     * @param committed 置き換えたファイルのパス（失敗した場合は空のまま）
+     * @return すべて置き換えた場合 true（false の場合は既存のファイルを元に戻し、1 つも置き換えない）
+     */
+    bool commit(std::vector<String> &committed);
+
+    /**
+     * @brief 検証済みのファイルに指定のパスが含まれるか（置き換え前に閉じておくファイルの確認用）
+     */
+    bool isStaged(const String &path) const;
+
+    /**
+     * @brief 前回の受信で残った一時ファイルを削除する（起動時に呼ぶ、置き換えの途中で止まっていた場合は元に戻す）
+     */
+    static void cleanupStaging();
+
+    /**
+     * @brief 書き込み先として使えるパスか（`/` で始まり、`..` や一時フォルダを含まない）
+     */
+    static bool isValidPath(const String &path);
+
+    /**
+     * @brief CRC32（zlib と同じ多項式・初期値）を計算する
+     * @param crc これまでの値（最初は 0）
+     * @param data データ
+     * @param length バイト数
+     * @return 続きを含めた CRC32
+     */
+    static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length);
+
+    UploadState state() const { return uploadState; }
+    const String &error() const { return errorMessage; }
+    size_t fileCount() const { return files.size(); }
+    uint32_t bytesReceived() const { return receivedBytes; }
+
+private:
+    /**
+     * @brief 受信したファイル 1 つ分
+     */
+    struct StagedFile {
+        String path;              // 書き込み先のパス
+        String stagingPath;       // 一時ファイルのパス
+        uint32_t size = 0;        // 受信すべきバイト数（パックの場合のみ）
+        uint32_t written = 0;     // 受信したバイト数
+        uint32_t expectedCrc = 0; // 送信側の CRC32
+        uint32_t crc = 0;         // 受信したデータの CRC32
+    };
+
+    /**
+     * @brief パックの読み取り位置
+     */
+    enum PackField {
+        PACK_HEADER = 0,  // UploadPackHeader
+        PACK_PATH_LENGTH, // パスの長さ
+        PACK_PATH,        // パス
+        PACK_SIZE_CRC,    // サイズと CRC32
+        PACK_DATA,        // ファイルのデータ
+        PACK_DONE         // すべて読み取った
+    };
+
+    UploadState uploadState = UPLOAD_IDLE;
+    String errorMessage;
+    std::vector<StagedFile> files;
+    File out;                      // 書き込み中の一時ファイル
+    uint8_t *chunk = nullptr;      // 書き込み前のデータ（UPLOAD_WRITE_CHUNK バイト）
+    size_t chunkUsed = 0;
+    uint32_t receivedBytes = 0;
+
+    bool pack = false;
+    PackField field = PACK_HEADER;
+    uint8_t fieldBuffer[UPLOAD_PATH_MAX];
+    size_t fieldUsed = 0;
+    uint16_t pathLength = 0;
+    String pendingPath;            // サイズ・CRC32 を読み取り中のファイルのパス
+    uint32_t filesLeft = 0;
+
+    bool start(bool isPack);
+    bool writePack(const uint8_t *data, size_t length);
+    bool closePackEntry();
+    bool collect(const uint8_t *&data, size_t &length, size_t needed);
+    bool openStaged(const String &path, uint32_t size, uint32_t expectedCrc);
+    bool writeStaged(const uint8_t *data, size_t length);
+    bool closeStaged();
+    bool fail(const String &reason);
+    void discard();
+    static bool ensureParentDirs(const String &path);
+    static void rollback(const std::vector<String> &targets, const std::vector<String> &backups);
+};
+
+extern AssetUpload assetUpload; // 全体で共有するアップロード処理
+
+#endif // ASSETUPLOAD_H
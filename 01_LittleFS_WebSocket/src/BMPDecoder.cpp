@@ -0,0 +1,589 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "BMPDecoder.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
+
+// リトルエンディアンの 16 / 32 ビット値を読み取る（アライメント非依存）
+static uint16_t readLE16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+static uint32_t readLE32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// RGB888 を RGB565 に変換（MatrixPanel_I2S_DMA::color565 と同じ計算）
+static inline uint16_t toRGB565(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+/**
+ * @brief BMP ヘッダーを読み取り、表示可能な形式か検証する
+ *
+ * 1. ファイルヘッダー（14 バイト）と情報ヘッダー（40 バイト）を読み取る
+ * 2. シグネチャ `BM`・情報ヘッダーのサイズ・画像サイズを確認
+ * 3. 色深度と圧縮形式の組み合わせを確認
+ * 4. カラーパレット・ビットマスクがピクセルデータより前に収まっているか確認
+ * 5. ピクセルデータがファイル内に収まっているか確認
+ *
+ * @param file BMPファイルの参照（先頭から読み込む）
+ * @param info 検証済みのヘッダー情報の格納先
+ * @return 表示可能な BMP なら true / それ以外は false（理由をシリアル出力）
+ */
+bool readBMPInfo(File &file, BMPInfo &info) {
+    // 1. ヘッダーを読み取る
+    uint8_t header[54];
+    size_t headerBytes = file.read(header, sizeof(header));
+    panelMetrics.addFlashRead(METRICS_SRC_BMP, headerBytes);
+    if (headerBytes != sizeof(header)) {
+        Serial.println("BMPヘッダーの読み込みに失敗しました。");
+        return false;
+    }
+
+    // 2. シグネチャと画像サイズ
+    if (header[0] != 'B' || header[1] != 'M') {
+        Serial.println("BMPファイルではありません。");
+        return false;
+    }
+    uint32_t dibSize = readLE32(&header[14]);
+    int32_t width = (int32_t)readLE32(&header[18]);
+    int32_t height = (int32_t)readLE32(&header[22]);
+    if (dibSize < 40 || readLE16(&header[26]) != 1) {
+        Serial.println("未対応の BMP 情報ヘッダーです。");
+        return false;
+    }
+    if (width <= 0 || width > BMP_MAX_DIMENSION || height == 0 ||
+        height < -BMP_MAX_DIMENSION || height > BMP_MAX_DIMENSION) {
+        Serial.printf("BMPの画像サイズが不正です (%ld x %ld)。\n", (long)width, (long)height);
+        return false;
+    }
+
+    info.width = width;
+    info.height = height < 0 ? -height : height;
+    info.isTopDown = height < 0;
+    info.pixelDataOffset = readLE32(&header[10]);
+    info.bitsPerPixel = readLE16(&header[28]);
+    info.compression = readLE32(&header[30]);
+    info.fileSize = file.size();
+    info.headerSize = dibSize;
+    info.paletteColors = 0;
+    if (info.bitsPerPixel <= 8) {
+        uint32_t colors = readLE32(&header[46]);
+        uint32_t maxColors = 1u << info.bitsPerPixel;
+        info.paletteColors = (colors == 0 || colors > maxColors) ? maxColors : colors;
+    }
+
+    // 3～5. 形式・パレット・ピクセルデータの範囲（RLE は圧縮後のサイズで確認）
+    bool isRLE = info.compression == BMP_BI_RLE8 || info.compression == BMP_BI_RLE4;
+    return validateBMPInfo(info, isRLE ? readLE32(&header[34]) : 0);
+}
+
+/**
+ * @brief ヘッダー情報が表示可能な範囲に収まっているか検証する
+ *
+ * `readBMPInfo()` と同じ条件で、マニフェストから読み込んだ情報も確認する（壊れた・手で編集した
+ * マニフェストの値をそのままメモリ確保やデコードに使わないため）。
+ *
+ * 1. 画像サイズと情報ヘッダーのサイズ
+ * 2. 色深度と圧縮形式の組み合わせ
+ * 3. カラーパレット・ビットマスクがピクセルデータより前に収まっているか
+ * 4. ピクセルデータがファイル内に収まっているか
+ *
+ * @param info 確認するヘッダー情報
+ * @param rleBytes RLE の圧縮後のサイズ（不明な場合は 0、開始位置のみ確認）
+ * @return 表示可能なら true / それ以外は false（理由をシリアル出力）
+ */
+bool validateBMPInfo(const BMPInfo &info, uint32_t rleBytes) {
+    // 1. 画像サイズと情報ヘッダーのサイズ
+    if (info.width <= 0 || info.width > BMP_MAX_DIMENSION || info.height <= 0 || info.height > BMP_MAX_DIMENSION) {
+        Serial.printf("BMPの画像サイズが不正です (%d x %d)。\n", info.width, info.height);
+        return false;
+    }
+    if (info.headerSize < 40 || info.headerSize >= info.fileSize) {
+        Serial.println("未対応の BMP 情報ヘッダーです。");
+        return false;
+    }
+
+    // 2. 色深度と圧縮形式の組み合わせ
+    bool supported;
+    switch (info.bitsPerPixel) {
+        case 1:  supported = info.compression == BMP_BI_RGB; break;
+        case 4:  supported = info.compression == BMP_BI_RGB || info.compression == BMP_BI_RLE4; break;
+        case 8:  supported = info.compression == BMP_BI_RGB || info.compression == BMP_BI_RLE8; break;
+        case 16:
+        case 32: supported = info.compression == BMP_BI_RGB || info.compression == BMP_BI_BITFIELDS; break;
+        case 24: supported = info.compression == BMP_BI_RGB; break;
+        default: supported = false; break;
+    }
+    bool isRLE = info.compression == BMP_BI_RLE8 || info.compression == BMP_BI_RLE4;
+    if (!supported || (isRLE && info.isTopDown)) {
+        Serial.printf("未対応の BMP 形式です (%u bit, 圧縮 %lu)。\n",
+                      (unsigned)info.bitsPerPixel, (unsigned long)info.compression);
+        return false;
+    }
+
+    // 3. カラーパレット / ビットマスクの位置（パレットの色数は色深度の範囲内）
+    uint64_t extraEnd = 14 + (uint64_t)info.headerSize;
+    if (info.bitsPerPixel <= 8) {
+        if (info.paletteColors == 0 || info.paletteColors > (1u << info.bitsPerPixel)) {
+            Serial.println("BMPのパレット / ビットマスクが不正です。");
+            return false;
+        }
+        extraEnd += (uint64_t)info.paletteColors * 4;
+    } else if (info.compression == BMP_BI_BITFIELDS && info.headerSize == 40) {
+        extraEnd += 12; // 情報ヘッダーの直後に R / G / B のマスクが続く
+    }
+    if (info.pixelDataOffset < extraEnd) {
+        Serial.println("BMPのパレット / ビットマスクが不正です。");
+        return false;
+    }
+
+    // 4. ピクセルデータの範囲
+    uint64_t pixelBytes = isRLE ? rleBytes : (uint64_t)info.rowSize() * info.height;
+    if (info.pixelDataOffset >= info.fileSize || info.pixelDataOffset + pixelBytes > info.fileSize) {
+        Serial.println("BMPのピクセルデータがファイルに収まっていません。");
+        return false;
+    }
+
+    return true;
+}
+
+// ===============================
+//      1 行分の変換処理（形式ごとの専用ループ）
+// ===============================
+
+/**
+ * @brief ビットマスク 1 色分（16 / 32 ビットの汎用処理用）
+ */
+struct BMPMaskChannel {
+    uint32_t mask = 0;  // マスク
+    uint8_t shift = 0;  // 最下位ビットの位置
+    uint8_t bits = 0;   // ビット数
+
+    void set(uint32_t m) {
+        mask = m;
+        shift = 0;
+        bits = 0;
+        if (!m) return;
+        while (!(m & 1)) { m >>= 1; shift++; }
+        while (m & 1) { m >>= 1; bits++; }
+    }
+
+    // 8 ビットに拡張した値を取り出す
+    uint8_t extract(uint32_t pixel) const {
+        if (!bits) return 0;
+        uint32_t v = (pixel & mask) >> shift;
+        if (bits >= 8) return (uint8_t)(v >> (bits - 8));
+        v <<= (8 - bits);
+        return (uint8_t)(v | (v >> bits)); // 下位ビットを上位ビットで埋める
+    }
+};
+
+/**
+ * @brief 行の変換方式
+ */
+enum BMPRowFormat {
+    ROW_PAL1,      // 1 ビット（パレット）
+    ROW_PAL4,      // 4 ビット（パレット）
+    ROW_PAL8,      // 8 ビット（パレット）
+    ROW_RGB555,    // 16 ビット（X1R5G5B5）
+    ROW_RGB565,    // 16 ビット（R5G6B5、そのままコピー）
+    ROW_BGR24,     // 24 ビット
+    ROW_BGRX32,    // 32 ビット（B8G8R8X8）
+    ROW_MASK16,    // 16 ビット（任意のビットマスク）
+    ROW_MASK32     // 32 ビット（任意のビットマスク）
+};
+
+static void convertRowPal1(const uint8_t *src, uint16_t *dst, int width, const uint16_t *lut) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8_t bits = *src++;
+        dst[x]     = lut[(bits >> 7) & 1];
+        dst[x + 1] = lut[(bits >> 6) & 1];
+        dst[x + 2] = lut[(bits >> 5) & 1];
+        dst[x + 3] = lut[(bits >> 4) & 1];
+        dst[x + 4] = lut[(bits >> 3) & 1];
+        dst[x + 5] = lut[(bits >> 2) & 1];
+        dst[x + 6] = lut[(bits >> 1) & 1];
+        dst[x + 7] = lut[bits & 1];
+    }
+    if (x < width) {
+        uint8_t bits = *src;
+        for (int i = 0; x < width; x++, i++) {
+            dst[x] = lut[(bits >> (7 - i)) & 1];
+        }
+    }
+}
+
+static void convertRowPal4(const uint8_t *src, uint16_t *dst, int width, const uint16_t *lut) {
+    int x = 0;
+    for (; x + 2 <= width; x += 2) {
+        uint8_t pair = *src++;
+        dst[x]     = lut[pair >> 4];
+        dst[x + 1] = lut[pair & 0x0F];
+    }
+    if (x < width) {
+        dst[x] = lut[*src >> 4];
+    }
+}
+
+static void convertRowPal8(const uint8_t *src, uint16_t *dst, int width, const uint16_t *lut) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = lut[src[x]];
+    }
+}
+
+static void convertRowRGB555(const uint8_t *src, uint16_t *dst, int width) {
+    for (int x = 0; x < width; x++) {
+        uint16_t v = readLE16(&src[x * 2]);
+        // 5 ビットの緑を 6 ビットに拡張する
+        dst[x] = (uint16_t)(((v & 0x7C00) << 1) | ((v & 0x03E0) << 1) | ((v & 0x0200) >> 4) | (v & 0x001F));
+    }
+}
+
+static void convertRowRGB565(const uint8_t *src, uint16_t *dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = readLE16(&src[x * 2]);
+    }
+}
+
+static void convertRowBGR24(const uint8_t *src, uint16_t *dst, int width) {
+    for (int x = 0; x < width; x++, src += 3) {
+        dst[x] = toRGB565(src[2], src[1], src[0]);
+    }
+}
+
+static void convertRowBGRX32(const uint8_t *src, uint16_t *dst, int width) {
+    for (int x = 0; x < width; x++, src += 4) {
+        dst[x] = toRGB565(src[2], src[1], src[0]);
+    }
+}
+
+static void convertRowMask(const uint8_t *src, uint16_t *dst, int width, int bytesPerPixel, const BMPMaskChannel *masks) {
+    for (int x = 0; x < width; x++, src += bytesPerPixel) {
+        uint32_t v = bytesPerPixel == 2 ? readLE16(src) : readLE32(src);
+        dst[x] = toRGB565(masks[0].extract(v), masks[1].extract(v), masks[2].extract(v));
+    }
+}
+
+// ===============================
+//      ピクセルデータの読み込み（チャンク単位）
+// ===============================
+
+// コアごとに 1 つ、起動時から確保しておく読み込みバッファ（同じコアで同時に行うデコードは 1 つまで）
+static uint8_t chunkBuffers[2][BMP_READ_CHUNK_BYTES];
+
+/**
+ * @brief ピクセルデータを `BMP_READ_CHUNK_BYTES` ずつまとめて読み込むリーダー（全形式で共用）
+ *
+ * 1 行ごとに `file.read()` を呼ぶ代わりに、複数行分をまとめて読み込み、バッファ上のデータをそのまま変換に使う。
+ * 行がバッファの末尾にかかる場合は、残りを先頭に移してから続きを読み込む。
+ * バッファはコアごとに静的に確保するため、画像の大きさに関わらずスタック・ヒープを使わない。
+ */
+struct BMPChunkReader {
+    File &file;
+    uint8_t *buffer;
+    size_t length = 0;    // バッファ内の有効なバイト数
+    size_t position = 0;  // 次に取り出す位置
+    uint32_t remaining;   // ピクセルデータの残りバイト数（まだ読み込んでいない分）
+    uint32_t bytesRead = 0;
+
+    BMPChunkReader(File &f, uint32_t size) : file(f), buffer(chunkBuffers[xPortGetCoreID() & 1]), remaining(size) {}
+
+    // 連続した n バイト（BMP_READ_CHUNK_BYTES 以下）を取り出す（足りない場合は nullptr）
+    const uint8_t *take(size_t n) {
+        if (length - position < n) {
+            // 1. 残りを先頭に移し、空いた分をまとめて読み込む
+            size_t left = length - position;
+            memmove(buffer, buffer + position, left);
+            length = left;
+            position = 0;
+            while (length < n && remaining > 0) {
+                size_t want = BMP_READ_CHUNK_BYTES - length;
+                if (want > remaining) want = remaining;
+                size_t got = file.read(buffer + length, want);
+                bytesRead += got;
+                if (got == 0) {
+                    remaining = 0;
+                    break;
+                }
+                remaining -= got;
+                length += got;
+            }
+            if (length < n) return nullptr;
+        }
+        const uint8_t *p = buffer + position;
+        position += n;
+        return p;
+    }
+
+    // n バイトを dest に読み込む（バッファより大きい行用、バッファの残りを使ってから直接読み込む）
+    bool read(uint8_t *dest, size_t n) {
+        size_t left = length - position;
+        size_t copied = left < n ? left : n;
+        memcpy(dest, buffer + position, copied);
+        position += copied;
+        if (copied == n) return true;
+        size_t want = n - copied;
+        if (want > remaining) return false;
+        size_t got = file.read(dest + copied, want);
+        bytesRead += got;
+        remaining -= got;
+        return got == want;
+    }
+
+    // 次の 1 バイトを返す（終端に達した場合は -1）
+    int next() {
+        const uint8_t *p = take(1);
+        return p ? *p : -1;
+    }
+};
+
+// ===============================
+//      RLE の展開
+// ===============================
+
+/**
+ * @brief RLE8 / RLE4 のピクセルデータを展開し、1 行ずつコールバックに渡す
+ *
+ * RLE の画像は常に下から上の順で格納されている。
+ * 差分移動（デルタ）で飛ばされたピクセルはパレットの 0 番の色で埋める。
+ *
+ * @return 読み込んだバイト数
+ */
+static uint32_t decodeRLE(File &file, const BMPInfo &info, const uint16_t *lut, uint8_t *indices,
+                          uint16_t *pixels, BMPRowHandler handler, void *context) {
+    const bool isRLE4 = info.compression == BMP_BI_RLE4;
+    const int width = info.width;
+    BMPChunkReader reader(file, info.fileSize - info.pixelDataOffset);
+
+    int row = 0; // 出力済みの行数（下から数える）
+    int x = 0;
+    memset(indices, 0, width);
+
+    // 現在の行を出力して次の行へ進む
+    auto emitRow = [&]() {
+        if (row >= info.height) return;
+        for (int i = 0; i < width; i++) {
+            pixels[i] = lut[indices[i]];
+        }
+        handler(info.height - 1 - row, pixels, context);
+        row++;
+        x = 0;
+        memset(indices, 0, width);
+    };
+
+    while (row < info.height) {
+        int count = reader.next();
+        int value = reader.next();
+        if (count < 0 || value < 0) break; // データ終端
+
+        if (count > 0) {
+            // 1. 連続するピクセル（RLE4 は上位 / 下位の 4 ビットを交互に使う）
+            for (int i = 0; i < count && x < width; i++, x++) {
+                indices[x] = isRLE4 ? ((i & 1) ? (value & 0x0F) : (value >> 4)) : value;
+            }
+        } else if (value == 0) {
+            // 2. 行末
+            emitRow();
+        } else if (value == 1) {
+            // 3. 画像の終わり
+            break;
+        } else if (value == 2) {
+            // 4. 差分移動（右に dx、上に dy）
+            int dx = reader.next();
+            int dy = reader.next();
+            if (dx < 0 || dy < 0) break;
+            int nextX = x + dx;
+            for (int i = 0; i < dy && row < info.height; i++) {
+                emitRow();
+            }
+            x = nextX < width ? nextX : width;
+        } else {
+            // 5. 非圧縮のピクセル列（2 バイト境界までパディングされる）
+            int dataBytes = isRLE4 ? (value + 1) / 2 : value;
+            int pixel = 0;
+            for (int i = 0; i < dataBytes; i++) {
+                int b = reader.next();
+                if (b < 0) break;
+                if (isRLE4) {
+                    if (pixel < value && x < width) indices[x++] = b >> 4;
+                    pixel++;
+                    if (pixel < value && x < width) indices[x++] = b & 0x0F;
+                    pixel++;
+                } else if (x < width) {
+                    indices[x++] = b;
+                }
+            }
+            if (dataBytes & 1) reader.next();
+        }
+    }
+
+    // 6. 残りの行を出力（途中で終わった場合は 0 番の色で埋める）
+    while (row < info.height) {
+        emitRow();
+    }
+    return reader.bytesRead;
+}
+
+/**
+ * @brief BMP のピクセルデータを RGB565 に変換し、1 行ずつコールバックに渡す
+ *
+ * 1. カラーパレット（8 ビット以下）またはビットマスク（BI_BITFIELDS）を読み込む
+ * 2. 行の変換方式を決める（よく使う形式は専用ループ）
+ * 3. 作業用のバッファを用意する（幅が小さければスタック上）
+ * 4. ピクセルデータはチャンク単位でまとめて読み込み（`BMPChunkReader`）、RLE は展開しながら、それ以外は 1 行ずつ変換する
+ *
+ * @param file BMPファイルの参照（読み取り位置は任意）
+ * @param info `readBMPInfo()` またはマニフェストで得たヘッダー情報
+ * @param handler 1 行ごとに呼ばれるコールバック
+ * @param context コールバックに渡す任意のポインタ
+ * @return 成功時 true / 失敗時 false
+ */
+bool decodeBMP(File &file, const BMPInfo &info, BMPRowHandler handler, void *context) {
+    TRACE_SCOPE("decodeBMP", file.path());
+
+    const int width = info.width;
+    const bool isRLE = info.compression == BMP_BI_RLE8 || info.compression == BMP_BI_RLE4;
+    uint32_t bytesRead = 0;
+
+    // 1. カラーパレット / ビットマスクの読み込み
+    uint16_t *palette = nullptr;
+    BMPMaskChannel masks[3];
+    if (info.bitsPerPixel <= 8) {
+        // 範囲外のインデックスでも読み出せるよう 256 色分を確保（未使用分は黒）
+        palette = (uint16_t *)calloc(256, sizeof(uint16_t));
+        if (!palette) {
+            Serial.println("メモリ確保に失敗しました。");
+            return false;
+        }
+        file.seek(14 + info.headerSize, SeekSet);
+        uint8_t entries[64]; // 16 色分ずつ読み込む
+        for (int i = 0; i < info.paletteColors; i += 16) {
+            int n = info.paletteColors - i < 16 ? info.paletteColors - i : 16;
+            size_t got = file.read(entries, n * 4);
+            bytesRead += got;
+            for (int j = 0; j < n && j * 4 + 2 < (int)got; j++) {
+                palette[i + j] = toRGB565(entries[j * 4 + 2], entries[j * 4 + 1], entries[j * 4]);
+            }
+        }
+    } else if (info.compression == BMP_BI_BITFIELDS) {
+        uint8_t maskBytes[12];
+        file.seek(54, SeekSet); // V4 / V5 ヘッダーでも同じ位置にマスクがある
+        bytesRead += file.read(maskBytes, sizeof(maskBytes));
+        masks[0].set(readLE32(&maskBytes[0]));
+        masks[1].set(readLE32(&maskBytes[4]));
+        masks[2].set(readLE32(&maskBytes[8]));
+    } else if (info.bitsPerPixel == 16) {
+        masks[0].set(0x7C00);
+        masks[1].set(0x03E0);
+        masks[2].set(0x001F);
+    }
+
+    // 2. 行の変換方式を決める
+    BMPRowFormat format;
+    switch (info.bitsPerPixel) {
+        case 1:  format = ROW_PAL1; break;
+        case 4:  format = ROW_PAL4; break;
+        case 8:  format = ROW_PAL8; break;
+        case 16:
+            if (masks[0].mask == 0x7C00 && masks[1].mask == 0x03E0 && masks[2].mask == 0x001F) format = ROW_RGB555;
+            else if (masks[0].mask == 0xF800 && masks[1].mask == 0x07E0 && masks[2].mask == 0x001F) format = ROW_RGB565;
+            else format = ROW_MASK16;
+            break;
+        case 24: format = ROW_BGR24; break;
+        default:
+            if (info.compression == BMP_BI_RGB ||
+                (masks[0].mask == 0xFF0000 && masks[1].mask == 0xFF00 && masks[2].mask == 0xFF)) format = ROW_BGRX32;
+            else format = ROW_MASK32;
+            break;
+    }
+
+    // 3. 作業用バッファ（RLE はパレット番号 1 行分、それ以外は読み込みバッファより大きい行の場合のみファイルの 1 行分）
+    uint8_t stackRaw[BMP_STACK_ROW_PIXELS];
+    uint16_t stackPixels[BMP_STACK_ROW_PIXELS];
+    int rowSize = info.rowSize();
+    int rawSize = isRLE ? width : (rowSize > BMP_READ_CHUNK_BYTES ? rowSize : 0);
+    uint8_t *raw = rawSize <= (int)sizeof(stackRaw) ? stackRaw : (uint8_t *)malloc(rawSize);
+    uint16_t *pixels = width <= BMP_STACK_ROW_PIXELS ? stackPixels : (uint16_t *)malloc(width * sizeof(uint16_t));
+    bool ok = raw && pixels;
+    if (!ok) {
+        Serial.println("メモリ確保に失敗しました。");
+    }
+
+    // 4. ピクセルデータを変換（チャンク単位で読み込み、バッファ上の行をそのまま変換する）
+    if (ok) {
+        file.seek(info.pixelDataOffset, SeekSet);
+        if (isRLE) {
+            bytesRead += decodeRLE(file, info, palette, raw, pixels, handler, context);
+        } else {
+            BMPChunkReader reader(file, info.fileSize - info.pixelDataOffset);
+            for (int row = 0; row < info.height; row++) {
+                const uint8_t *src = (rawSize > 0) ? (reader.read(raw, rowSize) ? raw : nullptr) : reader.take(rowSize);
+                if (!src) {
+                    Serial.println("BMPのピクセルデータが途中で終わっています。");
+                    ok = false;
+                    break;
+                }
+                switch (format) {
+                    case ROW_PAL1:   convertRowPal1(src, pixels, width, palette); break;
+                    case ROW_PAL4:   convertRowPal4(src, pixels, width, palette); break;
+                    case ROW_PAL8:   convertRowPal8(src, pixels, width, palette); break;
+                    case ROW_RGB555: convertRowRGB555(src, pixels, width); break;
+                    case ROW_RGB565: convertRowRGB565(src, pixels, width); break;
+                    case ROW_BGR24:  convertRowBGR24(src, pixels, width); break;
+                    case ROW_BGRX32: convertRowBGRX32(src, pixels, width); break;
+                    case ROW_MASK16: convertRowMask(src, pixels, width, 2, masks); break;
+                    case ROW_MASK32: convertRowMask(src, pixels, width, 4, masks); break;
+                }
+                int y = info.isTopDown ? row : (info.height - 1 - row); // BMPが上下逆なら修正
+                handler(y, pixels, context);
+            }
+            bytesRead += reader.bytesRead;
+        }
+    }
+
+    // 5. 後片付け
+    if (raw && raw != stackRaw) free(raw);
+    if (pixels && pixels != stackPixels) free(pixels);
+    free(palette);
+    panelMetrics.addFlashRead(METRICS_SRC_BMP, bytesRead);
+    return ok;
+}
+
+// decodeBMPToBuffer() 用の展開先
+struct BMPBufferTarget {
+    uint16_t *dest;
+    int stride;
+    int destX;
+    int width;
+};
+
+/**
+ * @brief BMP 全体を RGB565 のバッファに展開する
+ *
+ * @param file BMPファイルの参照
+ * @param info ヘッダー情報
+ * @param dest 展開先（`destStride` × `info.height` ピクセル以上）
+ * @param destStride 展開先の 1 行あたりのピクセル数
+ * @param destX 展開先の書き込み開始 X 座標（画像を横に並べる場合に使用）
+ * @return 成功時 true / 失敗時 false
+ */
+bool decodeBMPToBuffer(File &file, const BMPInfo &info, uint16_t *dest, int destStride, int destX) {
+    BMPBufferTarget target = { dest, destStride, destX, info.width };
+    return decodeBMP(file, info, [](int y, const uint16_t *row, void *context) {
+        BMPBufferTarget *t = (BMPBufferTarget *)context;
+        memcpy(t->dest + (size_t)y * t->stride + t->destX, row, t->width * sizeof(uint16_t));
+    }, &target);
+}
@@ -0,0 +1,118 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef BMPDECODER_H
+#define BMPDECODER_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>   // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"  // ESP32 の LittleFS を使用するためのライブラリ
+
+// ===============================
+//      デコーダー設定
+// ===============================
+#define BMP_MAX_DIMENSION 4096       // 受け付ける画像の最大幅・高さ（ピクセル）
+#define BMP_STACK_ROW_PIXELS 128     // この幅まではスタック上のバッファで 1 行を処理（超える場合はヒープを使用）
+#define BMP_READ_CHUNK_BYTES 2048     // ピクセルデータを 1 回で読み込む量（コアごとに静的に確保、これより大きい行は直接読み込む）
+
+/**
+ * @brief BMP の圧縮形式（情報ヘッダーの biCompression）
+ */
+enum BMPCompression {
+    BMP_BI_RGB = 0,        // 無圧縮
+    BMP_BI_RLE8 = 1,       // 8 ビットのランレングス圧縮
+    BMP_BI_RLE4 = 2,       // 4 ビットのランレングス圧縮
+    BMP_BI_BITFIELDS = 3   // 16 / 32 ビットのビットマスク指定
+};
+
+/**
+ * @brief 検証済みの BMP ヘッダー情報
+ *
+ * ヘッダーの値はすべてリトルエンディアンとして読み取り、
+ * 色深度・圧縮形式・ファイルサイズとの整合性を確認したものだけを格納する。
+ */
+struct BMPInfo {
+    int width = 0;                // 画像の横幅（ピクセル）
+    int height = 0;               // 画像の縦幅（ピクセル、常に正の値）
+    uint32_t pixelDataOffset = 0; // ピクセルデータの開始位置（バイト）
+    uint16_t bitsPerPixel = 0;    // 色深度（1 / 4 / 8 / 16 / 24 / 32 ビット）
+    uint32_t compression = 0;     // 圧縮形式（BMPCompression）
+    uint32_t fileSize = 0;        // ファイルサイズ（バイト、マニフェストの鮮度確認に使用）
+    bool isTopDown = false;       // 画像データの並びが「上から下」なら true
+    uint32_t headerSize = 40;     // 情報ヘッダーのサイズ（カラーパレットの位置の計算に使用）
+    uint16_t paletteColors = 0;   // カラーパレットの色数（8 ビット以下のみ）
+
+    /**
+     * @brief 1 行あたりのバイト数（4 バイト境界へのパディングを含む、無圧縮時）
+     */
+    int rowSize() const { return ((width * bitsPerPixel + 31) / 32) * 4; }
+};
+
+/**
+ * @brief デコードした 1 行分のピクセル（RGB565）を受け取るコールバック
+ *
+ * @param y 画像内の行番号（0 が一番上）
+ * @param row 1 行分のピクセル（`width` 個、コールバックの中でのみ有効）
+ * @param context `decodeBMP()` に渡した任意のポインタ
+ */
+typedef void (*BMPRowHandler)(int y, const uint16_t *row, void *context);
+
+/**
+ * @brief BMP ヘッダーを読み取り、表示可能な形式か検証する
+ *
+ * 呼び出し後、ファイルの読み取り位置はヘッダーの直後になる。
+ *
+ * @param file BMPファイルの参照（先頭から読み込む）
+ * @param info 検証済みのヘッダー情報の格納先
+ * @return 表示可能な BMP なら true / それ以外は false（理由をシリアル出力）
+ */
+bool readBMPInfo(File &file, BMPInfo &info);
+
+/**
+ * @brief ヘッダー情報が表示可能な範囲に収まっているか検証する（マニフェストの値の確認にも使用）
+ * @param info 確認するヘッダー情報
+ * @param rleBytes RLE の圧縮後のサイズ（不明な場合は 0、開始位置のみ確認）
+ * @return 表示可能なら true / それ以外は false（理由をシリアル出力）
+ */
+bool validateBMPInfo(const BMPInfo &info, uint32_t rleBytes = 0);
+
+/**
+ * @brief BMP のピクセルデータを RGB565 に変換し、1 行ずつコールバックに渡す
+ *
+ * 対応形式: 1 / 4 / 8 ビット（パレット）、RLE8 / RLE4、16 ビット（555 / ビットマスク）、
+ * 24 ビット、32 ビット（BGRX / ビットマスク、アルファは無視）。
+ * 行の並び順はファイルの格納順（下から上の場合は最終行から）となる。
+ *
+ * @param file BMPファイルの参照（読み取り位置は任意）
+ * @param info `readBMPInfo()` またはマニフェストで得たヘッダー情報
+ * @param handler 1 行ごとに呼ばれるコールバック
+ * @param context コールバックに渡す任意のポインタ
+ * @return 成功時 true / 失敗時 false
+ */
+bool decodeBMP(File &file, const BMPInfo &info, BMPRowHandler handler, void *context);
+
+/**
+ * @brief BMP 全体を RGB565 のバッファに展開する
+ *
+ * @param file BMPファイルの参照
+ * @param info ヘッダー情報
+ * @param dest 展開先（`destStride` × `info.height` ピクセル以上）
+ * @param destStride 展開先の 1 行あたりのピクセル数
+ * @param destX 展開先の書き込み開始 X 座標（画像を横に並べる場合に使用）
+ * @return 成功時 true / 失敗時 false
+ */
+bool decodeBMPToBuffer(File &file, const BMPInfo &info, uint16_t *dest, int destStride, int destX = 0);
+
+#endif // BMPDECODER_H
@@ -0,0 +1,385 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "BitmapFont.h"
+#include "drawBitmap.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+BitmapFont bitmapFont;
+
+/**
+ * @brief フォントファイルを開く
+ *
+ * ヘッダーを確認し、索引が FONT_INDEX_RAM_MAX 以下ならメモリに読み込む。
+ * 展開済みの文字を保持する領域は、フォントの大きさに合わせてここで確保する。
+ *
+ * @param path フォントファイルのパス
+ * @return 使用できる場合 true（ファイルが無い場合は文字列の画像は作成しない）
+ */
+bool BitmapFont::begin(const char *path) {
+    // 1. ファイルを開き、ヘッダーを確認
+    ready = false;
+    if (file) file.close();
+    file = LittleFS.open(path, "r");
+    if (!file) {
+        Serial.printf("フォント %s が無いため、文字列の表示は使用できません。\n", path);
+        return false;
+    }
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, "LFN1", 4) != 0 ||
+        header.height == 0 || header.height > FONT_MAX_HEIGHT ||
+        header.maxWidth == 0 || header.maxWidth > FONT_MAX_WIDTH || header.glyphCount == 0 ||
+        file.size() < sizeof(header) + (size_t)header.glyphCount * 8) {
+        Serial.printf("フォント %s の形式が正しくありません。\n", path);
+        file.close();
+        return false;
+    }
+
+    // 2. 索引が小さければメモリに読み込む（大きい場合はファイル上で二分探索）
+    size_t indexBytes = (size_t)header.glyphCount * 8;
+    index.clear();
+    if (indexBytes <= FONT_INDEX_RAM_MAX) {
+        index.resize(header.glyphCount * 2);
+        if (file.read((uint8_t *)index.data(), indexBytes) != indexBytes) {
+            file.close();
+            return false;
+        }
+        panelMetrics.addFlashRead(METRICS_SRC_BMP, sizeof(header) + indexBytes);
+    }
+
+    // 3. 展開済みの文字を保持する領域を確保
+    free(slotBits);
+    slotStride = (size_t)((header.maxWidth + 7) / 8) * header.height;
+    slotBits = (uint8_t *)malloc(slotStride * FONT_CACHE_SLOTS);
+    if (!slotBits) {
+        Serial.println("グリフキャッシュのメモリ確保に失敗しました。");
+        file.close();
+        return false;
+    }
+    for (CachedGlyph &slot : slots) {
+        slot = CachedGlyph();
+    }
+
+    ready = true;
+    Serial.printf("フォント %s を読み込みました（%u 文字、高さ %d）。\n",
+                  path, (unsigned)header.glyphCount, header.height);
+    return true;
+}
+
+/**
+ * @brief フォントファイルを閉じる（ファイルを置き換える前に呼ぶ、再開は `begin()`）
+ */
+void BitmapFont::end() {
+    ready = false;
+    if (file) file.close();
+    index.clear();
+    free(slotBits);
+    slotBits = nullptr;
+}
+
+/**
+ * @brief CSV のセルが文字列の指定（`text:` または `text[...]:` で始まる）か
+ */
+bool BitmapFont::isTextAsset(const String &spec) {
+    return spec.startsWith("text:") || spec.startsWith("text[");
+}
+
+/**
+ * @brief `text[幅x高さ,色]:文字列` を読み取る（`[...]` の各項目は省略可）
+ *
+ * 例: `text:幸せ通り` / `text[80x16]:幸せ通り` / `text[x16,ffa500]:快速` （色は RGB の 16 進数）
+ *
+ * @param spec CSV のセル
+ * @param style 書式
+ * @param text 文字列
+ * @return 読み取れた場合 true
+ */
+bool BitmapFont::parseTextAsset(const String &spec, TextStyle &style, String &text) {
+    if (!isTextAsset(spec)) return false;
+    int colon = spec.indexOf(':');
+    if (colon == -1) return false;
+    text = spec.substring(colon + 1);
+
+    // 1. 書式の指定が無い場合は文字列の大きさのまま
+    if (spec[4] != '[') return true;
+    int close = spec.indexOf(']');
+    if (close == -1 || close > colon) return false;
+    String options = spec.substring(5, close);
+
+    // 2. 大きさ（幅x高さ、どちらも省略可）
+    int comma = options.indexOf(',');
+    String size = (comma == -1) ? options : options.substring(0, comma);
+    int cross = size.indexOf('x');
+    if (cross != -1) {
+        style.boxWidth = size.substring(0, cross).toInt();
+        style.boxHeight = size.substring(cross + 1).toInt();
+    } else if (size.length() > 0) {
+        style.boxWidth = size.toInt();
+    }
+
+    // 3. 文字色（RRGGBB）
+    if (comma != -1) {
+        uint32_t rgb = strtoul(options.substring(comma + 1).c_str(), nullptr, 16);
+        style.color = ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F);
+    }
+    return style.boxWidth >= 0 && style.boxHeight >= 0;
+}
+
+/**
+ * @brief CSV のセル（`text:...`）の文字列を画像にする
+ * @param spec CSV のセル
+ * @param out 作成した画像（既存の画像は解放する）
+ * @return 作成できた場合 true
+ */
+bool BitmapFont::renderAsset(const String &spec, BMPData &out) {
+    TextStyle style;
+    String text;
+    if (!parseTextAsset(spec, style, text)) {
+        Serial.printf("文字列の指定が正しくありません: %s\n", spec.c_str());
+        return false;
+    }
+    return renderText(text, style, out);
+}
+
+/**
+ * @brief CSV のセル（`text:...`）を画像にした場合の大きさを求める（画像は作成しない）
+ *
+ * 文字幅はグリフキャッシュから求めるため、続けて `renderAsset()` を呼んでもフォントを読み直さない。
+ *
+ * @param spec CSV のセル
+ * @param width 画像の幅
+ * @param height 画像の高さ
+ * @return 求められた場合 true（`renderAsset()` が失敗する指定は false）
+ */
+bool BitmapFont::measureAsset(const String &spec, int &width, int &height) {
+    TextStyle style;
+    String text;
+    if (!ready || !parseTextAsset(spec, style, text)) return false;
+    width = (style.boxWidth > 0) ? style.boxWidth : textWidth(text);
+    height = (style.boxHeight > 0) ? style.boxHeight : header.height;
+    return width > 0 && height > 0;
+}
+
+/**
+ * @brief 文字列を画像にする（中央揃え、画像の幅を超える部分は切り捨て）
+ *
+ * 文字はグリフキャッシュから取り出し、1 ビット / ピクセルのデータを文字色・背景色に展開する。
+ *
+ * @param text 文字列（UTF-8）
+ * @param style 書式
+ * @param out 作成した画像（既存の画像は解放する）
+ * @return 作成できた場合 true
+ */
+bool BitmapFont::renderText(const String &text, const TextStyle &style, BMPData &out) {
+    TRACE_SCOPE("renderText", text.c_str());
+    if (out.cache) {
+        free(out.cache);
+        out.cache = nullptr;
+    }
+    out.width = out.height = 0;
+    if (!ready) return false;
+
+    // 1. 文字コードに分解し、文字列の幅を求める
+    std::vector<uint32_t> codes;
+    decodeUTF8(text, codes);
+    int textW = 0;
+    for (uint32_t code : codes) {
+        textW += advanceOf(glyph(code, nullptr));
+    }
+
+    // 2. 画像の大きさを決めてメモリを確保
+    int width = (style.boxWidth > 0) ? style.boxWidth : textW;
+    int height = (style.boxHeight > 0) ? style.boxHeight : header.height;
+    if (width <= 0 || height <= 0) return false;
+    out.cache = (uint16_t *)malloc((size_t)width * height * sizeof(uint16_t));
+    if (!out.cache) {
+        Serial.println("文字列の画像のメモリ確保に失敗しました。");
+        return false;
+    }
+    out.width = width;
+    out.height = height;
+
+    // 3. 背景色で塗り、文字を書き込む
+    paint(codes, textW, style, out.cache, width, width, height);
+    return true;
+}
+
+/**
+ * @brief CSV のセル（`text:...`）の文字列を、確保済みのバッファの一部に書き込む
+ *
+ * 連結画像の作成時に、一時的な画像を作らずに連結先の列へ直接書き込むために使う。
+ * 大きさは `measureAsset()` で求めたものを渡すこと。
+ *
+ * @param spec CSV のセル
+ * @param dest 書き込み先の左上
+ * @param destStride 書き込み先の 1 行あたりのピクセル数
+ * @param width 書き込む幅（`measureAsset()` の幅）
+ * @param height 書き込む高さ（`measureAsset()` の高さ）
+ * @return 書き込めた場合 true
+ */
+bool BitmapFont::renderAssetInto(const String &spec, uint16_t *dest, int destStride, int width, int height) {
+    TextStyle style;
+    String text;
+    if (!ready || !parseTextAsset(spec, style, text)) return false;
+    TRACE_SCOPE("renderText", text.c_str());
+    std::vector<uint32_t> codes;
+    decodeUTF8(text, codes);
+    int textW = 0;
+    for (uint32_t code : codes) {
+        textW += advanceOf(glyph(code, nullptr));
+    }
+    paint(codes, textW, style, dest, destStride, width, height);
+    return true;
+}
+
+// 背景色で塗り、中央揃えで 1 文字ずつ書き込む（画像の幅を超える部分は切り捨て）
+void BitmapFont::paint(const std::vector<uint32_t> &codes, int textW, const TextStyle &style,
+                       uint16_t *out, int stride, int width, int height) {
+    // 1. 背景色で塗る
+    for (int y = 0; y < height; y++) {
+        uint16_t *dest = out + (size_t)y * stride;
+        for (int x = 0; x < width; x++) {
+            dest[x] = style.background;
+        }
+    }
+
+    // 2. 中央揃えで 1 文字ずつ書き込む
+    int penX = (width - textW) / 2;
+    if (penX < 0) penX = 0; // 幅に収まらない場合は左詰めで切り捨て
+    int top = (height - header.height) / 2;
+    for (uint32_t code : codes) {
+        const uint8_t *bits = nullptr;
+        const CachedGlyph *cached = glyph(code, &bits);
+        if (cached->found) {
+            int rowBytes = (cached->width + 7) / 8;
+            for (int y = 0; y < header.height; y++) {
+                int drawY = top + y;
+                if (drawY < 0 || drawY >= height) continue;
+                const uint8_t *row = bits + y * rowBytes;
+                uint16_t *dest = out + (size_t)drawY * stride;
+                for (int x = 0; x < cached->width; x++) {
+                    int drawX = penX + x;
+                    if (drawX >= width) break;
+                    if (row[x >> 3] & (0x80 >> (x & 7))) {
+                        dest[drawX] = style.color;
+                    }
+                }
+            }
+        }
+        penX += advanceOf(cached);
+        if (penX >= width) break;
+    }
+}
+
+/**
+ * @brief 文字列の幅（ピクセル）
+ */
+int BitmapFont::textWidth(const String &text) {
+    if (!ready) return 0;
+    std::vector<uint32_t> codes;
+    decodeUTF8(text, codes);
+    int width = 0;
+    for (uint32_t code : codes) {
+        width += advanceOf(glyph(code, nullptr));
+    }
+    return width;
+}
+
+// 文字を取り出す（キャッシュに無ければフォントファイルから読み込む）
+const BitmapFont::CachedGlyph *BitmapFont::glyph(uint32_t code, const uint8_t **bits) {
+    size_t slotIndex = code & (FONT_CACHE_SLOTS - 1);
+    CachedGlyph &slot = slots[slotIndex];
+    uint8_t *slotData = slotBits + slotIndex * slotStride;
+    if (bits) *bits = slotData;
+
+    // 1. キャッシュにあればそのまま使う
+    if (slot.code == code) {
+        hits++;
+        return &slot;
+    }
+    misses++;
+
+    // 2. 索引から位置を探し、文字幅とビットマップを読み込む
+    slot.code = code;
+    slot.found = false;
+    slot.width = 0;
+    uint32_t offset;
+    if (!findGlyph(code, offset) || !file.seek(offset)) {
+        return &slot;
+    }
+    uint8_t width = 0;
+    if (file.read(&width, 1) != 1 || width == 0 || width > header.maxWidth) {
+        return &slot;
+    }
+    size_t bytes = (size_t)((width + 7) / 8) * header.height;
+    if (file.read(slotData, bytes) != bytes) {
+        return &slot;
+    }
+    panelMetrics.addFlashRead(METRICS_SRC_BMP, 1 + bytes);
+    slot.width = width;
+    slot.found = true;
+    return &slot;
+}
+
+// 索引を二分探索して文字データの位置を求める
+bool BitmapFont::findGlyph(uint32_t code, uint32_t &offset) {
+    uint32_t lo = 0, hi = header.glyphCount;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        uint32_t entry[2];
+        if (!index.empty()) {
+            entry[0] = index[mid * 2];
+            entry[1] = index[mid * 2 + 1];
+        } else if (!file.seek(sizeof(header) + (size_t)mid * 8) ||
+                   file.read((uint8_t *)entry, sizeof(entry)) != sizeof(entry)) {
+            return false;
+        }
+        if (entry[0] == code) {
+            offset = entry[1];
+            return true;
+        }
+        if (entry[0] < code) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+// UTF-8 の文字列を文字コードの並びに変換する（不正なバイトは読み飛ばす）
+void BitmapFont::decodeUTF8(const String &text, std::vector<uint32_t> &codes) {
+    const uint8_t *s = (const uint8_t *)text.c_str();
+    size_t length = text.length();
+    codes.reserve(length);
+    for (size_t i = 0; i < length;) {
+        uint8_t c = s[i];
+        int extra = (c < 0x80) ? 0 : (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : -1;
+        if (extra < 0 || i + extra >= length) {
+            i++;
+            continue;
+        }
+        uint32_t code = (extra == 0) ? c : (c & (0x3F >> extra));
+        for (int k = 1; k <= extra; k++) {
+            code = (code << 6) | (s[i + k] & 0x3F);
+        }
+        codes.push_back(code);
+        i += extra + 1;
+    }
+}
+
+// 文字の送り幅（フォントに無い文字は高さの半分の空白）
+int BitmapFont::advanceOf(const CachedGlyph *cached) const {
+    return cached->found ? cached->width : header.height / 2;
+}
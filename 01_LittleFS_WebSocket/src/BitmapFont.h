@@ -0,0 +1,175 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef BITMAPFONT_H
+#define BITMAPFONT_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>    // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"   // ESP32 の LittleFS を使用するためのライブラリ
+#include <vector>       // 文字コードの並び
+
+struct BMPData; // drawBitmap.h
+
+// ===============================
+//      フォントの設定
+// ===============================
+#define FONT_DEFAULT_PATH "/font/default.lfn" // 起動時に読み込むフォント（tools/makeFont.py で作成）
+#define FONT_MAX_HEIGHT 32                     // 対応する文字の高さの上限
+#define FONT_MAX_WIDTH 32                      // 対応する文字幅の上限
+#define FONT_CACHE_SLOTS 128                   // 展開済みの文字を保持する数（2 のべき乗）
+#define FONT_INDEX_RAM_MAX (16 * 1024)         // 文字の索引をメモリに読み込む上限（超える場合はファイル上で検索）
+
+/**
+ * @brief フォントファイル（.lfn）のヘッダー（リトルエンディアン）
+ *
+ * ヘッダーの後に索引（文字コード順の `{ uint32 文字コード, uint32 位置 }`）を `glyphCount` 件、
+ * 続けて各文字のデータ（`uint8 幅` + 1 行 `(幅 + 7) / 8` バイト × `height` 行、左端が最上位ビット）を格納する。
+ */
+struct __attribute__((packed)) FontHeader {
+    char magic[4];        // "LFN1"
+    uint8_t height;       // 文字の高さ（全文字共通）
+    uint8_t maxWidth;     // 最大の文字幅
+    uint16_t reserved;    // 予約（0）
+    uint32_t glyphCount;  // 文字数
+};
+
+/**
+ * @brief 文字列を画像にするときの書式（CSV では `text[80x16,ffa500]:文字列` のように指定）
+ */
+struct TextStyle {
+    int boxWidth = 0;            // 画像の幅（0 の場合は文字列の幅）
+    int boxHeight = 0;           // 画像の高さ（0 の場合はフォントの高さ）
+    uint16_t color = 0xFFFF;     // 文字色（RGB565）
+    uint16_t background = 0x0000; // 背景色（RGB565）
+};
+
+// ===============================
+//      BitmapFont クラスの定義
+// ===============================
+/**
+ * @brief LittleFS 上のビットマップフォントで文字列を画像にするクラス
+ *
+ * 駅名などを画像ファイルの代わりに文字列で指定できるようにする。
+ * 文字は 1 ビット / ピクセルで保存し、使った文字は展開してメモリに保持する（グリフキャッシュ）。
+ * 文字列は 1 回だけ RGB565 の画像（`BMPData`）にし、以降は通常の画像と同様に描画・連結する。
+ *
+ * パネル制御タスクからのみ使用する（排他制御は行わない）。
+ */
+class BitmapFont {
+public:
+    /**
+     * @brief フォントファイルを開く
+     * @param path フォントファイルのパス
+     * @return 使用できる場合 true（ファイルが無い場合は文字列の画像は作成しない）
+     */
+    bool begin(const char *path = FONT_DEFAULT_PATH);
+
+    /**
+     * @brief フォントファイルを閉じる（ファイルを置き換える前に呼ぶ、再開は `begin()`）
+     */
+    void end();
+
+    /**
+     * @brief CSV のセルが文字列の指定（`text:` または `text[...]:` で始まる）か
+     */
+    static bool isTextAsset(const String &spec);
+
+    /**
+     * @brief `text[幅x高さ,色]:文字列` を読み取る（`[...]` の各項目は省略可）
+     * @param spec CSV のセル
+     * @param style 書式
+     * @param text 文字列
+     * @return 読み取れた場合 true
+     */
+    static bool parseTextAsset(const String &spec, TextStyle &style, String &text);
+
+    /**
+     * @brief CSV のセル（`text:...`）の文字列を画像にする
+     * @param spec CSV のセル
+     * @param out 作成した画像（既存の画像は解放する）
+     * @return 作成できた場合 true
+     */
+    bool renderAsset(const String &spec, BMPData &out);
+
+    /**
+     * @brief CSV のセル（`text:...`）を画像にした場合の大きさを求める（画像は作成しない）
+     * @param spec CSV のセル
+     * @param width 画像の幅
+     * @param height 画像の高さ
+     * @return 求められた場合 true（`renderAsset()` が失敗する指定は false）
+     */
+    bool measureAsset(const String &spec, int &width, int &height);
+
+    /**
+     * @brief CSV のセル（`text:...`）の文字列を、確保済みのバッファの一部に書き込む（連結画像用）
+     * @param spec CSV のセル
+     * @param dest 書き込み先の左上
+     * @param destStride 書き込み先の 1 行あたりのピクセル数
+     * @param width 書き込む幅（`measureAsset()` の幅）
+     * @param height 書き込む高さ（`measureAsset()` の高さ）
+     * @return 書き込めた場合 true
+     */
+    bool renderAssetInto(const String &spec, uint16_t *dest, int destStride, int width, int height);
+
+    /**
+     * @brief 文字列を画像にする（中央揃え、画像の幅を超える部分は切り捨て）
+     * @param text 文字列（UTF-8）
+     * @param style 書式
+     * @param out 作成した画像（既存の画像は解放する）
+     * @return 作成できた場合 true
+     */
+    bool renderText(const String &text, const TextStyle &style, BMPData &out);
+
+    /**
+     * @brief 文字列の幅（ピクセル）
+     */
+    int textWidth(const String &text);
+
+    bool isReady() const { return ready; }
+    int height() const { return header.height; }
+    uint32_t cacheHits() const { return hits; }
+    uint32_t cacheMisses() const { return misses; }
+
+private:
+    /**
+     * @brief 展開済みの文字 1 つ分（文字コードの下位ビットで格納位置を決める）
+     */
+    struct CachedGlyph {
+        uint32_t code = 0xFFFFFFFF; // 文字コード（未使用の場合は 0xFFFFFFFF）
+        uint8_t width = 0;          // 文字幅（フォントに無い文字は 0）
+        bool found = false;         // フォントに文字があったか
+    };
+
+    File file;                       // フォントファイル（開いたまま保持）
+    FontHeader header = {};
+    bool ready = false;
+    std::vector<uint32_t> index;     // 索引（メモリに読み込んだ場合のみ、文字コードと位置の組）
+    CachedGlyph slots[FONT_CACHE_SLOTS];
+    uint8_t *slotBits = nullptr;     // 各スロットの 1 ビット / ピクセルのデータ
+    size_t slotStride = 0;           // スロット 1 つ分のバイト数
+    uint32_t hits = 0, misses = 0;
+
+    const CachedGlyph *glyph(uint32_t code, const uint8_t **bits);
+    bool findGlyph(uint32_t code, uint32_t &offset);
+    static void decodeUTF8(const String &text, std::vector<uint32_t> &codes);
+    int advanceOf(const CachedGlyph *cached) const;
+    void paint(const std::vector<uint32_t> &codes, int textW, const TextStyle &style,
+               uint16_t *out, int stride, int width, int height);
+};
+
+extern BitmapFont bitmapFont; // 全体で共有するフォント
+
+#endif // BITMAPFONT_H
@@ -0,0 +1,268 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "BootState.h"
+#include "AssetUpload.h"
+#include "PanelGeometry.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+BootState bootState;
+
+/**
+ * @brief NVS から前回の表示状態を読み込む
+ * @param state 読み込んだ状態
+ * @return 保存されていた場合 true
+ */
+bool BootState::load(BootDisplayState &state) {
+    saved.version = 0; // 読み込めなかった場合は、最初の表示状態も保存する
+    dirty = true;
+    Preferences prefs;
+    if (!prefs.begin(BOOT_NVS_NAMESPACE, true)) {
+        return false; // 一度も保存していない
+    }
+    BootDisplayState stored;
+    bool ok = prefs.getBytesLength("state") == sizeof(stored) &&
+              prefs.getBytes("state", &stored, sizeof(stored)) == sizeof(stored) &&
+              stored.version == BootDisplayState().version;
+    prefs.end();
+    if (!ok) return false;
+
+    stored.preset[PRESET_NAME_LEN - 1] = '\0';
+    state = stored;
+    saved = stored;
+    pending = stored;
+    dirty = false;
+    return true;
+}
+
+/**
+ * @brief 保存したフレームをパネルに表示する
+ *
+ * 1 行ずつ展開して `PanelGeometry::blitSpan()` で書き込むため、表示中の内容の写しも同じ内容になる。
+ *
+ * @param panel 表示先の LED パネル
+ * @return 表示できた場合 true（無い場合・パネルの大きさが違う場合は false）
+ */
+bool BootState::showFrame(MatrixPanel_I2S_DMA *panel) {
+    TRACE_SCOPE("bootFrame");
+
+    // 1. ヘッダーを確認
+    File file = LittleFS.open(BOOT_FRAME_PATH, "r");
+    if (!file) return false;
+    BootFrameHeader head;
+    int width = panelGeometry.width();
+    int height = panelGeometry.height();
+    if (file.read((uint8_t *)&head, sizeof(head)) != sizeof(head) ||
+        memcmp(head.magic, "LBF1", 4) != 0 || head.width != width || head.height != height ||
+        file.size() != sizeof(head) + head.dataBytes) {
+        file.close();
+        return false;
+    }
+
+    // 2. 圧縮したデータを一括で読み込み、CRC32 を確認
+    uint8_t *data = (uint8_t *)malloc(head.dataBytes);
+    uint16_t *row = (uint16_t *)malloc(width * sizeof(uint16_t));
+    bool ok = data != nullptr && row != nullptr &&
+              file.read(data, head.dataBytes) == head.dataBytes &&
+              AssetUpload::crc32(0, data, head.dataBytes) == head.crc;
+    file.close();
+    panelMetrics.addFlashRead(METRICS_SRC_BMP, sizeof(head) + head.dataBytes);
+
+    // 3. 展開しながら 1 行ずつ書き込む（連続や直接の画素は行をまたいでもよい）
+    const uint8_t *p = data;
+    const uint8_t *end = data + head.dataBytes;
+    int x = 0, y = 0;
+    while (ok && y < height) {
+        if (p >= end) {
+            ok = false;
+            break;
+        }
+        uint8_t control = *p++;
+        bool repeat = (control & 0x80) != 0;
+        int count = repeat ? (control & 0x7F) + 2 : control + 1;
+        if (end - p < (repeat ? 2 : count * 2)) {
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < count && y < height; i++) {
+            const uint8_t *pixel = repeat ? p : p + i * 2;
+            row[x++] = pixel[0] | (pixel[1] << 8);
+            if (x == width) {
+                panelGeometry.blitSpan(panel, 0, y, row, width);
+                x = 0;
+                y++;
+            }
+        }
+        p += repeat ? 2 : count * 2;
+    }
+    free(data);
+    free(row);
+    if (!ok) {
+        Serial.println("保存したフレームが壊れているため、表示しません。");
+        return false;
+    }
+    panelGeometry.presentFrame(panel);
+    return true;
+}
+
+/**
+ * @brief 現在の表示状態を伝える（変わった場合のみ記録し、保存は `update()` で後から行う）
+ * @param state 現在の表示状態
+ * @param now 現在時刻（ミリ秒）
+ */
+void BootState::note(const BootDisplayState &state, unsigned long now) {
+    BootDisplayState current = state;
+    current.frameCrc = pending.frameCrc;
+    if (sameState(current, pending)) return;
+    pending = current;
+    dirty = true;
+    changedAt = now;
+}
+
+/**
+ * @brief 保存待ちの状態があり、待ち時間を過ぎているか
+ *
+ * 表示が `BOOT_STATE_SETTLE_MS` 変わっておらず、前回の保存から `BOOT_STATE_MIN_INTERVAL_MS` 経っている場合に true。
+ *
+ * @param now 現在時刻（ミリ秒）
+ * @return `update()` で保存を試みる場合 true
+ */
+bool BootState::due(unsigned long now) const {
+    if (!dirty || now - changedAt < BOOT_STATE_SETTLE_MS) return false;
+    return !everWritten || now - writtenAt >= BOOT_STATE_MIN_INTERVAL_MS;
+}
+
+/**
+ * @brief 待ち時間を過ぎていれば、表示状態とフレームを保存する
+ *
+ * 表示状態が前回の保存と同じ場合は何も書き込まない。
+ * フレームは CRC32 が前回と同じ場合は書き込まない（トグル中の別の段階でも、同じ表示状態なら保存し直さない）。
+ *
+ * @param frame 表示中の内容（パネル全体の RGB565、NULL の場合はフレームを保存しない）
+ * @param now 現在時刻（ミリ秒）
+ * @return 保存した場合 true
+ */
+bool BootState::update(const uint16_t *frame, unsigned long now) {
+    // 1. 表示が落ち着き、前回の保存から十分に時間が経っているか
+    if (!due(now)) return false;
+    dirty = false;
+    pending.frameCrc = saved.frameCrc;
+    if (sameState(pending, saved)) return false;
+    TRACE_SCOPE("bootSave");
+
+    // 2. フレームを保存（失敗した場合も表示状態は保存する）
+    if (frame) {
+        uint32_t crc = pending.frameCrc;
+        if (saveFrame(frame, crc)) {
+            pending.frameCrc = crc;
+        }
+    }
+
+    // 3. 表示状態を NVS に保存
+    Preferences prefs;
+    if (!prefs.begin(BOOT_NVS_NAMESPACE, false)) {
+        Serial.println("NVS を開けないため、表示状態を保存できません。");
+        return false;
+    }
+    bool ok = prefs.putBytes("state", &pending, sizeof(pending)) == sizeof(pending);
+    prefs.end();
+    if (!ok) {
+        Serial.println("表示状態を NVS に保存できませんでした。");
+        return false;
+    }
+    saved = pending;
+    writtenAt = now;
+    everWritten = true;
+    writes++;
+    return true;
+}
+
+// フレームを圧縮して保存する（一時ファイルに書き込み、名前の変更で置き換える）
+bool BootState::saveFrame(const uint16_t *frame, uint32_t &crc) {
+    // 1. 圧縮（最悪の場合でも 128 画素ごとに 1 バイト増えるだけ）
+    size_t count = (size_t)panelGeometry.width() * panelGeometry.height();
+    uint8_t *data = (uint8_t *)malloc(count * 2 + count / 128 + 1);
+    if (!data) return false;
+    size_t dataBytes = encodeFrame(frame, count, data);
+    uint32_t newCrc = AssetUpload::crc32(0, data, dataBytes);
+    if (newCrc == crc && LittleFS.exists(BOOT_FRAME_PATH)) {
+        free(data);
+        return true; // 同じフレームは書き込まない
+    }
+
+    // 2. 一時ファイルに書き込む
+    BootFrameHeader head;
+    memcpy(head.magic, "LBF1", 4);
+    head.width = panelGeometry.width();
+    head.height = panelGeometry.height();
+    head.dataBytes = dataBytes;
+    head.crc = newCrc;
+    String stagingPath = String(BOOT_FRAME_PATH) + ".tmp";
+    LittleFS.mkdir("/boot");
+    File file = LittleFS.open(stagingPath, "w");
+    bool ok = file &&
+              file.write((const uint8_t *)&head, sizeof(head)) == sizeof(head) &&
+              file.write(data, dataBytes) == dataBytes;
+    if (file) file.close();
+    free(data);
+
+    // 3. 書き込めた場合のみ置き換える（途中で電源が切れても前回のフレームが残る）
+    if (!ok || !LittleFS.rename(stagingPath, BOOT_FRAME_PATH)) {
+        LittleFS.remove(stagingPath);
+        Serial.println("フレームを保存できませんでした。");
+        return false;
+    }
+    crc = newCrc;
+    return true;
+}
+
+// RGB565 の画素を圧縮する（形式は BootFrameHeader を参照）
+size_t BootState::encodeFrame(const uint16_t *pixels, size_t count, uint8_t *out) {
+    size_t used = 0;
+    size_t i = 0;
+    while (i < count) {
+        // 1. 同じ画素が 2 つ以上続く場合は繰り返し
+        size_t run = 1;
+        while (i + run < count && run < 129 && pixels[i + run] == pixels[i]) run++;
+        if (run >= 2) {
+            out[used++] = 0x80 | (uint8_t)(run - 2);
+            out[used++] = pixels[i] & 0xFF;
+            out[used++] = pixels[i] >> 8;
+            i += run;
+            continue;
+        }
+
+        // 2. 繰り返しが始まるまでの画素はそのまま
+        size_t literal = 1;
+        while (i + literal < count && literal < 128 &&
+               !(i + literal + 1 < count && pixels[i + literal] == pixels[i + literal + 1])) {
+            literal++;
+        }
+        out[used++] = (uint8_t)(literal - 1);
+        for (size_t k = 0; k < literal; k++) {
+            out[used++] = pixels[i + k] & 0xFF;
+            out[used++] = pixels[i + k] >> 8;
+        }
+        i += literal;
+    }
+    return used;
+}
+
+// 保存済みの状態と同じか（フレームの CRC32 を含む）
+bool BootState::sameState(const BootDisplayState &a, const BootDisplayState &b) {
+    return memcmp(&a, &b, sizeof(BootDisplayState)) == 0;
+}
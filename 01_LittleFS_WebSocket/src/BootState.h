@@ -0,0 +1,140 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef BOOTSTATE_H
+#define BOOTSTATE_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>        // Arduino 環境の基本ライブラリ
+#include <Preferences.h>    // NVS（表示状態の保存先）
+#include "LittleFS.h"       // ESP32 の LittleFS を使用するためのライブラリ
+#include "ScenePreset.h"    // PRESET_NAME_LEN
+
+// ===============================
+//      起動時の復元の設定
+// ===============================
+#define BOOT_NVS_NAMESPACE "panel"          // NVS の名前空間
+#define BOOT_FRAME_PATH "/boot/frame.lbf"   // 最後に表示したフレームの保存先（LittleFS）
+#define BOOT_STATE_SETTLE_MS 10000          // 表示が変わってから保存するまでの待ち時間（連続した操作はまとめて 1 回）
+#define BOOT_STATE_MIN_INTERVAL_MS 60000    // 保存の最短間隔（時刻表の再生中などに書き込みが続かないようにする）
+
+/**
+ * @brief NVS に保存する表示状態
+ */
+struct __attribute__((packed)) BootDisplayState {
+    uint8_t version = 1;                  // 形式の版（一致しない場合は復元しない）
+    uint8_t mode = 0;                     // 表示モード
+    uint16_t full = 1;                    // 全画面表示の ID
+    uint16_t type = 1;                    // 種別の ID
+    uint16_t dest = 1;                    // 行先の ID
+    uint16_t dep = 7;                     // 始発駅の ID
+    uint16_t next = 1;                    // 次駅の ID
+    char preset[PRESET_NAME_LEN] = "";    // Mode 4 のプリセット名
+    uint32_t frameCrc = 0;                // 保存したフレームの CRC32（同じフレームは書き込まない）
+};
+
+/**
+ * @brief 保存したフレームのヘッダー（リトルエンディアン）
+ *
+ * ヘッダーの後に、RGB565 の画素を次の形式で圧縮したデータを `dataBytes` バイト続ける。
+ * - 制御バイトの最上位ビットが 1: 続く 1 画素を `(制御バイト & 0x7F) + 2` 回繰り返す
+ * - 制御バイトの最上位ビットが 0: 続く `制御バイト + 1` 画素をそのまま使う
+ */
+struct __attribute__((packed)) BootFrameHeader {
+    char magic[4];       // "LBF1"
+    uint16_t width;      // フレームの横幅（パネル全体の大きさ）
+    uint16_t height;     // フレームの縦幅
+    uint32_t dataBytes;  // 圧縮したデータのバイト数
+    uint32_t crc;        // 圧縮したデータの CRC32
+};
+
+// ===============================
+//      BootState クラスの定義
+// ===============================
+/**
+ * @brief 最後の表示状態とフレームを保存し、起動直後に復元する
+ *
+ * 表示状態（mode / num_*）は NVS、フレーム（`frameMirror` の内容を圧縮したもの）は LittleFS に保存する。
+ * 書き込みは表示が `BOOT_STATE_SETTLE_MS` 変わらなかったときだけ、最短でも `BOOT_STATE_MIN_INTERVAL_MS` おきに行い、
+ * 前回と同じ内容は書き込まない（フラッシュの消耗を抑える）。
+ *
+ * 起動時は `load()` で状態を、`showFrame()` で CSV や BMP を読まずにフレームをそのまま表示する。
+ * パネル制御タスクからのみ使用する（起動時は各タスクの作成前に使用する）。
+ */
+class BootState {
+public:
+    /**
+     * @brief NVS から前回の表示状態を読み込む
+     * @param state 読み込んだ状態
+     * @return 保存されていた場合 true
+     */
+    bool load(BootDisplayState &state);
+
+    /**
+     * @brief 保存したフレームをパネルに表示する
+     * @param panel 表示先の LED パネル
+     * @return 表示できた場合 true（無い場合・パネルの大きさが違う場合は false）
+     */
+    bool showFrame(MatrixPanel_I2S_DMA *panel);
+
+    /**
+     * @brief 現在の表示状態を伝える（変わった場合のみ記録し、保存は `update()` で後から行う）
+     * @param state 現在の表示状態
+     * @param now 現在時刻（ミリ秒）
+     */
+    void note(const BootDisplayState &state, unsigned long now);
+
+    /**
+     * @brief 保存待ちの状態があり、待ち時間を過ぎているか（`update()` を呼ぶ前にフレームの予算を確保するため）
+     * @param now 現在時刻（ミリ秒）
+     * @return `update()` で保存を試みる場合 true
+     */
+    bool due(unsigned long now) const;
+
+    /**
+     * @brief 待ち時間を過ぎていれば、表示状態とフレームを保存する（パネル制御タスクのループで呼ぶ）
+     * @param frame 表示中の内容（パネル全体の RGB565）
+     * @param now 現在時刻（ミリ秒）
+     * @return 保存した場合 true
+     */
+    bool update(const uint16_t *frame, unsigned long now);
+
+    uint32_t writeCount() const { return writes; }
+
+    /**
+     * @brief RGB565 の画素を圧縮する（形式は `BootFrameHeader` を参照、フレーム配信の行の差分にも使用）
+     * @param pixels 圧縮する画素
+     * @param count 画素数
+     * @param out 格納先（最大で `count * 2 + count / 128 + 1` バイト）
+     * @return 圧縮したデータのバイト数
+     */
+    static size_t encodeFrame(const uint16_t *pixels, size_t count, uint8_t *out);
+
+private:
+    BootDisplayState saved;              // 最後に保存した（または読み込んだ）状態
+    BootDisplayState pending;            // 保存待ちの状態
+    bool dirty = false;
+    unsigned long changedAt = 0;         // 最後に表示状態が変わった時刻
+    unsigned long writtenAt = 0;         // 最後に保存した時刻
+    bool everWritten = false;
+    uint32_t writes = 0;
+
+    bool saveFrame(const uint16_t *frame, uint32_t &crc);
+    static bool sameState(const BootDisplayState &a, const BootDisplayState &b);
+};
+
+extern BootState bootState; // 全体で共有する起動時の復元処理
+
+#endif // BOOTSTATE_H
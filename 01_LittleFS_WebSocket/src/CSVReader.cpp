@@ -12,6 +12,9 @@
  * 利用に伴う損害について、作者は一切責任を負いません。
  */
 #include "CSVReader.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
+#include <algorithm> // std::sort / std::lower_bound / std::binary_search
 
 // CSVReader クラスのコンストラクタ
 CSVReader::CSVReader(const char *path) : filePath(path) {}
@@ -50,143 +53,262 @@ void CSVReader::close() {
     if (file) file.close();
 }
 
+// カンマ区切りの 1 行を列に分ける（前後の空白は行全体でのみ削除する）
+static void splitColumns(String line, std::vector<String> &columns) {
+    columns.clear();
+    line.trim();
+    while (line.length() > 0) {
+        int separatorIndex = line.indexOf(',');
+        if (separatorIndex == -1) {
+            // 最後の列
+            columns.push_back(line);
+            break;
+        }
+        // 通常の列
+        columns.push_back(line.substring(0, separatorIndex));
+        line = line.substring(separatorIndex + 1);
+    }
+}
+
 /**
- * @brief 指定された列のインデックスを取得する
+ * @brief 指定した ID に対応するファイルパスを取得する（整数 ID 対応版）
  *
- * CSV のヘッダー行を読み込み、指定された列名が何番目にあるかを取得する。
+ * 1 件だけの `lookup()` として検索する。
  *
- * @param label 検索する列名
- * @return 列のインデックス（0 から始まる）/ 見つからない場合は -1
+ * @param IDNumber 検索する ID（整数）
+ * @param label 取得するデータの列名
+ * @return 見つかった場合は該当データ（ファイルパスなど）を返す / 見つからなかった場合は空文字列
  */
-int CSVReader::getColumnIndex(const String &label) {
+String CSVReader::getPath(int IDNumber, const String &label) {
+    char traceDetail[TRACE_DETAIL_LEN];
+    snprintf(traceDetail, sizeof(traceDetail), "%d/%s", IDNumber, label.c_str());
+    TRACE_SCOPE("CSVReader::getPath", traceDetail);
+
+    std::vector<CatalogQuery> queries(1, CatalogQuery(IDNumber, label));
+    lookup(queries);
+    return queries[0].value;
+}
+
+/**
+ * @brief 複数の ID・列をまとめて検索する（ファイルを 1 回だけ先頭から読む）
+ *
+ * 見出し行を 1 回だけ解析し、該当する行がすべて見つかった時点で読み込みを終える。
+ * 同じ ID の複数の列（日本語 / 英語など）は同じ行から取得する。
+ *
+ * @param queries 検索する ID と列名（結果は各要素の `value` / `found` に格納）
+ * @return 見つかった件数
+ */
+size_t CSVReader::lookup(std::vector<CatalogQuery> &queries) {
+    TRACE_SCOPE("CSVReader::lookup", filePath);
+    for (CatalogQuery &query : queries) {
+        query.value = "";
+        query.found = false;
+    }
+    if (queries.empty()) return 0;
+
     // 1. CSV ファイルを開く
     File file = LittleFS.open(filePath, "r");
-    if (!file.available()) {
-        Serial.println("CSVが空です。");
-        return -1;
+    if (!file) {
+        Serial.printf("CSVファイル %s を開けませんでした。\n", filePath);
+        return 0;
     }
+    panelMetrics.countCSVLookup();
 
-    // 2. ヘッダー行を読み取る（1行目）
-    String headerLine = file.readStringUntil('\n');
-    file.close();  // 読み終わったらすぐに閉じる
-    headerLine.trim(); // 前後の空白を削除
-
-    // 3. ヘッダーの各列を解析
-    int columnIndex = 0;
-    while (headerLine.length() > 0) {
-        int separatorIndex = headerLine.indexOf(',');
-        String currentLabel;
-
-        if (separatorIndex == -1) {
-            // 最後の列
-            currentLabel = headerLine;
-            headerLine = "";
+    // 2. 見出し行から ID 列と各列名の位置を求める
+    std::vector<String> columns;
+    splitColumns(file.readStringUntil('\n'), columns);
+    auto columnOf = [&columns](const String &label) {
+        for (size_t i = 0; i < columns.size(); i++) {
+            if (columns[i] == label) return (int)i;
+        }
+        return -1;
+    };
+    int idColumnIndex = columnOf("ID");
+    std::vector<int> labelColumns;
+    std::vector<String> idStrings; // ID は文字列として比べる
+    size_t pending = 0;
+    for (const CatalogQuery &query : queries) {
+        idStrings.push_back(String(query.id));
+        int index = columnOf(query.label);
+        if (idColumnIndex == -1 || index == -1) {
+            Serial.printf("ファイル %s で列 %s が見つかりませんでした。\n", filePath,
+                          idColumnIndex == -1 ? "ID" : query.label.c_str());
         } else {
-            // 通常の列
-            currentLabel = headerLine.substring(0, separatorIndex);
-            headerLine = headerLine.substring(separatorIndex + 1);
+            pending++;
         }
+        labelColumns.push_back(index);
+    }
 
-        // 4. 指定されたラベルと一致する列が見つかったら、そのインデックスを返す
-        if (currentLabel == label) {
-            return columnIndex;
+    // 3. CSV を 1 行ずつ読み込み、ID が一致する行から該当する列をすべて取得する
+    size_t found = 0;
+    while (pending > 0 && file.available()) {
+        splitColumns(file.readStringUntil('\n'), columns);
+        if (idColumnIndex >= (int)columns.size()) continue;
+        const String &currentID = columns[idColumnIndex];
+        for (size_t i = 0; i < queries.size(); i++) {
+            CatalogQuery &query = queries[i];
+            if (query.found || labelColumns[i] == -1 || currentID != idStrings[i]) continue;
+            query.found = true;
+            if (labelColumns[i] < (int)columns.size()) {
+                query.value = columns[labelColumns[i]];
+            }
+            found++;
+            pending--;
         }
-
-        // 5. 次の列へ
-        columnIndex++;
     }
+    panelMetrics.addFlashRead(METRICS_SRC_CSV, file.position()); // 先頭から読み進めた分
+    file.close();
 
-    // 6. ラベルが見つからなかった場合はエラーメッセージを出力し、-1 を返す
-    Serial.printf("ファイル %s でラベル %s が見つかりませんでした。\n", filePath, label.c_str());
-    return -1;
+    // 4. 見つからなかった ID を知らせる
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (!queries[i].found && labelColumns[i] != -1) {
+            Serial.printf("ID %d が見つかりませんでした。\n", queries[i].id);
+        }
+    }
+    return found;
 }
 
 /**
- * @brief 指定した ID に対応するファイルパスを取得する
+ * @brief CSV を読み直し、内容が変わった行の世代を進める
  *
- * 指定された ID の行を検索し、指定された列（label）の値を取得する。
+ * 行ごとのハッシュを前回と比べ、変わった行・追加された行・削除された行だけに新しい世代を付ける。
+ * 見出し行が変わった場合（列の追加・並べ替え）はすべての行を変更とみなす。
  *
- * @param id 検索する ID（文字列）
- * @param label 取得するデータの列名
- * @param file 読み込み対象の CSV ファイル
- * @return 見つかった場合は該当データ（ファイルパスなど）を返す / 見つからなかった場合は空文字列
+ * @return 変更があった場合 true（カタログの世代が 1 進む）
  */
-String CSVReader::getFilePath(const String &id, const String &label, File &file) {
-    // 1. ID列と指定ラベル列のインデックスを取得
-    int idColumnIndex = getColumnIndex("ID");
-    int labelColumnIndex = getColumnIndex(label);
+bool CSVReader::reload() {
+    TRACE_SCOPE("CSVReader::reload", filePath);
 
-    // 2. 指定された列が見つからなかった場合はエラーを出力し、空文字列を返す
-    if (idColumnIndex == -1 || labelColumnIndex == -1) {
-        Serial.printf("指定された列が見つかりません (IDまたは%s)\n", label.c_str());
-        return "";
+    // 1. CSV ファイルを開き、見出し行を比べる
+    File file = LittleFS.open(filePath, "r");
+    if (!file) {
+        Serial.printf("CSVファイル %s を開けませんでした。\n", filePath);
+        return false;
     }
+    String line = file.readStringUntil('\n');
+    line.trim();
+    uint32_t newHeaderHash = hashLine(line);
+    bool headerChanged = (newHeaderHash != headerHash);
+    uint32_t nextGeneration = catalogGeneration + 1;
 
-    // 3. CSV を 1 行ずつ読み込み、ID が一致する行を探す
+    // 2. 各行のハッシュを前回と比べ、変わった行だけ新しい世代にする
+    std::vector<CatalogRow> nextRows;
+    size_t changed = 0;
     while (file.available()) {
-        String line = file.readStringUntil('\n');
+        line = file.readStringUntil('\n');
         line.trim();
+        if (line.length() == 0) continue;
+        CatalogRow row;
+        row.id = line.toInt(); // ID は 1 列目
+        row.hash = hashLine(line);
+        const CatalogRow *old = findRow(row.id);
+        if (!headerChanged && old && old->hash == row.hash) {
+            row.generation = old->generation;
+        } else {
+            row.generation = nextGeneration;
+            changed++;
+        }
+        nextRows.push_back(row);
+    }
+    panelMetrics.addFlashRead(METRICS_SRC_CSV, file.position());
+    file.close();
+    std::sort(nextRows.begin(), nextRows.end(), [](const CatalogRow &a, const CatalogRow &b) { return a.id < b.id; });
 
-        String currentID;
-        String currentLabelData;
-        int currentColumn = 0;
-
-        // 4. 各列のデータを取得
-        while (line.length() > 0) {
-            int separatorIndex = line.indexOf(',');
-            String part;
-
-            if (separatorIndex == -1) {
-                part = line;
-                line = "";
-            } else {
-                part = line.substring(0, separatorIndex);
-                line = line.substring(separatorIndex + 1);
-            }
+    // 3. 削除された行は削除した世代を残す
+    for (const CatalogRow &old : rows) {
+        auto it = std::lower_bound(nextRows.begin(), nextRows.end(), old.id,
+                                   [](const CatalogRow &row, int id) { return row.id < id; });
+        if (it != nextRows.end() && it->id == old.id) continue;
+        CatalogRow removed = old;
+        if (removed.hash != 0) {
+            removed.hash = 0;
+            removed.generation = nextGeneration;
+            changed++;
+        }
+        nextRows.insert(it, removed);
+    }
 
-            if (currentColumn == idColumnIndex) {
-                currentID = part;
-            } else if (currentColumn == labelColumnIndex) {
-                currentLabelData = part;
-            }
-            currentColumn++;
+    // 4. 変更があった場合のみ世代を進める
+    rows.swap(nextRows);
+    headerHash = newHeaderHash;
+    if (changed == 0 && !headerChanged) {
+        return false;
+    }
+    catalogGeneration = nextGeneration;
+    Serial.printf("CSVファイル %s を読み直しました（世代 %u、変更 %u 行）。\n",
+                  filePath, (unsigned)catalogGeneration, (unsigned)changed);
+    return true;
+}
+
+/**
+ * @brief 指定の文字列（画像のパスなど）を含む行の世代を進める（画像だけを置き換えた場合など）
+ * @param text 検索する文字列
+ * @return 該当した行の数
+ */
+size_t CSVReader::touchRows(const String &text) {
+    File file = LittleFS.open(filePath, "r");
+    if (!file) return 0;
+    file.readStringUntil('\n'); // 見出し行
+
+    // 1. 文字列を含む行の ID を集める
+    std::vector<int> ids;
+    while (file.available()) {
+        String line = file.readStringUntil('\n');
+        if (line.indexOf(text) != -1) {
+            ids.push_back(line.toInt());
         }
+    }
+    panelMetrics.addFlashRead(METRICS_SRC_CSV, file.position());
+    file.close();
+    if (ids.empty()) return 0;
 
-        // 5. ID が一致したら、指定された列のデータを返す
-        if (currentID == id) {
-            return currentLabelData;
+    // 2. 該当した行に新しい世代を付ける
+    catalogGeneration++;
+    std::sort(ids.begin(), ids.end());
+    for (CatalogRow &row : rows) {
+        if (std::binary_search(ids.begin(), ids.end(), row.id)) {
+            row.generation = catalogGeneration;
         }
     }
+    return ids.size();
+}
 
-    // 6. 該当する ID が見つからなかった場合
-    Serial.printf("ID %s が見つかりませんでした。\n", id.c_str());
-    return "";
+/**
+ * @brief 指定の行が最後に変わった世代
+ * @param rowNumber ID
+ * @return 世代（一度も存在しない ID は 0）
+ */
+uint32_t CSVReader::rowGeneration(int rowNumber) const {
+    const CatalogRow *row = findRow(rowNumber);
+    return row ? row->generation : 0;
 }
 
 /**
- * @brief 指定した ID に対応するファイルパスを取得する（整数 ID 対応版）
- *
- * `getFilePath()` を呼び出して、整数 ID を文字列に変換して検索する。
- *
- * @param IDNumber 検索する ID（整数）
- * @param label 取得するデータの列名
- * @return 見つかった場合は該当データ（ファイルパスなど）を返す / 見つからなかった場合は空文字列
+ * @brief 複数の行のうち最も新しい世代（連結画像など、複数の行から作るキャッシュ用）
  */
-String CSVReader::getPath(int IDNumber, const String &label) {
-    // 1. CSV ファイルを開く
-    File file = LittleFS.open(filePath, "r");
-    if (!file) {
-        Serial.printf("CSVファイル %s を開けませんでした。\n", filePath);
-        return "";
+uint32_t CSVReader::rowsGeneration(const std::vector<int> &rowNumbers) const {
+    uint32_t newest = 0;
+    for (int rowNumber : rowNumbers) {
+        newest = max(newest, rowGeneration(rowNumber));
     }
+    return newest;
+}
 
-    // 2. 整数 ID を文字列に変換して検索
-    String idString = String(IDNumber);
-    String path = getFilePath(idString, label, file);
+// ID で行を探す（二分探索）
+const CatalogRow *CSVReader::findRow(int rowNumber) const {
+    auto it = std::lower_bound(rows.begin(), rows.end(), rowNumber,
+                               [](const CatalogRow &row, int id) { return row.id < id; });
+    return (it != rows.end() && it->id == rowNumber) ? &*it : nullptr;
+}
 
-    // 3. ファイルを閉じて結果を返す
-    file.close();
-    return path;
+// 行の内容のハッシュ（FNV-1a、0 は削除済みの行に使うため避ける）
+uint32_t CSVReader::hashLine(const String &line) {
+    uint32_t hash = 2166136261u;
+    const char *s = line.c_str();
+    for (size_t i = 0; i < line.length(); i++) {
+        hash = (hash ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return hash ? hash : 1;
 }
 
 /**
@@ -19,6 +19,32 @@
 // ===============================
 #include <Arduino.h>  // Arduino 環境の基本ライブラリ
 #include "LittleFS.h" // ESP32 の LittleFS（小型ファイルシステム）を使用
+#include <vector>     // 行ごとの世代
+
+/**
+ * @brief カタログ（CSV）の 1 行分の世代
+ *
+ * `generation` はその行の内容が最後に変わったときのカタログの世代。
+ * 行が削除された場合も、削除した世代を残す（`hash` は 0）。
+ */
+struct CatalogRow {
+    int id = 0;              // ID 列の値
+    uint32_t hash = 0;       // 行の内容のハッシュ（FNV-1a）
+    uint32_t generation = 0; // 行が最後に変わった世代
+};
+
+/**
+ * @brief `CSVReader::lookup()` でまとめて検索する 1 件分（ID と列名、結果）
+ */
+struct CatalogQuery {
+    int id = 0;      // 検索する ID
+    String label;    // 取得する列名
+    String value;    // 取得したデータ（該当なしの場合は空文字列）
+    bool found = false; // 該当する行と列があった場合 true
+
+    CatalogQuery() {}
+    CatalogQuery(int rowNumber, const String &columnLabel) : id(rowNumber), label(columnLabel) {}
+};
 
 // ===============================
 //      CSVReader クラスの定義
@@ -47,7 +73,7 @@ public:
      * @brief 指定した行番号と列ラベルからデータを取得
      *
      * ID（数値）に対応するデータを取得する。
-     * 内部で `open()` を呼び出してファイルを開閉する。
+     * 1 件だけの `lookup()` として検索する（複数の列が必要な場合は `lookup()` でまとめる）。
      *
      * @param rowNumber 検索対象の ID（数値）
      * @param label 取得したいデータの列名
@@ -55,8 +81,64 @@ public:
      */
     String getPath(int rowNumber, const String &label);
 
+    /**
+     * @brief 複数の ID・列をまとめて検索する（ファイルを 1 回だけ先頭から読む）
+     *
+     * 見出し行を 1 回だけ解析し、該当する行がすべて見つかった時点で読み込みを終える。
+     * 同じ ID の複数の列（日本語 / 英語など）は同じ行から取得する。
+     *
+     * @param queries 検索する ID と列名（結果は各要素の `value` / `found` に格納）
+     * @return 見つかった件数
+     */
+    size_t lookup(std::vector<CatalogQuery> &queries);
+
+    /**
+     * @brief CSV を読み直し、内容が変わった行の世代を進める
+     *
+     * 行ごとのハッシュを前回と比べ、変わった行・追加された行・削除された行だけに新しい世代を付ける。
+     * 見出し行が変わった場合（列の追加・並べ替え）はすべての行を変更とみなす。
+     *
+     * @return 変更があった場合 true（カタログの世代が 1 進む）
+     */
+    bool reload();
+
+    /**
+     * @brief 指定の文字列（画像のパスなど）を含む行の世代を進める（画像だけを置き換えた場合など）
+     * @param text 検索する文字列
+     * @return 該当した行の数
+     */
+    size_t touchRows(const String &text);
+
+    /**
+     * @brief カタログの世代（`reload()` で変更があるたびに 1 進む、未読み込みの場合は 0）
+     */
+    uint32_t generation() const { return catalogGeneration; }
+
+    /**
+     * @brief 指定の行が最後に変わった世代
+     *
+     * 画像などのキャッシュは作成時の値を記録しておき、値が変わっていれば作り直す。
+     *
+     * @param rowNumber ID
+     * @return 世代（一度も存在しない ID は 0）
+     */
+    uint32_t rowGeneration(int rowNumber) const;
+
+    /**
+     * @brief 複数の行のうち最も新しい世代（連結画像など、複数の行から作るキャッシュ用）
+     */
+    uint32_t rowsGeneration(const std::vector<int> &rowNumbers) const;
+
+    const char *path() const { return filePath; }
+
 private:
     const char *filePath; // CSV ファイルのパス（LittleFS に保存）
+    std::vector<CatalogRow> rows;    // ID 順に並べた行ごとの世代
+    uint32_t headerHash = 0;         // 見出し行のハッシュ
+    uint32_t catalogGeneration = 0;  // カタログの世代
+
+    const CatalogRow *findRow(int rowNumber) const;
+    static uint32_t hashLine(const String &line);
 
     /**
      * @brief CSV ファイルを開く
@@ -74,29 +156,6 @@ private:
      * ファイルが開いている場合に適切にクローズする。
      */
     void close();
-
-    /**
-     * @brief 指定したラベル（列名）の列インデックスを取得
-     *
-     * CSV のヘッダー行を解析し、指定した列名が何番目にあるかを取得する。
-     *
-     * @param label 検索する列名
-     * @return 列のインデックス（0 から始まる）/ 見つからない場合は -1
-     */
-    int getColumnIndex(const String &label);
-
-    /**
-     * @brief 指定した ID に対応するデータを取得（内部処理用）
-     *
-     * CSV を 1 行ずつ解析し、指定した ID に対応する列データを取得する。
-     * `open()` を使用せず、既に開かれているファイルオブジェクトを使用する。
-     *
-     * @param id 検索対象の ID（文字列）
-     * @param label 取得したいデータの列名
-     * @param file CSV ファイルオブジェクト（すでに開かれている状態）
-     * @return 取得したデータ（該当なしの場合は空文字列）
-     */
-    String getFilePath(const String &id, const String &label, File &file);
 };
 
 /**
@@ -0,0 +1,104 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "DecodePool.h"
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+DecodePool decodePool;
+
+/**
+ * @brief ワーカーのタスクを作成する（`setup()` で 1 回だけ呼ぶ）
+ * @return 作成できた場合 true
+ */
+bool DecodePool::begin() {
+    if (worker) return true;
+
+    // 1. ワーカーとの合図を用意
+    startSignal = xSemaphoreCreateBinary();
+    doneSignal = xSemaphoreCreateBinary();
+    if (!startSignal || !doneSignal) {
+        Serial.println("展開ワーカーの合図を作成できませんでした（呼び出し元のみで展開します）。");
+        return false;
+    }
+
+    // 2. コア 0 にワーカーを作成
+    if (xTaskCreatePinnedToCore(workerTask, "Decode_Task", DECODE_POOL_STACK_SIZE, this,
+                                DECODE_POOL_PRIORITY, &worker, DECODE_POOL_CORE) != pdPASS) {
+        Serial.println("展開ワーカーを作成できませんでした（呼び出し元のみで展開します）。");
+        worker = nullptr;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief `count` 件の処理をワーカーと分担して実行し、すべて終わるまで待つ
+ *
+ * 処理はあらかじめ分けず、両方のタスクが次の番号を 1 つずつ取っていく（大きさの違う画像でも偏らない）。
+ *
+ * @param count 処理の件数
+ * @param job 1 件分の処理
+ * @param context `job` に渡す任意のポインタ
+ */
+void DecodePool::run(size_t count, Job job, void *context) {
+    if (count == 0) return;
+
+    // 1. 1 件だけ・ワーカーが無い・ワーカーと同じコアの場合は呼び出し元ですべて実行
+    if (count == 1 || !worker || xPortGetCoreID() == DECODE_POOL_CORE) {
+        for (size_t i = 0; i < count; i++) {
+            job(i, context);
+        }
+        return;
+    }
+    TRACE_SCOPE("DecodePool::run");
+
+    // 2. 処理の一覧を設定し、ワーカーに開始を知らせる
+    currentJob = job;
+    currentContext = context;
+    jobCount = count;
+    nextIndex.store(0);
+    parallelCount++;
+    xSemaphoreGive(startSignal);
+
+    // 3. 呼び出し元も同じ一覧から処理を取って実行
+    drain();
+
+    // 4. ワーカーが担当分を終えるまで待つ（ここで全件の完了がそろう）
+    xSemaphoreTake(doneSignal, portMAX_DELAY);
+    currentJob = nullptr;
+    currentContext = nullptr;
+    jobCount = 0;
+}
+
+// 残っている処理を 1 件ずつ取って実行する（実行した件数を返す）
+size_t DecodePool::drain() {
+    size_t done = 0;
+    for (size_t i = nextIndex.fetch_add(1); i < jobCount; i = nextIndex.fetch_add(1)) {
+        currentJob(i, currentContext);
+        done++;
+    }
+    return done;
+}
+
+// ワーカーのタスク（開始の合図を待ち、処理が無くなるまで実行して完了を知らせる）
+void DecodePool::workerTask(void *pvParameters) {
+    DecodePool *pool = static_cast<DecodePool *>(pvParameters);
+    while (true) {
+        xSemaphoreTake(pool->startSignal, portMAX_DELAY);
+        pool->workerCount += pool->drain();
+        xSemaphoreGive(pool->doneSignal);
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef DECODEPOOL_H
+#define DECODEPOOL_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h> // Arduino 環境の基本ライブラリ（FreeRTOS を含む）
+#include <atomic>    // 処理を割り当てる番号（タスク間で共有）
+
+// ===============================
+//      展開ワーカーの設定
+// ===============================
+#define DECODE_POOL_CORE 0             // ワーカーを動かすコア（パネル制御タスクと反対側）
+#define DECODE_POOL_STACK_SIZE 4096    // ワーカーのスタックサイズ（バイト）
+#define DECODE_POOL_PRIORITY 1         // ワーカーの優先度（Web サーバーのタスクと同じ）
+
+// ===============================
+//      DecodePool クラスの定義
+// ===============================
+/**
+ * @brief 画像の展開を 2 つのコアで分担する
+ *
+ * パネル制御タスク（コア 1）が `run()` を呼ぶと、同じ処理の一覧をコア 0 のワーカーと取り合って実行し、
+ * すべて終わるまで待ってから戻る（表示内容を切り替えるのは `run()` が戻った後）。
+ * 各処理は自分の書き込み先（画像ごとのメモリ、または連結画像の担当する列）にだけ書き込むこと。
+ *
+ * BMP の読み込み用のバッファはコアごとに 1 つなので（`BMPDecoder`）、コア 0 で `run()` を呼んだ場合や、
+ * `begin()` の前はワーカーを使わずに呼び出し元ですべて実行する。
+ * `run()` はパネル制御タスクからのみ呼ぶ（同時に 2 つ以上実行しない）。
+ */
+class DecodePool {
+public:
+    /**
+     * @brief 1 件分の処理
+     * @param index 処理の番号（0 から `count - 1`）
+     * @param context `run()` に渡した任意のポインタ
+     */
+    typedef void (*Job)(size_t index, void *context);
+
+    /**
+     * @brief ワーカーのタスクを作成する（`setup()` で 1 回だけ呼ぶ）
+     * @return 作成できた場合 true
+     */
+    bool begin();
+
+    /**
+     * @brief `count` 件の処理をワーカーと分担して実行し、すべて終わるまで待つ
+     * @param count 処理の件数
+     * @param job 1 件分の処理
+     * @param context `job` に渡す任意のポインタ
+     */
+    void run(size_t count, Job job, void *context);
+
+    unsigned long parallelRuns() const { return parallelCount; } // ワーカーと分担した回数
+    unsigned long workerJobs() const { return workerCount; }     // ワーカーが実行した処理の数
+
+private:
+    TaskHandle_t worker = nullptr;
+    SemaphoreHandle_t startSignal = nullptr; // 処理の開始をワーカーに知らせる
+    SemaphoreHandle_t doneSignal = nullptr;  // ワーカーが担当分を終えたことを知らせる
+    Job currentJob = nullptr;
+    void *currentContext = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex{0};        // 次に実行する処理の番号（両方のタスクで取り合う）
+    unsigned long parallelCount = 0;
+    std::atomic<unsigned long> workerCount{0};
+
+    size_t drain();
+    static void workerTask(void *pvParameters);
+};
+
+extern DecodePool decodePool; // 全体で共有する展開ワーカー
+
+#endif // DECODEPOOL_H
@@ -0,0 +1,102 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "FrameGovernor.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+FrameGovernor frameGovernor;
+
+// 処理ごとの後回しにする最長時間（ミリ秒）
+static const unsigned long maxDeferMs[FRAME_WORK_COUNT] = {
+    FRAME_TOGGLE_MAX_DEFER_MS,
+    FRAME_BACKGROUND_MAX_DEFER_MS,
+};
+
+/**
+ * @brief フレームの開始を記録する（描画ループの先頭で呼ぶ）
+ */
+void FrameGovernor::beginFrame() {
+    frameStart = micros();
+}
+
+/**
+ * @brief フレームの終了を記録し、予算を超えた場合は締め切りに遅れた回数に数える（描画ループの末尾で呼ぶ）
+ */
+void FrameGovernor::endFrame() {
+    uint32_t us = micros() - frameStart;
+    frames.fetch_add(1, std::memory_order_relaxed);
+    lastMissed = us > FRAME_BUDGET_US;
+    if (lastMissed) missed.fetch_add(1, std::memory_order_relaxed);
+    if (us > worstUs.load(std::memory_order_relaxed)) worstUs.store(us, std::memory_order_relaxed);
+
+    // 要求されなくなった処理（表示内容が変わってトグルが無くなった場合など）は後回しの記録を消去
+    for (int work = 0; work < FRAME_WORK_COUNT; work++) {
+        if (!requested[work]) deferredSince[work] = 0;
+        requested[work] = false;
+    }
+}
+
+/**
+ * @brief 処理を今のフレームで実行してよいか
+ *
+ * 直前のフレームが予算内で、今のフレームの経過時間と見込み時間の合計が予算に収まる場合に実行する。
+ * 優先度の高い処理を後回しにしている間は、それより低い処理も実行しない。
+ *
+ * @param work 処理の種類
+ * @return 実行する場合 true（false の場合は次のフレームで改めて呼ぶ）
+ */
+bool FrameGovernor::admit(FrameWork work) {
+    // 1. 予算に収まる見込みか
+    requested[work] = true;
+    uint32_t elapsed = micros() - frameStart;
+    bool fits = !lastMissed && elapsed + estimateUs[work] <= FRAME_BUDGET_US;
+    for (int higher = 0; higher < work; higher++) {
+        if (deferredSince[higher] != 0) fits = false;
+    }
+    if (fits) {
+        deferredSince[work] = 0;
+        return true;
+    }
+
+    // 2. 後回しにする（最長時間を過ぎた場合は実行）
+    unsigned long now = millis();
+    if (deferredSince[work] == 0) {
+        deferredSince[work] = now ? now : 1; // 0 は後回しにしていないことを表すため避ける
+        deferred[work].fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (now - deferredSince[work] >= maxDeferMs[work]) {
+        deferredSince[work] = 0;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 実行した処理の時間を記録する（見込み時間の更新）
+ *
+ * 長かった場合はその時間に合わせ、短かった場合は 1/8 ずつ近づける（重い処理の直後に油断しない）。
+ *
+ * @param work 処理の種類
+ * @param us 処理時間（マイクロ秒）
+ */
+void FrameGovernor::finished(FrameWork work, uint32_t us) {
+    uint32_t &estimate = estimateUs[work];
+    if (us >= estimate) {
+        estimate = us;
+    } else {
+        estimate -= (estimate - us + 7) / 8;
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef FRAMEGOVERNOR_H
+#define FRAMEGOVERNOR_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h> // Arduino 環境の基本ライブラリ
+#include <atomic>    // 集計値（/metrics から読み取る）
+
+// ===============================
+//      フレームの予算の設定
+// ===============================
+#define FRAME_BUDGET_US 20000              // 1 フレーム（描画ループ 1 周）の予算（スクロール 33.3 px/s の 1 ピクセル 30ms より短く）
+#define FRAME_TOGGLE_MAX_DEFER_MS 250      // トグルを遅らせる最長時間（過ぎた場合は予算によらず実行）
+#define FRAME_BACKGROUND_MAX_DEFER_MS 1000 // 先読み・起動用の保存を遅らせる最長時間
+#define FRAME_COMMAND_SETTLE_MS 100        // 表示内容の変更を受けてから切り替えるまでの待ち時間（続けて届いた変更はまとめる）
+
+/**
+ * @brief 予算に応じて後回しにする処理の種類（優先度の高い順）
+ *
+ * スクロールと切り替え効果は常に実行し、予算に収まらない場合はトグル、次に先読みを後回しにする。
+ */
+enum FrameWork {
+    FRAME_WORK_TOGGLE,     // トグルの切り替え（toggleCacheBMP / toggleBMP / プリセットの段階）
+    FRAME_WORK_BACKGROUND, // 先読み（AssetCache::pump）・起動用の保存（BootState::update）
+    FRAME_WORK_COUNT
+};
+
+// ===============================
+//      FrameGovernor クラスの定義
+// ===============================
+/**
+ * @brief 描画ループ 1 周ごとの処理時間を予算（`FRAME_BUDGET_US`）と比べ、後回しにする処理を決める
+ *
+ * 画像の読み込みや表示内容の作成でフレームが遅れた場合に、同じフレームにトグルや先読みを重ねると
+ * スクロールの次の 1 ピクセルがさらに遅れる。そのため次の順で後回しにする。
+ * 1. 直前のフレームが予算を超えた、または今のフレームの残りに収まらない見込みの処理は次のフレームに回す
+ * 2. トグルを後回しにしている間は先読みも行わない
+ * 3. 後回しが最長時間（`FRAME_TOGGLE_MAX_DEFER_MS` / `FRAME_BACKGROUND_MAX_DEFER_MS`）を過ぎた場合は実行する
+ *
+ * 処理ごとの見込み時間は、実行した時間が長ければすぐに、短ければ少しずつ更新する。
+ * パネル制御タスクからのみ使用する（集計値の読み取りは他のタスクからも可）。
+ */
+class FrameGovernor {
+public:
+    /**
+     * @brief フレームの開始を記録する（描画ループの先頭で呼ぶ）
+     */
+    void beginFrame();
+
+    /**
+     * @brief フレームの終了を記録し、予算を超えた場合は締め切りに遅れた回数に数える（描画ループの末尾で呼ぶ）
+     */
+    void endFrame();
+
+    /**
+     * @brief 処理を今のフレームで実行してよいか
+     * @param work 処理の種類
+     * @return 実行する場合 true（false の場合は次のフレームで改めて呼ぶ）
+     */
+    bool admit(FrameWork work);
+
+    /**
+     * @brief 実行した処理の時間を記録する（見込み時間の更新）
+     * @param work 処理の種類
+     * @param us 処理時間（マイクロ秒）
+     */
+    void finished(FrameWork work, uint32_t us);
+
+    uint32_t frameCount() const { return frames.load(std::memory_order_relaxed); }
+    uint32_t missedDeadlines() const { return missed.load(std::memory_order_relaxed); }
+    uint32_t deferredCount(FrameWork work) const { return deferred[work].load(std::memory_order_relaxed); }
+    uint32_t worstFrameUs() const { return worstUs.load(std::memory_order_relaxed); }
+
+private:
+    unsigned long frameStart = 0;                        // フレームの開始時刻（マイクロ秒）
+    bool lastMissed = false;                             // 直前のフレームが予算を超えたか
+    uint32_t estimateUs[FRAME_WORK_COUNT] = {};          // 処理ごとの見込み時間
+    unsigned long deferredSince[FRAME_WORK_COUNT] = {};  // 後回しにし始めた時刻（ミリ秒、0: 後回しにしていない）
+    bool requested[FRAME_WORK_COUNT] = {};               // 今のフレームで `admit()` を呼んだか
+    std::atomic<uint32_t> frames{0};
+    std::atomic<uint32_t> missed{0};
+    std::atomic<uint32_t> deferred[FRAME_WORK_COUNT] = {};
+    std::atomic<uint32_t> worstUs{0};
+};
+
+extern FrameGovernor frameGovernor; // 全体で共有するフレームの予算管理
+
+/**
+ * @brief スコープの処理時間を `FrameGovernor::finished()` に記録する
+ *
+ * `if (frameGovernor.admit(FRAME_WORK_TOGGLE)) { FrameWorkTimer timer(FRAME_WORK_TOGGLE); ... }` のように使う。
+ */
+class FrameWorkTimer {
+public:
+    explicit FrameWorkTimer(FrameWork work) : work(work), start(micros()) {}
+    ~FrameWorkTimer() { frameGovernor.finished(work, micros() - start); }
+
+private:
+    FrameWork work;
+    unsigned long start;
+};
+
+#endif // FRAMEGOVERNOR_H
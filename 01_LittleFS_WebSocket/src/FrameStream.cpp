@@ -0,0 +1,422 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "FrameStream.h"
+#include "BootState.h"   // 行の圧縮（BootState::encodeFrame）
+#include "AssetUpload.h" // CRC32（PNG のチャンク）
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+FrameStream frameStream;
+
+// 配信の応答ヘッダー（本文はフレームごとに 1 チャンク）
+static const char STREAM_RESPONSE[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Cache-Control: no-store\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+// 空きが無い場合の応答
+static const char BUSY_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 16\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "too many viewers";
+
+/**
+ * @brief 公開用のバッファと配信タスクを用意する（`setup()` で 1 回だけ呼ぶ）
+ * @param width フレームの横幅
+ * @param height フレームの縦幅
+ * @return 用意できた場合 true
+ */
+bool FrameStream::begin(int width, int height) {
+    if (published) return true;
+
+    // 1. 公開用のバッファと排他制御
+    published = (uint16_t *)calloc((size_t)width * height, sizeof(uint16_t));
+    lock = xSemaphoreCreateMutex();
+    clientQueue = xQueueCreate(FRAME_STREAM_MAX_CLIENTS, sizeof(WiFiClient *));
+    if (!published || !lock || !clientQueue) {
+        Serial.println("フレーム配信のメモリを確保できませんでした（/frame は使用できません）。");
+        free(published);
+        published = nullptr;
+        return false;
+    }
+    frameWidth = width;
+    frameHeight = height;
+
+    // 2. コア 0 に配信タスクを作成（失敗しても `/frame` は使用できる）
+    if (xTaskCreatePinnedToCore(streamTask, "Frame_Task", FRAME_STREAM_STACK_SIZE, this,
+                                FRAME_STREAM_PRIORITY, &task, FRAME_STREAM_CORE) != pdPASS) {
+        Serial.println("フレーム配信のタスクを作成できませんでした（/frame/stream は使用できません）。");
+        task = nullptr;
+    }
+    return true;
+}
+
+/**
+ * @brief 表示中のフレームを公開する（パネル制御タスクのループで、表示の更新後に呼ぶ）
+ *
+ * 変化した行だけを写す。読み取り中の場合は待たずに次のループへ回す。
+ *
+ * @param frame 表示中の内容（パネル全体の RGB565、NULL の場合は何もしない）
+ * @param now 現在時刻（ミリ秒）
+ */
+void FrameStream::publish(const uint16_t *frame, unsigned long now) {
+    if (!published || !frame) return;
+
+    // 1. 閲覧が無い・間隔内の場合は何もしない（`/frame` が待っている場合は間隔によらず写す）
+    bool wanted = snapshotWanted.load();
+    if (!wanted && (clients.load() == 0 || now - publishedAt < FRAME_STREAM_INTERVAL_MS)) return;
+
+    // 2. 配信タスク・Web サーバーのタスクが読み取り中の場合は待たない
+    if (xSemaphoreTake(lock, 0) != pdTRUE) return;
+    TRACE_SCOPE("FrameStream::publish");
+
+    // 3. 変化した行だけを写す
+    bool changed = publishedSequence.load() == 0;
+    size_t rowBytes = (size_t)frameWidth * sizeof(uint16_t);
+    for (int y = 0; y < frameHeight; y++) {
+        const uint16_t *src = frame + (size_t)y * frameWidth;
+        uint16_t *dst = published + (size_t)y * frameWidth;
+        if (memcmp(src, dst, rowBytes) != 0) {
+            memcpy(dst, src, rowBytes);
+            changed = true;
+        }
+    }
+    if (changed) publishedSequence++;
+    xSemaphoreGive(lock);
+
+    publishedAt = now;
+    if (wanted) snapshotWanted.store(false);
+}
+
+/**
+ * @brief 公開中のフレームを取り出す（新しいフレームを `FRAME_STREAM_SNAPSHOT_WAIT_MS` まで待つ）
+ *
+ * パネル制御タスクが作成中などで待ちきれない場合は、最後に公開したフレームを返す。
+ *
+ * @param out 格納先（`width()` × `height()` 画素）
+ * @param sequence 取り出したフレームの番号
+ * @return 取り出せた場合 true（一度も公開していない場合は false）
+ */
+bool FrameStream::snapshot(uint16_t *out, uint32_t &sequence) {
+    if (!published) return false;
+    TRACE_SCOPE("FrameStream::snapshot");
+
+    // 1. パネル制御タスクに公開を頼み、次のループを待つ
+    snapshotWanted.store(true);
+    unsigned long start = millis();
+    while (snapshotWanted.load() && millis() - start < FRAME_STREAM_SNAPSHOT_WAIT_MS) {
+        vTaskDelay(5 / portTICK_PERIOD_MS);
+    }
+
+    // 2. 公開中のフレームを写す
+    xSemaphoreTake(lock, portMAX_DELAY);
+    memcpy(out, published, (size_t)frameWidth * frameHeight * sizeof(uint16_t));
+    sequence = publishedSequence.load();
+    xSemaphoreGive(lock);
+    return sequence != 0;
+}
+
+/**
+ * @brief 配信する接続を登録する（応答のヘッダーは配信タスクが送る）
+ * @param client 接続（登録した場合は配信タスクが引き継ぐ）
+ * @return 登録した場合 true（空きが無い・`begin()` の前は false）
+ */
+bool FrameStream::addClient(const WiFiClient &client) {
+    if (!task || clients.load() >= FRAME_STREAM_MAX_CLIENTS) return false;
+
+    // WiFiClient は接続を共有するため、Web サーバーが自分の分を手放しても接続は切れない
+    WiFiClient *copy = new WiFiClient(client);
+    if (xQueueSend(clientQueue, &copy, 0) != pdTRUE) {
+        delete copy;
+        return false;
+    }
+    return true;
+}
+
+// ===============================
+//      配信タスク
+// ===============================
+// 1 フレーム分をチャンクとして送る
+static bool writeChunk(WiFiClient &client, const uint8_t *data, size_t length) {
+    char size[12];
+    int sizeLength = snprintf(size, sizeof(size), "%X\r\n", (unsigned)length);
+    return client.write((const uint8_t *)size, sizeLength) == (size_t)sizeLength &&
+           client.write(data, length) == length &&
+           client.write((const uint8_t *)"\r\n", 2) == 2;
+}
+
+// 配信タスク（接続があれば公開中のフレームの差分を送り続ける）
+void FrameStream::streamLoop() {
+    WiFiClient active[FRAME_STREAM_MAX_CLIENTS];
+    size_t pixels = (size_t)frameWidth * frameHeight;
+    uint16_t *prev = nullptr;     // 最後に送ったフレーム
+    uint16_t *cur = nullptr;      // 今回送るフレーム
+    uint8_t *message = nullptr;   // 送信する差分
+    uint32_t sentSequence = 0;
+    unsigned long sentAt = 0;
+    bool keyframe = true;
+
+    while (true) {
+        // 1. 登録された接続を受け取る（配信中の接続が無い場合は届くまで待つ）
+        WiFiClient *incoming = nullptr;
+        TickType_t wait = clients.load() == 0 ? portMAX_DELAY : 0;
+        while (xQueueReceive(clientQueue, &incoming, wait) == pdTRUE) {
+            wait = 0;
+            bool added = false;
+            for (size_t i = 0; i < FRAME_STREAM_MAX_CLIENTS && !added; i++) {
+                if (active[i].connected()) continue;
+                active[i] = *incoming;
+                active[i].write((const uint8_t *)STREAM_RESPONSE, sizeof(STREAM_RESPONSE) - 1);
+                keyframe = true; // 新しい接続には全体を送る
+                added = true;
+            }
+            if (!added) incoming->write((const uint8_t *)BUSY_RESPONSE, sizeof(BUSY_RESPONSE) - 1);
+            delete incoming;
+        }
+
+        // 2. 配信中の接続を数える（無くなった場合は作業用のメモリを解放）
+        size_t count = 0;
+        for (size_t i = 0; i < FRAME_STREAM_MAX_CLIENTS; i++) {
+            if (active[i].connected()) count++;
+        }
+        clients.store(count);
+        if (count == 0) {
+            free(prev);
+            free(cur);
+            free(message);
+            prev = cur = nullptr;
+            message = nullptr;
+            continue;
+        }
+        if (!prev) {
+            prev = (uint16_t *)malloc(pixels * sizeof(uint16_t));
+            cur = (uint16_t *)malloc(pixels * sizeof(uint16_t));
+            message = (uint8_t *)malloc(maxMessageSize(frameWidth, frameHeight));
+            if (!prev || !cur || !message) {
+                Serial.println("フレーム配信の作業用メモリを確保できませんでした。");
+                for (size_t i = 0; i < FRAME_STREAM_MAX_CLIENTS; i++) active[i].stop();
+                clients.store(0);
+                free(prev);
+                free(cur);
+                free(message);
+                prev = cur = nullptr;
+                message = nullptr;
+                continue;
+            }
+            keyframe = true;
+        }
+
+        // 3. 次のフレームを待つ（変化が無い場合も、一定間隔で空のフレームを送って切断を検出する）
+        vTaskDelay(FRAME_STREAM_INTERVAL_MS / portTICK_PERIOD_MS);
+        unsigned long now = millis();
+        if (!keyframe && publishedSequence.load() == sentSequence &&
+            now - sentAt < FRAME_STREAM_KEEPALIVE_MS) {
+            continue;
+        }
+
+        // 4. 公開中のフレームを写し、前回送ったフレームとの差分を作成
+        xSemaphoreTake(lock, portMAX_DELAY);
+        memcpy(cur, published, pixels * sizeof(uint16_t));
+        uint32_t sequence = publishedSequence.load();
+        xSemaphoreGive(lock);
+        size_t length;
+        {
+            TRACE_SCOPE("FrameStream::send");
+            length = encodeDelta(prev, cur, frameWidth, frameHeight, sequence, keyframe, message);
+
+            // 5. 各接続に送る（送れなかった接続は切断）
+            for (size_t i = 0; i < FRAME_STREAM_MAX_CLIENTS; i++) {
+                if (active[i].connected() && !writeChunk(active[i], message, length)) {
+                    active[i].stop();
+                }
+            }
+        }
+        uint16_t *swap = prev;
+        prev = cur;
+        cur = swap;
+        sentSequence = sequence;
+        sentAt = now;
+        keyframe = false;
+        sentCount++;
+        sentBytes += length;
+    }
+}
+
+void FrameStream::streamTask(void *pvParameters) {
+    static_cast<FrameStream *>(pvParameters)->streamLoop();
+}
+
+// ===============================
+//      フレームの形式
+// ===============================
+size_t FrameStream::maxMessageSize(int width, int height) {
+    // 行ごとに区間の 6 バイトと、圧縮した画素（最悪の場合でも 128 画素ごとに 1 バイト増えるだけ）
+    return sizeof(FrameStreamHeader) + (size_t)height * (6 + (size_t)width * 2 + width / 128 + 1);
+}
+
+/**
+ * @brief 前のフレームとの差分を配信用の形式（`FrameStreamHeader` と区間）で作成する
+ *
+ * 行ごとに、最初と最後の変化した画素の間を 1 つの区間にする（変化が無い行は含めない）。
+ *
+ * @return 書き込んだバイト数
+ */
+size_t FrameStream::encodeDelta(const uint16_t *prev, const uint16_t *cur, int width, int height,
+                                uint32_t sequence, bool keyframe, uint8_t *out) {
+    size_t used = sizeof(FrameStreamHeader);
+    uint16_t spanCount = 0;
+    for (int y = 0; y < height; y++) {
+        // 1. 行の中で変化した範囲を探す
+        const uint16_t *row = cur + (size_t)y * width;
+        int first = 0;
+        int last = width - 1;
+        if (!keyframe) {
+            const uint16_t *old = prev + (size_t)y * width;
+            while (first < width && row[first] == old[first]) first++;
+            if (first == width) continue;
+            while (last > first && row[last] == old[last]) last--;
+        }
+
+        // 2. 区間（行・最初の画素・画素数）と圧縮した画素を書き込む
+        uint16_t span[3] = { (uint16_t)y, (uint16_t)first, (uint16_t)(last - first + 1) };
+        memcpy(out + used, span, sizeof(span));
+        used += sizeof(span);
+        used += BootState::encodeFrame(row + first, span[2], out + used);
+        spanCount++;
+    }
+
+    // 3. ヘッダー
+    FrameStreamHeader head;
+    memcpy(head.magic, "LFS1", 4);
+    head.flags = keyframe ? 1 : 0;
+    head.spanCount = spanCount;
+    head.sequence = sequence;
+    head.width = width;
+    head.height = height;
+    head.dataBytes = used - sizeof(FrameStreamHeader);
+    memcpy(out, &head, sizeof(head));
+    return used;
+}
+
+// ビッグエンディアンで 4 バイト書き込む（PNG のチャンクの長さ・CRC）
+static void putBE32(uint8_t *out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+// 無圧縮の deflate ブロック（最大 65535 バイトごとに区切る）と Adler-32 を書き込む
+struct StoredDeflate {
+    uint8_t *out;
+    size_t used;
+    size_t remaining;      // 残りのデータのバイト数
+    size_t blockLeft = 0;  // 現在のブロックの残りのバイト数
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    void put(uint8_t value) {
+        if (blockLeft == 0) {
+            // ブロックのヘッダー（最後のブロックかどうか・長さとその補数）
+            blockLeft = remaining > 65535 ? 65535 : remaining;
+            out[used++] = remaining == blockLeft ? 1 : 0;
+            out[used++] = blockLeft & 0xFF;
+            out[used++] = blockLeft >> 8;
+            out[used++] = ~blockLeft & 0xFF;
+            out[used++] = (~blockLeft >> 8) & 0xFF;
+        }
+        out[used++] = value;
+        blockLeft--;
+        remaining--;
+        a = (a + value) % 65521;
+        b = (b + a) % 65521;
+    }
+};
+
+/**
+ * @brief RGB565 のフレームを PNG（24 ビット、無圧縮の deflate）に変換したときのバイト数
+ */
+size_t FrameStream::pngSize(int width, int height) {
+    size_t raw = (size_t)height * (1 + (size_t)width * 3); // 行ごとにフィルターの 1 バイト
+    size_t blocks = raw == 0 ? 1 : (raw + 65534) / 65535;
+    size_t zlib = 2 + blocks * 5 + raw + 4;
+    return 8 + (12 + 13) + (12 + zlib) + 12;
+}
+
+/**
+ * @brief RGB565 のフレームを PNG に変換する
+ *
+ * 圧縮は行わない（パネルの大きさでは数十 KB に収まり、ESP32 の負荷を抑えられる）。
+ *
+ * @return 書き込んだバイト数
+ */
+size_t FrameStream::encodePNG(const uint16_t *frame, int width, int height, uint8_t *out) {
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    size_t used = 0;
+    memcpy(out, SIGNATURE, sizeof(SIGNATURE));
+    used += sizeof(SIGNATURE);
+
+    // 1. IHDR（8 ビットの RGB、インターレース無し）
+    putBE32(out + used, 13);
+    memcpy(out + used + 4, "IHDR", 4);
+    putBE32(out + used + 8, width);
+    putBE32(out + used + 12, height);
+    const uint8_t format[5] = { 8, 2, 0, 0, 0 };
+    memcpy(out + used + 16, format, sizeof(format));
+    putBE32(out + used + 21, AssetUpload::crc32(0, out + used + 4, 17));
+    used += 25;
+
+    // 2. IDAT（行ごとにフィルター無しの 1 バイトと RGB を、無圧縮の zlib で格納）
+    size_t raw = (size_t)height * (1 + (size_t)width * 3);
+    size_t idatStart = used;
+    memcpy(out + used + 4, "IDAT", 4);
+    used += 8;
+    out[used++] = 0x78; // zlib のヘッダー（deflate、32KB の窓）
+    out[used++] = 0x01;
+    StoredDeflate deflate = { out, used, raw };
+    for (int y = 0; y < height; y++) {
+        deflate.put(0);
+        const uint16_t *row = frame + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            uint16_t pixel = row[x];
+            uint8_t r = (pixel >> 11) & 0x1F;
+            uint8_t g = (pixel >> 5) & 0x3F;
+            uint8_t b = pixel & 0x1F;
+            deflate.put((r << 3) | (r >> 2));
+            deflate.put((g << 2) | (g >> 4));
+            deflate.put((b << 3) | (b >> 2));
+        }
+    }
+    used = deflate.used;
+    putBE32(out + used, (deflate.b << 16) | deflate.a);
+    used += 4;
+    putBE32(out + idatStart, used - idatStart - 8);
+    putBE32(out + used, AssetUpload::crc32(0, out + idatStart + 4, used - idatStart - 4));
+    used += 4;
+
+    // 3. IEND
+    putBE32(out + used, 0);
+    memcpy(out + used + 4, "IEND", 4);
+    putBE32(out + used + 8, AssetUpload::crc32(0, out + used + 4, 4));
+    used += 12;
+    return used;
+}
@@ -0,0 +1,158 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h> // Arduino 環境の基本ライブラリ（FreeRTOS を含む）
+#include <WiFi.h>    // WiFiClient（配信先の接続）
+#include <atomic>    // 表示中のフレームの番号・閲覧の有無（タスク間で共有）
+
+// ===============================
+//      フレーム配信の設定
+// ===============================
+#define FRAME_STREAM_INTERVAL_MS 100        // フレームを写す・配信する最短間隔（最大 10 fps）
+#define FRAME_STREAM_KEEPALIVE_MS 1000      // 変化が無いときに空のフレームを送る間隔（切断の検出用）
+#define FRAME_STREAM_MAX_CLIENTS 2          // 同時に配信できる接続数
+#define FRAME_STREAM_SNAPSHOT_WAIT_MS 250   // `/frame` で新しいフレームを待つ最長時間
+#define FRAME_STREAM_CORE 0                 // 配信タスクを動かすコア（パネル制御タスクと反対側）
+#define FRAME_STREAM_STACK_SIZE 4096        // 配信タスクのスタックサイズ（バイト）
+#define FRAME_STREAM_PRIORITY 1             // 配信タスクの優先度（Web サーバーのタスクと同じ）
+
+/**
+ * @brief 配信するフレームのヘッダー（リトルエンディアン）
+ *
+ * ヘッダーの後に、変化した行ごとに次の区間を `spanCount` 個（合計 `dataBytes` バイト）続ける。
+ * - `uint16_t y`、`uint16_t x`、`uint16_t length`: 行と、変化した最初の画素・画素数
+ * - 続けて `length` 画素の RGB565 を `BootFrameHeader` と同じ形式で圧縮したデータ
+ *
+ * キーフレーム（`flags` の最下位ビットが 1）はすべての行を含む（接続した直後に送る）。
+ * 変化が無い間も `FRAME_STREAM_KEEPALIVE_MS` おきに区間が 0 個のフレームを送る。
+ */
+struct __attribute__((packed)) FrameStreamHeader {
+    char magic[4];       // "LFS1"
+    uint16_t flags;      // ビット 0: キーフレーム
+    uint16_t spanCount;  // 区間の数
+    uint32_t sequence;   // フレームの番号（パネル制御タスクで写した順）
+    uint16_t width;      // フレームの横幅（パネル全体の大きさ）
+    uint16_t height;     // フレームの縦幅
+    uint32_t dataBytes;  // ヘッダーに続く区間の合計バイト数
+};
+
+// ===============================
+//      FrameStream クラスの定義
+// ===============================
+/**
+ * @brief 表示中のフレームを Web 画面のプレビュー用に配信する（`/frame`、`/frame/stream`）
+ *
+ * パネル制御タスクは `publish()` で `frameMirror` の変化した行だけを公開用のバッファに写す。
+ * 閲覧している接続が無いとき・`FRAME_STREAM_INTERVAL_MS` 以内・他のタスクが読み取り中のときは何もしないため、
+ * 描画の時間にはほぼ影響しない。
+ *
+ * - `snapshot()`: Web サーバーのタスクから、公開中のフレームを取り出す（RGB565 / PNG で返す）
+ * - `addClient()`: 配信する接続を登録する（送信はコア 0 の配信タスクが行い、Web サーバーのタスクを止めない）
+ */
+class FrameStream {
+public:
+    /**
+     * @brief 公開用のバッファと配信タスクを用意する（`setup()` で 1 回だけ呼ぶ）
+     * @param width フレームの横幅
+     * @param height フレームの縦幅
+     * @return 用意できた場合 true
+     */
+    bool begin(int width, int height);
+
+    /**
+     * @brief 表示中のフレームを公開する（パネル制御タスクのループで、表示の更新後に呼ぶ）
+     * @param frame 表示中の内容（パネル全体の RGB565、NULL の場合は何もしない）
+     * @param now 現在時刻（ミリ秒）
+     */
+    void publish(const uint16_t *frame, unsigned long now);
+
+    /**
+     * @brief 公開中のフレームを取り出す（新しいフレームを `FRAME_STREAM_SNAPSHOT_WAIT_MS` まで待つ）
+     * @param out 格納先（`width()` × `height()` 画素）
+     * @param sequence 取り出したフレームの番号
+     * @return 取り出せた場合 true
+     */
+    bool snapshot(uint16_t *out, uint32_t &sequence);
+
+    /**
+     * @brief 配信する接続を登録する（応答のヘッダーは配信タスクが送る）
+     * @param client 接続（登録した場合は配信タスクが引き継ぐ）
+     * @return 登録した場合 true（空きが無い・`begin()` の前は false）
+     */
+    bool addClient(const WiFiClient &client);
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    uint32_t sequence() const { return publishedSequence.load(); }
+    size_t clientCount() const { return clients.load(); }
+    unsigned long framesSent() const { return sentCount; }
+    unsigned long bytesSent() const { return sentBytes; }
+
+    /**
+     * @brief RGB565 のフレームを PNG（24 ビット、無圧縮の deflate）に変換したときのバイト数
+     */
+    static size_t pngSize(int width, int height);
+
+    /**
+     * @brief RGB565 のフレームを PNG に変換する
+     * @param frame 変換するフレーム
+     * @param width フレームの横幅
+     * @param height フレームの縦幅
+     * @param out 格納先（`pngSize()` バイト）
+     * @return 書き込んだバイト数
+     */
+    static size_t encodePNG(const uint16_t *frame, int width, int height, uint8_t *out);
+
+    /**
+     * @brief 前のフレームとの差分を配信用の形式（`FrameStreamHeader` と区間）で作成する
+     * @param prev 前のフレーム（キーフレームの場合は未使用）
+     * @param cur 今回のフレーム
+     * @param width フレームの横幅
+     * @param height フレームの縦幅
+     * @param sequence フレームの番号
+     * @param keyframe すべての行を含める場合 true
+     * @param out 格納先（`maxMessageSize()` バイト）
+     * @return 書き込んだバイト数
+     */
+    static size_t encodeDelta(const uint16_t *prev, const uint16_t *cur, int width, int height,
+                              uint32_t sequence, bool keyframe, uint8_t *out);
+
+    static size_t maxMessageSize(int width, int height);
+
+private:
+    int frameWidth = 0;
+    int frameHeight = 0;
+    uint16_t *published = nullptr;             // 公開中のフレーム（`lock` で保護）
+    SemaphoreHandle_t lock = nullptr;
+    QueueHandle_t clientQueue = nullptr;       // 登録待ちの接続（`WiFiClient *`）
+    TaskHandle_t task = nullptr;
+    std::atomic<uint32_t> publishedSequence{0};
+    std::atomic<size_t> clients{0};            // 配信中の接続の数
+    std::atomic<bool> snapshotWanted{false};   // `/frame` が新しいフレームを待っている
+    unsigned long publishedAt = 0;             // 最後に公開した時刻（パネル制御タスクのみ使用）
+    unsigned long sentCount = 0;
+    unsigned long sentBytes = 0;
+
+    void streamLoop();
+    static void streamTask(void *pvParameters);
+};
+
+extern FrameStream frameStream; // 全体で共有するフレーム配信
+
+#endif // FRAMESTREAM_H
@@ -0,0 +1,133 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "Metrics.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+PanelMetrics panelMetrics;
+
+// ヒストグラムの各バケットの上限（マイクロ秒）と、出力時の秒表記
+static const uint32_t histogramBoundsUs[METRICS_HIST_BUCKETS] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000
+};
+static const char *const histogramBoundsSec[METRICS_HIST_BUCKETS] = {
+    "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05", "0.1", "0.5"
+};
+
+// 発生元のラベル（MetricsSource と同じ順序）
+static const char *const sourceLabels[METRICS_SRC_COUNT] = { "bmp", "csv" };
+
+/**
+ * @brief 1 件の処理時間を記録する
+ *
+ * 該当するバケットだけを加算し、出力時に累積値へ変換する。
+ *
+ * @param us 処理時間（マイクロ秒）
+ */
+void MetricsHistogram::observe(uint32_t us) {
+    int i = 0;
+    while (i < METRICS_HIST_BUCKETS && us > histogramBoundsUs[i]) {
+        i++;
+    }
+    buckets[i]++;
+    count++;
+    sumUs += us;
+}
+
+/**
+ * @brief 描画処理 1 回分の時間を記録する
+ * @param mode 表示モード（範囲外は無視）
+ * @param us 処理時間（マイクロ秒）
+ */
+void PanelMetrics::observeDraw(int mode, uint32_t us) {
+    if (mode < 0 || mode >= METRICS_MODE_COUNT) return;
+    drawHistogram[mode].observe(us);
+}
+
+/**
+ * @brief Prometheus 形式のゲージを 1 行追記する（HELP / TYPE 付き）
+ */
+void appendPrometheusGauge(String &out, const char *name, const char *help, uint32_t value) {
+    out += "# HELP "; out += name; out += " "; out += help; out += "\n";
+    out += "# TYPE "; out += name; out += " gauge\n";
+    out += name; out += " "; out += String((unsigned long)value); out += "\n";
+}
+
+/**
+ * @brief Prometheus 形式のカウンター（増える一方の値）を 1 行追記する（HELP / TYPE 付き、名前は `_total` で終える）
+ */
+void appendPrometheusCounter(String &out, const char *name, const char *help, uint32_t value) {
+    out += "# HELP "; out += name; out += " "; out += help; out += "\n";
+    out += "# TYPE "; out += name; out += " counter\n";
+    out += name; out += " "; out += String((unsigned long)value); out += "\n";
+}
+
+/**
+ * @brief 集計値を Prometheus テキスト形式で `out` に追記する
+ * @param out 出力先の文字列
+ */
+void PanelMetrics::appendPrometheus(String &out) const {
+    char line[128];
+
+    // 1. 描画時間ヒストグラム（モード別、バケットは累積値で出力）
+    out += "# HELP ledest_draw_duration_seconds drawModeN 1 回あたりの処理時間\n";
+    out += "# TYPE ledest_draw_duration_seconds histogram\n";
+    for (int mode = 0; mode < METRICS_MODE_COUNT; mode++) {
+        const MetricsHistogram &h = drawHistogram[mode];
+        uint32_t cumulative = 0;
+        for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+            cumulative += h.buckets[i];
+            snprintf(line, sizeof(line), "ledest_draw_duration_seconds_bucket{mode=\"%d\",le=\"%s\"} %lu\n",
+                     mode, histogramBoundsSec[i], (unsigned long)cumulative);
+            out += line;
+        }
+        cumulative += h.buckets[METRICS_HIST_BUCKETS];
+        snprintf(line, sizeof(line), "ledest_draw_duration_seconds_bucket{mode=\"%d\",le=\"+Inf\"} %lu\n",
+                 mode, (unsigned long)cumulative);
+        out += line;
+        snprintf(line, sizeof(line), "ledest_draw_duration_seconds_sum{mode=\"%d\"} %.6f\n",
+                 mode, (double)h.sumUs / 1e6);
+        out += line;
+        snprintf(line, sizeof(line), "ledest_draw_duration_seconds_count{mode=\"%d\"} %lu\n",
+                 mode, (unsigned long)h.count);
+        out += line;
+    }
+
+    // 2. LittleFS 読み込みバイト数
+    out += "# HELP ledest_flash_read_bytes_total LittleFS から読み込んだバイト数\n";
+    out += "# TYPE ledest_flash_read_bytes_total counter\n";
+    for (int s = 0; s < METRICS_SRC_COUNT; s++) {
+        snprintf(line, sizeof(line), "ledest_flash_read_bytes_total{source=\"%s\"} %lu\n",
+                 sourceLabels[s], (unsigned long)flashReadBytes[s].load(std::memory_order_relaxed));
+        out += line;
+    }
+
+    // 3. 画像読み込み回数
+    out += "# HELP ledest_asset_loads_total 画像の読み込み回数\n";
+    out += "# TYPE ledest_asset_loads_total counter\n";
+    snprintf(line, sizeof(line), "ledest_asset_loads_total{result=\"ok\"} %lu\n",
+             (unsigned long)assetLoadsOk.load(std::memory_order_relaxed));
+    out += line;
+    snprintf(line, sizeof(line), "ledest_asset_loads_total{result=\"error\"} %lu\n",
+             (unsigned long)assetLoadsError.load(std::memory_order_relaxed));
+    out += line;
+
+    // 4. CSV 検索回数
+    out += "# HELP ledest_csv_lookups_total CSV の検索回数\n";
+    out += "# TYPE ledest_csv_lookups_total counter\n";
+    snprintf(line, sizeof(line), "ledest_csv_lookups_total %lu\n",
+             (unsigned long)csvLookups.load(std::memory_order_relaxed));
+    out += line;
+}
@@ -0,0 +1,138 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>  // Arduino 環境の基本ライブラリ
+#include <atomic>     // タスク間で共有するカウンタ
+
+// ===============================
+//      計測設定
+// ===============================
+#define METRICS_MODE_COUNT 5        // 処理時間を記録する表示モードの数（Mode 0～3 とプリセットの Mode 4）
+#define METRICS_HIST_BUCKETS 8      // ヒストグラムのバケット数（+Inf を除く）
+
+/**
+ * @brief フラッシュ読み込みの発生元
+ */
+enum MetricsSource {
+    METRICS_SRC_BMP = 0, // BMP 画像（cacheBMPData など）
+    METRICS_SRC_CSV,     // CSV カタログ（CSVReader）
+    METRICS_SRC_COUNT
+};
+
+/**
+ * @brief 処理時間のヒストグラム（固定バケット、マイクロ秒単位）
+ *
+ * 書き込みは 1 つのタスク（パネル制御タスク）からのみ行う前提。
+ * 読み出し側（/metrics）は多少古い値を読んでも問題ない。
+ */
+struct MetricsHistogram {
+    uint32_t buckets[METRICS_HIST_BUCKETS + 1] = {}; // 各バケットの件数（最後が +Inf）
+    uint32_t count = 0;  // 記録件数
+    uint64_t sumUs = 0;  // 合計時間（マイクロ秒）
+
+    /**
+     * @brief 1 件の処理時間を記録する
+     * @param us 処理時間（マイクロ秒）
+     */
+    void observe(uint32_t us);
+};
+
+// ===============================
+//      PanelMetrics クラスの定義
+// ===============================
+/**
+ * @brief パネルの動作状況を集計するクラス
+ *
+ * ホットパスから呼ばれるため、記録処理は加算のみで完結させている。
+ * - `drawModeN` 1 回あたりの処理時間（モード別ヒストグラム）
+ * - LittleFS から読み込んだバイト数（発生元別）
+ * - 画像読み込み・CSV 検索の回数
+ *
+ * ヒープ残量やタスクのスタック残量は `/metrics` 応答時に main.cpp 側で取得する。
+ */
+class PanelMetrics {
+public:
+    /**
+     * @brief 描画処理 1 回分の時間を記録する
+     * @param mode 表示モード（範囲外は無視）
+     * @param us 処理時間（マイクロ秒）
+     */
+    void observeDraw(int mode, uint32_t us);
+
+    /**
+     * @brief LittleFS から読み込んだバイト数を加算する
+     * @param source 読み込みの発生元
+     * @param bytes 読み込んだバイト数
+     */
+    void addFlashRead(MetricsSource source, uint32_t bytes) {
+        flashReadBytes[source].fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 画像読み込みの結果を記録する
+     * @param ok 成功時 true
+     */
+    void countAssetLoad(bool ok) {
+        (ok ? assetLoadsOk : assetLoadsError).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief CSV 検索（getPath）の回数を記録する
+     */
+    void countCSVLookup() { csvLookups.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief 集計値を Prometheus テキスト形式で `out` に追記する
+     * @param out 出力先の文字列
+     */
+    void appendPrometheus(String &out) const;
+
+private:
+    MetricsHistogram drawHistogram[METRICS_MODE_COUNT];           // モード別の描画時間
+    std::atomic<uint32_t> flashReadBytes[METRICS_SRC_COUNT] = {}; // 発生元別の読み込みバイト数
+    std::atomic<uint32_t> assetLoadsOk{0};    // 画像読み込み成功回数
+    std::atomic<uint32_t> assetLoadsError{0}; // 画像読み込み失敗回数
+    std::atomic<uint32_t> csvLookups{0};      // CSV 検索回数
+};
+
+extern PanelMetrics panelMetrics; // 全体で共有する計測インスタンス
+
+/**
+ * @brief Prometheus 形式のゲージを 1 行追記する（HELP / TYPE 付き）
+ *
+ * @param out 出力先の文字列
+ * @param name メトリクス名
+ * @param help 説明文
+ * @param value 値
+ */
+void appendPrometheusGauge(String &out, const char *name, const char *help, uint32_t value);
+
+/**
+ * @brief Prometheus 形式のカウンター（増える一方の値）を 1 行追記する（HELP / TYPE 付き）
+ *
+ * `rate()` / `increase()` で使えるよう、名前は `_total` で終えること。
+ *
+ * @param out 出力先の文字列
+ * @param name メトリクス名
+ * @param help 説明文
+ * @param value 値（起動からの累計）
+ */
+void appendPrometheusCounter(String &out, const char *name, const char *help, uint32_t value);
+
+#endif // METRICS_H
@@ -0,0 +1,287 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "PanelGeometry.h"
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+PanelGeometry panelGeometry;
+
+/**
+ * @brief 既定値を設定する（設定ファイルが無い場合に使用）
+ * @param panelResX パネル 1 枚の横幅
+ * @param panelResY パネル 1 枚の縦幅
+ * @param chain 横に連結する枚数
+ * @param panelBrightness 輝度
+ */
+void PanelGeometry::setDefaults(int panelResX, int panelResY, int chain, int panelBrightness) {
+    resX = panelResX;
+    resY = panelResY;
+    cols = chain;
+    rows = 1;
+    wiring = PANEL_WIRING_ZIGZAG;
+    startBottom = false;
+    brightness = panelBrightness;
+    doubleBuffer = true;
+    layout = PanelLayout();
+    layout.contentWidth = width();
+    updateMap();
+}
+
+/**
+ * @brief 設定ファイル（`key,value` 形式の CSV）を読み込む
+ *
+ * 1 行目は見出し、`#` で始まる行はコメントとして読み飛ばす。
+ * 指定の無い項目は既定値のまま。値が不正な場合は設定全体を既定値に戻す。
+ *
+ * @param configPath 設定ファイルのパス
+ * @return 読み込めた場合 true（ファイルが無い・不正な場合は既定値のまま false）
+ */
+bool PanelGeometry::load(const char *configPath) {
+    // 1. 設定ファイルを開き、見出し行を読み飛ばす
+    File file = LittleFS.open(configPath, "r");
+    if (!file) {
+        Serial.printf("パネル設定 %s が無いため既定値を使用します。\n", configPath);
+        return false;
+    }
+    file.readStringUntil('\n');
+
+    // 2. 1 行ずつ読み取る
+    PanelGeometry loaded = *this;
+    bool hasContentWidth = false;
+    while (file.available()) {
+        String line = file.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0 || line.startsWith("#")) continue;
+
+        int comma = line.indexOf(',');
+        if (comma <= 0) continue;
+        String key = line.substring(0, comma);
+        String value = line.substring(comma + 1);
+        key.trim();
+        value.trim();
+
+        if (key == "res_x") loaded.resX = value.toInt();
+        else if (key == "res_y") loaded.resY = value.toInt();
+        else if (key == "cols") loaded.cols = value.toInt();
+        else if (key == "rows") loaded.rows = value.toInt();
+        else if (key == "wiring") loaded.wiring = (value == "serpentine") ? PANEL_WIRING_SERPENTINE : PANEL_WIRING_ZIGZAG;
+        else if (key == "start") loaded.startBottom = (value == "bottom");
+        else if (key == "brightness") loaded.brightness = constrain(value.toInt(), 0, 255);
+        else if (key == "double_buffer") loaded.doubleBuffer = (value != "off");
+        else if (key == "origin_x") loaded.layout.originX = value.toInt();
+        else if (key == "origin_y") loaded.layout.originY = value.toInt();
+        else if (key == "type_width") loaded.layout.typeWidth = value.toInt();
+        else if (key == "row_height") loaded.layout.rowHeight = value.toInt();
+        else if (key == "content_width") { loaded.layout.contentWidth = value.toInt(); hasContentWidth = true; }
+        else if (key == "scroll_speed") loaded.layout.scrollSpeed = value.toFloat();
+        else if (key == "languages") {
+            // 空白区切りの列名（例: JP EN ZH KO）
+            loaded.layout.languageCount = 0;
+            while (value.length() > 0) {
+                int space = value.indexOf(' ');
+                String language = (space < 0) ? value : value.substring(0, space);
+                value = (space < 0) ? String("") : value.substring(space + 1);
+                value.trim();
+                if (language.length() == 0) continue;
+                if (loaded.layout.languageCount == PANEL_MAX_LANGUAGES) {
+                    Serial.printf("パネル設定の言語は %d 個までです: %s\n", PANEL_MAX_LANGUAGES, language.c_str());
+                    break;
+                }
+                loaded.layout.languages[loaded.layout.languageCount++] = language;
+            }
+        }
+        else if (key.startsWith("transition_")) {
+            // 切り替え効果（transition_full / type / dest / next）
+            String layer = key.substring(strlen("transition_"));
+            TransitionStyle *style = (layer == "full") ? &loaded.layout.fullTransition
+                                   : (layer == "type") ? &loaded.layout.typeTransition
+                                   : (layer == "dest") ? &loaded.layout.destTransition
+                                   : (layer == "next") ? &loaded.layout.nextTransition : nullptr;
+            if (style == nullptr || !TransitionStyle::parse(value, *style)) {
+                Serial.printf("パネル設定の切り替え効果が不正です: %s,%s\n", key.c_str(), value.c_str());
+            }
+        }
+        else Serial.printf("パネル設定の不明な項目: %s\n", key.c_str());
+    }
+    file.close();
+
+    // 3. 値を検証する（パネル枚数・表示内容の配置）
+    if (!hasContentWidth) {
+        loaded.layout.contentWidth = loaded.width() - loaded.layout.originX;
+    }
+    const PanelLayout &l = loaded.layout;
+    if (loaded.resX <= 0 || loaded.resY <= 0 || loaded.cols <= 0 || loaded.rows <= 0 ||
+        loaded.chainLength() > PANEL_MAX_PANELS ||
+        l.originX < 0 || l.originY < 0 || l.typeWidth < 0 || l.rowHeight <= 0 ||
+        l.contentWidth <= l.typeWidth || l.originX + l.contentWidth > loaded.width() ||
+        l.originY + l.rowHeight >= loaded.height() || l.scrollSpeed < 0 || l.languageCount <= 0) {
+        Serial.printf("パネル設定 %s が不正なため既定値を使用します。\n", configPath);
+        return false;
+    }
+
+    // 4. 反映し、座標変換表を作り直す
+    *this = loaded;
+    updateMap();
+    Serial.printf("パネル構成: %d x %d（%d x %d 枚、%s）\n", width(), height(), cols, rows,
+                  wiring == PANEL_WIRING_SERPENTINE ? "serpentine" : "zigzag");
+    return true;
+}
+
+/**
+ * @brief 仮想画面上の各パネルに対応する HUB75 チェーン上の位置を計算する
+ *
+ * チェーンの先頭段から数えて奇数番目の段は、折り返し配線（serpentine）の場合
+ * 右から左へ配線され、パネルは 180 度回転して取り付けられている。
+ */
+void PanelGeometry::updateMap() {
+    identity = (rows == 1);
+    for (int row = 0; row < rows; row++) {
+        int rowFromStart = startBottom ? (rows - 1 - row) : row;
+        bool reversed = (wiring == PANEL_WIRING_SERPENTINE) && (rowFromStart % 2 == 1);
+        for (int col = 0; col < cols; col++) {
+            int colFromStart = reversed ? (cols - 1 - col) : col;
+            PanelMap &map = panelMap[row * cols + col];
+            map.chainX = (rowFromStart * cols + colFromStart) * resX;
+            map.flipped = reversed;
+        }
+    }
+}
+
+/**
+ * @brief 仮想画面の 1 行分の連続したピクセルを LED パネルに書き込む
+ *
+ * 範囲外の部分は切り捨て、パネルの境界ごとに座標を変換する。
+ *
+ * @param panel 書き込み先の LED パネル
+ * @param x 書き込み開始 X 座標（仮想画面）
+ * @param y 書き込む Y 座標（仮想画面）
+ * @param pixels ピクセルデータ（RGB565）
+ * @param length ピクセル数
+ */
+void PanelGeometry::blitSpan(MatrixPanel_I2S_DMA *panel, int x, int y, const uint16_t *pixels, int length) {
+    // 1. 範囲外を切り捨てる（ピクセルごとの範囲確認は行わない）
+    if (panel == nullptr || y < 0 || y >= height()) return;
+    if (x < 0) {
+        pixels -= x;
+        length += x;
+        x = 0;
+    }
+    if (x + length > width()) length = width() - x;
+    if (length <= 0) return;
+    if (mirror) {
+        memcpy(mirror + y * width() + x, pixels, length * sizeof(uint16_t));
+    }
+
+    // 2. ダブルバッファの場合は書き込んだ範囲を記録（presentFrame() で新しい裏画面に書き写す）
+    if (doubleBuffer) {
+        if (dirtyBottom <= dirtyTop) {
+            dirtyLeft = x;
+            dirtyRight = x + length;
+            dirtyTop = y;
+            dirtyBottom = y + 1;
+        } else {
+            dirtyLeft = min(dirtyLeft, x);
+            dirtyRight = max(dirtyRight, x + length);
+            dirtyTop = min(dirtyTop, y);
+            dirtyBottom = max(dirtyBottom, y + 1);
+        }
+    }
+
+    writeSpan(panel, x, y, pixels, length);
+}
+
+/**
+ * @brief 描画が完了したフレームを表示する（ダブルバッファの場合のみ、描画ループの最後に呼ぶ）
+ *
+ * 前回から変更が無ければ何もしない。変更があれば裏画面を表に切り替え、
+ * 新しい裏画面にも変更した範囲を書き写す（変更の無い部分は描き直さずに済むようにする）。
+ *
+ * @param panel 表示する LED パネル
+ */
+void PanelGeometry::presentFrame(MatrixPanel_I2S_DMA *panel) {
+    // 1. 変更が無ければ切り替えない（静止した表示は描き直さない）
+    if (!doubleBuffer || panel == nullptr || dirtyBottom <= dirtyTop) return;
+    TRACE_SCOPE("frameFlip");
+
+    // 2. 描画が完了した裏画面を表に切り替える（フレーム全体が一度に切り替わる）
+    panel->flipDMABuffer();
+
+    // 3. 新しい裏画面（1 つ前のフレーム）に今回の変更を書き写し、両画面の内容を一致させる
+    if (mirror) {
+        int span = dirtyRight - dirtyLeft;
+        for (int y = dirtyTop; y < dirtyBottom; y++) {
+            writeSpan(panel, dirtyLeft, y, mirror + y * width() + dirtyLeft, span);
+        }
+    }
+    dirtyTop = dirtyBottom = 0;
+}
+
+// 範囲内に収まったスパンを HUB75 チェーン上の座標に変換して書き込む
+void PanelGeometry::writeSpan(MatrixPanel_I2S_DMA *panel, int x, int y, const uint16_t *pixels, int length) const {
+    // 1. 1 段のみの場合は仮想画面とチェーンの座標が一致する
+    if (identity) {
+        for (int i = 0; i < length; i++) {
+            panel->drawPixel(x + i, y, pixels[i]);
+        }
+        return;
+    }
+
+    // 2. パネルの境界で分割し、パネルごとに 1 回だけ座標を変換する
+    int panelRow = y / resY;
+    int localY = y - panelRow * resY;
+    while (length > 0) {
+        int panelCol = x / resX;
+        int localX = x - panelCol * resX;
+        int run = min(resX - localX, length);
+        const PanelMap &map = panelMap[panelRow * cols + panelCol];
+
+        if (map.flipped) {
+            int chainX = map.chainX + (resX - 1 - localX);
+            int chainY = resY - 1 - localY;
+            for (int i = 0; i < run; i++) {
+                panel->drawPixel(chainX - i, chainY, pixels[i]);
+            }
+        } else {
+            int chainX = map.chainX + localX;
+            for (int i = 0; i < run; i++) {
+                panel->drawPixel(chainX + i, localY, pixels[i]);
+            }
+        }
+
+        x += run;
+        pixels += run;
+        length -= run;
+    }
+}
+
+/**
+ * @brief 1 行分の連続したピクセルをキャンバスに書き込む（範囲外は切り捨て）
+ *
+ * キャンバスのバッファに直接コピーする（回転は使用しない前提）。
+ */
+void PanelGeometry::blitSpanToCanvas(GFXcanvas16 *canvas, int x, int y, const uint16_t *pixels, int length) {
+    int canvasWidth = canvas->width();
+    if (y < 0 || y >= canvas->height()) return;
+    if (x < 0) {
+        pixels -= x;
+        length += x;
+        x = 0;
+    }
+    if (x + length > canvasWidth) length = canvasWidth - x;
+    if (length <= 0) return;
+
+    memcpy(canvas->getBuffer() + y * canvasWidth + x, pixels, length * sizeof(uint16_t));
+}
@@ -0,0 +1,180 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef PANELGEOMETRY_H
+#define PANELGEOMETRY_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>   // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"  // ESP32 の LittleFS を使用するためのライブラリ
+#include <ESP32-HUB75-MatrixPanel-I2S-DMA.h> // HUB75 LED パネル制御ライブラリ
+#include "Transition.h" // 表示の切り替え効果
+
+// ===============================
+//      パネル構成の設定
+// ===============================
+#define PANEL_CONFIG_PATH "/config/panel.csv" // パネル構成の設定ファイル
+#define PANEL_MAX_PANELS 16                   // 接続できるパネルの最大枚数
+#define PANEL_MAX_LANGUAGES 6                 // 切り替えて表示する言語の最大数
+
+/**
+ * @brief パネルの配線方式（複数段に並べた場合）
+ */
+enum PanelWiring {
+    PANEL_WIRING_ZIGZAG = 0,  // 各段とも左から右へ配線（パネルの向きはすべて同じ）
+    PANEL_WIRING_SERPENTINE   // 段ごとに折り返して配線（折り返した段のパネルは上下逆さまに取り付け）
+};
+
+/**
+ * @brief 表示内容の配置（種別・行先・次駅 / スクロールの位置）
+ *
+ * 128×32 の表示を基準に、種別を左、行先を右上、次駅 / スクロールを右下に配置する。
+ * パネルが大きい場合は `originX` / `originY` で位置を、`contentWidth` で右端を指定する。
+ */
+struct PanelLayout {
+    int originX = 0;        // 表示内容の左上 X 座標
+    int originY = 0;        // 表示内容の左上 Y 座標
+    int typeWidth = 48;     // 種別表示の幅（行先・次駅はこの右から始まる）
+    int rowHeight = 16;     // 上段（行先）の高さ（次駅・スクロールはこの下から始まる）
+    int contentWidth = 128; // 表示内容の幅（スクロール領域の右端）
+    float scrollSpeed = 33.3f; // 停車駅スクロールの速度（ピクセル/秒、1 未満も可）
+    TransitionStyle fullTransition; // 全画面表示（Mode 0）の切り替え効果
+    TransitionStyle typeTransition; // 種別の切り替え効果
+    TransitionStyle destTransition; // 行先（路線名）の切り替え効果
+    TransitionStyle nextTransition; // 次駅の切り替え効果
+    String languages[PANEL_MAX_LANGUAGES] = { "JP", "EN" }; // 切り替えて表示する言語（カタログの列名、表示順）
+    int languageCount = 2;                                  // 言語の数（先頭の言語は必須、他は空欄なら先頭の言語の画像）
+
+    int destX() const { return originX + typeWidth; }            // 行先・次駅・スクロールの X 座標
+    int lowerY() const { return originY + rowHeight; }           // 次駅・スクロールの Y 座標
+    int areaWidth() const { return contentWidth - typeWidth; }   // 行先・次駅・スクロール領域の幅
+};
+
+// ===============================
+//      PanelGeometry クラスの定義
+// ===============================
+/**
+ * @brief パネルの構成（解像度・枚数・配線）と座標変換を管理するクラス
+ *
+ * 起動時に `/config/panel.csv` から読み込む（無い場合は既定値）。
+ * 描画処理は「仮想画面」（パネルを並べた見た目どおりの座標）で行い、
+ * `blitSpan()` が HUB75 チェーン上の座標に変換して書き込む。
+ *
+ * 座標変換はパネル単位で事前に計算しておき、1 行分の連続したピクセル（スパン）ごとに
+ * 1 回だけ変換・範囲確認を行う（ピクセルごとの計算を避けるため）。
+ *
+ * ダブルバッファ（`doubleBuffer`）の場合、`blitSpan()` は DMA の裏画面に書き込み、
+ * `presentFrame()` でフレーム全体を一度に切り替える（描画途中の表示が見えないようにする）。
+ */
+class PanelGeometry {
+public:
+    int resX = 64;           // パネル 1 枚の横幅（ピクセル）
+    int resY = 32;           // パネル 1 枚の縦幅（ピクセル）
+    int cols = 2;            // 横に並べる枚数
+    int rows = 1;            // 縦に並べる段数
+    PanelWiring wiring = PANEL_WIRING_ZIGZAG; // 複数段の配線方式
+    bool startBottom = false; // チェーンの先頭（ESP32 に接続するパネル）が最下段なら true
+    int brightness = 128;    // 輝度（0～255）
+    bool doubleBuffer = true; // 裏画面に描画し、フレームの完成後に切り替えるなら true
+    PanelLayout layout;      // 表示内容の配置
+
+    /**
+     * @brief 既定値を設定する（設定ファイルが無い場合に使用）
+     * @param panelResX パネル 1 枚の横幅
+     * @param panelResY パネル 1 枚の縦幅
+     * @param chain 横に連結する枚数
+     * @param panelBrightness 輝度
+     */
+    void setDefaults(int panelResX, int panelResY, int chain, int panelBrightness);
+
+    /**
+     * @brief 設定ファイル（`key,value` 形式の CSV）を読み込む
+     * @param configPath 設定ファイルのパス
+     * @return 読み込めた場合 true（ファイルが無い場合は既定値のまま false）
+     */
+    bool load(const char *configPath = PANEL_CONFIG_PATH);
+
+    int width() const { return resX * cols; }      // 仮想画面の横幅
+    int height() const { return resY * rows; }     // 仮想画面の縦幅
+    int chainLength() const { return cols * rows; } // HUB75 チェーンの枚数
+
+    /**
+     * @brief 仮想画面の 1 行分の連続したピクセルを LED パネルに書き込む
+     *
+     * 範囲外の部分は切り捨て、パネルの境界ごとに座標を変換する。
+     *
+     * @param panel 書き込み先の LED パネル
+     * @param x 書き込み開始 X 座標（仮想画面）
+     * @param y 書き込む Y 座標（仮想画面）
+     * @param pixels ピクセルデータ（RGB565）
+     * @param length ピクセル数
+     */
+    void blitSpan(MatrixPanel_I2S_DMA *panel, int x, int y, const uint16_t *pixels, int length);
+
+    /**
+     * @brief 描画が完了したフレームを表示する（ダブルバッファの場合のみ、描画ループの最後に呼ぶ）
+     *
+     * 前回から変更が無ければ何もしない。変更があれば裏画面を表に切り替え、
+     * 新しい裏画面にも変更した範囲を書き写す（変更の無い部分は描き直さずに済むようにする）。
+     * 範囲の書き写しには表示中の内容の写し（`setMirror()`）を使用する。
+     *
+     * @param panel 表示する LED パネル
+     */
+    void presentFrame(MatrixPanel_I2S_DMA *panel);
+
+    /**
+     * @brief 表示中の内容の写し（仮想画面の大きさの RGB565 バッファ）を設定する
+     *
+     * 設定すると `blitSpan()` で LED パネルに書き込んだ内容を同じ位置に複写する
+     * （シーンのプリセット保存などで、表示中の内容を読み出すために使う）。
+     *
+     * @param buffer `width()` × `height()` ピクセルのバッファ（nullptr で解除）
+     */
+    void setMirror(uint16_t *buffer) { mirror = buffer; }
+    const uint16_t *mirrorBuffer() const { return mirror; }
+
+    /**
+     * @brief 1 行分の連続したピクセルをキャンバスに書き込む（範囲外は切り捨て）
+     */
+    static void blitSpanToCanvas(GFXcanvas16 *canvas, int x, int y, const uint16_t *pixels, int length);
+
+    /**
+     * @brief 座標変換表を作り直す（`load()` を使わずに構成を変更した場合に呼ぶ）
+     */
+    void updateMap();
+
+private:
+    /**
+     * @brief 仮想画面上のパネル 1 枚に対応する HUB75 チェーン上の位置
+     */
+    struct PanelMap {
+        int16_t chainX = 0;   // チェーン上の左端 X 座標
+        bool flipped = false; // 上下逆さま（180 度回転）に取り付けられているか
+    };
+
+    PanelMap panelMap[PANEL_MAX_PANELS]; // [段 * cols + 列] の順
+    bool identity = true;                // 1 段のみ（座標変換が不要）なら true
+    uint16_t *mirror = nullptr;          // 表示中の内容の写し（未設定なら nullptr）
+
+    // 前回の切り替え以降に書き込んだ範囲（ダブルバッファの場合のみ、dirtyBottom <= dirtyTop なら変更なし）
+    int dirtyLeft = 0, dirtyRight = 0;
+    int dirtyTop = 0, dirtyBottom = 0;
+
+    void writeSpan(MatrixPanel_I2S_DMA *panel, int x, int y, const uint16_t *pixels, int length) const;
+};
+
+extern PanelGeometry panelGeometry; // 全体で共有するパネル構成
+
+#endif // PANELGEOMETRY_H
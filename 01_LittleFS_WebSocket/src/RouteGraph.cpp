@@ -0,0 +1,275 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "RouteGraph.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
+#include <algorithm> // std::sort / std::lower_bound / std::stable_sort
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+RouteGraph routeGraph;
+
+// CSV の 1 行を列に分割する
+static void splitFields(const String &line, std::vector<String> &fields) {
+    fields.clear();
+    int start = 0;
+    while (true) {
+        int comma = line.indexOf(',', start);
+        String field = (comma == -1) ? line.substring(start) : line.substring(start, comma);
+        field.trim();
+        fields.push_back(field);
+        if (comma == -1) break;
+        start = comma + 1;
+    }
+}
+
+// 見出し行から各列の位置を調べる（無い列は -1）
+static void findColumns(File &file, const char *const *names, int count, int *columns) {
+    String header = file.readStringUntil('\n');
+    header.trim();
+    std::vector<String> fields;
+    splitFields(header, fields);
+    for (int i = 0; i < count; i++) {
+        columns[i] = -1;
+        for (size_t c = 0; c < fields.size(); c++) {
+            if (fields[c] == names[i]) columns[i] = c;
+        }
+    }
+}
+
+/**
+ * @brief 路線図と駅の情報を読み込む
+ *
+ * @param routePath 路線図 CSV のパス
+ * @param stationPath 次駅 CSV のパス
+ * @return 読み込めた場合 true（失敗した場合は空の路線図になり、停車駅スクロールは表示しない）
+ */
+bool RouteGraph::load(const char *routePath, const char *stationPath) {
+    TRACE_SCOPE("RouteGraph::load", routePath);
+    stations.clear();
+    byId.clear();
+    lines.clear();
+    nextHop.clear();
+    loadGeneration++;
+
+    // 1. 路線図を読み込む（路線ごとに、書かれた順が駅の並び）
+    File file = LittleFS.open(routePath, "r");
+    if (!file) {
+        Serial.printf("路線図 %s を開けませんでした（停車駅スクロールは表示しません）。\n", routePath);
+        return false;
+    }
+    const char *routeNames[] = { "ID", "line", "link" };
+    int routeColumns[3];
+    findColumns(file, routeNames, 3, routeColumns);
+    if (routeColumns[0] == -1 || routeColumns[1] == -1) {
+        Serial.printf("路線図 %s に ID / line 列がありません。\n", routePath);
+        file.close();
+        return false;
+    }
+    std::vector<String> fields;
+    std::vector<RouteStation> loaded;
+    while (file.available()) {
+        String line = file.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0 || line.startsWith("#")) continue;
+        splitFields(line, fields);
+        auto field = [&](int i) -> String {
+            return (routeColumns[i] >= 0 && routeColumns[i] < (int)fields.size()) ? fields[routeColumns[i]] : String();
+        };
+        RouteStation station;
+        station.id = field(0).toInt();
+        station.line = field(1).toInt();
+        station.link = field(2).toInt();
+        if (station.id == 0 || station.line == 0) {
+            Serial.printf("路線図の行が不正です: %s\n", line.c_str());
+            continue;
+        }
+        loaded.push_back(station);
+    }
+    panelMetrics.addFlashRead(METRICS_SRC_CSV, file.position());
+    file.close();
+
+    // 2. 路線ごとにまとめる（路線は最初に現れた順、駅の並びはそのまま）
+    for (RouteStation &station : loaded) {
+        auto it = std::find_if(lines.begin(), lines.end(), [&](const Line &l) { return l.id == station.line; });
+        if (it == lines.end()) {
+            lines.push_back({ station.line, 0, 0 });
+            it = lines.end() - 1;
+        }
+        station.lineIndex = it - lines.begin();
+        it->count++;
+    }
+    std::stable_sort(loaded.begin(), loaded.end(),
+                     [](const RouteStation &a, const RouteStation &b) { return a.lineIndex < b.lineIndex; });
+    stations.swap(loaded);
+    int first = 0;
+    for (Line &line : lines) {
+        line.first = first;
+        first += line.count;
+    }
+
+    // 3. ID で探すための索引（同じ ID が複数ある場合は最初の行を使う）
+    byId.resize(stations.size());
+    for (size_t i = 0; i < stations.size(); i++) byId[i] = i;
+    std::stable_sort(byId.begin(), byId.end(), [&](int a, int b) { return stations[a].id < stations[b].id; });
+    for (size_t i = 1; i < byId.size(); i++) {
+        if (stations[byId[i]].id == stations[byId[i - 1]].id) {
+            Serial.printf("路線図の駅 ID %d が重複しています。\n", stations[byId[i]].id);
+        }
+    }
+
+    // 4. 次駅 CSV から停車種別とスクロール用画像を 1 回で読み取る
+    file = LittleFS.open(stationPath, "r");
+    if (file) {
+        const char *stationNames[] = { "ID", "type", "Scroll" };
+        int stationColumns[3];
+        findColumns(file, stationNames, 3, stationColumns);
+        while (file.available()) {
+            String line = file.readStringUntil('\n');
+            line.trim();
+            if (line.length() == 0) continue;
+            splitFields(line, fields);
+            if (stationColumns[0] < 0 || stationColumns[0] >= (int)fields.size()) continue;
+            int index = indexOf(fields[stationColumns[0]].toInt());
+            if (index < 0) continue;
+            RouteStation &station = stations[index];
+            if (stationColumns[1] >= 0 && stationColumns[1] < (int)fields.size()) station.classes = fields[stationColumns[1]];
+            if (stationColumns[2] >= 0 && stationColumns[2] < (int)fields.size()) station.scroll = fields[stationColumns[2]];
+        }
+        panelMetrics.addFlashRead(METRICS_SRC_CSV, file.position());
+        file.close();
+    } else {
+        Serial.printf("CSVファイル %s を開けませんでした。\n", stationPath);
+    }
+
+    // 5. 路線の組ごとに最初に乗り継ぐ駅を求める
+    buildNextHop();
+    Serial.printf("路線図を読み込みました（%u 路線、%u 駅）。\n", (unsigned)lines.size(), (unsigned)stations.size());
+    return true;
+}
+
+// 始発駅から行先まで、途中の駅を順に `visit(駅, 乗り継ぐ駅か)` に渡す
+template <typename Visit>
+bool RouteGraph::walk(int dep, int dest, Visit visit) const {
+    int current = indexOf(dep);
+    int goal = indexOf(dest);
+    if (current < 0 || goal < 0) return false;
+    size_t lineTotal = lines.size();
+
+    // 路線内の 2 駅の間（両端を含まない）をたどる
+    auto walkLine = [&](int from, int to) {
+        int step = (from < to) ? 1 : -1;
+        for (int i = from + step; i != to; i += step) {
+            visit(stations[i], false);
+        }
+    };
+
+    // 1. 行先の路線に着くまで乗り継ぐ（路線の数より多く乗り継ぐことはない）
+    for (size_t transfers = 0; stations[current].lineIndex != stations[goal].lineIndex; transfers++) {
+        int exit = nextHop[stations[current].lineIndex * lineTotal + stations[goal].lineIndex];
+        if (exit < 0 || transfers >= lineTotal) return false;
+        int entry = indexOf(stations[exit].link);
+        if (exit != current) {
+            walkLine(current, exit);
+            if (entry == goal) return true; // 乗り継ぐ駅が行先
+            visit(stations[exit], true);
+        }
+        current = entry;
+    }
+
+    // 2. 行先の路線内をたどる
+    if (current != goal) {
+        walkLine(current, goal);
+    }
+    return true;
+}
+
+/**
+ * @brief 始発駅から行先までの途中の駅を、進む順に求める（始発駅・行先は含まない）
+ *
+ * 直通する場合は、乗り継ぐ駅を `transfer` として 1 回だけ含める（行先が乗り継ぐ駅の場合は含めない）。
+ *
+ * @param dep 始発駅の ID
+ * @param dest 行先の ID
+ * @param stops 途中の駅の格納先（既存の内容は消去）
+ * @return 行先までたどれた場合 true
+ */
+bool RouteGraph::route(int dep, int dest, std::vector<RouteStop> &stops) const {
+    stops.clear();
+    return walk(dep, dest, [&](const RouteStation &station, bool transfer) {
+        stops.push_back({ &station, transfer });
+    });
+}
+
+/**
+ * @brief 始発駅から行先までの駅数（隣の駅なら 1、たどれない場合は -1）
+ */
+int RouteGraph::hops(int dep, int dest) const {
+    int count = 0;
+    if (!walk(dep, dest, [&](const RouteStation &, bool) { count++; })) return -1;
+    return count + 1;
+}
+
+/**
+ * @brief 駅が属する路線の ID（路線図に無い駅は 0）
+ */
+int RouteGraph::lineOf(int id) const {
+    int index = indexOf(id);
+    return (index >= 0) ? stations[index].line : 0;
+}
+
+/**
+ * @brief ID で駅を探す（路線図に無い場合は NULL）
+ */
+const RouteStation *RouteGraph::station(int id) const {
+    int index = indexOf(id);
+    return (index >= 0) ? &stations[index] : nullptr;
+}
+
+// ID から `stations` の添字を求める（二分探索、無い場合は -1）
+int RouteGraph::indexOf(int id) const {
+    auto it = std::lower_bound(byId.begin(), byId.end(), id,
+                               [&](int index, int value) { return stations[index].id < value; });
+    return (it != byId.end() && stations[*it].id == id) ? *it : -1;
+}
+
+// 路線を頂点、直通を辺として、出発路線ごとに幅優先探索し、最初に乗り継ぐ駅を記録する
+void RouteGraph::buildNextHop() {
+    size_t lineTotal = lines.size();
+    nextHop.assign(lineTotal * lineTotal, -1);
+    std::vector<int> queue;
+    for (size_t from = 0; from < lineTotal; from++) {
+        // 1. 出発路線から始める
+        queue.clear();
+        std::vector<bool> visited(lineTotal, false);
+        visited[from] = true;
+        queue.push_back(from);
+
+        // 2. 乗り継ぐ駅を引き継ぎながら順に広げる
+        for (size_t head = 0; head < queue.size(); head++) {
+            int current = queue[head];
+            const Line &line = lines[current];
+            for (int i = line.first; i < line.first + line.count; i++) {
+                int target = indexOf(stations[i].link);
+                if (stations[i].link == 0 || target < 0) continue;
+                int next = stations[target].lineIndex;
+                if (visited[next]) continue;
+                visited[next] = true;
+                nextHop[from * lineTotal + next] = (current == (int)from) ? i : nextHop[from * lineTotal + current];
+                queue.push_back(next);
+            }
+        }
+    }
+}
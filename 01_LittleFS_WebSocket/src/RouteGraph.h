@@ -0,0 +1,123 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef ROUTEGRAPH_H
+#define ROUTEGRAPH_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>    // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"   // ESP32 の LittleFS を使用するためのライブラリ
+#include <vector>       // 駅・路線の一覧
+
+// ===============================
+//      路線図の設定
+// ===============================
+#define ROUTE_CSV_PATH "/list/list_route.csv"     // 路線図（路線・駅の並び・直通）
+#define ROUTE_STATION_CSV_PATH "/list/list_next.csv" // 駅の停車種別・スクロール用画像
+
+/**
+ * @brief 路線図上の駅
+ */
+struct RouteStation {
+    int id = 0;          // 駅の ID（次駅 CSV の ID）
+    int line = 0;        // 路線の ID（路線名を表示する行先 CSV の ID）
+    int link = 0;        // 直通先の同じ駅の ID（無い場合は 0）
+    uint8_t lineIndex = 0; // 路線の番号（`lines` の添字）
+    String classes;      // 停車する種別（スペース区切りの className、次駅 CSV の type 列）
+    String scroll;       // スクロール用画像のパス（次駅 CSV の Scroll 列）
+};
+
+/**
+ * @brief 始発駅から行先までの途中の駅
+ */
+struct RouteStop {
+    const RouteStation *station; // 駅
+    bool transfer;               // 直通（乗り継ぎ）の駅か（種別に関わらず表示する）
+};
+
+// ===============================
+//      RouteGraph クラスの定義
+// ===============================
+/**
+ * @brief 路線・駅の並び・直通を CSV から読み込み、始発駅から行先までの途中駅を求める
+ *
+ * 路線図 CSV は `ID,line,link` の列を持ち、同じ路線の駅を並び順に続けて書く。
+ * `link` には直通先の路線での同じ駅の ID を書く（例: 夢の森線の夢見ヶ丘 10 ⇔ 花霞線の夢見ヶ丘 110）。
+ * 路線を増やす場合も CSV に行を加えるだけでよい。
+ *
+ * 読み込み時に、駅の停車種別とスクロール用画像を次駅 CSV から 1 回だけ読み取り、
+ * 路線の組ごとに最初に乗り継ぐ駅（経路表）を求めておく。
+ * そのため `route()` は CSV を開かず、途中の駅を順に 1 回たどるだけで求められる。
+ *
+ * パネル制御タスクからのみ使用する（排他制御は行わない）。
+ */
+class RouteGraph {
+public:
+    /**
+     * @brief 路線図と駅の情報を読み込む
+     * @param routePath 路線図 CSV のパス
+     * @param stationPath 次駅 CSV のパス
+     * @return 読み込めた場合 true（失敗した場合は空の路線図になり、停車駅スクロールは表示しない）
+     */
+    bool load(const char *routePath = ROUTE_CSV_PATH, const char *stationPath = ROUTE_STATION_CSV_PATH);
+
+    /**
+     * @brief 始発駅から行先までの途中の駅を、進む順に求める（始発駅・行先は含まない）
+     * @param dep 始発駅の ID
+     * @param dest 行先の ID
+     * @param stops 途中の駅の格納先（既存の内容は消去）
+     * @return 行先までたどれた場合 true
+     */
+    bool route(int dep, int dest, std::vector<RouteStop> &stops) const;
+
+    /**
+     * @brief 始発駅から行先までの駅数（隣の駅なら 1、たどれない場合は -1）
+     */
+    int hops(int dep, int dest) const;
+
+    /**
+     * @brief 駅が属する路線の ID（路線図に無い駅は 0）
+     */
+    int lineOf(int station) const;
+
+    const RouteStation *station(int id) const;
+    size_t stationCount() const { return stations.size(); }
+    size_t lineCount() const { return lines.size(); }
+    uint32_t generation() const { return loadGeneration; }
+
+private:
+    /**
+     * @brief 路線（駅は `stations` の `first` から `count` 件、並び順に格納）
+     */
+    struct Line {
+        int id;
+        int first;
+        int count;
+    };
+
+    std::vector<RouteStation> stations; // 路線ごとに並び順で格納
+    std::vector<int> byId;              // ID 順に並べた `stations` の添字
+    std::vector<Line> lines;
+    std::vector<int> nextHop;           // [出発路線 × 到着路線] 最初に乗り継ぐ駅の添字（-1: たどれない）
+    uint32_t loadGeneration = 0;        // 読み込むたびに進む
+
+    int indexOf(int id) const;
+    void buildNextHop();
+    template <typename Visit> bool walk(int dep, int dest, Visit visit) const;
+};
+
+extern RouteGraph routeGraph; // 全体で共有する路線図
+
+#endif // ROUTEGRAPH_H
@@ -0,0 +1,390 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "SceneBuilder.h"
+#include "AssetCache.h"
+#include "AssetManifest.h"
+#include "RouteGraph.h"
+#include "PanelGeometry.h"
+#include "TraceBuffer.h"
+#include <utility> // std::swap
+
+// すべての `Scene` の画像が使っているメモリ
+std::atomic<uint32_t> Scene::residentTotal{0};
+
+// Scene クラスのコンストラクタ（役割はすべて無し）
+Scene::Scene() {
+    for (int slot = 0; slot < SCENE_SLOT_COUNT; slot++) {
+        slotImage[slot] = -1;
+    }
+}
+
+/**
+ * @brief 段階の画像を用意する（表示中と次の段階の言語以外の画像を破棄し、次の言語の画像を先読みする）
+ *
+ * 1. 表示する言語・次の言語のどちらでも使わない画像を破棄する
+ * 2. 表示する言語の画像がメモリに無ければ読み込む（先読み済みなら `AssetCache` から受け取る）
+ * 3. 次の言語の画像の先読みを予約する（`AssetCache::pump()` が描画の合間に読み込む）
+ *
+ * 2 言語以下の場合はすべての画像が常にメモリにあるため、何もしない。
+ *
+ * @param phase 表示する段階
+ */
+void Scene::preparePhase(int phase) {
+    if (phase < 0 || phase >= phases) return;
+    uint32_t window = windowOf(phase);
+    uint32_t shown = 1u << phaseLanguages[phase];
+
+    std::vector<BMPLoad> loads;
+    for (int i = 0; i < imageCount; i++) {
+        // 1. 表示中・次の言語で使わない画像を破棄
+        if ((imageLanguages[i] & window) == 0) {
+            release(i);
+            continue;
+        }
+        if (images[i].cache) continue;
+
+        // 2. 表示する言語の画像は今読み込み、3. 次の言語の画像は先読みを予約
+        if (imageLanguages[i] & shown) {
+            loads.push_back({ imagePaths[i], &images[i] });
+        } else {
+            assetCache.enqueue(imagePaths[i]);
+        }
+    }
+    if (!loads.empty()) {
+        TRACE_SCOPE("Scene::preparePhase", loads.front().path.c_str());
+        loadImages(loads); // 読み込めなかった画像は描画せず、次にその言語を表示するときに読み込み直す
+    }
+}
+
+// 段階の表示中と次に表示する言語（ビットごと、次の段階が同じ言語の場合はその先の別の言語）
+uint32_t Scene::windowOf(int phase) const {
+    int language = phaseLanguages[phase];
+    for (int step = 1; step < phases; step++) {
+        int next = phaseLanguages[(phase + step) % phases];
+        if (next != language) return (1u << language) | (1u << next);
+    }
+    return 1u << language;
+}
+
+// 画像をまとめて読み込み、使っているメモリに加える
+void Scene::loadImages(const std::vector<BMPLoad> &loads) {
+    cacheBMPDataBatch(loads);
+    for (const BMPLoad &load : loads) {
+        if (load.dest->cache) {
+            residentTotal.fetch_add((uint32_t)load.dest->width * load.dest->height * sizeof(uint16_t),
+                                    std::memory_order_relaxed);
+        }
+    }
+}
+
+// 画像を破棄する（パスと世代は残し、再び必要になったときに読み込む）
+void Scene::release(int index) {
+    BMPData &image = images[index];
+    if (image.cache == nullptr) return;
+    residentTotal.fetch_sub((uint32_t)image.width * image.height * sizeof(uint16_t), std::memory_order_relaxed);
+    free(image.cache);
+    image.cache = nullptr;
+}
+
+/**
+ * @brief 内容を入れ替える（画像・停車駅スクロールのメモリはコピーせず所有者を入れ替える）
+ */
+void Scene::swap(Scene &other) {
+    std::swap(target, other.target);
+    std::swap(showLine, other.showLine);
+    std::swap(stripPaths, other.stripPaths);
+    std::swap(stripRows, other.stripRows);
+    strip.swap(other.strip);
+    std::swap(images, other.images);
+    std::swap(imagePaths, other.imagePaths);
+    std::swap(imageLanguages, other.imageLanguages);
+    std::swap(imageCount, other.imageCount);
+    std::swap(slotImage, other.slotImage);
+    std::swap(slotRow, other.slotRow);
+    std::swap(slotGeneration, other.slotGeneration);
+    std::swap(phaseLanguages, other.phaseLanguages);
+    std::swap(phases, other.phases);
+    std::swap(routeGeneration, other.routeGeneration);
+}
+
+/**
+ * @brief 画像と停車駅スクロールをすべて破棄する
+ */
+void Scene::clear() {
+    for (int i = 0; i < imageCount; i++) {
+        release(i);
+        images[i] = BMPData();
+        imagePaths[i] = "";
+        imageLanguages[i] = 0;
+    }
+    imageCount = 0;
+    for (int slot = 0; slot < SCENE_SLOT_COUNT; slot++) {
+        slotImage[slot] = -1;
+        slotRow[slot] = 0;
+        slotGeneration[slot] = 0;
+    }
+    phases = 0;
+    target = SceneTarget();
+    showLine = false;
+    stripPaths.clear();
+    stripRows.clear();
+    strip.clear();
+    strip.generation = 0;
+    routeGeneration = 0;
+}
+
+// SceneBuilder クラスのコンストラクタ
+SceneBuilder::SceneBuilder(CSVReader &typeReader, CSVReader &destReader, CSVReader &nextReader)
+    : typeReader(typeReader), destReader(destReader), nextReader(nextReader) {}
+
+/**
+ * @brief 表示中の `Scene` が、指定の表示内容と現在のカタログ・路線図のままか
+ *
+ * 表示内容が同じでも、参照した行（画像の差し替えを含む）や路線図が変わっていれば作り直す。
+ */
+bool SceneBuilder::isCurrent(const Scene &scene, const SceneTarget &target) const {
+    if (scene.empty() || scene.target != target || scene.routeGeneration != routeGraph.generation()) {
+        return false;
+    }
+    for (int slot = 0; slot < SCENE_SLOT_COUNT; slot++) {
+        if (scene.slotImage[slot] < 0) continue;
+        if (readerOf(slot).rowGeneration(scene.slotRow[slot]) != scene.slotGeneration[slot]) {
+            return false;
+        }
+    }
+    return target.mode != 3 || nextReader.rowsGeneration(scene.stripRows) == scene.strip.generation;
+}
+
+/**
+ * @brief 表示内容をすべて作成し、成功した場合のみ `scene` と入れ替える
+ *
+ * 1. 必要な行・列（表示するすべての言語の列）を CSV ごとに 1 回の読み込みでまとめて検索する
+ * 2. 同じパスの画像は 1 枚にまとめ、2 番目以降の言語の空欄は先頭の言語の画像を使う
+ * 3. トグルの段階（路線名・各言語）を決める
+ * 4. 最初の段階と次の言語の画像のうち、表示中の `Scene` にあるものは読み込み直さず、残りをまとめて読み込む
+ * 5. Mode 3 は停車駅スクロールを作成する（画像のパスリストと行の世代が同じなら表示中のものを使う）
+ * 6. すべてそろったら、使い回す画像を移して表示中の `Scene` と入れ替える
+ *
+ * @param target 作成する表示内容
+ * @param scene 表示中の表示内容（失敗した場合は変更しない）
+ * @return 入れ替えた場合 true（失敗した場合は `lastError()` に理由）
+ */
+bool SceneBuilder::build(const SceneTarget &target, Scene &scene) {
+    // 0. 同じ表示内容・同じカタログのまま失敗を繰り返さない（一時的な失敗は間隔を空けて作成し直す）
+    if (target == failedTarget && catalogStamp() == failedStamp &&
+        (failedForGood || millis() - failedAt < SCENE_RETRY_MS)) {
+        return false;
+    }
+    TRACE_SCOPE("SceneBuilder::build");
+
+    // 1. 作成中の表示内容を初期化し、路線名を表示するか決める
+    staging.clear();
+    staging.target = target;
+    bool stationScroll = (target.mode == 3);
+    int lineRow = routeGraph.lineOf(stationScroll ? target.dep : target.next); // 路線名を表示する行先の ID
+    staging.showLine = (target.dest < 900 && lineRow != 0);
+    staging.routeGeneration = routeGraph.generation();
+
+    // 2. 必要な行・列を CSV ごとにまとめて検索（種別・行先・次駅の CSV をそれぞれ 1 回だけ読む）
+    const PanelLayout &layout = panelGeometry.layout;
+    struct SlotQuery {
+        int slot;       // 役割と言語
+        int row;        // 行（ID）
+        size_t query;   // その CSV の検索の番号
+    };
+    std::vector<SlotQuery> wanted;
+    std::vector<CatalogQuery> typeQueries, destQueries, nextQueries;
+    auto want = [&](SceneRole role, int language, int row) {
+        std::vector<CatalogQuery> &queries = (role == SCENE_TYPE) ? typeQueries
+                                           : (role == SCENE_NEXT) ? nextQueries
+                                           : destQueries;
+        wanted.push_back({ Scene::slotOf(role, language), row, queries.size() });
+        queries.push_back(CatalogQuery(row, layout.languages[language]));
+    };
+    for (int language = 0; language < layout.languageCount; language++) { // 先頭の言語から順に（空欄の参照先を先に求める）
+        want(SCENE_TYPE, language, target.type);
+        want(SCENE_DEST, language, target.dest);
+        if (!stationScroll) {
+            want(SCENE_NEXT, language, target.next);
+        }
+    }
+    if (staging.showLine) {
+        want(SCENE_LINE, 0, lineRow);
+    }
+    size_t classQuery = typeQueries.size();
+    if (stationScroll) {
+        typeQueries.push_back(CatalogQuery(target.type, "className")); // 停車駅の判別に使用
+    }
+    typeReader.lookup(typeQueries);
+    destReader.lookup(destQueries);
+    nextReader.lookup(nextQueries);
+
+    // 3. 役割・言語ごとに画像を割り当てる（同じパスは 1 枚にまとめ、2 番目以降の言語の空欄は先頭の言語の画像を使う）
+    uint32_t ownLanguages = 0; // 自身の画像がある言語（ビットごと）
+    for (const SlotQuery &slotQuery : wanted) {
+        CSVReader &reader = readerOf(slotQuery.slot);
+        const CatalogQuery &result = (&reader == &typeReader) ? typeQueries[slotQuery.query]
+                                   : (&reader == &nextReader) ? nextQueries[slotQuery.query]
+                                   : destQueries[slotQuery.query];
+        int language = slotQuery.slot % PANEL_MAX_LANGUAGES;
+        int index = 0;
+        if (result.found && result.value.length() > 0) {
+            while (index < staging.imageCount && staging.imagePaths[index] != result.value) index++;
+            if (index == staging.imageCount) {
+                staging.imagePaths[index] = result.value;
+                staging.imageCount++;
+            }
+            ownLanguages |= 1u << language;
+        } else if (language > 0) {
+            index = staging.slotImage[slotQuery.slot - language]; // 先頭の言語の同じ役割
+        } else {
+            return fail(target, String(reader.path()) + " の ID " + String(result.id) + " の " + result.label + " 列がありません", true);
+        }
+        uint32_t rowGeneration = reader.rowGeneration(slotQuery.row);
+        staging.slotImage[slotQuery.slot] = index;
+        staging.slotRow[slotQuery.slot] = slotQuery.row;
+        staging.slotGeneration[slotQuery.slot] = rowGeneration;
+        staging.imageLanguages[index] |= 1u << language;
+        staging.images[index].generation = max(staging.images[index].generation, rowGeneration);
+    }
+
+    // 3.1 トグルの段階を決める（路線名 → 先頭の言語 → 自身の画像がある言語）
+    if (staging.showLine) {
+        staging.phaseLanguages[staging.phases++] = 0; // 路線名は先頭の言語の種別・次駅と並べる
+    }
+    for (int language = 0; language < layout.languageCount; language++) {
+        if (language == 0 || (ownLanguages & (1u << language))) {
+            staging.phaseLanguages[staging.phases++] = language;
+        }
+    }
+
+    // 4. 最初の段階と次の言語の画像を用意する（表示中の画像でパスと行の世代が同じものは使い回し、残りをまとめて読み込む）
+    //    それ以降の言語の画像は、表示する直前に `Scene::preparePhase()` が読み込む
+    uint32_t window = staging.windowOf(0);
+    int reuse[SCENE_SLOT_COUNT]; // 使い回す表示中の画像の番号（-1: 使い回さない）
+    std::vector<BMPLoad> loads;
+    for (int i = 0; i < staging.imageCount; i++) {
+        reuse[i] = -1;
+        if ((staging.imageLanguages[i] & window) == 0) continue;
+        for (int k = 0; k < scene.imageCount; k++) {
+            if (scene.images[k].cache && scene.imagePaths[k] == staging.imagePaths[i] &&
+                scene.images[k].generation == staging.images[i].generation) {
+                reuse[i] = k;
+                break;
+            }
+        }
+        if (reuse[i] < 0) {
+            loads.push_back({ staging.imagePaths[i], &staging.images[i] });
+        }
+    }
+    staging.loadImages(loads);
+    for (const BMPLoad &load : loads) {
+        if (!load.dest->cache) {
+            // マニフェストに無い画像は作り直しても読み込めない。それ以外はメモリ不足などの一時的な失敗とみなす
+            bool missing = assetManifest.isReady() && !assetManifest.find(load.path);
+            return fail(target, "画像 " + load.path + " を読み込めません", missing);
+        }
+    }
+
+    // 5. 停車駅スクロールを作成（画像のパスリストと参照した行の世代が同じなら表示中のものを使う）
+    bool reuseStrip = false;
+    if (stationScroll) {
+        buildStationScrollPaths(staging.stripPaths, typeQueries[classQuery].value, target.dest, target.dep, &staging.stripRows);
+        uint32_t stripGeneration = nextReader.rowsGeneration(staging.stripRows);
+        reuseStrip = !scene.strip.empty() && scene.stripPaths == staging.stripPaths && scene.strip.generation == stripGeneration;
+        if (!reuseStrip) {
+            if (!staging.strip.build(staging.stripPaths, panelGeometry.layout.areaWidth())) {
+                return fail(target, "停車駅スクロールを作成できません", false);
+            }
+            staging.strip.generation = stripGeneration;
+        }
+    }
+
+    // 6. すべてそろったので、使い回す画像・スクロールを移して入れ替える（古い表示内容はここで破棄）
+    for (int i = 0; i < staging.imageCount; i++) {
+        if (reuse[i] < 0) continue;
+        uint32_t generation = staging.images[i].generation;
+        staging.images[i] = scene.images[reuse[i]];
+        staging.images[i].generation = generation;
+        scene.images[reuse[i]] = BMPData();
+    }
+    if (reuseStrip) {
+        staging.strip.swap(scene.strip);
+    }
+    scene.swap(staging);
+    staging.clear();
+    failedTarget = SceneTarget();
+    return true;
+}
+
+// カタログ・路線図の世代の合計（いずれかが変われば変わる）
+uint32_t SceneBuilder::catalogStamp() const {
+    return typeReader.generation() + destReader.generation() + nextReader.generation() + routeGraph.generation();
+}
+
+// 役割・言語の画像を検索する CSV
+CSVReader &SceneBuilder::readerOf(int slot) const {
+    switch (slot / PANEL_MAX_LANGUAGES) {
+        case SCENE_TYPE: return typeReader;
+        case SCENE_NEXT: return nextReader;
+        default:         return destReader;
+    }
+}
+
+// 作成中の表示内容を破棄して失敗を記録する（表示中の表示内容は変更しない）
+bool SceneBuilder::fail(const SceneTarget &target, const String &reason, bool forGood) {
+    staging.clear();
+    error = reason;
+    failedTarget = target;
+    failedStamp = catalogStamp();
+    failedAt = millis();
+    failedForGood = forGood;
+    Serial.printf("表示内容を作成できませんでした（%s）。表示中の内容を維持します%s。\n",
+                  reason.c_str(), forGood ? "" : "（しばらくして作成し直します）");
+    return false;
+}
+
+/**
+ * @brief 停車駅スクロールに使う画像のパスリストを作成する
+ *
+ * 「この電車の停車駅は」→ 停車駅（、区切り）→「駅に停まります」の順に並べる。
+ * 途中の駅は路線図（`routeGraph`）から求め、種別の `className` に該当する駅と直通で乗り継ぐ駅を並べる。
+ * 駅数の上限は設けない（連結画像が大きい場合は `ScrollStrip` がページに分けて順に読み込む）。
+ *
+ * @param imagePaths 作成したパスリストの格納先（既存の内容は消去）
+ * @param className 種別の `className` 列
+ * @param numDest 行先の ID
+ * @param numDep 始発駅の ID
+ * @param rows 参照した次駅 CSV の行 ID の格納先（NULL の場合は記録しない、既存の内容は消去）
+ */
+void buildStationScrollPaths(std::vector<String> &imagePaths, const String &className, int numDest, int numDep,
+                             std::vector<int> *rows) {
+    imagePaths.clear(); // 既存リストをクリア
+    if (rows) rows->clear();
+    imagePaths.emplace_back("/img/Scroll/ScrollStart.bmp"); // 「この電車の停車駅は」
+
+    // 1. 始発駅から行先までの途中の駅を路線図から求め、停車する駅を並べる（長い場合は ScrollStrip がページに分ける）
+    std::vector<RouteStop> stops;
+    routeGraph.route(numDep, numDest, stops);
+    for (const RouteStop &stop : stops) {
+        if (rows) rows->push_back(stop.station->id); // 停車しない駅も、種別の変更で停車駅になりうるため記録する
+        if (stop.transfer || containsWord(stop.station->classes, className)) {
+            imagePaths.emplace_back("/img/Scroll/touten.bmp"); // 「、」
+            imagePaths.emplace_back(stop.station->scroll); // 駅名
+        }
+    }
+
+    // 2. 停車駅の終端画像を追加
+    imagePaths.emplace_back("/img/Scroll/ScrollEnd.bmp"); // 「駅に停まります」
+}
@@ -0,0 +1,219 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef SCENEBUILDER_H
+#define SCENEBUILDER_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>     // Arduino 環境の基本ライブラリ
+#include "CSVReader.h"   // 種別・行先・次駅のカタログ
+#include "drawBitmap.h"  // BMPData / cacheBMPDataBatch
+#include "ScrollStrip.h" // 停車駅スクロール
+#include "PanelGeometry.h" // 表示する言語（PANEL_MAX_LANGUAGES）
+#include <atomic>        // 画像が使っているメモリ（/metrics から読み取る）
+#include <vector>        // 画像のパス・停車駅の一覧
+
+/**
+ * @brief 表示内容を構成する画像の役割（言語ごとに 1 枚）
+ */
+enum SceneRole {
+    SCENE_TYPE,      // 種別
+    SCENE_DEST,      // 行先
+    SCENE_NEXT,      // 次駅（Mode 2 のみ）
+    SCENE_LINE,      // 路線名（表示する場合のみ、先頭の言語のみ）
+    SCENE_ROLE_COUNT
+};
+
+#define SCENE_SLOT_COUNT (SCENE_ROLE_COUNT * PANEL_MAX_LANGUAGES) // 役割と言語の組み合わせの数
+#define SCENE_MAX_PHASES (PANEL_MAX_LANGUAGES + 1)                // トグルの段階の最大数（路線名 + 各言語）
+#define SCENE_RETRY_MS 2000 // メモリ不足などで失敗した表示内容を作成し直すまでの間隔（ミリ秒）
+
+/**
+ * @brief 作成する表示内容（表示モードと各 ID）
+ */
+struct SceneTarget {
+    int mode = -1; // 表示モード（2 または 3）
+    int type = -1; // 種別の ID
+    int dest = -1; // 行先の ID
+    int next = -1; // 次駅の ID（Mode 2）
+    int dep = -1;  // 始発駅の ID（Mode 3）
+
+    bool operator==(const SceneTarget &other) const {
+        return mode == other.mode && type == other.type && dest == other.dest && next == other.next && dep == other.dep;
+    }
+    bool operator!=(const SceneTarget &other) const { return !(*this == other); }
+};
+
+// ===============================
+//      Scene クラスの定義
+// ===============================
+/**
+ * @brief 作成済みの表示内容（種別・行先・次駅・路線名の画像と、Mode 3 の停車駅スクロール）
+ *
+ * 画像はパスごとに 1 枚だけ持ち、同じパスの役割（日本語と英語が同じ画像、空欄で先頭の言語の画像を使う場合など）は同じ画像を指す。
+ * `SceneBuilder::build()` が別の `Scene` にすべて作成してから入れ替えるため、
+ * 表示中の `Scene` が作りかけの状態になることはない。
+ *
+ * トグルは「路線名（表示する場合）→ 各言語」の順に段階を切り替える。
+ * メモリに置く画像は表示中の段階と次の段階の言語の分だけで（`preparePhase()`）、
+ * 次の言語の画像は表示中に `AssetCache` で先読みしておく。言語を増やしてもメモリの使用量は 2 言語分のまま変わらない。
+ */
+class Scene {
+public:
+    SceneTarget target;             // 作成元の表示内容（未作成の場合は mode が -1）
+    bool showLine = false;          // 路線名を表示するか
+    std::vector<String> stripPaths; // 停車駅スクロールの画像のパスリスト（Mode 3）
+    std::vector<int> stripRows;     // 停車駅スクロールの作成で参照した次駅 CSV の行（Mode 3）
+    ScrollStrip strip;              // 停車駅スクロール（Mode 3）
+
+    Scene();
+
+    /**
+     * @brief 役割・言語ごとの画像（その役割が無い場合は NULL、メモリに無い間は `cache` が NULL）
+     * @param role 役割
+     * @param language 言語（`PanelLayout::languages` の添字）
+     */
+    BMPData *image(SceneRole role, int language) {
+        int index = slotImage[slotOf(role, language)];
+        return index < 0 ? nullptr : &images[index];
+    }
+
+    int phaseCount() const { return phases; }
+    int phaseLanguage(int phase) const { return phaseLanguages[phase]; } // 段階で表示する言語
+    bool isLinePhase(int phase) const { return showLine && phase == 0; } // 路線名を表示する段階か
+
+    /**
+     * @brief 段階の画像を用意する（表示中と次の段階の言語以外の画像を破棄し、次の言語の画像を先読みする）
+     * @param phase 表示する段階
+     */
+    void preparePhase(int phase);
+
+    /**
+     * @brief `toggleCacheBMP()` に渡す `TogglePhaseHook`（`context` は `Scene`）
+     */
+    static void preparePhaseHook(int phase, void *context) { static_cast<Scene *>(context)->preparePhase(phase); }
+
+    /**
+     * @brief すべての `Scene` の画像が使っているメモリ（バイト）
+     */
+    static uint32_t residentBytes() { return residentTotal.load(std::memory_order_relaxed); }
+
+    bool empty() const { return target.mode < 0; }
+
+    /**
+     * @brief 内容を入れ替える（画像・停車駅スクロールのメモリはコピーせず所有者を入れ替える）
+     */
+    void swap(Scene &other);
+
+    /**
+     * @brief 画像と停車駅スクロールをすべて破棄する
+     */
+    void clear();
+
+private:
+    friend class SceneBuilder;
+
+    BMPData images[SCENE_SLOT_COUNT];   // 画像（パスごとに 1 枚、`generation` は参照する行の最も新しい世代）
+    String imagePaths[SCENE_SLOT_COUNT];
+    uint32_t imageLanguages[SCENE_SLOT_COUNT] = {}; // 画像を使う言語（ビットごと、メモリに置くかの判断に使う）
+    int imageCount = 0;
+    int slotImage[SCENE_SLOT_COUNT];            // 役割・言語ごとの画像の番号（-1: 無し）
+    int slotRow[SCENE_SLOT_COUNT] = {};         // 役割・言語ごとの参照した CSV の行（ID）
+    uint32_t slotGeneration[SCENE_SLOT_COUNT] = {}; // 役割・言語ごとの参照した行の世代
+    int phaseLanguages[SCENE_MAX_PHASES] = {};  // 段階ごとの言語
+    int phases = 0;                             // トグルの段階の数
+    uint32_t routeGeneration = 0;               // 作成したときの路線図の世代
+
+    static std::atomic<uint32_t> residentTotal; // すべての `Scene` の画像が使っているメモリ
+
+    static int slotOf(SceneRole role, int language) { return role * PANEL_MAX_LANGUAGES + language; }
+    uint32_t windowOf(int phase) const;
+    void loadImages(const std::vector<BMPLoad> &loads);
+    void release(int index);
+};
+
+// ===============================
+//      SceneBuilder クラスの定義
+// ===============================
+/**
+ * @brief 表示内容（`Scene`）をまとめて作成し、すべてそろった場合のみ差し替える
+ *
+ * 1. 必要な行・列（表示するすべての言語の列）を CSV ごとに 1 回の読み込みでまとめて検索する（`CSVReader::lookup()`）
+ * 2. 同じパスの画像は 1 回だけ読み込み、表示中の `Scene` にある画像（パスと行の世代が同じもの）は読み込み直さない
+ * 3. 最初の 2 段階の言語の画像をまとめて読み込む（`cacheBMPDataBatch()`、2 つのコアで分担、残りの言語は表示の直前に読み込む）
+ * 4. すべてそろった場合のみ表示中の `Scene` と入れ替える
+ *
+ * 先頭の言語の列は必須で、2 番目以降の言語の列が無い・空欄の場合は先頭の言語の画像を使う
+ * （すべての役割が空欄の言語は表示しない）。
+ * 途中で失敗した場合（行・先頭の言語の列が無い、画像を読み込めない）は作成した分を破棄し、表示中の `Scene` は変更しない。
+ * 同じ表示内容・同じカタログの世代で失敗した場合は、次のように作成し直す。
+ * - CSV の行・列が無い、画像がマニフェストに無い（作り直しても同じ結果になる）: どちらかが変わるまで作成し直さない
+ * - 画像・停車駅スクロールを読み込めない（メモリ不足など、一時的な場合がある）: `SCENE_RETRY_MS` おきに作成し直す
+ *
+ * パネル制御タスクからのみ使用する（排他制御は行わない）。
+ */
+class SceneBuilder {
+public:
+    /**
+     * @brief コンストラクタ
+     * @param typeReader 種別用 CSV
+     * @param destReader 行先用 CSV（路線名も含む）
+     * @param nextReader 次駅用 CSV（停車駅スクロールの駅名も含む）
+     */
+    SceneBuilder(CSVReader &typeReader, CSVReader &destReader, CSVReader &nextReader);
+
+    /**
+     * @brief 表示中の `Scene` が、指定の表示内容と現在のカタログ・路線図のままか
+     */
+    bool isCurrent(const Scene &scene, const SceneTarget &target) const;
+
+    /**
+     * @brief 表示内容をすべて作成し、成功した場合のみ `scene` と入れ替える
+     * @param target 作成する表示内容
+     * @param scene 表示中の表示内容（失敗した場合は変更しない）
+     * @return 入れ替えた場合 true（失敗した場合は `lastError()` に理由）
+     */
+    bool build(const SceneTarget &target, Scene &scene);
+
+    const String &lastError() const { return error; }
+
+private:
+    CSVReader &typeReader;
+    CSVReader &destReader;
+    CSVReader &nextReader;
+    Scene staging;              // 作成中の表示内容
+    String error;               // 最後に失敗した理由
+    SceneTarget failedTarget;   // 最後に失敗した表示内容
+    uint32_t failedStamp = 0;   // 最後に失敗したときのカタログ・路線図の世代
+    unsigned long failedAt = 0; // 最後に失敗した時刻（ミリ秒）
+    bool failedForGood = false; // 作り直しても同じ結果になる失敗か（false の場合は `SCENE_RETRY_MS` 後に作成し直す）
+
+    uint32_t catalogStamp() const;
+    CSVReader &readerOf(int slot) const;
+    bool fail(const SceneTarget &target, const String &reason, bool forGood);
+};
+
+/**
+ * @brief 停車駅スクロールに使う画像のパスリストを作成する
+ * @param imagePaths 作成したパスリストの格納先（既存の内容は消去）
+ * @param className 種別の `className` 列（停車する駅の判別に使用）
+ * @param numDest 行先の ID
+ * @param numDep 始発駅の ID
+ * @param rows 参照した次駅 CSV の行の格納先（NULL の場合は返さない）
+ */
+void buildStationScrollPaths(std::vector<String> &imagePaths, const String &className, int numDest, int numDep,
+                             std::vector<int> *rows = nullptr);
+
+#endif // SCENEBUILDER_H
@@ -0,0 +1,325 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "ScenePreset.h"
+#include "PanelGeometry.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
+#include "FrameGovernor.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+ScenePreset scenePreset;
+
+// キャッシュ画像をフレームバッファの指定位置に重ねる（範囲外は切り捨て）
+static void composeImage(uint16_t *frame, int frameWidth, int frameHeight, const BMPData *image, int startX, int startY) {
+    if (image == nullptr || image->cache == nullptr) return;
+    int x0 = max(startX, 0);
+    int x1 = min(startX + image->width, frameWidth);
+    if (x1 <= x0) return;
+    for (int y = 0; y < image->height; y++) {
+        int drawY = startY + y;
+        if (drawY < 0 || drawY >= frameHeight) continue;
+        memcpy(frame + drawY * frameWidth + x0,
+               image->cache + y * image->width + (x0 - startX),
+               (x1 - x0) * sizeof(uint16_t));
+    }
+}
+
+/**
+ * @brief 表示中の内容をプリセットとして保存する
+ *
+ * 表示中の内容の写しに、トグルの各段階の画像を重ねたフレームを作成して書き出す。
+ * 画像をすべてメモリに置かない表示内容（3 言語以上）は、段階ごとに `phaseHook` で画像を用意させる。
+ * 書き込み中の電源断に備え、一時ファイルに書いてから名前を変更する。
+ *
+ * @param name プリセット名
+ * @return 成功時 true
+ */
+bool ScenePreset::save(const String &name) {
+    TRACE_SCOPE("presetSave", name.c_str());
+    const uint16_t *mirror = panelGeometry.mirrorBuffer();
+    if (!isValidName(name) || mirror == nullptr) {
+        return false;
+    }
+
+    // 1. ヘッダーを作成（トグル・スクロールは表示中の内容から）
+    ScenePresetHeader head = {};
+    memcpy(head.magic, "LPS2", 4);
+    head.width = panelWidth;
+    head.height = panelHeight;
+    head.phaseCount = 1;
+    if (activeScene.parts != nullptr && activeScene.numImages > 1) {
+        head.phaseCount = min(activeScene.numImages, PRESET_MAX_PHASES);
+        head.phaseInterval = activeScene.toggleInterval;
+    }
+    const BMPData *scroll = activeScene.scroll;
+    if (scroll != nullptr && scroll->cache != nullptr) {
+        head.stripWidth = scroll->width;
+        head.stripHeight = scroll->height;
+        head.scrollX = activeScene.scrollX;
+        head.scrollY = activeScene.scrollY;
+        head.scrollWidth = activeScene.scrollWidth;
+        head.scrollHeight = activeScene.scrollHeight;
+        head.scrollSpeed = (uint32_t)(activeScene.scrollSpeed * 1000.0f + 0.5f);
+    } else if (activeScene.scrollPaged) {
+        // ページに分けた連結画像は全体を一度に読み込めないため、スクロール領域は表示中の内容のまま保存する
+        Serial.println("停車駅スクロールが長いため、プリセットにはスクロールを保存しません。");
+    }
+
+    // 2. 合成用のフレームを 1 枚分確保
+    size_t framePixels = (size_t)panelWidth * panelHeight;
+    uint16_t *frame = (uint16_t *)malloc(framePixels * sizeof(uint16_t));
+    if (!frame) {
+        Serial.println("プリセット保存用のメモリ確保に失敗しました。");
+        return false;
+    }
+
+    // 3. 一時ファイルに書き込む
+    if (!LittleFS.exists(PRESET_DIR)) {
+        LittleFS.mkdir(PRESET_DIR);
+    }
+    String path = pathFor(name);
+    String tempPath = path + ".tmp";
+    File file = LittleFS.open(tempPath, "w");
+    if (!file) {
+        Serial.printf("プリセット %s を書き込めませんでした。\n", tempPath.c_str());
+        free(frame);
+        return false;
+    }
+    bool ok = file.write((const uint8_t *)&head, sizeof(head)) == sizeof(head);
+
+    // 3.1 トグルの各段階のフレーム（表示中の内容に、その段階の画像を重ねる）
+    for (int phase = 0; ok && phase < head.phaseCount; phase++) {
+        memcpy(frame, mirror, framePixels * sizeof(uint16_t));
+        if (head.phaseCount > 1) {
+            if (activeScene.phaseHook != nullptr) {
+                activeScene.phaseHook(phase, activeScene.phaseContext); // メモリに無い言語の画像を読み込ませる
+            }
+            for (const ToggleCacheBMPPart &part : *activeScene.parts) {
+                // toggleCacheBMP() と同じく、画像が足りない部品は表示を維持する
+                if (part.bmpList.empty() || activeScene.numImages > (int)part.bmpList.size()) continue;
+                composeImage(frame, panelWidth, panelHeight,
+                             part.bmpList[phase % activeScene.numImages], part.startX, part.startY);
+            }
+        }
+        size_t bytes = framePixels * sizeof(uint16_t);
+        ok = file.write((const uint8_t *)frame, bytes) == bytes;
+    }
+    free(frame);
+    if (head.phaseCount > 1 && activeScene.phaseHook != nullptr) {
+        activeScene.phaseHook(activeScene.phase, activeScene.phaseContext); // 表示中の段階の画像に戻す
+    }
+
+    // 3.2 スクロール用の連結画像
+    if (ok && head.stripWidth > 0) {
+        size_t bytes = (size_t)head.stripWidth * head.stripHeight * sizeof(uint16_t);
+        ok = file.write((const uint8_t *)scroll->cache, bytes) == bytes;
+    }
+    file.close();
+
+    // 4. 書き込みが完了したら正式な名前に変更
+    if (!ok) {
+        Serial.printf("プリセット %s の書き込みに失敗しました。\n", name.c_str());
+        LittleFS.remove(tempPath);
+        return false;
+    }
+    LittleFS.remove(path);
+    if (!LittleFS.rename(tempPath, path)) {
+        LittleFS.remove(tempPath);
+        return false;
+    }
+    Serial.printf("プリセット %s を保存しました（%d 段階、スクロール %s）。\n",
+                  name.c_str(), head.phaseCount, head.stripWidth > 0 ? "あり" : "なし");
+    return true;
+}
+
+/**
+ * @brief プリセットを読み込み、次の `draw()` で表示する
+ *
+ * フレームとスクロール用の連結画像をそれぞれ 1 回の読み込みで取得する。
+ *
+ * @param name プリセット名
+ * @return 成功時 true（パネルの大きさが保存時と異なる場合は失敗）
+ */
+bool ScenePreset::recall(const String &name) {
+    TRACE_SCOPE("presetRecall", name.c_str());
+    if (!isValidName(name)) return false;
+
+    // 1. ヘッダーを読み込み、現在のパネルで表示できるか確認
+    File file = LittleFS.open(pathFor(name), "r");
+    if (!file) {
+        Serial.printf("プリセット %s が見つかりません。\n", name.c_str());
+        return false;
+    }
+    ScenePresetHeader head;
+    size_t framePixels = (size_t)panelWidth * panelHeight;
+    size_t frameBytes = 0, stripBytes = 0;
+    bool ok = file.read((uint8_t *)&head, sizeof(head)) == sizeof(head) &&
+              memcmp(head.magic, "LPS2", 4) == 0 &&
+              head.width == panelWidth && head.height == panelHeight &&
+              head.phaseCount >= 1 && head.phaseCount <= PRESET_MAX_PHASES;
+    if (ok) {
+        frameBytes = framePixels * head.phaseCount * sizeof(uint16_t);
+        stripBytes = (size_t)head.stripWidth * head.stripHeight * sizeof(uint16_t);
+        ok = file.size() == sizeof(head) + frameBytes + stripBytes;
+    }
+    if (!ok) {
+        Serial.printf("プリセット %s は形式またはパネルの大きさが一致しません。\n", name.c_str());
+        file.close();
+        return false;
+    }
+
+    // 2. フレームと連結画像を一括で読み込む
+    uint16_t *newFrames = (uint16_t *)malloc(frameBytes);
+    uint16_t *newStrip = stripBytes > 0 ? (uint16_t *)malloc(stripBytes) : nullptr;
+    ok = newFrames != nullptr && (stripBytes == 0 || newStrip != nullptr) &&
+         file.read((uint8_t *)newFrames, frameBytes) == frameBytes &&
+         (stripBytes == 0 || file.read((uint8_t *)newStrip, stripBytes) == stripBytes);
+    file.close();
+    panelMetrics.addFlashRead(METRICS_SRC_BMP, sizeof(head) + frameBytes + stripBytes);
+    if (!ok) {
+        Serial.printf("プリセット %s の読み込みに失敗しました。\n", name.c_str());
+        free(newFrames);
+        free(newStrip);
+        return false;
+    }
+
+    // 3. 読み込んだ内容に差し替える
+    clear();
+    header = head;
+    frames = newFrames;
+    strip.cache = newStrip;
+    strip.width = head.stripWidth;
+    strip.height = head.stripHeight;
+    strip.offsetX = 0;
+    loadedName = name;
+    needsRedraw = true;
+    return true;
+}
+
+/**
+ * @brief プリセットを削除する
+ */
+bool ScenePreset::remove(const String &name) {
+    return isValidName(name) && LittleFS.remove(pathFor(name));
+}
+
+/**
+ * @brief 保存済みのプリセット名を JSON 配列（例: `["kaiso","shiunten"]`）で返す
+ */
+String ScenePreset::listJson() {
+    String json = "[";
+    File dir = LittleFS.open(PRESET_DIR, "r");
+    if (dir && dir.isDirectory()) {
+        bool first = true;
+        File file = dir.openNextFile();
+        while (file) {
+            String fileName = file.name();
+            fileName = fileName.substring(fileName.lastIndexOf('/') + 1);
+            if (!file.isDirectory() && fileName.endsWith(PRESET_EXT)) {
+                if (!first) json += ",";
+                json += "\"" + fileName.substring(0, fileName.length() - strlen(PRESET_EXT)) + "\"";
+                first = false;
+            }
+            file.close();
+            file = dir.openNextFile();
+        }
+    }
+    json += "]";
+    return json;
+}
+
+/**
+ * @brief プリセット名として使えるか（英数字・'-'・'_' のみ、PRESET_NAME_LEN 文字未満）
+ */
+bool ScenePreset::isValidName(const String &name) {
+    if (name.length() == 0 || name.length() >= PRESET_NAME_LEN) return false;
+    for (unsigned int i = 0; i < name.length(); i++) {
+        char c = name[i];
+        if (!isalnum((unsigned char)c) && c != '-' && c != '_') return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 呼び出したプリセットを表示する（Mode 4、描画ループから毎回呼ぶ）
+ *
+ * 呼び出し直後はフレーム全体を 1 回だけ描画し、以降はトグルとスクロールのみ更新する。
+ */
+void ScenePreset::draw() {
+    if (!frames) return;
+    unsigned long now = millis();
+
+    // 1. 呼び出し直後はフレーム全体を描画
+    if (needsRedraw) {
+        needsRedraw = false;
+        currentPhase = 0;
+        phaseStart = now;
+        strip.offsetX = 0;
+        strip.scrollMicros = 0;
+        blitFrame(currentPhase);
+    } else if (header.phaseCount > 1 && now - phaseStart >= header.phaseInterval &&
+               frameGovernor.admit(FRAME_WORK_TOGGLE)) {
+        // 2. トグルの段階を進める（フレームの予算に収まらない場合は次のフレームに回す）
+        TRACE_SCOPE("toggleFlip");
+        FrameWorkTimer timer(FRAME_WORK_TOGGLE);
+        currentPhase = (currentPhase + 1) % header.phaseCount;
+        phaseStart = now;
+        blitFrame(currentPhase);
+    }
+
+    // 3. スクロール
+    if (strip.cache) {
+        updateScroll(&strip, header.scrollX, header.scrollY, header.scrollWidth, header.scrollHeight, header.scrollSpeed / 1000.0f);
+    }
+}
+
+/**
+ * @brief 読み込んだプリセットを破棄する
+ */
+void ScenePreset::clear() {
+    free(frames);
+    frames = nullptr;
+    free(strip.cache);
+    strip = BMPData();
+    loadedName = "";
+}
+
+// プリセット名からファイルのパスを求める
+String ScenePreset::pathFor(const String &name) {
+    return String(PRESET_DIR) + "/" + name + PRESET_EXT;
+}
+
+// 指定した段階のフレームを LED パネルに描画する（スクロール領域は除く）
+void ScenePreset::blitFrame(int phase) const {
+    const uint16_t *frame = frames + (size_t)phase * header.width * header.height;
+    int scrollLeft = header.scrollX;
+    int scrollRight = header.scrollX + header.scrollWidth;
+    for (int y = 0; y < header.height; y++) {
+        const uint16_t *row = frame + y * header.width;
+        bool inScroll = strip.cache && y >= header.scrollY && y < header.scrollY + header.scrollHeight;
+        if (!inScroll) {
+            panelGeometry.blitSpan(matrix, 0, y, row, header.width);
+            continue;
+        }
+        // スクロール領域の左右のみ描画（スクロール中の内容を古いフレームで上書きしない）
+        if (scrollLeft > 0) {
+            panelGeometry.blitSpan(matrix, 0, y, row, scrollLeft);
+        }
+        if (scrollRight < header.width) {
+            panelGeometry.blitSpan(matrix, scrollRight, y, row + scrollRight, header.width - scrollRight);
+        }
+    }
+}
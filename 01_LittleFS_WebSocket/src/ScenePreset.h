@@ -0,0 +1,146 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef SCENEPRESET_H
+#define SCENEPRESET_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>    // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"   // ESP32 の LittleFS を使用するためのライブラリ
+#include "drawBitmap.h" // BMPData / ActiveScene
+
+// ===============================
+//      プリセットの設定
+// ===============================
+#define PRESET_DIR "/preset"          // プリセットを保存するフォルダ
+#define PRESET_EXT ".lps"             // プリセットファイルの拡張子
+#define PRESET_NAME_LEN 24            // プリセット名の最大長（英数字・'-'・'_'）
+#define PRESET_MAX_PHASES 8           // 保存できるトグルの段階数の上限
+
+/**
+ * @brief プリセットファイルのヘッダー（リトルエンディアン）
+ *
+ * ヘッダーの後に、トグルの各段階のフレーム（`width` × `height` の RGB565）を `phaseCount` 枚、
+ * 続けてスクロール用の連結画像（`stripWidth` × `stripHeight` の RGB565、無い場合は 0）を格納する。
+ */
+struct __attribute__((packed)) ScenePresetHeader {
+    char magic[4];            // "LPS2"
+    uint16_t width;           // フレームの横幅（保存時のパネル全体の大きさ）
+    uint16_t height;          // フレームの縦幅
+    uint16_t phaseCount;      // トグルの段階数（1 の場合は切り替えなし）
+    uint16_t reserved;        // 予約（0）
+    uint32_t phaseInterval;   // トグルの切り替え間隔（ミリ秒）
+    uint16_t stripWidth;      // スクロール用の連結画像の横幅（0 の場合はスクロールなし）
+    uint16_t stripHeight;     // スクロール用の連結画像の縦幅
+    int16_t scrollX;          // スクロール領域の X 座標
+    int16_t scrollY;          // スクロール領域の Y 座標
+    int16_t scrollWidth;      // スクロール領域の幅
+    int16_t scrollHeight;     // スクロール領域の高さ
+    uint32_t scrollSpeed;     // スクロールの速度（ミリピクセル/秒）
+};
+
+/**
+ * @brief プリセットの操作（Web サーバーのタスクからパネル制御タスクへ渡す）
+ */
+enum PresetCommandType {
+    PRESET_CMD_SAVE = 0, // 表示中の内容を保存
+    PRESET_CMD_RECALL    // 読み込んで表示（Mode 4）
+};
+
+struct PresetCommand {
+    PresetCommandType type = PRESET_CMD_RECALL;
+    char name[PRESET_NAME_LEN] = ""; // プリセット名
+};
+
+// ===============================
+//      ScenePreset クラスの定義
+// ===============================
+/**
+ * @brief 合成済みの表示内容（プリセット）の保存と呼び出し
+ *
+ * 保存時は表示中の内容（`PanelGeometry` の写し）にトグルの各段階の画像を重ねたフレームと、
+ * スクロール中の連結画像をそのまま書き出す。
+ * 呼び出し時はファイルを一括で読み込むだけで、CSV の検索や BMP の変換は行わない。
+ * 呼び出したプリセットは Mode 4 として `draw()` で表示する。
+ *
+ * パネル制御タスクからのみ使用する（排他制御は行わない）。
+ */
+class ScenePreset {
+public:
+    /**
+     * @brief 表示中の内容をプリセットとして保存する
+     * @param name プリセット名
+     * @return 成功時 true
+     */
+    bool save(const String &name);
+
+    /**
+     * @brief プリセットを読み込み、次の `draw()` で表示する
+     * @param name プリセット名
+     * @return 成功時 true（パネルの大きさが保存時と異なる場合は失敗）
+     */
+    bool recall(const String &name);
+
+    /**
+     * @brief プリセットを削除する
+     */
+    static bool remove(const String &name);
+
+    /**
+     * @brief 保存済みのプリセット名を JSON 配列（例: `["kaiso","shiunten"]`）で返す
+     */
+    static String listJson();
+
+    /**
+     * @brief プリセット名として使えるか（英数字・'-'・'_' のみ、PRESET_NAME_LEN 文字未満）
+     */
+    static bool isValidName(const String &name);
+
+    /**
+     * @brief 呼び出したプリセットを表示する（Mode 4、描画ループから毎回呼ぶ）
+     *
+     * 呼び出し直後はフレーム全体を 1 回だけ描画し、以降はトグルとスクロールのみ更新する。
+     */
+    void draw();
+
+    /**
+     * @brief 次の `draw()` でフレーム全体を描き直す（他のモードから戻った場合など）
+     */
+    void invalidate() { needsRedraw = true; }
+
+    bool isLoaded() const { return frames != nullptr; }
+    const String &name() const { return loadedName; }
+
+    /**
+     * @brief 読み込んだプリセットを破棄する
+     */
+    void clear();
+
+private:
+    ScenePresetHeader header = {};
+    uint16_t *frames = nullptr;  // トグルの各段階のフレーム（phaseCount 枚分）
+    BMPData strip;               // スクロール用の連結画像
+    String loadedName;
+    bool needsRedraw = false;
+    int currentPhase = 0;
+    unsigned long phaseStart = 0;
+
+    static String pathFor(const String &name);
+    void blitFrame(int phase) const;
+};
+
+extern ScenePreset scenePreset; // 全体で共有するプリセット
+
+#endif // SCENEPRESET_H
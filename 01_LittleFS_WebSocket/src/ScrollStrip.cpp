@@ -0,0 +1,256 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "ScrollStrip.h"
+#include "AssetCache.h"
+#include "PanelGeometry.h"
+#include "TraceBuffer.h"
+#include <utility> // std::swap
+
+/**
+ * @brief 画像の幅を求め、ページに分ける（画像は読み込まない）
+ *
+ * ページの幅は `STRIP_PAGE_MAX_BYTES` を超えないようにするが、`minPageWidth` に満たない間は画像を加え続ける。
+ * 最後のページが `minPageWidth` に満たない場合は、1 つ前のページにまとめる。
+ * 大きさを求められない画像・高さが異なる画像は連結しない。
+ *
+ * @param imagePaths 連結する画像のパスリスト
+ * @param minPageWidth ページの最小幅
+ * @param usable 大きさを求められた画像のパスリスト（ページはこの添字で表す）
+ * @param pages ページの一覧
+ * @param height 画像の高さ（NULL の場合は返さない）
+ * @return 全体の幅（表示できる画像が無い場合は 0）
+ */
+int ScrollStrip::paginate(const std::vector<String> &imagePaths, int minPageWidth,
+                          std::vector<String> &usable, std::vector<StripPage> &pages, int *height) {
+    usable.clear();
+    pages.clear();
+
+    // 1. 各画像の大きさを求める（画像は読み込まない）
+    std::vector<int> widths;
+    int stripHeight = 0;
+    for (const String &path : imagePaths) {
+        int w = 0, h = 0;
+        if (!measureImage(path, w, h) || w <= 0) {
+            Serial.printf("画像 %s の大きさを求められないため、連結しません。\n", path.c_str());
+            continue;
+        }
+        if (stripHeight == 0) {
+            stripHeight = h;
+        } else if (h != stripHeight) {
+            Serial.printf("画像 %s の高さが一致しないため、連結しません。\n", path.c_str());
+            continue;
+        }
+        usable.push_back(path);
+        widths.push_back(w);
+    }
+    if (height) *height = stripHeight;
+    if (usable.empty()) return 0;
+
+    // 2. メモリの上限に収まる幅ごとにページに分ける
+    int maxWidth = max(STRIP_PAGE_MAX_BYTES / (int)(stripHeight * sizeof(uint16_t)), 1);
+    StripPage page;
+    int x = 0;
+    for (size_t i = 0; i < usable.size(); i++) {
+        if (page.count > 0 && page.width + widths[i] > maxWidth && page.width >= minPageWidth) {
+            pages.push_back(page);
+            page = StripPage();
+            page.first = i;
+            page.x = x;
+        }
+        page.count++;
+        page.width += widths[i];
+        x += widths[i];
+    }
+
+    // 3. 最後のページが狭すぎる場合は 1 つ前のページにまとめる
+    if (!pages.empty() && page.width < minPageWidth) {
+        pages.back().count += page.count;
+        pages.back().width += page.width;
+    } else {
+        pages.push_back(page);
+    }
+    return x;
+}
+
+/**
+ * @brief 最初のページの先読みを予約する（時刻表の先読み用、`build()` が受け取れる形で予約する）
+ */
+void ScrollStrip::preload(const std::vector<String> &imagePaths, int minPageWidth) {
+    std::vector<String> usable;
+    std::vector<StripPage> pages;
+    if (paginate(imagePaths, minPageWidth, usable, pages) == 0) return;
+    std::vector<String> first(usable.begin() + pages[0].first, usable.begin() + pages[0].first + pages[0].count);
+    assetCache.enqueueStrip(first);
+}
+
+/**
+ * @brief 連結する画像をページに分け、最初のページを読み込む
+ *
+ * 次のページは表示を始めてから先読みする（`update()` を参照）。
+ *
+ * @param imagePaths 連結する画像のパスリスト（`cacheConcatenatedImages()` と同じ）
+ * @param minPageWidth ページの最小幅（スクロール領域の幅、表示範囲が 3 ページにまたがらないようにする）
+ * @return 表示できる画像がある場合 true
+ */
+bool ScrollStrip::build(const std::vector<String> &imagePaths, int minPageWidth) {
+    TRACE_SCOPE("ScrollStrip::build");
+
+    // 1. 以前の内容を破棄し、ページに分ける
+    clear();
+    totalWidth = paginate(imagePaths, minPageWidth, paths, pages, &stripHeight);
+    if (totalWidth == 0) return false;
+
+    // 2. 最初のページを読み込む（時刻表で先読み済みならそれを使う）
+    if (!residentPage(0, 0, pages.size() > 1 ? 1 : 0)) {
+        clear();
+        return false;
+    }
+    if (pages.size() > 1) {
+        Serial.printf("連結画像を %u ページに分けました（全体の幅 %d）。\n", (unsigned)pages.size(), totalWidth);
+    }
+    return true;
+}
+
+/**
+ * @brief スクロール表示を更新する（`updateScroll()` と同じ引数、描画ループから毎回呼ぶ）
+ *
+ * 表示範囲が次のページにかかる前に、次のページを `AssetCache` に予約しておく
+ * （描画の合間に `pump()` で読み込まれ、間に合わない場合のみここで読み込む）。
+ */
+void ScrollStrip::update(int start_x, int start_y, int area_width, int area_height, float scrollSpeed) {
+    if (pages.empty()) return;
+
+    // 1. 1 ページに収まる場合はこれまでどおり表示する
+    if (pages.size() == 1) {
+        if (slots[0].cache) {
+            updateScroll(&slots[0], start_x, start_y, area_width, area_height, scrollSpeed);
+        }
+        return;
+    }
+    activeScene.scroll = nullptr;
+    activeScene.scrollPaged = true;
+    activeScene.scrollX = start_x;
+    activeScene.scrollY = start_y;
+    activeScene.scrollWidth = area_width;
+    activeScene.scrollHeight = area_height;
+    activeScene.scrollSpeed = scrollSpeed;
+
+    // 2. 経過時間からスクロール量を計算（位置は連結画像全体で数える）
+    bool redraw = advanceScroll(offsetX, scrollAccum, scrollMicros, totalWidth, scrollSpeed);
+    int current = pageAt(offsetX);
+    int next = (current + 1) % (int)pages.size();
+
+    if (redraw) {
+        TRACE_SCOPE("scrollTick");
+
+        // 3. 表示範囲をページごとの区間に分けて描画（ページの末尾で次のページに移る）
+        int drawn = 0;
+        int x = offsetX;
+        int page = current;
+        while (drawn < area_width) {
+            const StripPage &p = pages[page];
+            int localX = x - p.x;
+            int run = min(area_width - drawn, p.width - localX);
+            const BMPData *data = residentPage(page, current, next);
+            if (data && data->cache && localX < data->width) {
+                int span = min(run, data->width - localX);
+                for (int y = 0; y < area_height; y++) {
+                    const uint16_t *row = data->cache + (y % data->height) * data->width;
+                    panelGeometry.blitSpan(matrix, start_x + drawn, start_y + y, row + localX, span);
+                }
+            }
+            drawn += run;
+            x += run;
+            if (x >= totalWidth) x = 0;
+            page = (page + 1) % (int)pages.size();
+        }
+    }
+
+    // 4. 次のページを先読み（表示中のページをスクロールしている間に読み込む）
+    bool nextResident = slotPage[0] == next || slotPage[1] == next;
+    if (!nextResident && prefetched != next) {
+        std::vector<String> nextPaths;
+        pagePaths(next, nextPaths);
+        assetCache.enqueueStrip(nextPaths);
+        prefetched = next;
+    }
+}
+
+/**
+ * @brief 読み込んだページをすべて破棄する
+ */
+void ScrollStrip::clear() {
+    for (int i = 0; i < 2; i++) {
+        free(slots[i].cache);
+        slots[i] = BMPData();
+        slotPage[i] = -1;
+    }
+    paths.clear();
+    pages.clear();
+    totalWidth = 0;
+    stripHeight = 0;
+    prefetched = -1;
+    offsetX = 0;
+    scrollAccum = 0;
+    scrollMicros = 0;
+}
+
+/**
+ * @brief 内容（読み込んだページ・スクロール位置を含む）を入れ替える（作成済みのスクロールを差し替える場合）
+ */
+void ScrollStrip::swap(ScrollStrip &other) {
+    std::swap(paths, other.paths);
+    std::swap(pages, other.pages);
+    std::swap(totalWidth, other.totalWidth);
+    std::swap(stripHeight, other.stripHeight);
+    std::swap(slots, other.slots);
+    std::swap(slotPage, other.slotPage);
+    std::swap(prefetched, other.prefetched);
+    std::swap(offsetX, other.offsetX);
+    std::swap(scrollAccum, other.scrollAccum);
+    std::swap(scrollMicros, other.scrollMicros);
+    std::swap(generation, other.generation);
+}
+
+// 全体での位置 x を含むページ（二分探索）
+int ScrollStrip::pageAt(int x) const {
+    int lo = 0, hi = (int)pages.size() - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (pages[mid].x <= x) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+// ページをスロットに読み込む（表示中・次のページ以外を入れ替える、先読み済みならそれを使う）
+const BMPData *ScrollStrip::residentPage(int page, int current, int next) {
+    for (int i = 0; i < 2; i++) {
+        if (slotPage[i] == page) return slots[i].cache ? &slots[i] : nullptr;
+    }
+    int victim = (slotPage[0] != current && slotPage[0] != next) ? 0 : 1;
+
+    std::vector<String> pageList;
+    pagePaths(page, pageList);
+    cacheConcatenatedImages(pageList, &slots[victim]);
+    slotPage[victim] = page; // 読み込めなかった場合も、毎回読み込み直さないよう記録する
+    if (prefetched == page) prefetched = -1;
+    return slots[victim].cache ? &slots[victim] : nullptr;
+}
+
+// ページの画像のパスリスト
+void ScrollStrip::pagePaths(int page, std::vector<String> &out) const {
+    const StripPage &p = pages[page];
+    out.assign(paths.begin() + p.first, paths.begin() + p.first + p.count);
+}
@@ -0,0 +1,118 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef SCROLLSTRIP_H
+#define SCROLLSTRIP_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>    // Arduino 環境の基本ライブラリ
+#include "drawBitmap.h" // BMPData / cacheConcatenatedImages / advanceScroll
+#include <vector>       // 画像・ページの一覧
+
+// ===============================
+//      連結画像のページの設定
+// ===============================
+#define STRIP_PAGE_MAX_BYTES (16 * 1024) // 連結画像 1 ページのメモリの上限（読み込み時間もこれに比例する）
+
+/**
+ * @brief 連結画像の 1 ページ（`paths` の `first` から `count` 枚）
+ */
+struct StripPage {
+    size_t first = 0; // 最初の画像（`paths` の添字）
+    size_t count = 0; // 画像の枚数
+    int x = 0;        // 連結画像全体での左端の位置
+    int width = 0;    // ページの幅
+};
+
+// ===============================
+//      ScrollStrip クラスの定義
+// ===============================
+/**
+ * @brief 停車駅などの長いスクロールを、メモリの上限に収まるページに分けて表示する
+ *
+ * 作成時は画像を読み込まずに各画像の幅を求め（マニフェスト・ヘッダー・フォントの文字幅）、
+ * `STRIP_PAGE_MAX_BYTES` を超えない範囲でページに分ける。
+ * メモリに置くのは表示中のページと次のページの 2 つだけで、次のページは表示中のページを
+ * スクロールしている間に `AssetCache` で先読みしておく。
+ * 全体が 1 ページに収まる場合は、これまでどおり 1 枚の連結画像として `updateScroll()` で表示する。
+ *
+ * パネル制御タスクからのみ使用する（排他制御は行わない）。
+ */
+class ScrollStrip {
+public:
+    /**
+     * @brief 連結する画像をページに分け、最初のページを読み込む
+     * @param imagePaths 連結する画像のパスリスト（`cacheConcatenatedImages()` と同じ）
+     * @param minPageWidth ページの最小幅（スクロール領域の幅、表示範囲が 3 ページにまたがらないようにする）
+     * @return 表示できる画像がある場合 true
+     */
+    bool build(const std::vector<String> &imagePaths, int minPageWidth);
+
+    /**
+     * @brief スクロール表示を更新する（`updateScroll()` と同じ引数、描画ループから毎回呼ぶ）
+     */
+    void update(int start_x, int start_y, int area_width, int area_height, float scrollSpeed);
+
+    /**
+     * @brief 読み込んだページをすべて破棄する
+     */
+    void clear();
+
+    /**
+     * @brief 内容（読み込んだページ・スクロール位置を含む）を入れ替える（作成済みのスクロールを差し替える場合）
+     */
+    void swap(ScrollStrip &other);
+
+    /**
+     * @brief 最初のページの先読みを予約する（時刻表の先読み用、`build()` が受け取れる形で予約する）
+     */
+    static void preload(const std::vector<String> &imagePaths, int minPageWidth);
+
+    /**
+     * @brief 画像の幅を求め、ページに分ける（画像は読み込まない）
+     * @param imagePaths 連結する画像のパスリスト
+     * @param minPageWidth ページの最小幅
+     * @param usable 大きさを求められた画像のパスリスト（ページはこの添字で表す）
+     * @param pages ページの一覧
+     * @param height 画像の高さ（NULL の場合は返さない）
+     * @return 全体の幅（表示できる画像が無い場合は 0）
+     */
+    static int paginate(const std::vector<String> &imagePaths, int minPageWidth,
+                        std::vector<String> &usable, std::vector<StripPage> &pages, int *height = nullptr);
+
+    bool empty() const { return pages.empty(); }
+    int width() const { return totalWidth; }
+    size_t pageCount() const { return pages.size(); }
+
+    uint32_t generation = 0; // 作成元の CSV の行の世代（呼び出し側で設定し、変われば作り直す）
+
+private:
+    std::vector<String> paths;      // 連結する画像（大きさを求められたもののみ）
+    std::vector<StripPage> pages;
+    int totalWidth = 0;
+    int stripHeight = 0;
+    BMPData slots[2];               // 読み込んだページ（表示中と次のページ）
+    int slotPage[2] = { -1, -1 };   // 各スロットのページ番号（-1: 空き）
+    int prefetched = -1;            // 先読みを予約したページ
+    int offsetX = 0;                // 全体でのスクロール位置
+    uint64_t scrollAccum = 0;       // 1 ピクセル未満のスクロール量
+    unsigned long scrollMicros = 0; // 最後にスクロール量を計算した時刻（0: 未開始）
+
+    int pageAt(int x) const;
+    const BMPData *residentPage(int page, int current, int next);
+    void pagePaths(int page, std::vector<String> &out) const;
+};
+
+#endif // SCROLLSTRIP_H
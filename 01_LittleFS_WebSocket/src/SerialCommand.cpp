@@ -0,0 +1,289 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "SerialCommand.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+SerialCommand serialCommand;
+
+// ===============================
+//      SerialFrameParser
+// ===============================
+/**
+ * @brief 1 バイト受け取る
+ *
+ * 先頭の 2 バイト → 種類・番号・長さ → 内容 → CRC の順に読み、CRC が合った場合のみフレームを返す。
+ * 合わない場合（ログの文字列の途中に先頭と同じバイトがあった場合など）は捨てて次の先頭を探す。
+ *
+ * @param byte 受信したバイト
+ * @param frame 取り出したフレームの格納先
+ * @return フレームがそろった場合 true
+ */
+bool SerialFrameParser::feed(uint8_t byte, SerialFrame &frame) {
+    switch (state) {
+        case WAIT_SYNC0:
+            if (byte == SERIAL_COMMAND_SYNC0) state = WAIT_SYNC1;
+            return false;
+        case WAIT_SYNC1:
+            // 0xA5 が続いた場合は、後の 0xA5 を先頭とみなす
+            state = (byte == SERIAL_COMMAND_SYNC1) ? READ_TYPE : (byte == SERIAL_COMMAND_SYNC0) ? WAIT_SYNC1 : WAIT_SYNC0;
+            return false;
+        case READ_TYPE:
+            pending.type = byte;
+            crc = SerialCommand::crc16(&byte, 1);
+            state = READ_SEQ;
+            return false;
+        case READ_SEQ:
+            pending.seq = byte;
+            crc = SerialCommand::crc16(&byte, 1, crc);
+            state = READ_LENGTH;
+            return false;
+        case READ_LENGTH:
+            if (byte > SERIAL_COMMAND_MAX_PAYLOAD) {
+                tooLong++;
+                state = WAIT_SYNC0;
+                return false;
+            }
+            pending.length = byte;
+            crc = SerialCommand::crc16(&byte, 1, crc);
+            received = 0;
+            state = (byte == 0) ? READ_CRC0 : READ_PAYLOAD;
+            return false;
+        case READ_PAYLOAD:
+            pending.payload[received++] = byte;
+            crc = SerialCommand::crc16(&byte, 1, crc);
+            if (received == pending.length) state = READ_CRC0;
+            return false;
+        case READ_CRC0:
+            frameCrc = byte;
+            state = READ_CRC1;
+            return false;
+        case READ_CRC1:
+            frameCrc |= (uint16_t)byte << 8;
+            state = WAIT_SYNC0;
+            if (frameCrc != crc) {
+                crcMismatches++;
+                return false;
+            }
+            frame = pending;
+            return true;
+    }
+    return false;
+}
+
+// ===============================
+//      SerialCommand
+// ===============================
+/**
+ * @brief 受信タスクを開始する（`setup()` で 1 回だけ呼ぶ）
+ * @param port 送受信するポート（`Serial` など）
+ * @param handler 要求を処理する関数
+ * @param context `handler` に渡す値
+ * @return 受信タスクを開始できた場合 true（false の場合も `poll()` は使える）
+ */
+bool SerialCommand::begin(Stream &port, SerialRequestHandler handler, void *context) {
+    this->port = &port;
+    this->handler = handler;
+    handlerContext = context;
+    if (task) return true;
+
+    // コア 0 に受信タスクを作成（Web サーバーのタスクより優先度を高くする）
+    if (xTaskCreatePinnedToCore(receiveTask, "Serial_Task", SERIAL_COMMAND_STACK_SIZE, this,
+                                SERIAL_COMMAND_PRIORITY, &task, SERIAL_COMMAND_CORE) != pdPASS) {
+        task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 受信済みのバイトを読み、そろったフレームに応答する
+ * @return 1 つ以上のフレームを処理した場合 true
+ */
+bool SerialCommand::poll() {
+    if (port == nullptr) return false;
+    bool handled = false;
+    while (port->available() > 0) {
+        int byte = port->read();
+        if (byte < 0) break;
+        if (parser.feed((uint8_t)byte, request)) {
+            dispatch();
+            handled = true;
+        }
+    }
+    return handled;
+}
+
+/**
+ * @brief 表示を更新したことを記録する（パネル制御タスクが、フレームを表示した後に呼ぶ）
+ *
+ * `sequence` が最新の `SERIAL_SET_STATE` の番号であれば、受信から表示までの時間を記録する
+ * （表示している間に次のコマンドが届いた場合は、そのコマンドの分は次のフレームで記録する）。
+ *
+ * @param sequence 表示内容の変数を読む前の `requestedSequence()`
+ * @param nowMicros 表示した時刻（マイクロ秒）
+ */
+void SerialCommand::presented(uint32_t sequence, unsigned long nowMicros) {
+    if (shown.load() == sequence) return;
+    shown.store(sequence);
+    if (sequence != requested.load()) return;
+
+    uint32_t latency = (uint32_t)nowMicros - receivedAt.load();
+    lastLatency.store(latency, std::memory_order_relaxed);
+    if (latency > worstLatency.load(std::memory_order_relaxed)) {
+        worstLatency.store(latency, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE（多項式 0x1021、初期値 0xFFFF）
+ * @param data 計算するデータ
+ * @param length バイト数
+ * @param crc 途中までの値（続きを計算する場合）
+ */
+uint16_t SerialCommand::crc16(const uint8_t *data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief フレームを送信する形式に変換する
+ * @param frame 変換するフレーム
+ * @param out 格納先（7 + `frame.length` バイト）
+ * @return 書き込んだバイト数
+ */
+size_t SerialCommand::encode(const SerialFrame &frame, uint8_t *out) {
+    size_t n = 0;
+    out[n++] = SERIAL_COMMAND_SYNC0;
+    out[n++] = SERIAL_COMMAND_SYNC1;
+    out[n++] = frame.type;
+    out[n++] = frame.seq;
+    out[n++] = frame.length;
+    memcpy(out + n, frame.payload, frame.length);
+    n += frame.length;
+    uint16_t crc = crc16(out + 2, 3 + frame.length);
+    out[n++] = crc & 0xFF;
+    out[n++] = crc >> 8;
+    return n;
+}
+
+/**
+ * @brief `SERIAL_SET_STATE` の内容を取り出して確認する
+ *
+ * プリセットの Mode 4 は名前が必要なため受け付けない（/preset で呼び出す）。
+ *
+ * @param request 届いた要求
+ * @param state 取り出した内容
+ * @return 結果（`SerialStatus`、OK の場合のみ `applySetState()` に渡せる）
+ */
+uint8_t SerialCommand::decodeSetState(const SerialFrame &request, SerialSetState &state) {
+    if (request.length != sizeof(state)) return SERIAL_STATUS_BAD_LENGTH;
+    memcpy(&state, request.payload, sizeof(state));
+    if ((state.fields & SERIAL_FIELD_MODE) && state.mode > 3) return SERIAL_STATUS_BAD_VALUE;
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief 指定された項目の変数を書き換える
+ *
+ * モードは最後に書き換え、パネル制御タスクが途中の組み合わせで切り替えないようにする。
+ *
+ * @param state `decodeSetState()` で確認した内容
+ * @param targets 書き換える変数
+ */
+void SerialCommand::applySetState(const SerialSetState &state, const SerialDisplayTargets &targets) {
+    if (state.fields & SERIAL_FIELD_FULL) *targets.full = state.full;
+    if (state.fields & SERIAL_FIELD_TYPE) *targets.type = state.type;
+    if (state.fields & SERIAL_FIELD_DEST) *targets.dest = state.dest;
+    if (state.fields & SERIAL_FIELD_DEP) *targets.dep = state.dep;
+    if (state.fields & SERIAL_FIELD_NEXT) *targets.next = state.next;
+    if (state.fields & SERIAL_FIELD_MODE) *targets.mode = state.mode;
+}
+
+/**
+ * @brief `SERIAL_QUERY_STATE` の応答（`SERIAL_STATE`）を作る
+ * @param request 届いた要求
+ * @param reply 応答
+ * @param targets 読み出す変数
+ * @param flags `SerialState::flags`
+ * @param latencyUs `SerialState::latencyUs`
+ * @return 結果（`SerialStatus`）
+ */
+uint8_t SerialCommand::encodeState(const SerialFrame &request, SerialFrame &reply, const SerialDisplayTargets &targets,
+                                   uint8_t flags, uint32_t latencyUs) {
+    if (request.length != 0) return SERIAL_STATUS_BAD_LENGTH;
+    SerialState state;
+    state.mode = *targets.mode;
+    state.full = *targets.full;
+    state.type = *targets.type;
+    state.dest = *targets.dest;
+    state.dep = *targets.dep;
+    state.next = *targets.next;
+    state.flags = flags;
+    state.latencyUs = latencyUs;
+    reply.type = SERIAL_STATE;
+    reply.length = sizeof(state);
+    memcpy(reply.payload, &state, sizeof(state));
+    return SERIAL_STATUS_OK;
+}
+
+/**
+ * @brief 届いた要求を処理して応答する
+ *
+ * 1. 応答（パネルからのフレーム）が届いた場合は知らない種類として扱う（折り返し接続の誤検出を防ぐ）
+ * 2. `SerialRequestHandler` で処理し、`SERIAL_SET_STATE` を受け付けた場合は番号を進める
+ * 3. 応答を 1 回の書き込みで送る（ログの出力と 1 フレームの途中で混ざらないようにする）
+ */
+void SerialCommand::dispatch() {
+    uint32_t now = micros();
+    frames.fetch_add(1, std::memory_order_relaxed);
+
+    // 1. 応答が届いた場合は処理しない
+    SerialFrame reply;
+    uint8_t status = SERIAL_STATUS_BAD_TYPE;
+    if ((request.type & 0x80) == 0 && handler != nullptr) {
+        // 2. 要求を処理（表示内容の変数を書き換えてから番号を進める）
+        status = handler(request, reply, handlerContext);
+        if (status == SERIAL_STATUS_OK && request.type == SERIAL_SET_STATE) {
+            receivedAt.store(now);
+            requested.fetch_add(1);
+        }
+    }
+
+    // 3. 応答を送る（結果のみの場合は SERIAL_ACK）
+    if (status != SERIAL_STATUS_OK || reply.type == 0) {
+        SerialAck ack = { request.type, status };
+        reply.type = SERIAL_ACK;
+        reply.length = sizeof(ack);
+        memcpy(reply.payload, &ack, sizeof(ack));
+    }
+    reply.seq = request.seq;
+    uint8_t buffer[SERIAL_COMMAND_MAX_PAYLOAD + 7];
+    port->write(buffer, encode(reply, buffer));
+}
+
+// 受信タスク（`SERIAL_COMMAND_POLL_MS` おきに受信したバイトを処理する）
+void SerialCommand::receiveTask(void *pvParameters) {
+    SerialCommand *self = static_cast<SerialCommand *>(pvParameters);
+    while (true) {
+        self->poll();
+        vTaskDelay(SERIAL_COMMAND_POLL_MS / portTICK_PERIOD_MS);
+    }
+}
@@ -0,0 +1,290 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef SERIALCOMMAND_H
+#define SERIALCOMMAND_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h> // Arduino 環境の基本ライブラリ（Stream / FreeRTOS を含む）
+#include <atomic>    // 受け付けた・表示した番号と集計値（タスク間で共有）
+
+// ===============================
+//      シリアルコマンドの設定
+// ===============================
+#define SERIAL_COMMAND_SYNC0 0xA5          // フレームの先頭 1 バイト目
+#define SERIAL_COMMAND_SYNC1 0x5A          // フレームの先頭 2 バイト目
+#define SERIAL_COMMAND_MAX_PAYLOAD 32      // 1 フレームの内容の最大バイト数
+#define SERIAL_COMMAND_POLL_MS 1           // 受信を確認する間隔（ミリ秒）
+#define SERIAL_COMMAND_CORE 0              // 受信タスクを動かすコア（パネル制御タスクと反対側）
+#define SERIAL_COMMAND_STACK_SIZE 4096     // 受信タスクのスタックサイズ（バイト）
+#define SERIAL_COMMAND_PRIORITY 2          // 受信タスクの優先度（Web サーバーのタスクより高くし、HTTP の処理中も待たせない）
+
+/**
+ * @brief フレームの種類（上位ビットが 1 のものはパネルからの応答）
+ */
+enum SerialFrameType : uint8_t {
+    SERIAL_SET_STATE = 0x01,   // 表示内容の変更（内容は `SerialSetState`、応答は `SERIAL_ACK`）
+    SERIAL_QUERY_STATE = 0x02, // 表示内容の問い合わせ（内容なし、応答は `SERIAL_STATE`）
+    SERIAL_ACK = 0x81,         // 受け付けた結果（内容は `SerialAck`）
+    SERIAL_STATE = 0x82,       // 表示内容（内容は `SerialState`）
+};
+
+/**
+ * @brief `SERIAL_ACK` で返す結果
+ */
+enum SerialStatus : uint8_t {
+    SERIAL_STATUS_OK = 0,         // 受け付けた
+    SERIAL_STATUS_BAD_LENGTH = 1, // 内容のバイト数が種類と合わない
+    SERIAL_STATUS_BAD_TYPE = 2,   // 知らない種類
+    SERIAL_STATUS_BAD_VALUE = 3,  // 値が範囲外（Mode 4 の指定など）
+};
+
+/**
+ * @brief `SerialSetState::fields` のビット（1 の項目だけを変更する、`/send` で指定した引数と同じ）
+ */
+enum SerialStateField : uint8_t {
+    SERIAL_FIELD_MODE = 1 << 0,
+    SERIAL_FIELD_FULL = 1 << 1,
+    SERIAL_FIELD_TYPE = 1 << 2,
+    SERIAL_FIELD_DEST = 1 << 3,
+    SERIAL_FIELD_DEP = 1 << 4,
+    SERIAL_FIELD_NEXT = 1 << 5,
+};
+
+/**
+ * @brief `SERIAL_SET_STATE` の内容（リトルエンディアン、12 バイト）
+ */
+struct __attribute__((packed)) SerialSetState {
+    uint8_t fields;  // 変更する項目（`SerialStateField` の組み合わせ）
+    uint8_t mode;    // 表示モード（0～3）
+    uint16_t full;   // 全画面表示の ID
+    uint16_t type;   // 種別の ID
+    uint16_t dest;   // 行先の ID
+    uint16_t dep;    // 始発駅の ID
+    uint16_t next;   // 次駅の ID
+};
+
+/**
+ * @brief `SERIAL_STATE` の内容（リトルエンディアン、16 バイト）
+ */
+struct __attribute__((packed)) SerialState {
+    uint8_t mode;       // 表示モード（`/status` と同じく、指定された値）
+    uint16_t full;
+    uint16_t type;
+    uint16_t dest;
+    uint16_t dep;
+    uint16_t next;
+    uint8_t flags;      // ビット 0: 直前の `SERIAL_SET_STATE` を表示に反映済み / ビット 1: 時刻表を再生中
+    uint32_t latencyUs; // 直前に反映した `SERIAL_SET_STATE` の受信から表示までの時間（マイクロ秒）
+};
+
+/**
+ * @brief 表示内容の変数（`SERIAL_SET_STATE` の書き換え先、`SERIAL_QUERY_STATE` の読み出し元）
+ *
+ * 実機では main.cpp の `mode` / `num_*`、PC 上の代役では代役の変数を指す。
+ */
+struct SerialDisplayTargets {
+    unsigned short *mode;
+    unsigned short *full;
+    unsigned short *type;
+    unsigned short *dest;
+    unsigned short *dep;
+    unsigned short *next;
+};
+
+/**
+ * @brief `SERIAL_ACK` の内容（2 バイト）
+ */
+struct __attribute__((packed)) SerialAck {
+    uint8_t type;   // 受け付けたフレームの種類
+    uint8_t status; // 結果（`SerialStatus`）
+};
+
+/**
+ * @brief 1 フレーム分の内容
+ *
+ * 送受信するフレームの形式（合計 7 + `length` バイト）:
+ * - `0xA5 0x5A`: 先頭（ログの文字列と混ざっても見つけられるよう 2 バイト）
+ * - `type`、`seq`、`length`: 種類、要求の番号（応答は要求と同じ番号）、内容のバイト数
+ * - 内容（`length` バイト）
+ * - `type` から内容の末尾までの CRC-16/CCITT-FALSE（リトルエンディアン）
+ */
+struct SerialFrame {
+    uint8_t type = 0;
+    uint8_t seq = 0;
+    uint8_t length = 0;
+    uint8_t payload[SERIAL_COMMAND_MAX_PAYLOAD];
+};
+
+/**
+ * @brief 要求を処理する関数
+ * @param request 届いた要求
+ * @param reply 応答（`SERIAL_ACK` 以外を返す場合に `type` / `length` / `payload` を設定）
+ * @param context `SerialCommand::begin()` に渡した値
+ * @return 結果（OK 以外、または `reply` を設定しない場合は `SERIAL_ACK` で返す）
+ */
+typedef uint8_t (*SerialRequestHandler)(const SerialFrame &request, SerialFrame &reply, void *context);
+
+// ===============================
+//      SerialFrameParser クラスの定義
+// ===============================
+/**
+ * @brief 受信したバイト列からフレームを取り出す
+ *
+ * 先頭の 2 バイトを探してから読み進め、CRC が合わない・長すぎるフレームは捨てて次の先頭を探す。
+ * 同じ UART に出力するログの文字列は、先頭の 2 バイトと CRC で読み飛ばす。
+ */
+class SerialFrameParser {
+public:
+    /**
+     * @brief 1 バイト受け取る
+     * @param byte 受信したバイト
+     * @param frame 取り出したフレームの格納先
+     * @return フレームがそろった場合 true
+     */
+    bool feed(uint8_t byte, SerialFrame &frame);
+
+    uint32_t crcErrors() const { return crcMismatches; }      // CRC が合わずに捨てたフレームの数
+    uint32_t oversizeFrames() const { return tooLong; }       // 内容のバイト数が上限を超えていたため捨てたフレームの数
+
+private:
+    enum State { WAIT_SYNC0, WAIT_SYNC1, READ_TYPE, READ_SEQ, READ_LENGTH, READ_PAYLOAD, READ_CRC0, READ_CRC1 };
+    State state = WAIT_SYNC0;
+    SerialFrame pending;   // 受信中のフレーム
+    uint8_t received = 0;  // 受信した内容のバイト数
+    uint16_t crc = 0;      // 受信中のフレームの CRC（計算値）
+    uint16_t frameCrc = 0; // 受信中のフレームの CRC（受信値）
+    uint32_t crcMismatches = 0;
+    uint32_t tooLong = 0;
+};
+
+// ===============================
+//      SerialCommand クラスの定義
+// ===============================
+/**
+ * @brief UART から届くバイナリのコマンド（表示内容の変更・問い合わせ）を処理する
+ *
+ * コア 0 の受信タスクが `SERIAL_COMMAND_POLL_MS` おきに受信したバイトを読み、
+ * そろったフレームを `SerialRequestHandler` に渡して、同じ番号の応答（`SERIAL_ACK` / `SERIAL_STATE`）を返す。
+ *
+ * 表示までの時間を測るため、`SERIAL_SET_STATE` を受け付けるたびに番号（`requestedSequence()`）を進める。
+ * パネル制御タスクは表示を更新したフレームで `presented()` を呼び、受信から表示までの時間を記録する。
+ *
+ * PC 上の代役（`standin/serialStandIn.cpp`）は受信タスクを使わず、`poll()` を直接呼ぶ。
+ */
+class SerialCommand {
+public:
+    /**
+     * @brief 受信タスクを開始する（`setup()` で 1 回だけ呼ぶ）
+     * @param port 送受信するポート（`Serial` など）
+     * @param handler 要求を処理する関数
+     * @param context `handler` に渡す値
+     * @return 受信タスクを開始できた場合 true（false の場合も `poll()` は使える）
+     */
+    bool begin(Stream &port, SerialRequestHandler handler, void *context = nullptr);
+
+    /**
+     * @brief 受信済みのバイトを読み、そろったフレームに応答する
+     * @return 1 つ以上のフレームを処理した場合 true
+     */
+    bool poll();
+
+    /**
+     * @brief 受け付けた `SERIAL_SET_STATE` の番号（表示内容の変数を書き換えた後に進む）
+     */
+    uint32_t requestedSequence() const { return requested.load(); }
+
+    /**
+     * @brief 表示を更新したことを記録する（パネル制御タスクが、フレームを表示した後に呼ぶ）
+     * @param sequence 表示内容の変数を読む前の `requestedSequence()`
+     * @param nowMicros 表示した時刻（マイクロ秒）
+     */
+    void presented(uint32_t sequence, unsigned long nowMicros);
+
+    /**
+     * @brief 受け付けた `SERIAL_SET_STATE` がまだ表示に反映されていないか
+     */
+    bool pending() const { return shown.load() != requested.load(); }
+
+    uint32_t frameCount() const { return frames.load(std::memory_order_relaxed); }
+    uint32_t crcErrors() const { return parser.crcErrors(); }
+    uint32_t oversizeFrames() const { return parser.oversizeFrames(); }
+    uint32_t lastLatencyUs() const { return lastLatency.load(std::memory_order_relaxed); }
+    uint32_t worstLatencyUs() const { return worstLatency.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief CRC-16/CCITT-FALSE（多項式 0x1021、初期値 0xFFFF）
+     * @param data 計算するデータ
+     * @param length バイト数
+     * @param crc 途中までの値（続きを計算する場合）
+     */
+    static uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+    /**
+     * @brief フレームを送信する形式に変換する
+     * @param frame 変換するフレーム
+     * @param out 格納先（7 + `frame.length` バイト）
+     * @return 書き込んだバイト数
+     */
+    static size_t encode(const SerialFrame &frame, uint8_t *out);
+
+    /**
+     * @brief `SERIAL_SET_STATE` の内容を取り出して確認する
+     * @param request 届いた要求
+     * @param state 取り出した内容
+     * @return 結果（`SerialStatus`、OK の場合のみ `applySetState()` に渡せる）
+     */
+    static uint8_t decodeSetState(const SerialFrame &request, SerialSetState &state);
+
+    /**
+     * @brief 指定された項目の変数を書き換える（モードは最後に書き換える）
+     * @param state `decodeSetState()` で確認した内容
+     * @param targets 書き換える変数
+     */
+    static void applySetState(const SerialSetState &state, const SerialDisplayTargets &targets);
+
+    /**
+     * @brief `SERIAL_QUERY_STATE` の応答（`SERIAL_STATE`）を作る
+     * @param request 届いた要求
+     * @param reply 応答
+     * @param targets 読み出す変数
+     * @param flags `SerialState::flags`
+     * @param latencyUs `SerialState::latencyUs`
+     * @return 結果（`SerialStatus`）
+     */
+    static uint8_t encodeState(const SerialFrame &request, SerialFrame &reply, const SerialDisplayTargets &targets,
+                               uint8_t flags, uint32_t latencyUs);
+
+private:
+    Stream *port = nullptr;
+    SerialRequestHandler handler = nullptr;
+    void *handlerContext = nullptr;
+    SerialFrameParser parser;
+    SerialFrame request;                       // 受信中・処理中の要求（受信タスクのみ使用）
+    TaskHandle_t task = nullptr;
+    std::atomic<uint32_t> requested{0};        // 受け付けた `SERIAL_SET_STATE` の番号
+    std::atomic<uint32_t> shown{0};            // 表示に反映した番号
+    std::atomic<uint32_t> receivedAt{0};       // 最後に受け付けた `SERIAL_SET_STATE` を受信した時刻（マイクロ秒）
+    std::atomic<uint32_t> lastLatency{0};
+    std::atomic<uint32_t> worstLatency{0};
+    std::atomic<uint32_t> frames{0};
+
+    void dispatch();
+    static void receiveTask(void *pvParameters);
+};
+
+extern SerialCommand serialCommand; // 全体で共有するシリアルコマンド
+
+#endif // SERIALCOMMAND_H
@@ -0,0 +1,249 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "Timetable.h"
+
+/**
+ * @brief 時刻表を読み込む（再生は `start()` で開始）
+ *
+ * 形式: 1 行目は見出し（`mode,full,type,dest,dep,next,hold,trigger`、列の順序は任意）。
+ * `hold` は秒単位。省略した列は 0（trigger は空）。
+ *
+ * @param path 時刻表ファイルのパス
+ * @return 1 行以上読み込めた場合 true
+ */
+bool Timetable::load(const char *path) {
+    // 1. ファイルを開く
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        Serial.printf("時刻表 %s を開けませんでした。\n", path);
+        return false;
+    }
+
+    // 2. 見出し行から各列の位置を調べる
+    const char *names[] = { "mode", "full", "type", "dest", "dep", "next", "hold", "trigger" };
+    const int columnCount = sizeof(names) / sizeof(names[0]);
+    int columns[columnCount];
+    for (int i = 0; i < columnCount; i++) columns[i] = -1;
+
+    String header = file.readStringUntil('\n');
+    header.trim();
+    int column = 0, start = 0;
+    while (start <= (int)header.length()) {
+        int comma = header.indexOf(',', start);
+        String name = (comma == -1) ? header.substring(start) : header.substring(start, comma);
+        name.trim();
+        for (int i = 0; i < columnCount; i++) {
+            if (name == names[i]) columns[i] = column;
+        }
+        column++;
+        if (comma == -1) break;
+        start = comma + 1;
+    }
+    if (columns[0] == -1) {
+        Serial.printf("時刻表 %s に mode 列がありません。\n", path);
+        file.close();
+        return false;
+    }
+
+    // 3. 1 行ずつ読み取る
+    std::vector<TimetableStep> loaded;
+    while (file.available()) {
+        String line = file.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0 || line.startsWith("#")) continue;
+
+        // 3.1 列に分割
+        std::vector<String> fields;
+        start = 0;
+        while (true) {
+            int comma = line.indexOf(',', start);
+            fields.push_back(comma == -1 ? line.substring(start) : line.substring(start, comma));
+            if (comma == -1) break;
+            start = comma + 1;
+        }
+        auto field = [&](int i) -> String {
+            return (columns[i] >= 0 && columns[i] < (int)fields.size()) ? fields[columns[i]] : String();
+        };
+
+        // 3.2 値を格納
+        TimetableStep step;
+        step.mode = field(0).toInt();
+        step.full = field(1).toInt();
+        step.type = field(2).toInt();
+        step.dest = field(3).toInt();
+        step.dep = field(4).toInt();
+        step.next = field(5).toInt();
+        step.holdMs = (unsigned long)field(6).toInt() * 1000UL;
+        String trigger = field(7);
+        trigger.trim();
+        strncpy(step.trigger, trigger.c_str(), TIMETABLE_TRIGGER_LEN - 1);
+        step.trigger[TIMETABLE_TRIGGER_LEN - 1] = '\0';
+
+        if (step.mode > 3) {
+            Serial.printf("時刻表の行が不正です: %s\n", line.c_str());
+            continue;
+        }
+        loaded.push_back(step);
+    }
+    file.close();
+
+    if (loaded.empty()) {
+        Serial.printf("時刻表 %s に有効な行がありません。\n", path);
+        return false;
+    }
+
+    // 4. 読み込んだ内容に差し替える（再生は停止状態）
+    steps.swap(loaded);
+    loadedPath = path;
+    state = STOPPED;
+    currentIndex = 0;
+    Serial.printf("時刻表 %s を読み込みました（%u 行）。\n", path, (unsigned)steps.size());
+    return true;
+}
+
+/**
+ * @brief 指定した行から再生を開始する
+ */
+void Timetable::start(unsigned long now, size_t index) {
+    if (steps.empty()) return;
+    state = PLAYING;
+    moveTo(index < steps.size() ? index : 0, now);
+}
+
+/**
+ * @brief 時間経過を確認し、必要なら次の行へ進める
+ * @return 行が変わった場合 true（呼び出し側で表示を切り替える）
+ */
+bool Timetable::update(unsigned long now) {
+    if (state != PLAYING) return false;
+
+    const TimetableStep &step = steps[currentIndex];
+    if (step.holdMs == 0 || now - stepStart < step.holdMs) {
+        return false; // イベント待ち、または表示時間内
+    }
+
+    // 最後の行は表示したまま終了
+    if (currentIndex + 1 >= steps.size()) {
+        state = FINISHED;
+        return false;
+    }
+    return moveTo(currentIndex + 1, now);
+}
+
+/**
+ * @brief 操作を反映する
+ * @return 行が変わった場合 true
+ */
+bool Timetable::apply(const TimetableCommand &command, unsigned long now) {
+    switch (command.type) {
+    case TIMETABLE_CMD_LOAD:
+        if (!load(command.text)) return false;
+        start(now, command.value >= 0 ? command.value : 0);
+        return true;
+
+    case TIMETABLE_CMD_PLAY:
+        if (state == PAUSED) {
+            stepStart += now - pausedAt; // 一時停止していた時間は表示時間に含めない
+            state = PLAYING;
+            return false;
+        }
+        if (state == STOPPED || state == FINISHED) {
+            start(now, state == FINISHED ? 0 : currentIndex);
+            return !steps.empty();
+        }
+        return false;
+
+    case TIMETABLE_CMD_PAUSE:
+        if (state == PLAYING) {
+            pausedAt = now;
+            state = PAUSED;
+        }
+        return false;
+
+    case TIMETABLE_CMD_STOP:
+        state = STOPPED;
+        return false;
+
+    case TIMETABLE_CMD_SKIP:
+        if (steps.empty()) return false;
+        if (state == STOPPED || state == FINISHED) state = PLAYING;
+        return moveTo((long)currentIndex + command.value, now);
+
+    case TIMETABLE_CMD_SEEK:
+        if (steps.empty()) return false;
+        if (state == STOPPED || state == FINISHED) state = PLAYING;
+        return moveTo(command.value, now);
+
+    case TIMETABLE_CMD_EVENT:
+        // 現在の行のイベントと一致した場合のみ次へ進む
+        if (state != PLAYING || steps[currentIndex].trigger[0] == '\0' ||
+            strcmp(steps[currentIndex].trigger, command.text) != 0) {
+            return false;
+        }
+        if (currentIndex + 1 >= steps.size()) {
+            state = FINISHED;
+            return false;
+        }
+        return moveTo(currentIndex + 1, now);
+    }
+    return false;
+}
+
+/**
+ * @brief 現在の行（再生していない場合は nullptr）
+ */
+const TimetableStep *Timetable::current() const {
+    if (state == STOPPED || steps.empty()) return nullptr;
+    return &steps[currentIndex];
+}
+
+/**
+ * @brief 現在から `ahead` 行先の状態（先読み用、範囲外の場合は nullptr）
+ */
+const TimetableStep *Timetable::peek(size_t ahead) const {
+    if (state == STOPPED || state == FINISHED || currentIndex + ahead >= steps.size()) return nullptr;
+    return &steps[currentIndex + ahead];
+}
+
+/**
+ * @brief 現在の行の残り時間（ミリ秒、時間で進まない場合は 0）
+ */
+unsigned long Timetable::remaining(unsigned long now) const {
+    if (steps.empty() || (state != PLAYING && state != PAUSED)) return 0;
+    unsigned long hold = steps[currentIndex].holdMs;
+    unsigned long elapsed = ((state == PAUSED) ? pausedAt : now) - stepStart;
+    return (hold == 0 || elapsed >= hold) ? 0 : hold - elapsed;
+}
+
+/**
+ * @brief 再生状態の名前（/timetable の応答用）
+ */
+const char *Timetable::stateName() const {
+    switch (state) {
+    case PLAYING:  return "playing";
+    case PAUSED:   return "paused";
+    case FINISHED: return "finished";
+    default:       return "stopped";
+    }
+}
+
+// 指定行へ移動する（範囲外は先頭 / 末尾に丸める）
+bool Timetable::moveTo(long index, unsigned long now) {
+    if (index < 0) index = 0;
+    if (index >= (long)steps.size()) index = steps.size() - 1;
+    currentIndex = index;
+    stepStart = now;
+    pausedAt = now;
+    return true;
+}
@@ -0,0 +1,142 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>   // Arduino 環境の基本ライブラリ
+#include "LittleFS.h"  // ESP32 の LittleFS を使用するためのライブラリ
+#include <vector>      // 時刻表の各行
+
+// ===============================
+//      時刻表の設定
+// ===============================
+#define TIMETABLE_DIR "/timetable"       // 時刻表ファイルを置くフォルダ
+#define TIMETABLE_LOOKAHEAD 1            // 画像を先読みしておく行数（メモリに余裕があれば増やせる）
+#define TIMETABLE_TRIGGER_LEN 16         // イベント名の最大長
+
+/**
+ * @brief 時刻表の 1 行（1 つの表示状態）
+ *
+ * 停車中（dwell）と走行中（run）は別の行として並べる。
+ * `hold` 秒経過するか、`trigger` のイベントを受け取ると次の行へ進む。
+ */
+struct TimetableStep {
+    unsigned short mode = 0;  // 表示モード（0～3、/send の mode と同じ）
+    unsigned short full = 0;  // 全画面表示の ID
+    unsigned short type = 0;  // 種別の ID
+    unsigned short dest = 0;  // 行先の ID
+    unsigned short dep = 0;   // 始発駅の ID
+    unsigned short next = 0;  // 次駅の ID
+    unsigned long holdMs = 0; // 表示を続ける時間（ミリ秒、0 の場合はイベントでのみ進む）
+    char trigger[TIMETABLE_TRIGGER_LEN] = ""; // 次の行へ進めるイベント名（空の場合は時間でのみ進む）
+};
+
+/**
+ * @brief 時刻表の操作（Web サーバーのタスクからパネル制御タスクへ渡す）
+ */
+enum TimetableCommandType {
+    TIMETABLE_CMD_LOAD = 0, // 時刻表を読み込んで再生（path / index）
+    TIMETABLE_CMD_PLAY,     // 再生（一時停止から再開）
+    TIMETABLE_CMD_PAUSE,    // 一時停止
+    TIMETABLE_CMD_STOP,     // 停止（表示はそのまま）
+    TIMETABLE_CMD_SKIP,     // count 行進める（負の値で戻る）
+    TIMETABLE_CMD_SEEK,     // index 行目へ移動
+    TIMETABLE_CMD_EVENT     // イベント（name）を通知
+};
+
+struct TimetableCommand {
+    TimetableCommandType type = TIMETABLE_CMD_PLAY;
+    int value = 0;       // SKIP: 進める行数 / SEEK, LOAD: 行番号
+    char text[48] = "";  // LOAD: ファイルのパス / EVENT: イベント名
+};
+
+// ===============================
+//      Timetable クラスの定義
+// ===============================
+/**
+ * @brief 時刻表（表示状態の並び）を順に再生するクラス
+ *
+ * CSV 形式の時刻表を読み込み、時間またはイベントで次の状態へ進める。
+ * 表示の切り替え自体は行わず、現在の状態と先の状態（先読み用）を返すだけ。
+ * 時刻はすべて呼び出し側から渡す（`millis()` の値）。
+ */
+class Timetable {
+public:
+    /**
+     * @brief 時刻表を読み込む（再生は `start()` で開始）
+     *
+     * 形式: 1 行目は見出し（`mode,full,type,dest,dep,next,hold,trigger`、列の順序は任意）。
+     * `hold` は秒単位。省略した列は 0（trigger は空）。
+     *
+     * @param path 時刻表ファイルのパス
+     * @return 1 行以上読み込めた場合 true
+     */
+    bool load(const char *path);
+
+    /**
+     * @brief 指定した行から再生を開始する
+     */
+    void start(unsigned long now, size_t index = 0);
+
+    /**
+     * @brief 時間経過を確認し、必要なら次の行へ進める
+     * @return 行が変わった場合 true（呼び出し側で表示を切り替える）
+     */
+    bool update(unsigned long now);
+
+    /**
+     * @brief 操作を反映する
+     * @return 行が変わった場合 true
+     */
+    bool apply(const TimetableCommand &command, unsigned long now);
+
+    /**
+     * @brief 現在の行（再生していない場合は nullptr）
+     */
+    const TimetableStep *current() const;
+
+    /**
+     * @brief 現在から `ahead` 行先の状態（先読み用、範囲外の場合は nullptr）
+     */
+    const TimetableStep *peek(size_t ahead) const;
+
+    /**
+     * @brief 現在の行の残り時間（ミリ秒、時間で進まない場合は 0）
+     */
+    unsigned long remaining(unsigned long now) const;
+
+    bool isPlaying() const { return state == PLAYING; }
+    bool isPaused() const { return state == PAUSED; }
+    size_t index() const { return currentIndex; }
+    size_t size() const { return steps.size(); }
+    const String &path() const { return loadedPath; }
+    const char *stateName() const;
+
+private:
+    enum State { STOPPED, PLAYING, PAUSED, FINISHED };
+
+    std::vector<TimetableStep> steps;
+    String loadedPath;
+    State state = STOPPED;
+    size_t currentIndex = 0;
+    unsigned long stepStart = 0; // 現在の行に入った時刻
+    unsigned long pausedAt = 0;  // 一時停止した時刻
+
+    bool moveTo(long index, unsigned long now);
+};
+
+#endif // TIMETABLE_H
@@ -0,0 +1,168 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+TraceBuffer traceBuffer;
+
+/**
+ * @brief 実行中のタスクの番号を返す（初めて記録するタスクは空いている枠に登録する）
+ *
+ * タスクは削除しない前提のため、登録した枠は解放しない。
+ *
+ * @return タスクの番号（1 始まり）。タスクが不明・枠が足りない場合は 0
+ */
+uint8_t TraceBuffer::currentTask() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (!self) return 0;
+    for (int i = 0; i < TRACE_MAX_TASKS; i++) {
+        TaskHandle_t registered = tasks[i].load(std::memory_order_acquire);
+        if (!registered && tasks[i].compare_exchange_strong(registered, self, std::memory_order_acq_rel)) {
+            return i + 1;
+        }
+        if (registered == self) return i + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief イベントを 1 件記録する
+ *
+ * 1. 実行中のコアのバッファから書き込み位置を確保（fetch_add）
+ * 2. `seq` を 0 にして書き込み中であることを示す（フェンスで、内容の書き込みより先に見えるようにする）
+ * 3. 内容を書き込んだ後、`seq` にイベント番号 + 1 を設定して公開する
+ *
+ * @param name イベント名（静的な文字列リテラルを渡すこと）
+ * @param phase 'B'（開始）または 'E'（終了）
+ * @param detail 付加情報（nullptr 可、長い場合は末尾を残して切り詰める）
+ */
+void TraceBuffer::record(const char *name, char phase, const char *detail) {
+    int core = xPortGetCoreID();
+    if (core < 0 || core >= TRACE_CORES) core = 0;
+
+    // 1. 書き込み位置を確保
+    uint32_t index = heads[core].fetch_add(1, std::memory_order_relaxed);
+    TraceEvent &ev = events[core][index % TRACE_EVENTS_PER_CORE];
+
+    // 2. 書き込み中にする
+    ev.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // 3. 内容を書き込む
+    ev.timestampUs = micros();
+    ev.name = name;
+    ev.phase = phase;
+    ev.task = currentTask();
+    if (detail) {
+        size_t len = strlen(detail);
+        const char *tail = len >= TRACE_DETAIL_LEN ? detail + len - (TRACE_DETAIL_LEN - 1) : detail;
+        while ((*tail & 0xC0) == 0x80) tail++; // UTF-8 の文字の途中から始めない（JSON が壊れるため）
+        strncpy(ev.detail, tail, TRACE_DETAIL_LEN - 1);
+        ev.detail[TRACE_DETAIL_LEN - 1] = '\0';
+    } else {
+        ev.detail[0] = '\0';
+    }
+
+    // 4. 公開する
+    ev.seq.store(index + 1, std::memory_order_release);
+}
+
+// JSON 文字列用にエスケープして追記する
+static void appendJSONEscaped(String &out, const char *text) {
+    for (const char *p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        if ((unsigned char)*p < 0x20) continue; // 制御文字は捨てる
+        out += *p;
+    }
+}
+
+/**
+ * @brief 記録済みイベントを Chrome トレース JSON として出力する
+ *
+ * 先頭にタスク名（`thread_name`）を出力し、続けてコアごとに古い順でイベントを出力する。
+ * `tid` にはタスクの番号を入れるため、トレースビューアではタスクごとに別の行に並ぶ
+ * （コア 0 の Web サーバー・UART の受信・画像の展開・フレームの配信も区別される）。
+ *
+ * @param writer 断片を受け取るコールバック
+ * @param context コールバックに渡す任意のポインタ
+ */
+void TraceBuffer::exportChromeTrace(TraceWriter writer, void *context) const {
+    writer("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", context);
+
+    bool first = true;
+    String chunk;
+
+    // 0. タスク名を出力する
+    for (int i = 0; i < TRACE_MAX_TASKS; i++) {
+        TaskHandle_t task = tasks[i].load(std::memory_order_acquire);
+        if (!task) break;
+        chunk += first ? "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                       : ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+        first = false;
+        chunk += String(i + 1);
+        chunk += ",\"args\":{\"name\":\"";
+        appendJSONEscaped(chunk, pcTaskGetName(task));
+        chunk += "\"}}";
+    }
+
+    for (int core = 0; core < TRACE_CORES; core++) {
+        // 1. 出力対象の範囲（最新 TRACE_EVENTS_PER_CORE 件）を決める
+        uint32_t head = heads[core].load(std::memory_order_acquire);
+        uint32_t start = head > TRACE_EVENTS_PER_CORE ? head - TRACE_EVENTS_PER_CORE : 0;
+
+        for (uint32_t index = start; index < head; index++) {
+            const TraceEvent &ev = events[core][index % TRACE_EVENTS_PER_CORE];
+
+            // 2. 書き込み中・上書き済みのイベントは捨てる
+            if (ev.seq.load(std::memory_order_acquire) != index + 1) continue;
+            uint32_t timestampUs = ev.timestampUs;
+            const char *name = ev.name;
+            char phase = ev.phase;
+            uint8_t task = ev.task;
+            char detail[TRACE_DETAIL_LEN];
+            memcpy(detail, ev.detail, TRACE_DETAIL_LEN);
+            detail[TRACE_DETAIL_LEN - 1] = '\0';
+            std::atomic_thread_fence(std::memory_order_acquire); // 読み取った内容より後に `seq` を読み直す
+            if (ev.seq.load(std::memory_order_relaxed) != index + 1 || !name) continue;
+
+            // 3. 1 イベント分の JSON を作る
+            chunk += first ? "{\"name\":\"" : ",{\"name\":\"";
+            first = false;
+            appendJSONEscaped(chunk, name);
+            chunk += "\",\"ph\":\"";
+            chunk += phase;
+            chunk += "\",\"ts\":";
+            chunk += String((unsigned long)timestampUs);
+            chunk += ",\"pid\":1,\"tid\":";
+            chunk += String(task);
+            if (detail[0]) {
+                chunk += ",\"args\":{\"detail\":\"";
+                appendJSONEscaped(chunk, detail);
+                chunk += "\"}";
+            }
+            chunk += "}";
+
+            // 4. ある程度たまったら出力する（送信回数を減らすため）
+            if (chunk.length() >= 1024) {
+                writer(chunk, context);
+                chunk = "";
+            }
+        }
+    }
+
+    chunk += "]}";
+    writer(chunk, context);
+}
@@ -0,0 +1,120 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef TRACEBUFFER_H
+#define TRACEBUFFER_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>  // Arduino 環境の基本ライブラリ
+#include <atomic>     // ロックフリーなリングバッファの管理
+
+//#define TRACE_DISABLE  // トレースを無効化する場合はコメントを解除
+
+// ===============================
+//      トレース設定
+// ===============================
+#define TRACE_CORES 2              // ESP32 のコア数（コアごとにバッファを持つ）
+#define TRACE_EVENTS_PER_CORE 128  // 1 コアあたりに保持するイベント数（古いものから上書き）
+#define TRACE_DETAIL_LEN 24        // 付加情報（ファイル名など）の最大長（末尾を残して切り詰める）
+#define TRACE_MAX_TASKS 8          // 区別して記録するタスクの数（超えた分は tid 0 にまとめる）
+
+/**
+ * @brief トレースイベント 1 件分
+ *
+ * `seq` は書き込み完了時に「イベント番号 + 1」となり、書き込み中は 0 になる。
+ * 読み出し側は読み込みの前後で `seq` を比較し、途中で上書きされたイベントを捨てる。
+ */
+struct TraceEvent {
+    std::atomic<uint32_t> seq{0};   // 書き込み済みイベント番号 + 1（0 は書き込み中 / 未使用）
+    uint32_t timestampUs = 0;       // 記録時刻（micros()）
+    const char *name = nullptr;     // イベント名（静的な文字列のみ）
+    char phase = 0;                 // 'B': 開始 / 'E': 終了
+    uint8_t task = 0;               // 記録したタスクの番号（1 始まり、0 は不明）。`tid` として出力する
+    char detail[TRACE_DETAIL_LEN] = {}; // 付加情報（ファイルパスなど）
+};
+
+/**
+ * @brief 出力用コールバック（Chrome トレース JSON の断片を受け取る）
+ */
+typedef void (*TraceWriter)(const String &chunk, void *context);
+
+// ===============================
+//      TraceBuffer クラスの定義
+// ===============================
+/**
+ * @brief コアごとの固定長リングバッファに開始 / 終了イベントを記録するクラス
+ *
+ * - 書き込み位置は `fetch_add` で確保するため、同じコア上のタスク間でもロック不要
+ * - イベントには記録したタスクの番号を持たせる（同じコアの複数タスクの開始 / 終了が入れ子にならないため）
+ * - 読み出し（/trace）は書き込みを止めずに行い、上書き途中のイベントだけを除外する
+ * - 出力は Chrome の `trace_event` 形式（chrome://tracing や Perfetto で表示可能）
+ */
+class TraceBuffer {
+public:
+    /**
+     * @brief イベントを 1 件記録する
+     *
+     * @param name イベント名（静的な文字列リテラルを渡すこと）
+     * @param phase 'B'（開始）または 'E'（終了）
+     * @param detail 付加情報（nullptr 可、長い場合は末尾を残して切り詰める）
+     */
+    void record(const char *name, char phase, const char *detail = nullptr);
+
+    /**
+     * @brief 記録済みイベントを Chrome トレース JSON として出力する
+     *
+     * 出力は複数の断片に分けて `writer` に渡される（巨大な String を作らないため）。
+     *
+     * @param writer 断片を受け取るコールバック
+     * @param context コールバックに渡す任意のポインタ
+     */
+    void exportChromeTrace(TraceWriter writer, void *context) const;
+
+private:
+    uint8_t currentTask();
+
+    TraceEvent events[TRACE_CORES][TRACE_EVENTS_PER_CORE]; // コアごとのリングバッファ
+    std::atomic<uint32_t> heads[TRACE_CORES] = {};          // 次に書き込むイベント番号
+    std::atomic<TaskHandle_t> tasks[TRACE_MAX_TASKS] = {};  // 記録したタスク（添字 + 1 がタスクの番号）
+};
+
+extern TraceBuffer traceBuffer; // 全体で共有するトレースバッファ
+
+/**
+ * @brief スコープの開始 / 終了をトレースに記録するクラス
+ *
+ * `TRACE_SCOPE("cacheBMPData", path.c_str());` のように使う。
+ */
+class TraceScope {
+public:
+    TraceScope(const char *name, const char *detail = nullptr) : name(name) {
+        traceBuffer.record(name, 'B', detail);
+    }
+    ~TraceScope() { traceBuffer.record(name, 'E'); }
+
+private:
+    const char *name;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TRACE_DISABLE
+    #define TRACE_SCOPE(...) do {} while (0)
+#else
+    #define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(__VA_ARGS__)
+#endif
+
+#endif // TRACEBUFFER_H
@@ -0,0 +1,302 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#include "Transition.h"
+#include "drawBitmap.h"
+#include "PanelGeometry.h"
+#include "TraceBuffer.h"
+
+// -------------------------------
+// グローバル変数定義
+// -------------------------------
+TransitionEngine transitions;
+
+// 進み具合（0～TRANSITION_STEPS）から効果の進行度（0～255）への変換表（始めと終わりを緩やかにする）
+static const uint8_t easeTable[TRANSITION_STEPS + 1] = {
+    0, 0, 1, 2, 3, 4, 6, 8, 11, 14, 17, 20, 24, 27, 31, 35,
+    40, 44, 49, 54, 59, 64, 70, 75, 81, 86, 92, 98, 104, 110, 116, 122,
+    128, 133, 139, 145, 151, 157, 163, 169, 174, 180, 185, 191, 196, 201, 206, 211,
+    215, 220, 224, 228, 231, 235, 238, 241, 244, 247, 249, 251, 252, 253, 254, 255,
+    255
+};
+
+// ディザ（4x4 の Bayer 配列）の閾値。進行度がこれ以上になった画素から新しい画像にする
+static const uint8_t ditherTable[16] = {
+    8, 136, 40, 168,
+    200, 72, 232, 104,
+    56, 184, 24, 152,
+    248, 120, 216, 88
+};
+
+// 設定ファイルでの名前（TransitionType の順）
+static const char *const transitionNames[] = { "cut", "wipe", "slide", "slide_up", "fade", "dissolve", "flap" };
+
+// RGB565 の 2 ピクセルを 32 ビットにまとめたときの成分の位置
+// （各成分の上に 5 ビットの余白を空け、0～32 倍しても隣の成分にあふれないようにする）
+#define RGB565_LANE_EVEN 0x07E0F81FUL // 1 ピクセル目の青・赤、2 ピクセル目の緑
+#define RGB565_LANE_ODD  0x07C0F83FUL // 5 ビット右にずらした、1 ピクセル目の緑、2 ピクセル目の青・赤
+
+/**
+ * @brief 2 ピクセルずつまとめて混ぜ合わせる（結果 = a × (32 - alpha) / 32 + b × alpha / 32）
+ * @param a 切り替え前の 1 行
+ * @param b 新しい画像の 1 行
+ * @param out 出力先
+ * @param length ピクセル数
+ * @param alpha 新しい画像の割合（0～32）
+ */
+static void blendRow565(const uint16_t *a, const uint16_t *b, uint16_t *out, int length, uint32_t alpha) {
+    uint32_t inverse = 32 - alpha;
+    int x = 0;
+    for (; x + 1 < length; x += 2) {
+        uint32_t pa, pb;
+        memcpy(&pa, a + x, sizeof(pa));
+        memcpy(&pb, b + x, sizeof(pb));
+        uint32_t even = (((pa & RGB565_LANE_EVEN) * inverse + (pb & RGB565_LANE_EVEN) * alpha) >> 5) & RGB565_LANE_EVEN;
+        uint32_t odd = ((((pa >> 5) & RGB565_LANE_ODD) * inverse + ((pb >> 5) & RGB565_LANE_ODD) * alpha) >> 5) & RGB565_LANE_ODD;
+        uint32_t blended = even | (odd << 5);
+        memcpy(out + x, &blended, sizeof(blended));
+    }
+    // 奇数個の場合の最後の 1 ピクセル
+    if (x < length) {
+        uint32_t pa = a[x], pb = b[x];
+        uint32_t even = (((pa & RGB565_LANE_EVEN) * inverse + (pb & RGB565_LANE_EVEN) * alpha) >> 5) & RGB565_LANE_EVEN;
+        uint32_t odd = ((((pa >> 5) & RGB565_LANE_ODD) * inverse + ((pb >> 5) & RGB565_LANE_ODD) * alpha) >> 5) & RGB565_LANE_ODD;
+        out[x] = (uint16_t)(even | (odd << 5));
+    }
+}
+
+/**
+ * @brief `種類:ミリ秒` 形式の文字列を読み取る
+ * @param value 設定値（例: `fade:300`、ミリ秒を省略した場合は 300）
+ * @param style 読み取り結果
+ * @return 読み取れた場合 true（不明な種類の場合は false）
+ */
+bool TransitionStyle::parse(const String &value, TransitionStyle &style) {
+    int colon = value.indexOf(':');
+    String name = (colon == -1) ? value : value.substring(0, colon);
+    name.trim();
+
+    for (int i = 0; i < (int)(sizeof(transitionNames) / sizeof(transitionNames[0])); i++) {
+        if (name == transitionNames[i]) {
+            style.type = (TransitionType)i;
+            long duration = (colon == -1) ? 300 : value.substring(colon + 1).toInt();
+            style.durationMs = (style.type == TRANSITION_CUT) ? 0 : constrain(duration, 0L, 10000L);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 指定位置の表示を新しい画像へ切り替える
+ *
+ * 効果が `cut` の場合や表示中の内容の写しが無い場合は、その場で描画する。
+ * 同じ位置で実行中の切り替えは、その時点の表示から新しい画像への切り替えに置き換える。
+ *
+ * @param x 描画開始 X 座標
+ * @param y 描画開始 Y 座標
+ * @param image 新しい画像（内容は複写するため、呼び出し後に解放してよい）
+ * @param style 切り替え効果
+ */
+void TransitionEngine::start(int x, int y, const BMPData *image, const TransitionStyle &style) {
+    if (image == nullptr || image->cache == nullptr) return;
+
+    // 1. 描画範囲をパネル内に収める
+    int left = max(x, 0);
+    int top = max(y, 0);
+    int right = min(x + image->width, panelWidth);
+    int bottom = min(y + image->height, panelHeight);
+    if (right <= left || bottom <= top) return;
+
+    // 2. 同じ位置で実行中の切り替えを止める（以降はその時点の表示から切り替える）
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (layers[i].x == left && layers[i].y == top) {
+            release(layers[i]);
+            layers.erase(layers.begin() + i);
+            break;
+        }
+    }
+
+    // 3. 効果なしの場合はその場で描画
+    const uint16_t *mirror = panelGeometry.mirrorBuffer();
+    if (style.isCut() || mirror == nullptr) {
+        drawBMPFromCache(image, x, y);
+        return;
+    }
+
+    // 4. 切り替え前の表示と新しい画像を複写（メモリが足りない場合はその場で描画）
+    Layer layer;
+    layer.x = left;
+    layer.y = top;
+    layer.width = right - left;
+    layer.height = bottom - top;
+    layer.style = style;
+    size_t bytes = (size_t)layer.width * layer.height * sizeof(uint16_t);
+    layer.from = (uint16_t *)malloc(bytes);
+    layer.to = (uint16_t *)malloc(bytes);
+    if (!layer.from || !layer.to) {
+        release(layer);
+        drawBMPFromCache(image, x, y);
+        return;
+    }
+    for (int row = 0; row < layer.height; row++) {
+        memcpy(layer.from + row * layer.width, mirror + (top + row) * panelWidth + left,
+               layer.width * sizeof(uint16_t));
+        memcpy(layer.to + row * layer.width, image->cache + (top - y + row) * image->width + (left - x),
+               layer.width * sizeof(uint16_t));
+    }
+    if ((int)rowBuffer.size() < layer.width) {
+        rowBuffer.resize(layer.width);
+    }
+
+    // 5. 次の update() から描画を開始
+    layer.startMillis = millis();
+    layers.push_back(layer);
+}
+
+/**
+ * @brief 実行中の切り替えを 1 コマ進める（描画ループから毎回呼ぶ）
+ *
+ * コマが変わらない間は何もしない（最大 TRANSITION_STEPS + 1 回だけ描画する）。
+ */
+void TransitionEngine::update() {
+    if (layers.empty()) return;
+    unsigned long now = millis();
+
+    for (size_t i = 0; i < layers.size();) {
+        Layer &layer = layers[i];
+
+        // 1. 経過時間からコマを求める
+        unsigned long elapsed = now - layer.startMillis;
+        int step = (elapsed >= layer.style.durationMs)
+                       ? TRANSITION_STEPS
+                       : (int)(elapsed * TRANSITION_STEPS / layer.style.durationMs);
+
+        // 2. コマが変わった場合のみ描画
+        if (step != layer.lastStep) {
+            TRACE_SCOPE("transition");
+            drawStep(layer, step);
+            layer.lastStep = step;
+        }
+
+        // 3. 最後のコマを描画したら終了
+        if (step >= TRANSITION_STEPS) {
+            release(layer);
+            layers.erase(layers.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+/**
+ * @brief 実行中の切り替えをすべて最後のコマまで描画して終了する（表示モードの変更時など）
+ */
+void TransitionEngine::finishAll() {
+    for (Layer &layer : layers) {
+        if (layer.lastStep != TRANSITION_STEPS) {
+            drawStep(layer, TRANSITION_STEPS);
+        }
+        release(layer);
+    }
+    layers.clear();
+}
+
+// 指定したコマを 1 行ずつ合成して描画する
+void TransitionEngine::drawStep(const Layer &layer, int step) {
+    int progress = easeTable[step]; // 進行度（0～255）
+    int width = layer.width;
+    int height = layer.height;
+    int middle = height / 2;        // フラップの折り目
+    uint16_t *row = rowBuffer.data();
+
+    for (int y = 0; y < height; y++) {
+        const uint16_t *from = layer.from + y * width;
+        const uint16_t *to = layer.to + y * width;
+        const uint16_t *out = row; // 描画する 1 行（合成しない場合は from / to をそのまま使う）
+
+        switch (layer.style.type) {
+        case TRANSITION_WIPE: {
+            // 左から edge までを新しい画像に
+            int edge = progress * width / 255;
+            memcpy(row, to, edge * sizeof(uint16_t));
+            memcpy(row + edge, from + edge, (width - edge) * sizeof(uint16_t));
+            break;
+        }
+        case TRANSITION_SLIDE: {
+            // 切り替え前の表示を左へ押し出し、右から新しい画像を入れる
+            int shift = progress * width / 255;
+            memcpy(row, from + shift, (width - shift) * sizeof(uint16_t));
+            memcpy(row + (width - shift), to, shift * sizeof(uint16_t));
+            break;
+        }
+        case TRANSITION_SLIDE_UP: {
+            // 行単位で上へ押し出す（合成は不要）
+            int shift = progress * height / 255;
+            out = (y < height - shift) ? layer.from + (y + shift) * width
+                                       : layer.to + (y - (height - shift)) * width;
+            break;
+        }
+        case TRANSITION_FADE:
+            blendRow565(from, to, row, width, (progress * 32 + 127) / 255);
+            break;
+        case TRANSITION_DISSOLVE: {
+            const uint8_t *threshold = ditherTable + (y & 3) * 4;
+            for (int x = 0; x < width; x++) {
+                row[x] = (progress >= threshold[x & 3]) ? to[x] : from[x];
+            }
+            break;
+        }
+        case TRANSITION_FLAP:
+            // 前半: 切り替え前の上半分が折り目に向かって縮み、その上に新しい画像が現れる
+            // 後半: 新しい画像の下半分が折り目から伸びて、切り替え前の下半分を覆う
+            if (progress < 128) {
+                int scale = 128 - progress; // 倒れていくフラップの高さ（128 分率）
+                int flapTop = middle - middle * scale / 128;
+                if (y < flapTop) {
+                    out = to;
+                } else if (y < middle) {
+                    int sourceY = constrain(middle - (middle - y) * 128 / scale, 0, middle - 1);
+                    out = layer.from + sourceY * width;
+                } else {
+                    out = from;
+                }
+            } else {
+                int scale = progress - 128; // 降りてくるフラップの高さ（127 分率）
+                int flapBottom = middle + (height - middle) * scale / 127;
+                if (y < middle) {
+                    out = to;
+                } else if (y < flapBottom) {
+                    int sourceY = constrain(middle + (y - middle) * 127 / max(scale, 1), middle, height - 1);
+                    out = layer.to + sourceY * width;
+                } else {
+                    out = from;
+                }
+            }
+            break;
+        default:
+            out = to;
+            break;
+        }
+
+        panelGeometry.blitSpan(matrix, layer.x, layer.y + y, out, width);
+    }
+}
+
+// 複写した画像のメモリを解放する
+void TransitionEngine::release(Layer &layer) {
+    free(layer.from);
+    free(layer.to);
+    layer.from = nullptr;
+    layer.to = nullptr;
+}
@@ -0,0 +1,126 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+// ===============================
+//      必要なライブラリのインクルード
+// ===============================
+#include <Arduino.h>   // Arduino 環境の基本ライブラリ
+#include <vector>      // 実行中の切り替え効果
+
+struct BMPData; // drawBitmap.h
+
+// ===============================
+//      切り替え効果の設定
+// ===============================
+#define TRANSITION_STEPS 64 // 切り替え 1 回あたりの最大コマ数（進み具合の分解能）
+
+/**
+ * @brief 表示の切り替え効果の種類
+ */
+enum TransitionType {
+    TRANSITION_CUT = 0,  // 即座に切り替え（従来どおり）
+    TRANSITION_WIPE,     // 左から右へ塗り替え
+    TRANSITION_SLIDE,    // 新しい画像が右から押し出す
+    TRANSITION_SLIDE_UP, // 新しい画像が下から押し出す
+    TRANSITION_FADE,     // 徐々に混ぜ合わせる
+    TRANSITION_DISSOLVE, // 点状に入れ替える（4x4 のディザ）
+    TRANSITION_FLAP      // 上半分が倒れ、続いて下半分が降りる（反転フラップ式）
+};
+
+/**
+ * @brief 表示部品（レイヤー）ごとの切り替え効果
+ *
+ * 設定ファイルでは `種類:ミリ秒`（例: `wipe:400`、`cut` のみでも可）で指定する。
+ */
+struct TransitionStyle {
+    TransitionType type = TRANSITION_CUT; // 効果の種類
+    uint16_t durationMs = 0;              // 切り替えにかける時間（ミリ秒）
+
+    /**
+     * @brief `種類:ミリ秒` 形式の文字列を読み取る
+     * @param value 設定値（例: `fade:300`）
+     * @param style 読み取り結果
+     * @return 読み取れた場合 true（不明な種類の場合は false）
+     */
+    static bool parse(const String &value, TransitionStyle &style);
+
+    bool isCut() const { return type == TRANSITION_CUT || durationMs == 0; }
+};
+
+// ===============================
+//      TransitionEngine クラスの定義
+// ===============================
+/**
+ * @brief 表示部品の切り替え効果を実行するクラス
+ *
+ * `start()` で切り替え前の表示（`PanelGeometry` の写し）と新しい画像を複写しておき、
+ * `update()` のたびに経過時間に応じたコマを 1 行ずつ合成して `blitSpan()` で描画する。
+ * 進み具合の曲線・ディザの閾値は事前に計算した表を使い、混ぜ合わせは RGB565 の
+ * 2 ピクセルを 32 ビットにまとめた整数演算で行う（1 コマの処理量は画像 1 枚の描画とほぼ同じ）。
+ *
+ * パネル制御タスクからのみ使用する（排他制御は行わない）。
+ */
+class TransitionEngine {
+public:
+    /**
+     * @brief 指定位置の表示を新しい画像へ切り替える
+     *
+     * 効果が `cut` の場合や表示中の内容の写しが無い場合は、その場で描画する。
+     * 同じ位置で実行中の切り替えは、その時点の表示から新しい画像への切り替えに置き換える。
+     *
+     * @param x 描画開始 X 座標
+     * @param y 描画開始 Y 座標
+     * @param image 新しい画像（内容は複写するため、呼び出し後に解放してよい）
+     * @param style 切り替え効果
+     */
+    void start(int x, int y, const BMPData *image, const TransitionStyle &style);
+
+    /**
+     * @brief 実行中の切り替えを 1 コマ進める（描画ループから毎回呼ぶ）
+     */
+    void update();
+
+    /**
+     * @brief 実行中の切り替えをすべて最後のコマまで描画して終了する（表示モードの変更時など）
+     */
+    void finishAll();
+
+    bool isActive() const { return !layers.empty(); }
+
+private:
+    /**
+     * @brief 実行中の切り替え 1 件（描画範囲はパネル内に収めてある）
+     */
+    struct Layer {
+        int x = 0, y = 0;            // 描画範囲の左上
+        int width = 0, height = 0;   // 描画範囲の大きさ
+        uint16_t *from = nullptr;    // 切り替え前の表示（width × height）
+        uint16_t *to = nullptr;      // 新しい画像（width × height）
+        TransitionStyle style;
+        unsigned long startMillis = 0;
+        int lastStep = -1;           // 最後に描画したコマ（0～TRANSITION_STEPS）
+    };
+
+    std::vector<Layer> layers;
+    std::vector<uint16_t> rowBuffer; // 1 行分の合成用バッファ
+
+    void drawStep(const Layer &layer, int step);
+    static void release(Layer &layer);
+};
+
+extern TransitionEngine transitions; // 全体で共有する切り替え効果
+
+#endif // TRANSITION_H
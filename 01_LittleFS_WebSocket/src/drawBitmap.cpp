@@ -12,6 +12,15 @@
  * 利用に伴う損害について、作者は一切責任を負いません。
  */
 #include "drawBitmap.h"
+#include "AssetManifest.h"
+#include "AssetCache.h"
+#include "BMPDecoder.h"
+#include "BitmapFont.h"
+#include "DecodePool.h"
+#include "FrameGovernor.h"
+#include "PanelGeometry.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
 
 // -------------------------------
 // グローバル変数定義
@@ -26,13 +35,16 @@ bool flg_scrollEnd = false;
 
 // 表示状態管理（トグル用フラグ）
 bool toggleState = true;        // 初期表示を bmp1 に設定
-bool toggleLangState = true;    // true: 日本語, false: 英語（言語切り替え用）
+
+// 表示中のトグル / スクロールの内容（シーンのプリセット保存用）
+ActiveScene activeScene;
 
 /**
  * @brief BMPファイルのヘッダー情報を解析する
  *
  * BMP ファイルのヘッダーを読み取り、画像の幅・高さ・ピクセルデータの開始位置を取得する。
  * また、BMP のデータが上下逆（Bottom-Up）かどうかも判定する。
+ * 色深度・圧縮形式などの検証は `readBMPInfo()`（AssetManifest.h）で行う。
  *
  * @param file BMPファイルの参照（LittleFS から開いたファイルオブジェクト）
  * @param imgWidth 読み取った画像の幅（ピクセル単位）
@@ -42,219 +54,368 @@ bool toggleLangState = true;    // true: 日本語, false: 英語（言語切り
  * @return 成功時 true / 失敗時 false
  */
 bool parseBMPHeader(File &file, int &imgWidth, int &imgHeight, int &pixelDataOffset, bool &isTopDown) {
-    uint8_t header[54];  // BMP ヘッダーは 54 バイト
-    if (file.read(header, 54) != 54) {  // ヘッダー部分を 54 バイト読み取る
-        Serial.println("BMPヘッダーの読み込みに失敗しました。");
+    BMPInfo info;
+    if (!readBMPInfo(file, info)) {
         return false;
     }
 
-    // BMP ヘッダー情報を解析
-    imgWidth = *(int *)&header[18];            // 画像の横幅（ピクセル）
-    imgHeight = abs(*(int *)&header[22]);      // 画像の縦幅（ピクセル、絶対値を取る）
-    pixelDataOffset = *(int *)&header[10];     // ピクセルデータの開始位置（バイト）
-    isTopDown = (*(int *)&header[22] < 0);     // 画像が「上から描画される」なら true（通常は false）
+    imgWidth = info.width;                    // 画像の横幅（ピクセル）
+    imgHeight = info.height;                  // 画像の縦幅（ピクセル）
+    pixelDataOffset = info.pixelDataOffset;   // ピクセルデータの開始位置（バイト）
+    isTopDown = info.isTopDown;               // 画像が「上から描画される」なら true（通常は false）
 
     return true;  // ヘッダー解析成功
 }
 
 /**
- * @brief BMP画像をメモリにキャッシュして、高速描画を可能にする
+ * @brief BMPファイルを開き、検証済みのヘッダー情報を取得する
  *
- * 画像データを一度読み込み、メモリ上にキャッシュすることで、ファイルアクセス不要で即座に描画可能にする。
+ * マニフェストが用意されている場合はその情報を使い、ヘッダーの読み込みを省略する。
+ * マニフェストにない画像（存在しない・無効）はファイルを開かずに失敗とする。
+ * ファイルサイズがマニフェストと異なる場合は、差し替えられたとみなしてヘッダーを解析し直す。
  *
- * @param bitmapFilePath BMPファイルのパス（LittleFS上に保存されている）
- * @param bmpData BMPデータのキャッシュ構造体（幅・高さ・ピクセルデータを格納）
+ * @param path BMPファイルのパス
+ * @param file 開いたファイルの格納先（失敗時は閉じた状態）
+ * @param info ヘッダー情報の格納先
+ * @return 成功時 true / 失敗時 false
  */
-void cacheBMPData(const String &bitmapFilePath, BMPData &bmpData) {
-    // 1. 既存のキャッシュがある場合は解放（メモリリーク防止）
-    if (bmpData.cache) {
-        free(bmpData.cache);
-        bmpData.cache = nullptr;
+static bool openBMPAsset(const String &path, File &file, BMPInfo &info) {
+    // 1. マニフェストで存在と形式を確認
+    const BMPInfo *known = nullptr;
+    if (assetManifest.isReady()) {
+        known = assetManifest.find(path);
+        if (!known) {
+            Serial.printf("BMPファイル %s はマニフェストにありません（存在しないか無効）。\n", path.c_str());
+            return false;
+        }
     }
 
     // 2. BMPファイルを開く（LittleFS から読み込む）
-    File file = LittleFS.open(bitmapFilePath, "r");
+    file = LittleFS.open(path, "r");
     if (!file) {
-        Serial.printf("BMPファイル %s を開けませんでした。\n", bitmapFilePath.c_str());
-        return;
+        Serial.printf("BMPファイル %s を開けませんでした。\n", path.c_str());
+        return false;
     }
 
-    // 3. BMP ヘッダー情報を取得
-    int imgWidth, imgHeight, pixelDataOffset;
-    bool isTopDown;
-    if (!parseBMPHeader(file, imgWidth, imgHeight, pixelDataOffset, isTopDown)) {
-        Serial.println("BMPヘッダー解析失敗！");
+    // 3. マニフェストの情報がそのまま使えるならヘッダー解析を省略
+    if (known && file.size() == known->fileSize) {
+        info = *known;
+        return true;
+    }
+
+    // 4. BMP ヘッダー情報を解析
+    if (!readBMPInfo(file, info)) {
+        Serial.printf("BMPヘッダー解析失敗！ (%s)\n", path.c_str());
         file.close();
+        return false;
+    }
+    return true;
+}
+
+// BMP のヘッダー情報を、マニフェスト（無い場合はヘッダーのみの読み込み）から求める（ピクセルデータは読まない）
+static bool lookupBMPInfo(const String &path, BMPInfo &info) {
+    // 1. マニフェストがあればファイルを開かない
+    if (assetManifest.isReady()) {
+        const BMPInfo *known = assetManifest.find(path);
+        if (!known) return false;
+        info = *known;
+        return true;
+    }
+
+    // 2. ヘッダーのみを読む
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+    bool ok = readBMPInfo(file, info);
+    file.close();
+    return ok;
+}
+
+/**
+ * @brief 画像を読み込まずに大きさだけを求める
+ *
+ * BMP はマニフェストが用意されていればその情報を使い、無い場合はヘッダーのみを読む。
+ * 文字列の指定（`text:...`）はフォントの文字幅から求める。
+ *
+ * @param path 画像のパス（または文字列の指定）
+ * @param width 画像の幅
+ * @param height 画像の高さ
+ * @return 求められた場合 true（存在しない・無効な画像は false）
+ */
+bool measureImage(const String &path, int &width, int &height) {
+    // 1. 文字列の指定はフォントで求める
+    if (BitmapFont::isTextAsset(path)) {
+        return bitmapFont.measureAsset(path, width, height);
+    }
+
+    // 2. BMP はマニフェスト、またはヘッダーのみから求める
+    BMPInfo info;
+    if (!lookupBMPInfo(path, info)) return false;
+    width = info.width;
+    height = info.height;
+    return true;
+}
+
+// BMP ファイルを開いて新しいメモリに展開する（`bmpData` は空の状態で渡す）
+// 先読みキャッシュ・フォントを使わないため、展開ワーカー（`DecodePool`）からも呼べる
+static void loadBMPFile(const String &bitmapFilePath, BMPData &bmpData) {
+    TRACE_SCOPE("loadBMPFile", bitmapFilePath.c_str());
+
+    // 1. BMPファイルを開き、ヘッダー情報を取得（マニフェストがあれば解析を省略）
+    File file;
+    BMPInfo info;
+    if (!openBMPAsset(bitmapFilePath, file, info)) {
+        panelMetrics.countAssetLoad(false);
         return;
     }
 
-    // 4. ピクセルデータを格納するメモリを確保（RGB565 形式で保存）
+    // 2. BMP ヘッダー情報を展開
+    int imgWidth = info.width;
+    int imgHeight = info.height;
+
+    // 3. ピクセルデータを格納するメモリを確保（RGB565 形式で保存）
     bmpData.cache = (uint16_t *)malloc(imgWidth * imgHeight * sizeof(uint16_t));
     if (!bmpData.cache) {
         Serial.println("メモリ確保に失敗しました。");
         file.close();
+        panelMetrics.countAssetLoad(false);
         return;
     }
 
-    // 5. 画像の幅と高さを記録
+    // 4. 画像の幅と高さを記録
     bmpData.width = imgWidth;
     bmpData.height = imgHeight;
 
-    // 6. ピクセルデータの開始位置へ移動
-    file.seek(pixelDataOffset, SeekSet);
+    // 5. ピクセルデータを RGB565 に変換しながら読み込む（形式ごとの処理は BMPDecoder）
+    bool decoded = decodeBMPToBuffer(file, info, bmpData.cache, imgWidth);
+
+    // 6. ファイルを閉じる（メモリ解放）
+    file.close();
+    if (!decoded) {
+        free(bmpData.cache);
+        bmpData.cache = nullptr;
+        bmpData.width = 0;
+        bmpData.height = 0;
+        panelMetrics.countAssetLoad(false);
+        return;
+    }
+    panelMetrics.countAssetLoad(true);
+    Serial.printf("BMPファイル %s をキャッシュしました。\n", bitmapFilePath.c_str());
+}
 
-    // 7. 1 行あたりのデータサイズ（パディングを考慮）
-    int rowSize = (imgWidth * 3 + 3) & ~3; // 1 行のバイト数（24bit RGB なので 3 バイト × 幅）
+// 先読み済みの画像を受け取るか、文字列の指定を画像にする（どちらでもなければ false、既存のキャッシュは解放済み）
+// 先読みキャッシュとフォントは排他制御をしないため、パネル制御タスクでのみ呼ぶ
+static bool takeOrRenderAsset(const String &bitmapFilePath, BMPData &bmpData) {
+    // 1. 先読み済み（AssetCache）ならファイルを読まずにそのメモリを受け取る
+    if (assetCache.take(bitmapFilePath, bmpData)) {
+        return true;
+    }
 
-    // 8. ピクセルデータのバッファ
-    uint8_t rowBuffer[rowSize];
+    // 2. 既存のキャッシュがある場合は解放（メモリリーク防止）
+    if (bmpData.cache) {
+        free(bmpData.cache);
+        bmpData.cache = nullptr;
+    }
+    bmpData.width = 0;
+    bmpData.height = 0;
 
-    // 9. BMP画像のピクセルデータを 1 行ずつ読み込む
-    for (int y = 0; y < imgHeight; y++) {
-        int rowIndex = isTopDown ? y : (imgHeight - 1 - y); // BMPが上下逆なら修正
-        file.read(rowBuffer, rowSize);
+    // 3. 文字列の指定（`text:...`）はフォントで画像にする
+    if (BitmapFont::isTextAsset(bitmapFilePath)) {
+        panelMetrics.countAssetLoad(bitmapFont.renderAsset(bitmapFilePath, bmpData));
+        return true;
+    }
+    return false;
+}
 
-        for (int x = 0; x < imgWidth; x++) {
-            uint8_t b = rowBuffer[x * 3];   // 青（Blue）
-            uint8_t g = rowBuffer[x * 3 + 1]; // 緑（Green）
-            uint8_t r = rowBuffer[x * 3 + 2]; // 赤（Red）
+/**
+ * @brief BMP画像をメモリにキャッシュして、高速描画を可能にする
+ *
+ * 画像データを一度読み込み、メモリ上にキャッシュすることで、ファイルアクセス不要で即座に描画可能にする。
+ *
+ * @param bitmapFilePath BMPファイルのパス（LittleFS上に保存されている）
+ * @param bmpData BMPデータのキャッシュ構造体（幅・高さ・ピクセルデータを格納）
+ */
+void cacheBMPData(const String &bitmapFilePath, BMPData &bmpData) {
+    TRACE_SCOPE("cacheBMPData", bitmapFilePath.c_str());
 
-            // BMPは RGB888 (8bit x 3) 形式なので、RGB565 (16bit) に変換して保存
-            bmpData.cache[rowIndex * imgWidth + x] = matrix->color565(r, g, b);
-        }
+    // 1. 先読み済み・文字列の指定ならファイルを展開しない
+    if (takeOrRenderAsset(bitmapFilePath, bmpData)) {
+        return;
     }
 
-    // 10. ファイルを閉じる（メモリ解放）
-    file.close();
-    Serial.printf("BMPファイル %s をキャッシュしました。\n", bitmapFilePath.c_str());
+    // 2. BMP ファイルを展開
+    loadBMPFile(bitmapFilePath, bmpData);
 }
 
 /**
- * @brief 一定時間ごとに言語（日本語 / 英語）を切り替える
- * @param interval 設定された時間間隔（ミリ秒単位）
+ * @brief 複数の画像をまとめてキャッシュする（BMP ファイルの展開は 2 つのコアで分担する）
+ *
+ * 先読み済みの画像の受け取りと文字列の画像化は呼び出し元で行い、残った BMP ファイルの展開だけを
+ * `DecodePool` でワーカーと分担する（各画像は自分のメモリに展開する）。
+ * すべての画像がそろってから戻るため、戻った後に表示内容を切り替えればよい。
+ * 各画像の `generation` は変更しない（呼び出し側が読み込みの前に設定してよい）。
+ *
+ * @param loads 読み込む画像と格納先の一覧
  */
-void toggleLanguage(unsigned long interval) {
-    unsigned long currentMillis = millis();
-
-    // 設定時間が経過したらトグルを切り替え
-    if (currentMillis - previousToggleMillis >= interval) {
-        previousToggleMillis = currentMillis;
-        toggleLangState = !toggleLangState;
+void cacheBMPDataBatch(const std::vector<BMPLoad> &loads) {
+    if (loads.empty()) return;
+    TRACE_SCOPE("cacheBMPDataBatch");
+
+    // 1. 呼び出し元で処理できるもの（先読み済み・文字列）を先に済ませ、BMP ファイルの展開を残す
+    std::vector<const BMPLoad *> pending;
+    pending.reserve(loads.size());
+    for (const BMPLoad &load : loads) {
+        uint32_t generation = load.dest->generation;
+        if (!takeOrRenderAsset(load.path, *load.dest)) {
+            pending.push_back(&load);
+        }
+        load.dest->generation = generation;
     }
+
+    // 2. BMP ファイルの展開をワーカーと分担し、すべて終わるまで待つ
+    decodePool.run(pending.size(), [](size_t index, void *context) {
+        const BMPLoad *load = (*static_cast<std::vector<const BMPLoad *> *>(context))[index];
+        loadBMPFile(load->path, *load->dest);
+    }, &pending);
 }
 
 /**
  * @brief 指定された複数の BMP 画像を連結し、スクロール表示用のキャッシュを作成する
  *
- * この関数は、複数の BMP 画像を連結し、メモリ上にキャッシュを作成する。
- * これにより、画像スクロール時に高速描画が可能になる。
+ * 2 回に分けて処理する。
+ * - 1 回目: 画像を読み込まずに各画像の幅を求め（`measureImage()`）、連結画像の大きさを決めて 1 回だけメモリを確保する
+ * - 2 回目: 各画像を連結画像の該当する列に直接展開する（画像ごとの一時バッファやコピーは使わない）
+ *   BMP ファイルの展開は `DecodePool` で 2 つのコアに分担し、すべての列がそろってから戻る
+ *
+ * 1 回目で大きさを求められなかった画像は連結しない。2 回目で読み込めなかった画像の列は黒で埋める。
  *
  * @param imagePaths 連結する画像のパスリスト（複数の BMP ファイルを結合）
  * @param createdBMP 連結画像のキャッシュデータ（BMPData 構造体に格納）
  */
 void cacheConcatenatedImages(const std::vector<String> &imagePaths, BMPData *createdBMP) {
+    TRACE_SCOPE("cacheConcatenatedImages");
+
+    // 0. 先読み済み（AssetCache）ならファイルを読まずにそのメモリを受け取る
+    if (assetCache.takeStrip(imagePaths, *createdBMP)) {
+        return;
+    }
+
     // 1. 既存のキャッシュを解放（メモリリーク防止）
     if (createdBMP->cache) {
         free(createdBMP->cache);
         createdBMP->cache = nullptr;
     }
+    createdBMP->scrollMicros = 0; // 読み込みにかかった時間はスクロール量に含めない
 
     // 2. 画像の総幅と高さを初期化
     createdBMP->width = 0;
     createdBMP->height = 0;
 
-    // 各画像のピクセルデータを一時保存するリスト
-    std::vector<uint16_t *> individualCaches; // 各画像のキャッシュ
-    std::vector<int> imageWidths; // 各画像の幅
-
-    // 3. 画像リスト内の各 BMP ファイルを順番に処理
+    // 3. 1 回目: 各画像の幅を求め、連結後の大きさを決める（ヘッダー・マニフェスト・フォントの文字幅のみ）
+    struct Segment {
+        const String *path; // 画像のパス
+        int width;          // 画像の幅
+        int x;              // 連結画像での左端の位置
+        BMPInfo info;       // BMP のヘッダー情報（2 回目でヘッダーを読み直さないよう保持）
+        bool decoded;       // 2 回目で展開できたか
+    };
+    std::vector<Segment> segments;
+    segments.reserve(imagePaths.size());
     for (const auto &path : imagePaths) {
-        // 3.1 BMPファイルを開く（LittleFS から）
-        File file = LittleFS.open(path, "r");
-        if (!file) {
-            Serial.printf("BMPファイル %s を開けませんでした。\n", path.c_str());
-            continue; // ファイルが開けなかったらスキップ
+        int imgWidth = 0, imgHeight = 0;
+        BMPInfo info;
+        bool measured;
+        if (BitmapFont::isTextAsset(path)) {
+            measured = bitmapFont.measureAsset(path, imgWidth, imgHeight);
+        } else {
+            measured = lookupBMPInfo(path, info);
+            imgWidth = info.width;
+            imgHeight = info.height;
         }
-
-        // 3.2 BMPヘッダー情報を取得
-        int imgWidth, imgHeight, pixelDataOffset;
-        bool isTopDown;
-        if (!parseBMPHeader(file, imgWidth, imgHeight, pixelDataOffset, isTopDown)) {
-            file.close();
-            continue; // ヘッダーが読めなかったらスキップ
+        if (!measured) {
+            Serial.printf("画像 %s を読み込めないため、連結しません。\n", path.c_str());
+            panelMetrics.countAssetLoad(false);
+            continue; // 開けない・無効な画像はスキップ
         }
 
-        // 3.3 最初の画像の高さを記録し、以降の画像と一致しているか確認
+        // 3.1 最初の画像の高さを記録し、以降の画像と一致しているか確認
         if (createdBMP->height == 0) {
             createdBMP->height = imgHeight;
         } else if (createdBMP->height != imgHeight) {
             Serial.println("画像の高さが一致しません。処理を中断します。");
-            for (auto &cache : individualCaches) {
-                free(cache); // メモリ解放
-            }
-            return;
-        }
-
-        // 3.4 BMPピクセルデータを格納するメモリ領域を確保
-        uint16_t *tempCache = (uint16_t *)malloc(imgWidth * imgHeight * sizeof(uint16_t));
-        if (!tempCache) {
-            Serial.println("メモリ確保に失敗しました。");
-            for (auto &cache : individualCaches) {
-                free(cache);
-            }
+            createdBMP->width = 0;
+            createdBMP->height = 0;
             return;
         }
-
-        // 3.5 BMPピクセルデータの開始位置へ移動
-        file.seek(pixelDataOffset, SeekSet);
-        int rowSize = (imgWidth * 3 + 3) & ~3; // 各行のバイト数（パディング含む）
-        uint8_t rowBuffer[rowSize];
-
-        // 3.6 BMP画像のピクセルデータを 1 行ずつ読み込み
-        for (int y = 0; y < imgHeight; y++) {
-            int rowIndex = isTopDown ? y : (imgHeight - 1 - y); // BMPが上下逆なら修正
-            file.read(rowBuffer, rowSize);
-
-            for (int x = 0; x < imgWidth; x++) {
-                uint8_t b = rowBuffer[x * 3];   // 青の値
-                uint8_t g = rowBuffer[x * 3 + 1]; // 緑の値
-                uint8_t r = rowBuffer[x * 3 + 2]; // 赤の値
-                tempCache[rowIndex * imgWidth + x] = matrix->color565(r, g, b); // RGB565へ変換
-            }
-        }
-
-        // 3.7 ファイルを閉じて、一時キャッシュに追加
-        file.close();
-        individualCaches.push_back(tempCache);
-        imageWidths.push_back(imgWidth);
+        segments.push_back({ &path, imgWidth, createdBMP->width, info, false });
         createdBMP->width += imgWidth; // 連結後の総幅を更新
     }
+    if (segments.empty()) {
+        createdBMP->height = 0;
+        return;
+    }
 
-    // 4. 連結画像のメモリを確保
-    createdBMP->cache = (uint16_t *)malloc(createdBMP->width * createdBMP->height * sizeof(uint16_t));
+    // 4. 連結画像のメモリを 1 回だけ確保
+    int stride = createdBMP->width;
+    createdBMP->cache = (uint16_t *)malloc((size_t)stride * createdBMP->height * sizeof(uint16_t));
     if (!createdBMP->cache) {
         Serial.println("連結キャッシュのメモリ確保に失敗しました。");
-        for (auto &cache : individualCaches) {
-            free(cache);
-        }
+        createdBMP->width = 0;
+        createdBMP->height = 0;
         return;
     }
 
-    // 5. 画像を横に連結（個々の画像データを1つのバッファにまとめる）
-    int offsetX = 0;
-    for (size_t i = 0; i < individualCaches.size(); i++) {
-        uint16_t *tempCache = individualCaches[i];
-        int imgWidth = imageWidths[i];
+    // 5. 2 回目: 各画像を連結画像の該当する列に直接展開する
+    // 5.1 文字列の指定（`text:...`）はフォントで直接書き込む（フォントは排他制御をしないため呼び出し元で）
+    std::vector<size_t> bmpSegments;
+    bmpSegments.reserve(segments.size());
+    for (size_t i = 0; i < segments.size(); i++) {
+        Segment &segment = segments[i];
+        if (!BitmapFont::isTextAsset(*segment.path)) {
+            bmpSegments.push_back(i);
+            continue;
+        }
+        TRACE_SCOPE("concatSegment", segment.path->c_str());
+        segment.decoded = bitmapFont.renderAssetInto(*segment.path, createdBMP->cache + segment.x, stride,
+                                                     segment.width, createdBMP->height);
+    }
 
-        for (int y = 0; y < createdBMP->height; y++) {
-            // 各行を連結バッファにコピー（画像の一部を横に配置）
-            memcpy(&createdBMP->cache[y * createdBMP->width + offsetX],
-                   &tempCache[y * imgWidth],
-                   imgWidth * sizeof(uint16_t));
+    // 5.2 BMP ファイルはワーカーと分担して展開する（画像ごとに担当する列が重ならないため、同じメモリに書き込める）
+    struct ConcatJob {
+        std::vector<Segment> *segments;
+        const std::vector<size_t> *indices;
+        BMPData *strip;
+    } concatJob = { &segments, &bmpSegments, createdBMP };
+    decodePool.run(bmpSegments.size(), [](size_t index, void *context) {
+        ConcatJob *job = static_cast<ConcatJob *>(context);
+        Segment &segment = (*job->segments)[(*job->indices)[index]];
+        const String &path = *segment.path;
+        TRACE_SCOPE("concatSegment", path.c_str());
+
+        // 1 回目と同じ大きさなら RGB565 に変換しながら展開する
+        // （ファイルサイズが 1 回目の情報と異なる場合のみ、差し替えられたとみなしてヘッダーを読み直す）
+        BMPInfo info = segment.info;
+        File file = LittleFS.open(path, "r");
+        if (!file) {
+            Serial.printf("BMPファイル %s を開けませんでした。\n", path.c_str());
+            return;
+        }
+        bool valid = file.size() == info.fileSize || readBMPInfo(file, info);
+        if (valid && info.width == segment.width && info.height == job->strip->height) {
+            segment.decoded = decodeBMPToBuffer(file, info, job->strip->cache, job->strip->width, segment.x);
+        } else {
+            Serial.printf("BMPファイル %s の大きさが変わっています。\n", path.c_str());
         }
+        file.close();
+    }, &concatJob);
 
-        offsetX += imgWidth; // 次の画像の開始位置を調整
-        free(tempCache); // 一時キャッシュを解放
+    // 5.3 読み込めなかった画像の列は黒で埋める（幅は 1 回目で決めたまま）
+    for (const Segment &segment : segments) {
+        if (!segment.decoded) {
+            for (int y = 0; y < createdBMP->height; y++) {
+                memset(createdBMP->cache + (size_t)y * stride + segment.x, 0, segment.width * sizeof(uint16_t));
+            }
+        }
+        panelMetrics.countAssetLoad(segment.decoded);
     }
 
     Serial.println("画像の連結キャッシュが完成しました！");
@@ -272,56 +433,46 @@ void cacheConcatenatedImages(const std::vector<String> &imagePaths, BMPData *cre
  * @param targetCanvas 描画先のキャンバス（NULL の場合は直接 LED パネルへ描画）
  */
 void drawBMP(const String &filename, int startX, int startY, GFXcanvas16 *targetCanvas) {
-    // 1. BMPファイルを開く
-    File file = LittleFS.open(filename, "r");
-    if (!file) {
-        Serial.printf("BMPファイル %s を開けませんでした。\n", filename.c_str());
+    TRACE_SCOPE("drawBMP", filename.c_str());
+
+    // 0. 文字列の指定（`text:...`）は一時的に画像にして描画する
+    if (BitmapFont::isTextAsset(filename)) {
+        BMPData text;
+        if (bitmapFont.renderAsset(filename, text)) {
+            drawBMPFromCache(&text, startX, startY, targetCanvas);
+        }
+        free(text.cache);
         return;
     }
 
-    // 2. BMP ヘッダー情報を取得
-    int imgWidth, imgHeight, pixelDataOffset;
-    bool isTopDown;
-    if (!parseBMPHeader(file, imgWidth, imgHeight, pixelDataOffset, isTopDown)) {
-        file.close();
+    // 1. BMPファイルを開き、ヘッダー情報を取得（マニフェストがあれば解析を省略）
+    File file;
+    BMPInfo info;
+    if (!openBMPAsset(filename, file, info)) {
         return;
     }
 
-    // 3. ピクセルデータの開始位置に移動
-    file.seek(pixelDataOffset, SeekSet);
-
-    // 4. 1 行のサイズ（パディング含む）
-    int rowSize = (imgWidth * 3 + 3) & ~3; // BMP の 1 行あたりのデータサイズ（24bit カラー + パディング）
-    uint8_t rowBuffer[rowSize]; // 行データを一時的に格納するバッファ
-
-    // 5. 画像データを 1 行ずつ読み込んで描画
-    for (int y = 0; y < imgHeight; y++) {
-        int rowIndex = isTopDown ? y : (imgHeight - 1 - y); // BMP の並び順に応じて Y 座標を調整
-        file.read(rowBuffer, rowSize); // 1 行分のデータを読み込む
-
-        // 5.1 1 ピクセルずつ処理して描画
-        for (int x = 0; x < imgWidth; x++) {
-            uint8_t b = rowBuffer[x * 3];   // 青 (Blue)
-            uint8_t g = rowBuffer[x * 3 + 1]; // 緑 (Green)
-            uint8_t r = rowBuffer[x * 3 + 2]; // 赤 (Red)
-
-            uint16_t color = matrix->color565(r, g, b); // RGB888 を RGB565 に変換
-
-            if (targetCanvas) {
-                // 5.2 キャンバスが指定されている場合はキャンバスに描画
-                targetCanvas->drawPixel(startX + x, startY + rowIndex, color);
-            } else {
-                // 5.3 キャンバスがない場合は LED パネルに直接描画
-                int drawX = startX + x;
-                int drawY = startY + rowIndex;
-                if (drawX >= 0 && drawX < panelWidth && drawY >= 0 && drawY < panelHeight) {
-                    matrix->drawPixel(drawX, drawY, color);
-                }
-            }
+    // 2. 描画先の情報をまとめる
+    struct DrawTarget {
+        int startX;
+        int startY;
+        int width;
+        GFXcanvas16 *canvas;
+    } target = { startX, startY, info.width, targetCanvas };
+
+    // 3. 画像データを 1 行ずつ変換して描画
+    decodeBMP(file, info, [](int y, const uint16_t *row, void *context) {
+        const DrawTarget *t = (const DrawTarget *)context;
+        if (t->canvas) {
+            // 3.1 キャンバスが指定されている場合はキャンバスに描画
+            PanelGeometry::blitSpanToCanvas(t->canvas, t->startX, t->startY + y, row, t->width);
+        } else {
+            // 3.2 キャンバスがない場合は LED パネルに直接描画
+            panelGeometry.blitSpan(matrix, t->startX, t->startY + y, row, t->width);
         }
-    }
+    }, &target);
 
-    // 6. ファイルを閉じる
+    // 4. ファイルを閉じる
     file.close();
 }
 
@@ -349,80 +500,108 @@ void drawBMPFromCache(const BMPData *bmpData, int startX, int startY, GFXcanvas1
                       startX, startY, bmpData->width, bmpData->height);
     #endif
 
-    // 3. キャッシュからピクセルデータを読み取り、パネルに描画
+    // 3. キャッシュから 1 行ずつピクセルデータを読み取り、パネルに描画
     for (int y = 0; y < bmpData->height; y++) {
-        for (int x = 0; x < bmpData->width; x++) {
-            uint16_t color = bmpData->cache[y * bmpData->width + x]; // キャッシュからピクセルカラーを取得
-            if (targetCanvas) {
-                // 3.1 キャンバスが指定されている場合はキャンバスに描画
-                targetCanvas->drawPixel(startX + x, startY + y, color);
-            } else {
-                // 3.2 キャンバスがない場合は LED パネルに直接描画
-                int drawX = startX + x;
-                int drawY = startY + y;
-                if (drawX >= 0 && drawX < panelWidth && drawY >= 0 && drawY < panelHeight) {
-                    matrix->drawPixel(drawX, drawY, color);
-                }
-            }
+        const uint16_t *row = bmpData->cache + y * bmpData->width;
+        if (targetCanvas) {
+            // 3.1 キャンバスが指定されている場合はキャンバスに描画
+            PanelGeometry::blitSpanToCanvas(targetCanvas, startX, startY + y, row, bmpData->width);
+        } else {
+            // 3.2 キャンバスがない場合は LED パネルに直接描画
+            panelGeometry.blitSpan(matrix, startX, startY + y, row, bmpData->width);
         }
     }
+}
 
+/**
+ * @brief 経過時間からスクロール位置を進める（`updateScroll()` と `ScrollStrip` で共用）
+ *
+ * 速度 [ミリピクセル/秒] × 経過時間 [マイクロ秒] を積算し、1 ピクセル以上たまった分だけ位置を進める。
+ * 位置が `width` を越えたら先頭に戻し、`flg_scrollEnd` をセットする。
+ *
+ * @param offsetX スクロール位置（0 ～ width - 1）
+ * @param scrollAccum 1 ピクセル未満のスクロール量
+ * @param scrollMicros 最後にスクロール量を計算した時刻（0: 未開始）
+ * @param width 1 周の幅（ピクセル）
+ * @param scrollSpeed スクロールの速度（ピクセル/秒、1 未満も可）
+ * @return 描画し直す必要がある場合 true（開始直後、または 1 ピクセル以上進んだ場合）
+ */
+bool advanceScroll(int &offsetX, uint64_t &scrollAccum, unsigned long &scrollMicros, int width, float scrollSpeed) {
+    unsigned long currentMicros = micros();
+    bool redraw = false;
+    if (scrollMicros == 0) {
+        // 開始直後（画像の読み込み直後）は現在の位置で描画し、ここから時間を計る
+        scrollAccum = 0;
+        offsetX %= width;
+        redraw = true;
+    } else {
+        uint32_t speed = (uint32_t)(max(scrollSpeed, 0.0f) * 1000.0f + 0.5f);
+        scrollAccum += (uint64_t)speed * (currentMicros - scrollMicros);
+
+        // 1 ピクセル以上たまった分だけ位置を進める（末尾を越えたら先頭に戻る）
+        if (scrollAccum >= SCROLL_SUBPIXEL_ONE) {
+            uint64_t pixels = scrollAccum / SCROLL_SUBPIXEL_ONE;
+            scrollAccum -= pixels * SCROLL_SUBPIXEL_ONE;
+            uint64_t position = (uint64_t)offsetX + pixels;
+            flg_scrollEnd = position >= (uint64_t)width; // 1 周したらスクロール終了フラグをセット
+            offsetX = position % width;
+            redraw = true;
+        }
+    }
+    scrollMicros = currentMicros ? currentMicros : 1; // 0 は未開始を表すため避ける
+    return redraw;
 }
 
 /**
  * @brief 画像をスクロール表示する関数（非ブロッキング処理）
  *
  * キャッシュされた BMP 画像をスクロールさせながら描画する。
- * 一定時間ごとにスクロールを更新することで、滑らかなアニメーションを実現する。
+ * スクロール位置は前回からの経過時間と速度から求める（1 ピクセル未満の端数は固定小数点で繰り越す）。
+ * 描画ループが遅れた場合は遅れた分だけまとめて進むため、見かけの速度は一定に保たれる。
+ * 位置が 1 ピクセル以上変わった場合のみ描画する。
  *
- * @param conCache スクロール表示する BMP データのキャッシュ（BMPData 構造体）
+ * @param conCache スクロール表示する BMP データのキャッシュ（BMPData 構造体、スクロール位置も保持）
  * @param start_x 描画開始 X 座標（スクロール領域の左上の位置）
  * @param start_y 描画開始 Y 座標
  * @param area_width スクロールエリアの幅（描画する範囲）
  * @param area_height スクロールエリアの高さ
- * @param scrollInterval スクロールの更新間隔（ミリ秒単位）
+ * @param scrollSpeed スクロールの速度（ピクセル/秒、1 未満も可）
  */
-void updateScroll(BMPData *conCache, int start_x, int start_y, int area_width, int area_height, int scrollInterval) {
-    static unsigned long previousScrollMillis = 0;  // スクロールの更新時間
+void updateScroll(BMPData *conCache, int start_x, int start_y, int area_width, int area_height, float scrollSpeed) {
     // 1. キャッシュデータが存在するか確認
-    if (!conCache->cache) {
+    if (!conCache->cache || conCache->width <= 0) {
         Serial.println("連結キャッシュが存在しません！");
         return;
     }
+    activeScene.scroll = conCache;
+    activeScene.scrollX = start_x;
+    activeScene.scrollY = start_y;
+    activeScene.scrollWidth = area_width;
+    activeScene.scrollHeight = area_height;
+    activeScene.scrollSpeed = scrollSpeed;
 
-    // 2. スクロール更新処理（一定時間ごとに実行）
-    unsigned long currentMillis = millis();
-    if (currentMillis - previousScrollMillis >= scrollInterval) {
-        previousScrollMillis = currentMillis;
+    // 2. 経過時間からスクロール量を計算
+    bool redraw = advanceScroll(conCache->offsetX, conCache->scrollAccum, conCache->scrollMicros,
+                                conCache->width, scrollSpeed);
+
+    if (redraw) {
+        TRACE_SCOPE("scrollTick");
 
         // 3. スクロール範囲内のピクセルを更新
         for (int y = 0; y < area_height; y++) {
-            int cacheY = (y + start_y) % conCache->height; // 縦方向のスクロール位置を計算
-
-            for (int x = 0; x < area_width; x++) {
-                int cacheX = (x + conCache->offsetX) % conCache->width; // 横方向のスクロール位置を計算
-                uint16_t color = conCache->cache[cacheY * conCache->width + cacheX]; // キャッシュからピクセルデータ取得
-
-                int drawX = start_x + x;
-                int drawY = start_y + y;
-
-                // 4. 描画範囲がディスプレイ内であることを確認して描画
-                if (drawX >= 0 && drawX < panelWidth && drawY >= 0 && drawY < panelHeight) {
-                    matrix->drawPixel(drawX, drawY, color);
-                }
+            int cacheY = y % conCache->height; // 縦方向のスクロール位置を計算
+            const uint16_t *cacheRow = conCache->cache + cacheY * conCache->width;
+
+            // 4. 画像の末尾で折り返し、連続した区間ごとに描画（範囲外は blitSpan で切り捨て）
+            int drawn = 0;
+            int cacheX = conCache->offsetX; // 横方向のスクロール位置
+            while (drawn < area_width) {
+                int run = min(area_width - drawn, conCache->width - cacheX);
+                panelGeometry.blitSpan(matrix, start_x + drawn, start_y + y, cacheRow + cacheX, run);
+                drawn += run;
+                cacheX = 0;
             }
         }
-
-        // 5. スクロール位置を更新（1 ピクセルずつ右に移動）
-        conCache->offsetX++;
-
-        // 6. スクロールが 1 周したらリセット
-        if (conCache->offsetX >= conCache->width) {
-            conCache->offsetX = 0;
-            flg_scrollEnd = true; // スクロール終了フラグをセット
-        } else {
-            flg_scrollEnd = false;
-        }
     }
 }
 
@@ -441,9 +620,11 @@ void toggleBMP(std::vector<ToggleBMPPart> &parts, unsigned long interval, int wi
     // 1. 現在の時間を取得
     unsigned long currentMillis = millis();
 
-    // 2. 指定間隔が経過しているかチェック
-    if (currentMillis - previousToggleMillis >= interval) {
+    // 2. 指定間隔が経過しているかチェック（フレームの予算に収まらない場合は次のフレームに回す）
+    if (currentMillis - previousToggleMillis >= interval && frameGovernor.admit(FRAME_WORK_TOGGLE)) {
         previousToggleMillis = currentMillis; // 最後の切り替え時間を更新
+        TRACE_SCOPE("toggleFlip");
+        FrameWorkTimer timer(FRAME_WORK_TOGGLE);
         toggleState = !toggleState; // トグル状態を変更
 
         // 3. 各 BMP パーツの画像を描画
@@ -466,12 +647,17 @@ void toggleBMP(std::vector<ToggleBMPPart> &parts, unsigned long interval, int wi
  * - `numImages` に応じて画像をローテーション
  * - `numImages <= 0` の場合、処理を中止
  * - 画像が足りない場合は描画内容を変更せず、その部分は維持
+ * - `phaseHook` を指定した場合は、各段階を描画する直前に呼んで画像を用意させる
+ *   （画像をすべてメモリに置かない表示内容のため、まだ読み込まれていない画像は描画しない）
  *
  * @param parts 切り替え対象の BMP データ（複数の `ToggleCacheBMPPart` を管理）
  * @param numImages 使用する BMP 画像の数（リスト内の最大値を超えない範囲で適用）
  * @param interval 画像の切り替え間隔（ミリ秒単位）
+ * @param phaseHook 段階の画像を用意する関数（省略時はすべての画像がメモリにあるものとする）
+ * @param phaseContext `phaseHook` に渡す値
  */
-void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsigned long interval) {
+void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsigned long interval,
+                    TogglePhaseHook phaseHook, void *phaseContext) {
     static unsigned long previousToggleMillis = 0;
     static int currentImageIndex = 0; // 全体で統一する画像インデックス
 
@@ -482,6 +668,16 @@ void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsig
         #endif
         return;
     }
+    // 表示内容を切り替えた直後（`activeScene` を消去した後）は、最初の段階をすぐに描画する
+    bool firstDraw = activeScene.parts == nullptr;
+    if (firstDraw) {
+        currentImageIndex = 0;
+    }
+    activeScene.parts = &parts;
+    activeScene.numImages = numImages;
+    activeScene.toggleInterval = interval;
+    activeScene.phaseHook = phaseHook;
+    activeScene.phaseContext = phaseContext;
 
     // 2. 現在の時間を取得
     unsigned long currentMillis = millis();
@@ -491,9 +687,17 @@ void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsig
                       parts.size(), numImages, currentImageIndex);
     #endif
 
-    // 3. 指定間隔が経過したかチェック
-    if (currentMillis - previousToggleMillis >= interval) {
+    // 3. 指定間隔が経過したかチェック（フレームの予算に収まらない場合は次のフレームに回す）
+    //    切り替え直後の最初の段階は、前の表示内容を残さないよう予算によらず描画する
+    if (firstDraw || (currentMillis - previousToggleMillis >= interval && frameGovernor.admit(FRAME_WORK_TOGGLE))) {
         previousToggleMillis = currentMillis; // 最後の切り替え時間を更新
+        TRACE_SCOPE("toggleFlip");
+        FrameWorkTimer timer(FRAME_WORK_TOGGLE);
+        int phase = currentImageIndex % numImages;
+        activeScene.phase = phase;
+        if (phaseHook != nullptr) {
+            phaseHook(phase, phaseContext); // 表示する段階の画像を用意させる
+        }
 
         // 4. 各 BMP パーツの描画
         for (size_t i = 0; i < parts.size(); i++) {
@@ -517,21 +721,21 @@ void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsig
             }
 
             // 画像を選択
-            const BMPData *image = part.bmpList[currentImageIndex % numImages];
+            const BMPData *image = part.bmpList[phase];
 
             // 5. デバッグメッセージ
             #ifdef DEBUG
-                if (image == nullptr) {
+                if (image == nullptr || image->cache == nullptr) {
                     Serial.printf("Part %d: image is null! Keeping previous display.\n", (int)i);
                 } else {
                     Serial.printf("Part %d: Displaying image %d at (%d, %d)\n",
-                                  (int)i, currentImageIndex % numImages, part.startX, part.startY);
+                                  (int)i, phase, part.startX, part.startY);
                 }
             #endif
 
-            // 6. 画像を描画
+            // 6. 画像を描画（切り替え効果がある場合は以降の transitions.update() で少しずつ描画）
             if (image != nullptr) {
-                drawBMPFromCache(image, part.startX, part.startY);
+                transitions.start(part.startX, part.startY, image, part.transition);
             }
         }
 
@@ -550,11 +754,10 @@ void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsig
  * @param height LED パネルの高さ
  */
 void drawPixelfromCanvas(GFXcanvas16 &canvas, int width, int height) {
-    // 1. キャンバス内のすべてのピクセルを LED パネルへ転送
-    for (int16_t y = 0; y < height; y++) {
-        for (int16_t x = 0; x < width; x++) {
-            uint16_t color = canvas.getPixel(x, y); // 1 ピクセルの色を取得
-            matrix->drawPixel(x, y, color);        // LED パネルに描画
-        }
+    // 1. キャンバスのバッファを 1 行ずつ LED パネルへ転送
+    int rowWidth = min(width, (int)canvas.width());
+    int rowCount = min(height, (int)canvas.height());
+    for (int y = 0; y < rowCount; y++) {
+        panelGeometry.blitSpan(matrix, 0, y, canvas.getBuffer() + y * canvas.width(), rowWidth);
     }
 }
@@ -19,6 +19,7 @@
 // ===============================
 #include "LittleFS.h"  // ESP32 の LittleFS を使用するためのライブラリ
 #include <ESP32-HUB75-MatrixPanel-I2S-DMA.h> // HUB75 LED パネル制御ライブラリ
+#include "Transition.h" // 表示の切り替え効果
 
 //#define DEBUG  // デバッグモードを有効にする場合はコメントを解除
 
@@ -26,8 +27,8 @@
 //      外部で初期化される LED マトリクスパネルのインスタンスとサイズ
 // ===============================
 extern MatrixPanel_I2S_DMA *matrix; // LED パネルのインスタンス
-extern const int panelWidth;  // パネルの横幅（ピクセル単位）
-extern const int panelHeight; // パネルの縦幅（ピクセル単位）
+extern int panelWidth;  // パネルの横幅（ピクセル単位、起動時にパネル設定から決定）
+extern int panelHeight; // パネルの縦幅（ピクセル単位、起動時にパネル設定から決定）
 
 // ===============================
 //      表示の更新間隔（ミリ秒単位）
@@ -40,7 +41,6 @@ extern const int panelHeight; // パネルの縦幅（ピクセル単位）
 // ===============================
 extern bool toggleState;     // トグル表示の状態（true: 表示1, false: 表示2）
 extern bool flg_scrollEnd; // スクロールが終了したかどうかのフラグ（true: 終了）
-extern bool toggleLangState; // 言語切り替えフラグ（true: 日本語, false: 英語）
 
 // ===============================
 //      時間管理用変数（更新タイミング管理）
@@ -48,6 +48,8 @@ extern bool toggleLangState; // 言語切り替えフラグ（true: 日本語, f
 extern unsigned long previousToggleMillis; // 最後にトグルした時間
 extern unsigned long previousScrollMillis; // 最後にスクロールを更新した時間
 
+#define SCROLL_SUBPIXEL_ONE 1000000000ULL // スクロール量 1 ピクセル分（速度 [ミリピクセル/秒] × 経過時間 [マイクロ秒]）
+
 // ===============================
 //      BMP データ構造体定義
 // ===============================
@@ -62,6 +64,9 @@ struct BMPData {
     int width = 0;  // 画像の横幅（ピクセル単位）
     int height = 0; // 画像の縦幅（ピクセル単位）
     int offsetX = 0; // 画像のオフセット（スクロールの際に使用）
+    uint64_t scrollAccum = 0;       // 1 ピクセル未満のスクロール量（SCROLL_SUBPIXEL_ONE で 1 ピクセル）
+    unsigned long scrollMicros = 0; // 最後にスクロール量を計算した時刻（0: 未開始、次の呼び出しで描画）
+    uint32_t generation = 0;        // 作成元の CSV の行の世代（CSVReader::rowGeneration、変われば作り直す）
 };
 
 /**
@@ -86,11 +91,13 @@ struct ToggleBMPPart {
  * - `bmpList` に **任意の数の画像データを格納可能**
  * - `startX`, `startY` は **描画位置**
  * - 使用する画像の枚数は **外部で管理（関数の引数で指定）**
+ * - `transition` は **切り替え効果**（既定は即座に切り替え）
  */
 struct ToggleCacheBMPPart {
     std::vector<BMPData*> bmpList;  ///< 格納する BMP データのリスト（何枚でも可）
     int startX;                             ///< 描画開始 X 座標
     int startY;                             ///< 描画開始 Y 座標
+    TransitionStyle transition;             ///< 切り替え効果
 
     /**
      * @brief コンストラクタ（複数画像対応）
@@ -100,11 +107,46 @@ struct ToggleCacheBMPPart {
      * @param images 初期化時に格納する BMP データのリスト（可変長）
      * @param x 描画開始 X 座標
      * @param y 描画開始 Y 座標
+     * @param style 切り替え効果（省略時は即座に切り替え）
      */
-    ToggleCacheBMPPart(std::vector<BMPData *> images, int x, int y)
-        : bmpList(images), startX(x), startY(y) {}
+    ToggleCacheBMPPart(std::vector<BMPData *> images, int x, int y, const TransitionStyle &style = TransitionStyle())
+        : bmpList(images), startX(x), startY(y), transition(style) {}
 };
 
+/**
+ * @brief トグルの段階を表示する直前に、その段階の画像を用意する関数
+ *
+ * 画像をすべてメモリに置かない表示内容（3 言語以上の切り替えなど）が、
+ * 表示する段階の画像を読み込み、不要になった画像を破棄するために使う。
+ *
+ * @param phase 表示する段階（`bmpList` の添字）
+ * @param context `toggleCacheBMP()` に渡した値
+ */
+typedef void (*TogglePhaseHook)(int phase, void *context);
+
+/**
+ * @brief 表示中のトグル / スクロールの内容（シーンのプリセット保存用）
+ *
+ * `toggleCacheBMP()` と `updateScroll()` が呼ばれるたびに記録する。
+ * 表示内容が切り替わったときは呼び出し側で `ActiveScene()` を代入して消去する。
+ */
+struct ActiveScene {
+    const std::vector<ToggleCacheBMPPart> *parts = nullptr; ///< トグル表示の部品（無い場合は nullptr）
+    int numImages = 0;                ///< トグルの段階数
+    unsigned long toggleInterval = 0; ///< トグルの切り替え間隔（ミリ秒）
+    int phase = 0;                    ///< 表示中のトグルの段階
+    TogglePhaseHook phaseHook = nullptr; ///< 段階の画像を用意する関数（無い場合は nullptr、すべての画像がメモリにある）
+    void *phaseContext = nullptr;     ///< `phaseHook` に渡す値
+    const BMPData *scroll = nullptr;  ///< スクロール中の連結画像（無い場合は nullptr）
+    int scrollX = 0;                  ///< スクロール領域の X 座標
+    int scrollY = 0;                  ///< スクロール領域の Y 座標
+    int scrollWidth = 0;              ///< スクロール領域の幅
+    int scrollHeight = 0;             ///< スクロール領域の高さ
+    float scrollSpeed = 0;            ///< スクロールの速度（ピクセル/秒）
+    bool scrollPaged = false;         ///< 複数ページに分けた連結画像をスクロール中（`scroll` は nullptr）
+};
+extern ActiveScene activeScene;
+
 // ===============================
 //      連結画像のキャッシュ（スクロール用）
 // ===============================
@@ -121,6 +163,7 @@ extern int concatenatedHeight;
  *
  * BMP ファイルのヘッダーを読み取り、画像の幅・高さ・ピクセルデータの開始位置を取得する。
  * また、BMP のデータが上下逆（Bottom-Up）かどうかも判定する。
+ * 色深度・圧縮形式などの検証は `readBMPInfo()`（AssetManifest.h）で行う。
  *
  * @param file BMPファイルの参照（LittleFS から開いたファイルオブジェクト）
  * @param imgWidth 読み取った画像の幅（ピクセル単位）
@@ -131,6 +174,16 @@ extern int concatenatedHeight;
  */
 bool parseBMPHeader(File &file, int &imgWidth, int &imgHeight, int &pixelDataOffset, bool &isTopDown);
 
+/**
+ * @brief 画像を読み込まずに大きさだけを求める（マニフェスト・ヘッダー・フォントの文字幅から）
+ *
+ * @param path 画像のパス（または文字列の指定）
+ * @param width 画像の幅
+ * @param height 画像の高さ
+ * @return 求められた場合 true（存在しない・無効な画像は false）
+ */
+bool measureImage(const String &path, int &width, int &height);
+
 /**
  * @brief BMP画像をメモリにキャッシュして、高速描画を可能にする
  *
@@ -142,16 +195,29 @@ bool parseBMPHeader(File &file, int &imgWidth, int &imgHeight, int &pixelDataOff
 void cacheBMPData(const String &bitmapFilePath, BMPData &bmpData);
 
 /**
- * @brief 一定時間ごとに言語（日本語 / 英語）を切り替える
- * @param interval 設定された時間間隔（ミリ秒単位）
+ * @brief `cacheBMPDataBatch()` で読み込む画像 1 枚分
+ */
+struct BMPLoad {
+    String path;   // 画像のパス（または文字列の指定）
+    BMPData *dest; // 格納先
+};
+
+/**
+ * @brief 複数の画像をまとめてキャッシュする（BMP ファイルの展開は 2 つのコアで分担する）
+ *
+ * `cacheBMPData()` を順に呼んだ場合と同じ結果になるが、すべての画像がそろってから戻る。
+ * 各画像の `generation` は変更しない（呼び出し側が読み込みの前に設定してよい）。
+ *
+ * @param loads 読み込む画像と格納先の一覧
  */
-void toggleLanguage(unsigned long interval);
+void cacheBMPDataBatch(const std::vector<BMPLoad> &loads);
 
 /**
  * @brief 指定された複数の BMP 画像を連結し、スクロール表示用のキャッシュを作成する
  *
  * この関数は、複数の BMP 画像を連結し、メモリ上にキャッシュを作成する。
  * これにより、画像スクロール時に高速描画が可能になる。
+ * 先に各画像の幅だけを求めてメモリを 1 回で確保し、各画像はその列に直接展開する。
  *
  * @param imagePaths 連結する画像のパスリスト（複数の BMP ファイルを結合）
  * @param createdBMP 連結画像のキャッシュデータ（BMPData 構造体に格納）
@@ -184,20 +250,32 @@ void drawBMP(const String &filename, int startX, int startY, GFXcanvas16 *target
  */
 void drawBMPFromCache(const BMPData *bmpData, int startX, int startY, GFXcanvas16 *targetCanvas = nullptr);
 
+/**
+ * @brief 経過時間からスクロール位置を進める（`updateScroll()` と `ScrollStrip` で共用）
+ *
+ * @param offsetX スクロール位置（0 ～ width - 1）
+ * @param scrollAccum 1 ピクセル未満のスクロール量
+ * @param scrollMicros 最後にスクロール量を計算した時刻（0: 未開始）
+ * @param width 1 周の幅（ピクセル）
+ * @param scrollSpeed スクロールの速度（ピクセル/秒、1 未満も可）
+ * @return 描画し直す必要がある場合 true
+ */
+bool advanceScroll(int &offsetX, uint64_t &scrollAccum, unsigned long &scrollMicros, int width, float scrollSpeed);
+
 /**
  * @brief 画像をスクロール表示する関数（非ブロッキング処理）
  *
  * キャッシュされた BMP 画像をスクロールさせながら描画する。
- * 一定時間ごとにスクロールを更新することで、滑らかなアニメーションを実現する。
+ * スクロール位置は前回からの経過時間と速度から求めるため、描画ループが遅れても速度は一定に保たれる。
  *
- * @param conCache スクロール表示する BMP データのキャッシュ（BMPData 構造体）
+ * @param conCache スクロール表示する BMP データのキャッシュ（BMPData 構造体、スクロール位置も保持）
  * @param start_x 描画開始 X 座標（スクロール領域の左上の位置）
  * @param start_y 描画開始 Y 座標
  * @param area_width スクロールエリアの幅（描画する範囲）
  * @param area_height スクロールエリアの高さ
- * @param scrollInterval スクロールの更新間隔（ミリ秒単位）
+ * @param scrollSpeed スクロールの速度（ピクセル/秒、1 未満も可）
  */
-void updateScroll(BMPData *conCache, int start_x, int start_y, int area_width, int area_height, int scrollInterval);
+void updateScroll(BMPData *conCache, int start_x, int start_y, int area_width, int area_height, float scrollSpeed);
 
 /**
  * @brief 表示を一定間隔で切り替える関数（BMP のトグル表示）
@@ -220,12 +298,16 @@ void toggleBMP(std::vector<ToggleBMPPart> &parts, unsigned long interval, int wi
  * - `numImages` に応じて画像をローテーション
  * - `numImages <= 0` の場合、処理を中止
  * - 画像が足りない場合は描画内容を変更せず、その部分は維持
+ * - `phaseHook` を指定した場合は、各段階を描画する直前に呼んで画像を用意させる
  *
  * @param parts 切り替え対象の BMP データ（複数の `ToggleCacheBMPPart` を管理）
  * @param numImages 使用する BMP 画像の数（リスト内の最大値を超えない範囲で適用）
  * @param interval 画像の切り替え間隔（ミリ秒単位）
+ * @param phaseHook 段階の画像を用意する関数（省略時はすべての画像がメモリにあるものとする）
+ * @param phaseContext `phaseHook` に渡す値
  */
-void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsigned long interval);
+void toggleCacheBMP(std::vector<ToggleCacheBMPPart> &parts, int numImages, unsigned long interval,
+                    TogglePhaseHook phaseHook = nullptr, void *phaseContext = nullptr);
 
 /**
  * @brief キャンバスから LED パネルにピクセルデータを転送する
@@ -20,6 +20,23 @@
 #include "LittleFS.h"      // 小型ファイルシステム（LittleFS）のライブラリ
 #include "CSVReader.h"     // CSV データを読み取るカスタムクラス
 #include "drawBitmap.h"    // BMP 画像描画関連のカスタムライブラリ
+#include "AssetManifest.h" // 画像ヘッダーの事前検証（マニフェスト）
+#include "Metrics.h"       // 動作状況の計測（/metrics 用）
+#include "TraceBuffer.h"   // 処理のトレース記録（/trace 用）
+#include "PanelGeometry.h" // パネル構成（解像度・枚数・配線）と表示位置
+#include "Timetable.h"     // 時刻表の再生
+#include "AssetCache.h"    // 次の表示内容の画像の先読み
+#include "ScenePreset.h"   // 合成済みの表示内容（プリセット）の保存と呼び出し
+#include "BitmapFont.h"    // 文字列の表示（ビットマップフォント）
+#include "AssetUpload.h"   // 画像・CSV のアップロード（/upload）
+#include "BootState.h"     // 表示状態とフレームの保存・起動時の復元
+#include "RouteGraph.h"    // 路線図（路線・駅の並び・直通）
+#include "ScrollStrip.h"   // 停車駅スクロールのページ分割
+#include "DecodePool.h"    // 画像の展開を 2 つのコアで分担
+#include "SceneBuilder.h"  // 表示内容（Mode 2 / 3）のまとめての作成と差し替え
+#include "FrameStream.h"   // 表示中のフレームの配信（/frame）
+#include "FrameGovernor.h" // フレームの予算とトグル・先読みの後回し
+#include "SerialCommand.h" // UART からのバイナリコマンド
 
 //#define DEBUG  // デバッグモードを有効にする場合はコメントを解除
 
@@ -48,14 +65,15 @@ MatrixPanel_I2S_DMA *matrix;
  * - 64×32ピクセルのパネルを **横に2枚** 連結し、全体で **128×32ピクセル** のディスプレイとして使用する
  * - `PANEL_BRIGHTNESS = 128` なら、最大輝度（255）の約50%で動作
  *
- * @note 設定を変更した場合、マトリクス制御ライブラリの初期化処理も適切に調整する必要がある。
+ * これらは `/config/panel.csv` が無い場合の既定値。設定ファイルがあれば起動時にその内容で上書きする
+ * （パネル枚数・段数・配線方式・表示位置を変更できる。詳細は Readme を参照）。
  */
 #define PANEL_RES_X 64
 #define PANEL_RES_Y 32
 #define PANEL_CHAIN 2    // チェイン接続されたパネルの総数
 #define PANEL_BRIGHTNESS 128 // 輝度の設定（0～255）
-const int panelWidth = PANEL_RES_X * PANEL_CHAIN;  // 全体の横幅
-const int panelHeight = PANEL_RES_Y;               // 全体の縦幅
+int panelWidth = PANEL_RES_X * PANEL_CHAIN;  // 全体の横幅（起動時にパネル設定から決定）
+int panelHeight = PANEL_RES_Y;               // 全体の縦幅（起動時にパネル設定から決定）
 
 // ===============================
 //          CSVファイル設定
@@ -93,6 +111,7 @@ CSVReader nextReader(nextListPath);
  * 1: 種別 + 行先 (俗に言う始発表示)
  * 2: 種別 + 行先 + 次駅
  * 3: 停車駅スクロール
+ * 4: プリセット（保存した表示内容をそのまま表示、/preset で呼び出す）
  */
 unsigned short mode = 0;
 
@@ -120,8 +139,17 @@ unsigned short num_next = 1;  // 次駅データ
  *
  * `GFXcanvas16` を使用して、LED パネルに直接描画するのではなく、
  * 一度キャンバスに描画してから表示することで、スムーズな更新を実現する。
+ * パネル全体の大きさは起動時に決まるため、`initPanel()` で作成する。
  */
-GFXcanvas16 canvas(PANEL_RES_X * PANEL_CHAIN, PANEL_RES_Y);
+GFXcanvas16 *canvas = nullptr;
+
+/**
+ * @brief LED パネルに表示中の内容の写し（RGB565、パネル全体の大きさ）
+ *
+ * 描画のたびに `PanelGeometry::blitSpan()` が同じ内容を書き込む。
+ * プリセットの保存時に、表示中の内容を読み出すために使う。
+ */
+uint16_t *frameMirror = nullptr;
 
 // ===============================
 //         Webサーバー設定
@@ -149,6 +177,42 @@ WebServer server(80);  // ポート 80 で Web サーバーを開始
 TaskHandle_t TaskPanel;  // LED パネル制御タスク
 TaskHandle_t TaskServer; // Web サーバータスク
 
+#define TASK_STACK_SIZE 4096 // 各タスクのスタックサイズ（バイト）
+
+// ===============================
+//         時刻表の再生
+// ===============================
+
+/**
+ * @brief 時刻表の再生エンジンと操作用のキュー
+ *
+ * `timetable` はパネル制御タスクだけが操作する。
+ * Web サーバーのタスクからの操作（/timetable）は `timetableQueue` 経由で渡す。
+ */
+Timetable timetable;
+QueueHandle_t timetableQueue;
+#define TIMETABLE_QUEUE_LENGTH 8           // 未処理の操作を保持できる数
+#define PRELOAD_HEAP_RESERVE (48 * 1024)   // 一度に確保できる最大ブロックがこれを下回る場合は先読みしない
+
+/**
+ * @brief プリセットの操作用のキュー（/preset → パネル制御タスク）
+ */
+QueueHandle_t presetQueue;
+#define PRESET_QUEUE_LENGTH 4 // 未処理の操作を保持できる数
+
+/**
+ * @brief アップロードしたファイルの置き換え要求と結果のキュー（/upload ⇔ パネル制御タスク）
+ *
+ * 置き換えは描画の合間にパネル制御タスクで行い、Web サーバーのタスクは結果を待ってから応答する。
+ */
+struct UploadResult {
+    bool ok = false;         // すべて置き換えられたか
+    uint16_t committed = 0;  // 置き換えたファイル数
+};
+QueueHandle_t uploadQueue;
+QueueHandle_t uploadResultQueue;
+#define UPLOAD_COMMIT_TIMEOUT_MS 5000 // 置き換えの完了を待つ時間
+
 // ===============================
 //          WiFi 設定
 // ===============================
@@ -197,34 +261,86 @@ void listLittleFSFiles() {
  * @brief LED マトリクスパネルの初期化
  *
  * ESP32 の HUB75 LED マトリクスを初期化し、描画を行う準備をする。
- * - パネルの解像度 (`PANEL_RES_X` / `PANEL_RES_Y`) と連結数 (`PANEL_CHAIN`) を設定
- * - `MatrixPanel_I2S_DMA` のオブジェクトを作成し、パネルを制御
+ * - パネル構成を `/config/panel.csv` から読み込む（無い場合は `PANEL_RES_X` などの既定値）
+ * - `MatrixPanel_I2S_DMA` のオブジェクトを作成し、パネルを制御（既定ではダブルバッファ）
  * - 輝度を設定し、初期状態で画面をクリアする
  */
 void initPanel() {
     // 1. パネル設定のロード（HUB75 の構成を定義）
+    panelGeometry.setDefaults(PANEL_RES_X, PANEL_RES_Y, PANEL_CHAIN, PANEL_BRIGHTNESS);
+    panelGeometry.load(PANEL_CONFIG_PATH);
+    panelWidth = panelGeometry.width();
+    panelHeight = panelGeometry.height();
+
+    // 1.1 表示中の内容の写しを用意（プリセット保存・ダブルバッファの書き写し用）
+    frameMirror = (uint16_t *)calloc(panelWidth * panelHeight, sizeof(uint16_t));
+    panelGeometry.setMirror(frameMirror);
+    if (frameMirror == nullptr) {
+        panelGeometry.doubleBuffer = false; // 書き写し元が無いためダブルバッファは使用しない
+    }
+
     HUB75_I2S_CFG mxconfig(
-        PANEL_RES_X,   // 1つのパネルの横幅
-        PANEL_RES_Y,   // 1つのパネルの縦幅
-        PANEL_CHAIN    // 連結するパネルの数
+        panelGeometry.resX,         // 1つのパネルの横幅
+        panelGeometry.resY,         // 1つのパネルの縦幅
+        panelGeometry.chainLength() // 連結するパネルの数（全段の合計）
     );
+    mxconfig.double_buff = panelGeometry.doubleBuffer; // 裏画面に描画し、完成後に切り替える
 
     // 2. LED マトリクスパネルのオブジェクトを作成
     matrix = new MatrixPanel_I2S_DMA(mxconfig);
 
-    // 3. パネルの初期化を実行
-    matrix->begin();
+    // 3. パネルの初期化を実行（ダブルバッファ用の DMA メモリが確保できない場合は通常の描画に戻す）
+    if (!matrix->begin() && panelGeometry.doubleBuffer) {
+        Serial.println("ダブルバッファ用のメモリが不足しているため、通常の描画に切り替えます。");
+        delete matrix;
+        panelGeometry.doubleBuffer = false;
+        mxconfig.double_buff = false;
+        matrix = new MatrixPanel_I2S_DMA(mxconfig);
+        matrix->begin();
+    }
 
     // 4. パネルの輝度（明るさ）を設定（0～255 の範囲）
-    matrix->setBrightness8(PANEL_BRIGHTNESS);
+    matrix->setBrightness8(panelGeometry.brightness);
 
-    // 5. 初期状態でパネルをクリア（全画面を黒にする）
+    // 5. 初期状態でパネルをクリア（全画面を黒にする、ダブルバッファの場合は両画面とも）
     matrix->clearScreen();
+    if (panelGeometry.doubleBuffer) {
+        matrix->flipDMABuffer();
+        matrix->clearScreen();
+    }
 
-    // 6. 画像用バッファ（今後の描画用）
-    uint32_t* buffer = nullptr; // 画像のデータを保持するバッファ
-    int imgWidth = 0;           // 読み込んだ画像の幅
-    int imgHeight = 0;          // 読み込んだ画像の高さ
+    // 6. パネル全体の大きさで中間描画用キャンバスを作成
+    canvas = new GFXcanvas16(panelWidth, panelHeight);
+}
+
+/**
+ * @brief 前回の表示状態を復元し、保存したフレームを表示する（起動時に 1 回だけ呼ぶ）
+ *
+ * フレームは圧縮したものを展開して書き込むだけのため、CSV の検索や BMP の変換を待たずに表示できる。
+ * 表示状態は `mode` / `num_*` に戻し、パネル制御タスクの最初の描画で同じ内容を改めて描画する。
+ * プリセット（Mode 4）が読み込めない場合は全画面表示に戻す。
+ */
+void restoreDisplayState() {
+    // 1. 表示状態を NVS から読み込む
+    BootDisplayState state;
+    if (!bootState.load(state)) {
+        Serial.println("保存した表示状態が無いため、既定の表示で起動します。");
+        return;
+    }
+    mode = state.mode;
+    num_full = state.full;
+    num_type = state.type;
+    num_dest = state.dest;
+    num_dep = state.dep;
+    num_next = state.next;
+    if (mode == 4 && !scenePreset.recall(state.preset)) {
+        mode = 0;
+    }
+
+    // 2. 保存したフレームを表示
+    if (bootState.showFrame(matrix)) {
+        Serial.printf("起動から %lu ms で前回の表示を復元しました。\n", millis());
+    }
 }
 
 /**
@@ -261,55 +377,29 @@ void drawImageFromReader(CSVReader &reader, int IDNumber, const String &label, i
     }
 }
 
-/**
- * @brief 指定範囲の停車駅リストを `imagePaths` に追加し、停車駅数をカウントする
- *
- * 指定した範囲の駅 ID について、種別 `className` に該当する駅を `imagePaths` に追加する。
- * - `start` と `end` の大小を判定し、自動でリストを上る or 下る方向を決定
- * - 停車駅数が12を超えた場合は処理を中断し、制限フラグを返す
- * - `cnt` を引数にすることで、異なる路線の処理を分けてもカウントを引き継げる
- *
- * @param imagePaths 停車駅画像リスト（更新対象）
- * @param nextReader 次駅表示の CSV インスタンス
- * @param typeReader 種別表示の CSV インスタンス
- * @param numType 種別の ID（該当するクラスを検索するために使用）
- * @param start 検索開始駅 ID
- * @param end 検索終了駅 ID
- * @param cnt 現在の停車駅数（外部で管理し、継続的にカウント可能）
- * @return 停車駅が12駅を超えた場合は `true`（表示制限フラグ）、そうでなければ `false`
- */
-bool addStationList(std::vector<String> &imagePaths, CSVReader &nextReader, CSVReader &typeReader, int numType, int start, int end, unsigned char &cnt) {
-    bool overLimit = false; // 停車駅が 12 駅を超えたか
-    int Startid = (start<end)? (start + 1) : (start - 1);
-    int step = (start < end) ? +1 : -1; // 自動でリストの進む方向を判定
-
-    for (int i = Startid; i != end; i += step) {
-        if (cnt >= 12) {  // 12駅を超えたら中断
-            overLimit = true;
-            break;
-        }
-        if (containsWord(nextReader.getPath(i, "type"), typeReader.getPath(numType, "className"))) {
-            imagePaths.emplace_back("/img/Scroll/touten.bmp"); // 「、」
-            imagePaths.emplace_back(nextReader.getPath(i, "Scroll")); // 駅名
-            cnt++;
-        }
-    }
-
-    return overLimit;
-}
-
 /**
  * @brief 全画面描画 (Mode 0)
  *
  * 指定された ID の BMP 画像を 1 枚表示する。
  * - CSV から画像パスを取得し、座標 (0,0) に描画するだけのシンプルな処理
  * - 主にフルスクリーン用の BMP 画像を表示するのに使われる
+ * - 切り替え効果（`transition_full`）がある場合は画像を一度メモリに読み込み、少しずつ描画する
  *
  * @param fullReader 全画面表示用 CSV のインスタンス
  * @param numFull 表示する全画面 BMP の ID
  */
 void drawMode0(CSVReader &fullReader, int numFull) {
-    drawImageFromReader(fullReader, numFull, "path", 0, 0);
+    const PanelLayout &layout = panelGeometry.layout;
+    if (layout.fullTransition.isCut()) {
+        drawImageFromReader(fullReader, numFull, "path", layout.originX, layout.originY);
+        return;
+    }
+
+    // 切り替え効果を付けて表示（画像は transitions 側に複写されるため、すぐに解放する）
+    BMPData image;
+    cacheBMPData(fullReader.getPath(numFull, "path"), image);
+    transitions.start(layout.originX, layout.originY, &image, layout.fullTransition);
+    free(image.cache);
 }
 
 /**
@@ -317,7 +407,7 @@ void drawMode0(CSVReader &fullReader, int numFull) {
  *
  * 指定された ID の BMP 画像を 2 枚表示する。
  * - 種別（例: 急行・快速など）と行先（例: 新宿・池袋など）を組み合わせて表示
- * - 画像の配置は、種別を `(0,0)`, 行先を `(48,0)` に描画
+ * - 画像の配置は、種別を `(0,0)`, 行先を `(48,0)` に描画（128×32 の場合、パネル設定の表示位置を基準とする）
  * - 次駅IDから路線を判別し、行先表示の一部として利用することがある
  *
  * @param typeReader 種別用 CSV のインスタンス
@@ -329,39 +419,44 @@ void drawMode0(CSVReader &fullReader, int numFull) {
 void drawMode1(CSVReader &typeReader, CSVReader &destReader, int numType, int numDest, int numNext) {
     // 1. 直前の表示データを記録し、変更があった場合のみ更新する
     static int last_type = -1, last_dest = -1, last_next = -1;
+    static uint32_t last_typeGen = 0, last_destGen = 0; // 直接描画した行の世代（CSV の行が変わったら描画し直す）
+    const PanelLayout &layout = panelGeometry.layout; // 表示位置
 
-    if(numType != last_type) { // 種別に変更があったとき
-        drawImageFromReader(typeReader, numType, "large", 0, 0); // 種別を描画
+    if(numType != last_type || typeReader.rowGeneration(numType) != last_typeGen) { // 種別に変更があったとき
+        drawImageFromReader(typeReader, numType, "large", layout.originX, layout.originY); // 種別を描画
         last_type = numType;
+        last_typeGen = typeReader.rowGeneration(numType);
     }
 
-    if(numDest >= 900 || numNext == 0 || numNext >= 900) {
-        // 行先が無効範囲 (900番台) または次駅が無効範囲 (無表示 or 900番台)、もしくは路線名が非表示にされているとき
-        if(numDest != last_dest) { // 行先に変更があったとき
-            drawImageFromReader(destReader, numDest, "large", 48, 0);  // 行先を描画
+    int lineID = routeGraph.lineOf(numNext); // 次駅の路線（路線名を表示する行先の ID）
+    if(numDest >= 900 || lineID == 0) {
+        // 行先が無効範囲 (900番台) または次駅が路線図に無い (無表示 or 900番台)、もしくは路線名が非表示にされているとき
+        if(numDest != last_dest || destReader.rowGeneration(numDest) != last_destGen) { // 行先に変更があったとき
+            drawImageFromReader(destReader, numDest, "large", layout.destX(), layout.originY);  // 行先を描画
             last_dest = numDest;
+            last_destGen = destReader.rowGeneration(numDest);
         }
     } else {
         // 2. トグル表示のためのキャッシュ準備
         static BMPData bmpCacheLine, bmpCacheDest;
         static std::vector<BMPData*> partDest;
         static std::vector<ToggleCacheBMPPart> parts;
+        std::vector<BMPLoad> loads; // 読み込む画像（まとめて 2 つのコアで展開する）
         bool flg_change = false;
 
-        if(numDest != last_dest) { // 行先に変更があったとき
-            cacheBMPData(destReader.getPath(numDest, "large"), bmpCacheDest);
+        if(numDest != last_dest || destReader.rowGeneration(numDest) != bmpCacheDest.generation) { // 行先に変更があったとき
+            loads.push_back({ destReader.getPath(numDest, "large"), &bmpCacheDest });
+            bmpCacheDest.generation = destReader.rowGeneration(numDest);
             last_dest = numDest;
             flg_change = true;
         }
-        if(numNext != last_next) { // 次駅に変更があったとき
-            if(numNext < 100) {
-                cacheBMPData(destReader.getPath(901, "large"), bmpCacheLine); // 夢の森線
-            } else {
-                cacheBMPData(destReader.getPath(902, "large"), bmpCacheLine); // 花霞線
-            }
+        if(numNext != last_next || destReader.rowGeneration(lineID) != bmpCacheLine.generation) { // 次駅に変更があったとき
+            loads.push_back({ destReader.getPath(lineID, "large"), &bmpCacheLine });
+            bmpCacheLine.generation = destReader.rowGeneration(lineID);
             last_next = numNext;
             flg_change = true;
         }
+        cacheBMPDataBatch(loads); // すべての画像がそろってから切り替える
 
         // 3. パーツ構造体を更新（変更があった場合のみ）
         if (flg_change) {
@@ -369,7 +464,7 @@ void drawMode1(CSVReader &typeReader, CSVReader &destReader, int numType, int nu
             partDest.emplace_back(&bmpCacheLine); // 路線
             partDest.emplace_back(&bmpCacheDest); // 行先
             parts.clear();
-            parts.emplace_back(ToggleCacheBMPPart(partDest, 48, 0));
+            parts.emplace_back(ToggleCacheBMPPart(partDest, layout.destX(), layout.originY, layout.destTransition));
             flg_change = false;
         }
 
@@ -381,10 +476,10 @@ void drawMode1(CSVReader &typeReader, CSVReader &destReader, int numType, int nu
 /**
  * @brief 種別 + 行先 + 次駅の描画 (Mode 2)
  *
- * 指定された ID の BMP 画像を 3 枚表示し、言語 (日本語 / 英語) のトグル処理を行う。
- * - 日本語版 / 英語版の 2 つの画像を交互に切り替える
+ * 指定された ID の BMP 画像を 3 枚表示し、言語（`panel.csv` の `languages`、既定は日本語 / 英語）のトグル処理を行う。
+ * - 各言語の画像を順に切り替える（3 言語以上の場合、メモリに置くのは表示中と次の言語の画像のみ）
  * - toggleBMP() を使用して 3000ms ごとに表示を更新
- * - CSV のパスをキャッシュし、ID の変更があった場合のみ再取得することで処理を最適化
+ * - ID の変更があった場合のみ、`SceneBuilder` で表示内容をまとめて作り直す（CSV ごとに 1 回の検索、すべてそろってから差し替え）
  *
  * @param typeReader 種別用 CSV のインスタンス
  * @param destReader 行先用 CSV のインスタンス
@@ -394,90 +489,50 @@ void drawMode1(CSVReader &typeReader, CSVReader &destReader, int numType, int nu
  * @param numNext 表示する次駅の ID
  */
 void drawMode2(CSVReader &typeReader, CSVReader &destReader, CSVReader &nextReader, int numType, int numDest, int numNext) {
-    // 1. 直前の表示データを記録し、変更があった場合のみ更新する
-    static int last_numType = -1, last_numDest = -1, last_numNext = -1; // 前回のID
-    static String type_jp, type_en, dest_jp, dest_en, next_jp, next_en; // 各パーツの画像パス
-    static BMPData bmpCacheTypeJP, bmpCacheTypeEN; // 種別（日本語 / 英語）
-    static BMPData bmpCacheDestJP, bmpCacheDestEN; // 行先（日本語 / 英語）
-    static BMPData bmpCacheNextJP, bmpCacheNextEN; // 次駅（日本語 / 英語）
-    static BMPData bmpCacheLine; // 路線名
+    // 1. 表示中の表示内容（画像はすべてそろってから差し替える）
+    static SceneBuilder builder(typeReader, destReader, nextReader);
+    static Scene scene;
     static std::vector<BMPData*> partType, partDest, partNext; // トグル表示する画像群のベクター
     static std::vector<ToggleCacheBMPPart> parts; // トグル表示用の構造体
-    bool flg_change = false; // 1つでもパスが変わった場合に true にする
-    bool flg_line = false; // 路線名を表示するか
-
-    // 2. ID に変更があった場合のみ、新しい画像パスを取得
-    if (numType != last_numType) {
-        cacheBMPData(typeReader.getPath(numType, "JP"), bmpCacheTypeJP);
-        cacheBMPData(typeReader.getPath(numType, "EN"), bmpCacheTypeEN);
-        last_numType = numType; // ID を更新
-        flg_change = true;
-    }
-
-    if (numDest != last_numDest) {
-        //dest_jp = destReader.getPath(numDest, "JP"); // 日本語版
-        //dest_en = destReader.getPath(numDest, "EN"); // 英語版
-		cacheBMPData(destReader.getPath(numDest, "JP"), bmpCacheDestJP);
-		cacheBMPData(destReader.getPath(numDest, "EN"), bmpCacheDestEN);
-        last_numDest = numDest; // ID を更新
-        flg_change = true;
-    }
-
-    if (numNext != last_numNext) {
-        cacheBMPData(nextReader.getPath(numNext, "JP"), bmpCacheNextJP);
-        cacheBMPData(nextReader.getPath(numNext, "EN"), bmpCacheNextEN);
-        if(numDest < 900 && numNext != 0 && numNext < 900){
-            // 行き先が無効範囲(900番台)か次駅が無効範囲(無表示または900番台)ではなく、かつ路線名表示が有効化されているとき
-            if(numNext < 100){
-                cacheBMPData(destReader.getPath(901, "JP"), bmpCacheLine); // 夢の森線
-            } else {
-                cacheBMPData(destReader.getPath(902, "JP"), bmpCacheLine); // 花霞線
-            }
-            flg_line = true;
-        } else {
-            flg_line = false;
-        }
-        last_numNext = numNext; // ID を更新
-        flg_change = true;
-    }
-
-    // 3. パーツ構造体を更新（変更があった場合のみ）
-    if (flg_change) {
-        // 既存リストをクリア
+    const PanelLayout &layout = panelGeometry.layout; // 表示位置
+
+    // 2. ID（または CSV の行・路線図）に変更があった場合のみ、表示内容をまとめて作り直す（失敗した場合は表示中の内容を維持）
+    SceneTarget target;
+    target.mode = 2;
+    target.type = numType;
+    target.dest = numDest;
+    target.next = numNext;
+    if (!builder.isCurrent(scene, target) && builder.build(target, scene)) {
+        // 3. パーツ構造体を更新（差し替えた場合のみ）
         partType.clear();
         partDest.clear();
         partNext.clear();
-        if(flg_line){
-            partType.emplace_back(&bmpCacheTypeJP); // 種別JP
-            partDest.emplace_back(&bmpCacheLine); // 路線
-            partNext.emplace_back(&bmpCacheNextJP); // 次駅JP
+        for (int phase = 0; phase < scene.phaseCount(); phase++) { // 路線名（表示する場合）→ 各言語
+            int language = scene.phaseLanguage(phase);
+            partType.emplace_back(scene.image(SCENE_TYPE, language)); // 種別
+            partDest.emplace_back(scene.isLinePhase(phase) ? scene.image(SCENE_LINE, 0) : scene.image(SCENE_DEST, language)); // 路線 / 行先
+            partNext.emplace_back(scene.image(SCENE_NEXT, language)); // 次駅
         }
-        partType.emplace_back(&bmpCacheTypeJP); // 種別JP(2回目)
-        partDest.emplace_back(&bmpCacheDestJP); // 行先JP
-        partNext.emplace_back(&bmpCacheNextJP); // 次駅JP(2回目)
-
-        partType.emplace_back(&bmpCacheTypeEN); // 種別EN
-        partDest.emplace_back(&bmpCacheDestEN); // 行先EN
-        partNext.emplace_back(&bmpCacheNextEN); // 次駅EN
 
         parts.clear(); // 既存リストをクリア
-        parts.emplace_back(ToggleCacheBMPPart(partType, 0, 0));   // 種別
-        parts.emplace_back(ToggleCacheBMPPart(partDest, 48, 0));   // 行先
-        parts.emplace_back(ToggleCacheBMPPart(partNext, 48, 16)); // 次駅
-        flg_change = false; // フラグをリセット
+        parts.emplace_back(ToggleCacheBMPPart(partType, layout.originX, layout.originY, layout.typeTransition)); // 種別
+        parts.emplace_back(ToggleCacheBMPPart(partDest, layout.destX(), layout.originY, layout.destTransition)); // 行先
+        parts.emplace_back(ToggleCacheBMPPart(partNext, layout.destX(), layout.lowerY(), layout.nextTransition)); // 次駅
     }
+    if (parts.empty()) return; // 表示内容をまだ作成できていない
 
-    // 4. 設定したパーツを toggleBMP() で一定間隔ごとに切り替え表示
-	toggleCacheBMP(parts, parts[0].bmpList.size(), 3000);
+    // 4. 設定したパーツを toggleBMP() で一定間隔ごとに切り替え表示（3 言語以上は表示する直前に画像を用意させる）
+	toggleCacheBMP(parts, parts[0].bmpList.size(), 3000, Scene::preparePhaseHook, &scene);
 }
 
 /**
  * @brief 種別 + 行先 + 停車駅スクロールの描画 (Mode 3)
- * 日本語 / 英語のトグル処理あり。
+ * 言語（`panel.csv` の `languages`）のトグル処理あり。
  * 停車駅リストをスクロールさせながら表示する。
  * - 停車駅の数が 2 つ未満（始発と終点が隣接）の場合は Mode 2 にフォールバック
  * - cacheConcatenatedImages() を使用し、停車駅リストを 1 枚の画像に連結
  * - updateScroll() を使ってスクロールアニメーションを実行
+ * - 種別・行先・路線名の画像と停車駅スクロールは `SceneBuilder` でまとめて作り、すべてそろってから差し替える
  *
  * @param typeReader 種別表示の CSV インスタンス
  * @param destReader 行先表示の CSV インスタンス
@@ -487,124 +542,259 @@ void drawMode2(CSVReader &typeReader, CSVReader &destReader, CSVReader &nextRead
  * @param numDep 列車の始発駅の ID (停車駅リストの生成に使用)
  */
 void drawMode3(CSVReader &typeReader, CSVReader &destReader, CSVReader &nextReader, int numType, int numDest, int numDep) {
-    // 1. 直前の表示データを記録し、変更があった場合のみ更新する
-    static int last_numType = -1, last_numDest = -1, last_numDep = -1;
-    static BMPData stationScroll;
-    static BMPData bmpCacheTypeJP, bmpCacheTypeEN; // 種別（日本語 / 英語）
-    static BMPData bmpCacheDestJP, bmpCacheDestEN; // 行先（日本語 / 英語）
-    static BMPData bmpCacheLine; // 路線名
+    // 1. 表示中の表示内容（種別・行先・路線名の画像と停車駅スクロール、すべてそろってから差し替える）
+    static SceneBuilder builder(typeReader, destReader, nextReader);
+    static Scene scene;
     static std::vector<BMPData*> partType, partDest; // トグル表示する画像群のベクター
     static std::vector<ToggleCacheBMPPart> parts;
-    static std::vector<String> imagePaths;
-    bool flg_change = false; // 種別・行先の画像が変更されたか
-    bool scr_change = false; // 停車駅リストが変更されたか
-    bool flg_line = false; // 路線名を表示するか
+    const PanelLayout &layout = panelGeometry.layout; // 表示位置
 
     // 2. 停車駅の数が 2 未満、または行き先に駅名以外(900番台)が設定されているなら Mode 2 にフォールバック
-    if (abs(numDest - numDep) < 2 || numDest >= 900 || numDest == 0) {
-        mode = 2;
+    if (routeGraph.hops(numDep, numDest) < 2) { // 路線図でたどれない（行先が 900 番台など）場合も含む
+        if (mode == 3 && num_dest == numDest && num_dep == numDep) { // 切り替え待ちの別の変更は上書きしない
+            mode = 2;
+            num_next = numDest;
+        }
         drawMode2(typeReader, destReader, nextReader, numType, numDest, numDest);
-        num_next = numDest;
         return;
-    } else {
-        // 3. 種別の画像パスを取得し、キャッシュを作成
-        if (numType != last_numType) {
-            cacheBMPData(typeReader.getPath(numType, "JP"), bmpCacheTypeJP);
-            cacheBMPData(typeReader.getPath(numType, "EN"), bmpCacheTypeEN);
-            last_numType = numType;
-            flg_change = true;
-            scr_change = true; // 停車駅リストの更新フラグ
-        }
+    }
 
-        // 4. 行先の画像パスを取得し、キャッシュを作成
-        if (numDest != last_numDest) {
-            cacheBMPData(destReader.getPath(numDest, "JP"), bmpCacheDestJP);
-            cacheBMPData(destReader.getPath(numDest, "EN"), bmpCacheDestEN);
-            last_numDest = numDest;
-            flg_change = true;
-            scr_change = true;
+    // 3. ID（または CSV の行・路線図）に変更があった場合のみ、表示内容をまとめて作り直す（失敗した場合は表示中の内容を維持）
+    //    停車駅スクロールは時刻表で先読み済みならそれを使い、幅が広い場合はページに分ける
+    SceneTarget target;
+    target.mode = 3;
+    target.type = numType;
+    target.dest = numDest;
+    target.dep = numDep;
+    if (!builder.isCurrent(scene, target) && builder.build(target, scene)) {
+        // 4. トグル画像の構造体を更新（差し替えた場合のみ）
+        partType.clear();
+        partDest.clear();
+        for (int phase = 0; phase < scene.phaseCount(); phase++) { // 路線名（表示する場合）→ 各言語
+            int language = scene.phaseLanguage(phase);
+            partType.emplace_back(scene.image(SCENE_TYPE, language)); // 種別
+            partDest.emplace_back(scene.isLinePhase(phase) ? scene.image(SCENE_LINE, 0) : scene.image(SCENE_DEST, language)); // 路線 / 行先
         }
 
-        // 5. 始発駅が変わった場合も停車駅リストを更新
-        if (numDep != last_numDep) {
-            if(numDest < 900 && numDep != 0 && numDep < 900){
-            // 行き先が無効範囲(900番台)か次駅が無効範囲(無表示または900番台)ではない
-                if(numDep < 100){
-                    cacheBMPData(destReader.getPath(901, "JP"), bmpCacheLine); // 夢の森線
-                } else {
-                    cacheBMPData(destReader.getPath(902, "JP"), bmpCacheLine); // 花霞線
-                }
-                flg_line = true;
-            } else {
-                flg_line = false;
-        }
-            last_numDep = numDep;
-            flg_change = true;
-            scr_change = true;
-        }
+        parts.clear(); // 既存リストをクリア
+        parts.emplace_back(ToggleCacheBMPPart(partType, layout.originX, layout.originY, layout.typeTransition)); // 種別
+        parts.emplace_back(ToggleCacheBMPPart(partDest, layout.destX(), layout.originY, layout.destTransition)); // 行先
+    }
+    if (parts.empty()) return; // 表示内容をまだ作成できていない
 
-        // 6. 停車駅リストを更新
-        if (scr_change || stationScroll.cache == nullptr) {
-            imagePaths.clear(); // 既存リストをクリア
-            imagePaths.emplace_back("/img/Scroll/ScrollStart.bmp"); // 「この電車の停車駅は」
-
-            unsigned char cnt = 0; // 停車駅数をカウント
-            bool overLimit = false; // 停車駅が 12 駅を超えたか
-
-            // 直通の有無で分岐
-            if(numDep < 100 && numDest > 100){ // 夢の森線→花霞線
-                overLimit = addStationList(imagePaths, nextReader, typeReader, numType, numDep, 10, cnt); // ID=10(夢の森線夢見ヶ丘)まで
-                imagePaths.emplace_back("/img/Scroll/touten.bmp"); // 「、」
-                imagePaths.emplace_back(nextReader.getPath(10, "Scroll")); // 夢見ヶ丘
-                overLimit = addStationList(imagePaths, nextReader, typeReader, numType, 110, numDest, cnt); // ID=110(花霞線夢見ヶ丘)から
-            } else if(numDep > 100 && numDest < 100){ // 花霞線→夢の森線
-                overLimit = addStationList(imagePaths, nextReader, typeReader, numType, numDep, 110, cnt); // ID=110(花霞線夢見ヶ丘)まで
-                imagePaths.emplace_back("/img/Scroll/touten.bmp"); // 「、」
-                imagePaths.emplace_back(nextReader.getPath(10, "Scroll")); // 夢見ヶ丘
-                overLimit = addStationList(imagePaths, nextReader, typeReader, numType, 10, numDest, cnt); // ID=10(夢の森線夢見ヶ丘)から
-            } else { // 線内完結
-                overLimit = addStationList(imagePaths, nextReader, typeReader, numType, numDep, numDest, cnt);
-            }
+    // 5. 画像トグル（3 言語以上は表示する直前に画像を用意させる）
+    toggleCacheBMP(parts, parts[0].bmpList.size(), 3000, Scene::preparePhaseHook, &scene);
 
-            // 7. 停車駅の終端画像を追加
-            if (overLimit) {
-                imagePaths.emplace_back("/img/Scroll/ScrollEnd2.bmp"); // 「の順に停まります」
-            } else {
-                imagePaths.emplace_back("/img/Scroll/ScrollEnd.bmp"); // 「駅に停まります」
-            }
+    // 6. スクロール処理の更新（行先の下、表示内容の右端まで）
+    scene.strip.update(layout.destX(), layout.lowerY(), layout.areaWidth(), layout.rowHeight, layout.scrollSpeed);
+}
+
+// 同じ行の最初に表示する 2 言語の画像を 1 回の検索で求めて先読みを予約する
+// （3 言語目以降は表示中に `Scene::preparePhase()` が先読みする）
+static void enqueueLanguagePair(CSVReader &reader, int id) {
+    const PanelLayout &layout = panelGeometry.layout;
+    std::vector<CatalogQuery> queries;
+    for (int language = 0; language < min(layout.languageCount, 2); language++) {
+        queries.push_back(CatalogQuery(id, layout.languages[language]));
+    }
+    reader.lookup(queries);
+    for (const CatalogQuery &query : queries) {
+        assetCache.enqueue(query.value);
+    }
+}
 
-            // 8. 停車駅の連結画像キャッシュを作成
-            cacheConcatenatedImages(imagePaths, &stationScroll);
-            scr_change = false;
+/**
+ * @brief 時刻表の 1 行を表示するのに必要な画像の先読みを予約する
+ *
+ * `drawModeN()` が読み込む画像と同じパスを求め、直前の行から変わる部分だけを予約する
+ * （変わらない部分は `drawModeN()` が再読み込みしないため）。
+ * Mode 0 と Mode 1 の種別は `drawBMP()` で直接描画するため対象外。
+ *
+ * @param step 先読みする行
+ * @param prev その直前の行
+ */
+void preloadTimetableStep(const TimetableStep &step, const TimetableStep &prev) {
+    int stepMode = step.mode;
+    int lineId = step.next; // 路線名の判別に使う ID（Mode 3 は始発駅）
+    int nextId = step.next;
+
+    // 1. Mode 3 で停車駅が少ない場合は drawMode3() と同じく Mode 2 として扱う
+    if (stepMode == 3) {
+        if (routeGraph.hops(step.dep, step.dest) < 2) {
+            stepMode = 2;
+            nextId = lineId = step.dest;
+        } else {
+            lineId = step.dep;
         }
+    }
+    bool modeChanged = (stepMode != prev.mode);
+    int lineRow = routeGraph.lineOf(lineId); // 路線名を表示する行先の ID（路線図に無い場合は 0）
+    bool lineShown = (step.dest < 900 && lineRow != 0);
+
+    // 2. 表示モードごとに、変わる画像を予約
+    if (stepMode == 1) {
+        if (modeChanged || step.dest != prev.dest) assetCache.enqueue(destReader.getPath(step.dest, "large"));
+        if (lineShown && (modeChanged || step.next != prev.next)) assetCache.enqueue(destReader.getPath(lineRow, "large"));
+    } else if (stepMode == 2 || stepMode == 3) {
+        if (modeChanged || step.type != prev.type) enqueueLanguagePair(typeReader, step.type);
+        if (modeChanged || step.dest != prev.dest) enqueueLanguagePair(destReader, step.dest);
+        if (stepMode == 2 && (modeChanged || nextId != prev.next)) enqueueLanguagePair(nextReader, nextId);
+        if (lineShown) assetCache.enqueue(destReader.getPath(lineRow, panelGeometry.layout.languages[0]));
+    }
 
-        // 9. トグル画像の構造体を更新
-        if (flg_change) {
-            // 既存リストをクリア
-            partType.clear();
-            partDest.clear();
-            if(flg_line){
-                partType.emplace_back(&bmpCacheTypeJP); // 種別JP
-                partDest.emplace_back(&bmpCacheLine); // 路線
-            }
-            partType.emplace_back(&bmpCacheTypeJP); // 種別JP(2回目)
-            partDest.emplace_back(&bmpCacheDestJP); // 行先JP
+    // 3. 停車駅スクロールの連結画像（種別・行先・始発駅のいずれかが変わる場合）
+    if (stepMode == 3 && (modeChanged || step.type != prev.type || step.dest != prev.dest || step.dep != prev.dep)) {
+        std::vector<String> paths;
+        buildStationScrollPaths(paths, typeReader.getPath(step.type, "className"), step.dest, step.dep);
+        ScrollStrip::preload(paths, panelGeometry.layout.areaWidth()); // 最初のページのみ（続きは表示中に先読み）
+    }
+}
 
-            partType.emplace_back(&bmpCacheTypeEN); // 種別EN
-            partDest.emplace_back(&bmpCacheDestEN); // 行先EN
+/**
+ * @brief 時刻表の操作を反映し、行が変わったら表示内容を切り替える
+ *
+ * - `/timetable` から届いた操作をすべて処理する
+ * - 表示時間が経過していれば次の行へ進める
+ * - 行が変わった場合は表示内容（mode / num_*）を更新し、先の行の画像の先読みを予約する
+ */
+void updateTimetable() {
+    unsigned long now = millis();
+    bool changed = false;
+
+    // 1. 操作を処理
+    TimetableCommand command;
+    while (xQueueReceive(timetableQueue, &command, 0) == pdTRUE) {
+        if (command.type == TIMETABLE_CMD_LOAD || command.type == TIMETABLE_CMD_SEEK) {
+            assetCache.clear(); // 先の行が変わるため先読みをやり直す
+        }
+        changed |= timetable.apply(command, now);
+    }
 
-            parts.clear(); // 既存リストをクリア
-            parts.emplace_back(ToggleCacheBMPPart(partType, 0, 0));   // 種別
-            parts.emplace_back(ToggleCacheBMPPart(partDest, 48, 0));   // 行先
-            flg_change = false; // フラグをリセット
+    // 2. 時間経過を確認
+    changed |= timetable.update(now);
+    const TimetableStep *step = timetable.current();
+    if (!changed || step == nullptr) return;
+
+    // 3. 表示内容を切り替え（panelTask が変更を検出して再描画する）
+    TRACE_SCOPE("timetableStep");
+    mode = step->mode;
+    num_full = step->full;
+    num_type = step->type;
+    num_dest = step->dest;
+    num_dep = step->dep;
+    num_next = step->next;
+
+    // 4. 先の行の画像の先読みを予約
+    for (size_t ahead = 1; ahead <= TIMETABLE_LOOKAHEAD; ahead++) {
+        const TimetableStep *nextStep = timetable.peek(ahead);
+        if (nextStep == nullptr) break;
+        preloadTimetableStep(*nextStep, *timetable.peek(ahead - 1));
+    }
+}
+
+/**
+ * @brief プリセットの保存 / 呼び出しを処理する
+ *
+ * 呼び出しに成功した場合は Mode 4 に切り替える（CSV の検索や BMP の変換は行わない）。
+ */
+void updatePresets() {
+    PresetCommand command;
+    while (xQueueReceive(presetQueue, &command, 0) == pdTRUE) {
+        if (command.type == PRESET_CMD_SAVE) {
+            scenePreset.save(command.name);
+        } else if (scenePreset.recall(command.name)) {
+            mode = 4;
         }
+    }
+}
 
-        // 10. 画像トグル
-        toggleCacheBMP(parts, parts[0].bmpList.size(), 3000);
+/**
+ * @brief 現在の表示状態（起動時に復元する内容）
+ */
+BootDisplayState currentDisplayState() {
+    BootDisplayState state;
+    state.mode = mode;
+    state.full = num_full;
+    state.type = num_type;
+    state.dest = num_dest;
+    state.dep = num_dep;
+    state.next = num_next;
+    if (mode == 4) {
+        strncpy(state.preset, scenePreset.name().c_str(), PRESET_NAME_LEN - 1);
+    }
+    return state;
+}
 
-        // 11. スクロール処理の更新
-        updateScroll(&stationScroll, 48, 16, 80, 16, 30);
+/**
+ * @brief アップロードしたファイルを置き換え、関係するキャッシュを作り直す
+ *
+ * - 画像: マニフェストのエントリを更新（事前生成した `/manifest.csv` は古くなるため削除）し、
+ *   その画像を参照する CSV の行の世代を進める
+ * - `/manifest.csv`: マニフェストを読み込み直す
+ * - CSV: 読み直し、内容が変わった行の世代を進める（路線図・次駅 CSV の場合は路線図も読み込み直す）
+ * - フォント: 置き換える前に閉じ、置き換えた後に開き直す（`text:` の行の世代を進める）
+ * - 先読み済みの画像はすべて破棄する
+ *
+ * 表示中のキャッシュは `drawModeN()` が行の世代を比べて、変わった部分だけを作り直す。
+ *
+ * @return 置き換えた場合 true
+ */
+bool updateUploads() {
+    uint8_t request;
+    if (xQueueReceive(uploadQueue, &request, 0) != pdTRUE) {
+        return false;
+    }
+
+    // 1. 開いたままのフォントは置き換える前に閉じる
+    bool fontReplaced = assetUpload.isStaged(FONT_DEFAULT_PATH);
+    if (fontReplaced) {
+        bitmapFont.end();
+    }
+
+    // 2. 一時ファイルを正式なパスへ置き換える
+    std::vector<String> committed;
+    UploadResult result;
+    result.ok = assetUpload.commit(committed);
+    result.committed = committed.size();
+
+    // 3. 関係するキャッシュを作り直す
+    CSVReader *readers[] = { &fullReader, &typeReader, &destReader, &nextReader };
+    bool manifestReplaced = false, imagesReplaced = false, routeReplaced = false;
+    for (const String &path : committed) {
+        if (path == ASSET_MANIFEST_PATH) {
+            manifestReplaced = true;
+        } else if (path.startsWith(ASSET_ROOT_DIR "/") && path.endsWith(".bmp")) {
+            assetManifest.update(path);
+            imagesReplaced = true;
+            for (CSVReader *reader : readers) {
+                reader->touchRows(path); // その画像を参照する行
+            }
+        } else {
+            for (CSVReader *reader : readers) {
+                if (path == reader->path()) reader->reload();
+            }
+            if (path == ROUTE_CSV_PATH || path == ROUTE_STATION_CSV_PATH) routeReplaced = true;
+        }
     }
+    if (routeReplaced) {
+        routeGraph.load(); // 停車駅スクロールは drawMode3() が世代を比べて作り直す
+    }
+    if (manifestReplaced) {
+        assetManifest.begin();
+    } else if (imagesReplaced) {
+        LittleFS.remove(ASSET_MANIFEST_PATH); // 次回の起動時は走査して作成する
+    }
+    if (fontReplaced) {
+        bitmapFont.begin();
+        for (CSVReader *reader : readers) {
+            reader->touchRows("text:");
+            reader->touchRows("text[");
+        }
+    }
+    assetCache.clear();
+
+    xQueueSend(uploadResultQueue, &result, 0);
+    return result.committed > 0;
 }
 
 /**
@@ -620,27 +810,64 @@ void drawMode3(CSVReader &typeReader, CSVReader &destReader, CSVReader &nextRead
 void panelTask(void *pvParameters) {
     static int last_mode = -1;
     static int last_full = -1, last_type = -1, last_dest = -1, last_dep = -1, last_next = -1;
+    static uint32_t last_fullGen = 0; // 全画面表示の行の世代（Mode 1～3 は各描画関数で比較）
+    static bool changePending = false;     // 切り替え待ちの変更があるか
+    static unsigned long changeSeenAt = 0; // 変更に気付いた時刻
 
     while (true) {
-        // 1. モード変更 or 列車情報の更新があれば再描画
-        if (mode != last_mode || num_full != last_full || num_type != last_type ||
-            num_dest != last_dest || num_dep != last_dep || num_next != last_next) {
+        frameGovernor.beginFrame();
+
+        // 0. 時刻表の再生（再生中のみ表示内容を書き換える）・プリセットの操作
+        updateTimetable();
+        updatePresets();
+
+        // 0.1 アップロードしたファイルに置き換える（プリセットは行の世代を持たないため全体を描画し直す）
+        if (updateUploads() && mode == 4) {
+            last_mode = -1;
+        }
+
+        // 1. モード変更 or 列車情報の更新（全画面表示の行の書き換えを含む）があれば再描画
+        //    変更に気付いてから `FRAME_COMMAND_SETTLE_MS` の間は表示中の内容のままトグル / スクロールを続け、
+        //    その間に続けて届いた変更はまとめて 1 回で切り替える（プリセットと UART の set-state は待たずに切り替える）
+        uint32_t serialSequence = serialCommand.requestedSequence(); // 変数を読む前に記録（表示までの時間の計測用）
+        bool changed = mode != last_mode || num_full != last_full || num_type != last_type ||
+                       num_dest != last_dest || num_dep != last_dep || num_next != last_next ||
+                       (mode == 0 && fullReader.rowGeneration(num_full) != last_fullGen);
+        if (changed && !changePending) {
+            changePending = true;
+            changeSeenAt = millis();
+        } else if (!changed) {
+            changePending = false; // 元の値に戻された場合
+        }
+        bool applied = false;
+        if (changed && (mode == 4 || serialCommand.pending() || millis() - changeSeenAt >= FRAME_COMMAND_SETTLE_MS)) {
+            changePending = false;
+            applied = true;
 
             #ifdef DEBUG
                 Serial.printf("mode: %d\tnum_full: %d\tnum_type: %d\tnum_dest: %d\tnum_next: %d\n",
                               mode, num_full, num_type, num_dest, num_next);
             #endif
 
-            vTaskDelay(100 / portTICK_PERIOD_MS); // 安定性のため 100 ミリ秒の遅延を追加
+            // 1.1 表示中のトグル / スクロールの記録を消去（描画関数が改めて登録する）
+            activeScene = ActiveScene();
+            transitions.finishAll(); // 実行中の切り替え効果は最後のコマを描画して終了
+
+            if (mode == 4) {
+                scenePreset.invalidate(); // プリセットは次のフレームに全体を描画
+            }
 
             // 2. モードに応じて適切な描画関数を呼び出す
             if (mode == 0) {
+                unsigned long drawStart = micros();
                 drawMode0(fullReader, num_full);  // 全画面表示
+                panelMetrics.observeDraw(0, micros() - drawStart);
             }
 
             // 3. 直前の状態を保存（次回比較用）
             last_mode = mode;
             last_full = num_full;
+            last_fullGen = fullReader.rowGeneration(num_full);
             last_type = num_type;
             last_dest = num_dest;
             last_dep = num_dep;
@@ -648,13 +875,51 @@ void panelTask(void *pvParameters) {
         }
 
         // 4. Mode 1, 2, 3 は RTC を使用したトグル / スクロール処理のため、常に実行
-        if (mode == 1) {
-            drawMode1(typeReader, destReader, num_type, num_dest, num_next);  // 種別 + 行先 (俗に言う始発表示)
-        } else if (mode == 2) {
-            drawMode2(typeReader, destReader, nextReader, num_type, num_dest, num_next);
-        } else if (mode == 3) {
-            drawMode3(typeReader, destReader, nextReader, num_type, num_dest, num_dep);
+        //    切り替え待ちの変更があっても、表示中の内容（直前に切り替えた値）で描画する
+        int drawnMode = last_mode; // drawMode3 がフォールバックで mode を書き換えるため記録しておく
+        unsigned long drawStart = micros();
+        if (last_mode == 1) {
+            drawMode1(typeReader, destReader, last_type, last_dest, last_next);  // 種別 + 行先 (俗に言う始発表示)
+        } else if (last_mode == 2) {
+            drawMode2(typeReader, destReader, nextReader, last_type, last_dest, last_next);
+        } else if (last_mode == 3) {
+            drawMode3(typeReader, destReader, nextReader, last_type, last_dest, last_dep);
+        } else if (last_mode == 4) {
+            scenePreset.draw(); // プリセット（トグル / スクロールのみ更新）
+        }
+        if (drawnMode >= 1 && drawnMode <= 4) {
+            panelMetrics.observeDraw(drawnMode, micros() - drawStart);
+        }
+
+        // 4.1 実行中の切り替え効果を 1 コマ進める
+        transitions.update();
+
+        // 5. 描画が完了したフレームを表示（ダブルバッファの場合、変更があれば切り替え）
+        panelGeometry.presentFrame(matrix);
+        if (applied || !changed) {
+            serialCommand.presented(serialSequence, micros()); // UART の set-state から表示までの時間を記録
         }
+
+        // 6. 描画の合間に先読みを 1 件処理（ヒープに余裕があり、フレームの予算に収まる場合のみ）
+        if (assetCache.pendingCount() > 0 && ESP.getMaxAllocHeap() > PRELOAD_HEAP_RESERVE &&
+            frameGovernor.admit(FRAME_WORK_BACKGROUND)) {
+            FrameWorkTimer timer(FRAME_WORK_BACKGROUND);
+            assetCache.pump();
+        }
+
+        // 7. 表示状態が落ち着いたら、次回の起動用に表示状態とフレームを保存（フレームの予算に収まる場合のみ）
+        unsigned long now = millis();
+        bootState.note(currentDisplayState(), now);
+        if (bootState.due(now) && frameGovernor.admit(FRAME_WORK_BACKGROUND)) {
+            FrameWorkTimer timer(FRAME_WORK_BACKGROUND);
+            bootState.update(frameMirror, now);
+        }
+
+        // 8. 閲覧中であれば、表示中のフレームを Web 画面のプレビュー用に公開
+        frameStream.publish(frameMirror, now);
+
+        // 9. このフレームの処理時間を予算と比べる（超えた場合は次のフレームでトグル・先読みを後回しにする）
+        frameGovernor.endFrame();
     }
 }
 
@@ -705,24 +970,394 @@ void sendStatus() {
     #endif
 }
 
+/**
+ * @brief 手動で表示を変更した場合に時刻表の再生を一時停止する（`/send` と UART の set-state）
+ */
+void pauseTimetableForManualChange() {
+    if (timetable.isPlaying()) {
+        TimetableCommand pause;
+        pause.type = TIMETABLE_CMD_PAUSE;
+        xQueueSend(timetableQueue, &pause, 0);
+    }
+}
+
+/**
+ * @brief UART から届いた要求を処理する（シリアルコマンドの受信タスクから呼ばれる）
+ *
+ * - `SERIAL_SET_STATE`: `/send` と同じく、指定された項目の変数を書き換える（時刻表の再生中は一時停止）。
+ *   モードは最後に書き換え、パネル制御タスクが途中の組み合わせで切り替えないようにする
+ * - `SERIAL_QUERY_STATE`: `/status` と同じ値と、直前の set-state を表示に反映済みかを返す
+ *
+ * @param request 届いた要求
+ * @param reply 応答（`SERIAL_QUERY_STATE` の場合に設定）
+ * @param context 未使用
+ * @return 結果（`SerialStatus`）
+ */
+uint8_t handleSerialRequest(const SerialFrame &request, SerialFrame &reply, void *context) {
+    SerialDisplayTargets targets = { &mode, &num_full, &num_type, &num_dest, &num_dep, &num_next };
+    if (request.type == SERIAL_SET_STATE) {
+        // 1. 内容を確認（プリセットの Mode 4 は名前が必要なため /preset で呼び出す）
+        SerialSetState state;
+        uint8_t status = SerialCommand::decodeSetState(request, state);
+        if (status != SERIAL_STATUS_OK) return status;
+
+        // 2. 指定された項目を書き換える
+        TRACE_SCOPE("uart set-state");
+        pauseTimetableForManualChange();
+        SerialCommand::applySetState(state, targets);
+        return SERIAL_STATUS_OK;
+    }
+    if (request.type == SERIAL_QUERY_STATE) {
+        uint8_t flags = (serialCommand.pending() ? 0 : 0x01) | (timetable.isPlaying() ? 0x02 : 0);
+        return SerialCommand::encodeState(request, reply, targets, flags, serialCommand.lastLatencyUs());
+    }
+    return SERIAL_STATUS_BAD_TYPE;
+}
+
+/**
+ * @brief 動作状況を Prometheus テキスト形式で返す
+ *
+ * クライアントが `/metrics` にアクセスすると、以下の値を返す。
+ * - `drawModeN` の処理時間ヒストグラム、LittleFS 読み込みバイト数などの累積値（`panelMetrics`）
+ * - ヒープ残量・最低残量（ローウォーターマーク）・最大確保可能ブロック
+ * - `Panel_Task` / `Server_Task` のスタック残量の最小値（ハイウォーターマーク）
+ */
+void sendMetrics() {
+    String body;
+    body.reserve(4096);
+
+    // 1. 描画・読み込みの累積値
+    panelMetrics.appendPrometheus(body);
+
+    // 2. ヒープの状態
+    appendPrometheusGauge(body, "ledest_heap_free_bytes", "現在のヒープ空き容量", ESP.getFreeHeap());
+    appendPrometheusGauge(body, "ledest_heap_min_free_bytes", "起動後のヒープ空き容量の最小値", ESP.getMinFreeHeap());
+    appendPrometheusGauge(body, "ledest_heap_largest_free_block_bytes", "一度に確保できる最大ブロック", ESP.getMaxAllocHeap());
+
+    // 3. タスクのスタック残量（ESP32 ではバイト単位で返る）
+    body += "# HELP ledest_task_stack_high_water_bytes 起動後のスタック残量の最小値\n";
+    body += "# TYPE ledest_task_stack_high_water_bytes gauge\n";
+    body += "ledest_task_stack_high_water_bytes{task=\"Panel_Task\"} " + String((unsigned long)uxTaskGetStackHighWaterMark(TaskPanel)) + "\n";
+    body += "ledest_task_stack_high_water_bytes{task=\"Server_Task\"} " + String((unsigned long)uxTaskGetStackHighWaterMark(TaskServer)) + "\n";
+    appendPrometheusGauge(body, "ledest_task_stack_size_bytes", "各タスクに割り当てたスタックサイズ", TASK_STACK_SIZE);
+
+    // 4. 画像マニフェスト
+    appendPrometheusGauge(body, "ledest_assets_valid", "マニフェストに登録された有効な画像の数", assetManifest.size());
+    appendPrometheusGauge(body, "ledest_assets_invalid", "起動時の走査で無効と判定した画像の数", assetManifest.invalidCount());
+
+    // 5. 画像の先読み（時刻表）
+    appendPrometheusCounter(body, "ledest_preload_hits_total", "先読みした画像を表示に使った回数", assetCache.hitCount());
+    appendPrometheusCounter(body, "ledest_preload_evictions_total", "先読みした画像を使わずに破棄した回数", assetCache.evictCount());
+    appendPrometheusGauge(body, "ledest_preload_bytes", "先読みした画像が使っているメモリ", assetCache.bytes());
+    appendPrometheusGauge(body, "ledest_scene_image_bytes", "表示内容（Mode 2 / 3）の画像が使っているメモリ", Scene::residentBytes());
+
+    // 6. 文字列の表示（グリフキャッシュ）
+    appendPrometheusCounter(body, "ledest_glyph_cache_hits_total", "展開済みの文字を使った回数", bitmapFont.cacheHits());
+    appendPrometheusCounter(body, "ledest_glyph_cache_misses_total", "フォントファイルから文字を読み込んだ回数", bitmapFont.cacheMisses());
+
+    // 7. フレームの予算（締め切りに遅れた回数と後回しにした処理）
+    appendPrometheusCounter(body, "ledest_frames_total", "描画ループの周回数", frameGovernor.frameCount());
+    appendPrometheusCounter(body, "ledest_frame_deadline_misses_total", "処理時間がフレームの予算を超えた回数", frameGovernor.missedDeadlines());
+    appendPrometheusGauge(body, "ledest_frame_worst_us", "最も長かったフレームの処理時間（マイクロ秒）", frameGovernor.worstFrameUs());
+    appendPrometheusCounter(body, "ledest_frame_deferred_toggles_total", "トグルを次のフレームに回した回数", frameGovernor.deferredCount(FRAME_WORK_TOGGLE));
+    appendPrometheusCounter(body, "ledest_frame_deferred_preloads_total", "先読みを次のフレームに回した回数", frameGovernor.deferredCount(FRAME_WORK_BACKGROUND));
+
+    // 8. フレームの配信（プレビュー）
+    appendPrometheusGauge(body, "ledest_frame_stream_clients", "フレームを配信中の接続の数", frameStream.clientCount());
+    appendPrometheusCounter(body, "ledest_frame_stream_bytes_total", "配信したフレームの合計バイト数", frameStream.bytesSent());
+
+    // 9. UART からのコマンド
+    appendPrometheusCounter(body, "ledest_serial_frames_total", "UART から受け付けたフレームの数", serialCommand.frameCount());
+    appendPrometheusCounter(body, "ledest_serial_crc_errors_total", "UART で CRC が合わずに捨てたフレームの数", serialCommand.crcErrors());
+    appendPrometheusCounter(body, "ledest_serial_oversize_frames_total", "UART で内容のバイト数が上限を超えていたため捨てたフレームの数", serialCommand.oversizeFrames());
+    appendPrometheusGauge(body, "ledest_serial_latency_us", "直前の set-state の受信から表示までの時間（マイクロ秒）", serialCommand.lastLatencyUs());
+    appendPrometheusGauge(body, "ledest_serial_worst_latency_us", "set-state の受信から表示までの最長時間（マイクロ秒）", serialCommand.worstLatencyUs());
+
+    // 10. 稼働時間
+    appendPrometheusGauge(body, "ledest_uptime_seconds", "起動からの経過秒数", millis() / 1000);
+
+    server.send(200, "text/plain; version=0.0.4", body);
+}
+
+/**
+ * @brief トレースバッファの内容を Chrome トレース JSON 形式で返す
+ *
+ * クライアントが `/trace` にアクセスすると、各コアの直近のイベント
+ * （画像読み込み・CSV 検索・スクロール・表示切り替え・HTTP コマンド）を返す。
+ * 保存した JSON は chrome://tracing や Perfetto で開ける。
+ * 応答は大きくなるため、チャンク転送で少しずつ送信する。
+ */
+void sendTrace() {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    traceBuffer.exportChromeTrace([](const String &chunk, void *) {
+        server.sendContent(chunk);
+    }, nullptr);
+    server.sendContent(""); // チャンク転送の終端
+}
+
+/**
+ * @brief 表示中のフレームを返す
+ *
+ * - `/frame`（`?format=rgb565`）: RGB565 の画素（リトルエンディアン、左上から行ごと）
+ * - `/frame?format=png`: PNG（24 ビット）
+ * 大きさとフレームの番号は `X-Frame-Width` / `X-Frame-Height` / `X-Frame-Sequence` ヘッダーで返す。
+ */
+void handleFrame() {
+    TRACE_SCOPE("http /frame");
+    String format = server.hasArg("format") ? server.arg("format") : "rgb565";
+    if (format != "rgb565" && format != "png") {
+        server.send(400, "text/plain", "unknown format");
+        return;
+    }
+
+    // 1. 公開中のフレームを取り出す
+    int width = frameStream.width();
+    int height = frameStream.height();
+    size_t frameBytes = (size_t)width * height * sizeof(uint16_t);
+    uint16_t *frame = (uint16_t *)malloc(frameBytes);
+    uint32_t sequence = 0;
+    if (!frame || !frameStream.snapshot(frame, sequence)) {
+        free(frame);
+        server.send(503, "text/plain", "frame not available");
+        return;
+    }
+    server.sendHeader("Cache-Control", "no-store");
+    server.sendHeader("X-Frame-Width", String(width));
+    server.sendHeader("X-Frame-Height", String(height));
+    server.sendHeader("X-Frame-Sequence", String((unsigned long)sequence));
+
+    // 2. 指定の形式で返す
+    if (format == "png") {
+        uint8_t *png = (uint8_t *)malloc(FrameStream::pngSize(width, height));
+        if (!png) {
+            free(frame);
+            server.send(503, "text/plain", "out of memory");
+            return;
+        }
+        size_t pngBytes = FrameStream::encodePNG(frame, width, height, png);
+        server.setContentLength(pngBytes);
+        server.send(200, "image/png", "");
+        server.sendContent((const char *)png, pngBytes);
+        free(png);
+    } else {
+        server.setContentLength(frameBytes);
+        server.send(200, "application/octet-stream", "");
+        server.sendContent((const char *)frame, frameBytes);
+    }
+    free(frame);
+}
+
+/**
+ * @brief 表示中のフレームの差分を配信し続ける（形式は `FrameStreamHeader` を参照）
+ *
+ * 接続は配信タスクに引き継ぐため、Web サーバーのタスクはすぐに次のリクエストを処理できる。
+ */
+void handleFrameStream() {
+    if (!frameStream.addClient(server.client())) {
+        server.send(503, "text/plain", "too many viewers");
+    }
+}
+
+/**
+ * @brief 時刻表の操作と再生状態の取得
+ *
+ * `cmd` を指定すると操作をパネル制御タスクへ渡し、指定しない場合は再生状態を JSON で返す。
+ * - `/timetable?cmd=load&file=/timetable/sample.csv[&index=N]` 読み込んで再生
+ * - `/timetable?cmd=play` / `pause` / `stop` 再生 / 一時停止 / 停止
+ * - `/timetable?cmd=skip[&count=N]` N 行進める（負の値で戻る、省略時は 1）
+ * - `/timetable?cmd=seek&index=N` N 行目（0 始まり）へ移動
+ * - `/timetable?cmd=event&name=depart` イベントを通知（現在の行の trigger と一致すれば次へ）
+ * - 例: `{ "state": "playing", "file": "/timetable/sample.csv", "index": 2, "count": 8, "remaining_ms": 41000 }`
+ */
+void handleTimetable() {
+    // 1. cmd が無い場合は再生状態を返す
+    if (!server.hasArg("cmd")) {
+        String json = "{";
+        json += "\"state\":\"" + String(timetable.stateName()) + "\",";
+        json += "\"file\":\"" + timetable.path() + "\",";
+        json += "\"index\":" + String((unsigned long)timetable.index()) + ",";
+        json += "\"count\":" + String((unsigned long)timetable.size()) + ",";
+        json += "\"remaining_ms\":" + String(timetable.remaining(millis())) + ",";
+        json += "\"preload_pending\":" + String((unsigned long)assetCache.pendingCount());
+        json += "}";
+        server.send(200, "application/json", json);
+        return;
+    }
+
+    // 2. 操作の内容を組み立てる
+    TimetableCommand command;
+    String cmd = server.arg("cmd");
+    if (cmd == "load") {
+        String file = server.arg("file");
+        if (file.length() == 0 || file.length() >= sizeof(command.text)) {
+            server.send(400, "text/plain", "file not specified");
+            return;
+        }
+        command.type = TIMETABLE_CMD_LOAD;
+        command.value = server.hasArg("index") ? server.arg("index").toInt() : 0;
+        strncpy(command.text, file.c_str(), sizeof(command.text) - 1);
+    } else if (cmd == "play") {
+        command.type = TIMETABLE_CMD_PLAY;
+    } else if (cmd == "pause") {
+        command.type = TIMETABLE_CMD_PAUSE;
+    } else if (cmd == "stop") {
+        command.type = TIMETABLE_CMD_STOP;
+    } else if (cmd == "skip") {
+        command.type = TIMETABLE_CMD_SKIP;
+        command.value = server.hasArg("count") ? server.arg("count").toInt() : 1;
+    } else if (cmd == "seek" && server.hasArg("index")) {
+        command.type = TIMETABLE_CMD_SEEK;
+        command.value = server.arg("index").toInt();
+    } else if (cmd == "event" && server.hasArg("name")) {
+        command.type = TIMETABLE_CMD_EVENT;
+        strncpy(command.text, server.arg("name").c_str(), sizeof(command.text) - 1);
+    } else {
+        server.send(400, "text/plain", "unknown command");
+        return;
+    }
+
+    // 3. パネル制御タスクへ渡す（反映は次の描画ループ）
+    if (xQueueSend(timetableQueue, &command, 0) != pdTRUE) {
+        server.send(503, "text/plain", "timetable busy");
+        return;
+    }
+    server.send(200, "text/plain", "timetable: " + cmd);
+}
+
+/**
+ * @brief プリセットの保存・呼び出し・削除と一覧の取得
+ *
+ * - `/preset?cmd=save&name=kaiso` 表示中の内容を保存（トグルの全段階とスクロールを含む）
+ * - `/preset?cmd=recall&name=kaiso` 呼び出して表示（Mode 4）
+ * - `/preset?cmd=delete&name=kaiso` 削除
+ * - `cmd` を指定しない場合は保存済みのプリセット名と表示中のプリセットを JSON で返す
+ *   （例: `{ "presets": ["kaiso","shiunten"], "current": "kaiso" }`）
+ */
+void handlePreset() {
+    // 1. cmd が無い場合は一覧を返す
+    if (!server.hasArg("cmd")) {
+        String json = "{\"presets\":" + ScenePreset::listJson() + ",";
+        json += "\"current\":\"" + String(mode == 4 ? scenePreset.name() : String()) + "\"}";
+        server.send(200, "application/json", json);
+        return;
+    }
+
+    // 2. プリセット名を確認
+    String cmd = server.arg("cmd");
+    String name = server.arg("name");
+    if (!ScenePreset::isValidName(name)) {
+        server.send(400, "text/plain", "invalid name");
+        return;
+    }
+
+    // 3. 削除はこのタスクで処理
+    if (cmd == "delete") {
+        bool removed = ScenePreset::remove(name);
+        server.send(removed ? 200 : 404, "text/plain", removed ? "preset deleted" : "preset not found");
+        return;
+    }
+
+    // 4. 保存・呼び出しはパネル制御タスクへ渡す（表示中の内容を扱うため）
+    PresetCommand command;
+    if (cmd == "save") {
+        command.type = PRESET_CMD_SAVE;
+    } else if (cmd == "recall") {
+        command.type = PRESET_CMD_RECALL;
+        if (timetable.isPlaying()) {
+            // プリセットを呼び出した場合は時刻表の再生を一時停止する
+            TimetableCommand pause;
+            pause.type = TIMETABLE_CMD_PAUSE;
+            xQueueSend(timetableQueue, &pause, 0);
+        }
+    } else {
+        server.send(400, "text/plain", "unknown command");
+        return;
+    }
+    strncpy(command.name, name.c_str(), sizeof(command.name) - 1);
+    if (xQueueSend(presetQueue, &command, 0) != pdTRUE) {
+        server.send(503, "text/plain", "preset busy");
+        return;
+    }
+    server.send(200, "text/plain", "preset: " + cmd + " " + name);
+}
+
+bool uploadRejected = false; // 置き換え待ちのため今回の受信を受け付けなかったか
+
+/**
+ * @brief `/upload` の受信データを処理する（受信単位ごとに呼ばれる）
+ *
+ * - `path` を指定した場合は 1 ファイル（`crc32` が必須、無い場合は 400 を返す）
+ * - `path` を省略した場合はパック（tools/makePack.py で作成、ファイルごとに CRC32 を検証）
+ * 置き換え待ちのファイルがある間は、新しい受信を受け付けない。
+ */
+void handleUploadData() {
+    HTTPUpload &upload = server.upload();
+    if (upload.status == UPLOAD_FILE_START) {
+        uploadRejected = (assetUpload.state() == UPLOAD_STAGED);
+        if (uploadRejected) return;
+        if (server.hasArg("path")) {
+            assetUpload.beginFile(server.arg("path"), server.arg("crc32"));
+        } else {
+            assetUpload.beginPack();
+        }
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+        assetUpload.write(upload.buf, upload.currentSize);
+    } else if (upload.status == UPLOAD_FILE_END) {
+        assetUpload.finish();
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        assetUpload.abort("connection aborted");
+    }
+}
+
+/**
+ * @brief `/upload` の受信完了後に、パネル制御タスクへ置き換えを依頼して結果を返す
+ */
+void handleUploadDone() {
+    TRACE_SCOPE("http /upload");
+    // 1. 受信・検証に失敗した場合はその理由を返す
+    if (uploadRejected) {
+        server.send(503, "text/plain", "upload busy");
+        return;
+    }
+    if (assetUpload.state() != UPLOAD_STAGED) {
+        String reason = assetUpload.error().length() > 0 ? assetUpload.error() : String("no file");
+        server.send(400, "text/plain", "upload failed: " + reason);
+        return;
+    }
+
+    // 2. パネル制御タスクに置き換えを依頼し、完了を待つ
+    size_t files = assetUpload.fileCount();
+    uint32_t bytes = assetUpload.bytesReceived();
+    xQueueReset(uploadResultQueue);
+    uint8_t request = 1;
+    UploadResult result;
+    if (xQueueSend(uploadQueue, &request, 0) != pdTRUE ||
+        xQueueReceive(uploadResultQueue, &result, UPLOAD_COMMIT_TIMEOUT_MS / portTICK_PERIOD_MS) != pdTRUE) {
+        server.send(504, "text/plain", "upload staged, commit pending");
+        return;
+    }
+
+    // 3. 結果を返す
+    String json = "{\"ok\":" + String(result.ok ? "true" : "false");
+    json += ",\"files\":" + String((unsigned)files);
+    json += ",\"committed\":" + String((unsigned)result.committed);
+    json += ",\"bytes\":" + String((unsigned long)bytes) + "}";
+    server.send(result.ok ? 200 : 500, "application/json", json);
+}
+
 /**
  * @brief Web サーバータスク
  *
  * ESP32 の **コア 0** に割り当てられ、HTTP リクエストを処理する。
- * - WiFi に接続し、ESP32 の IP アドレスをシリアル出力
+ * - WiFi の接続（setup() で開始）を待ち、ESP32 の IP アドレスをシリアル出力
  * - `index.html` をクライアントへ送信
  * - `/send` エンドポイントでパラメータを受け取り、変数を更新
  *
  * @param pvParameters タスク用の引数（未使用）
  */
 void serverTask(void *pvParameters) {
-    #ifdef DEBUG
-        Serial.println("デバッグモード：WiFi接続を開始します…");
-    #endif
-
-    WiFi.begin(ssid, password);
-
-    // 1. WiFi 接続処理（接続完了まで 500ms ごとにチェック）
+    // 1. WiFi 接続処理（接続は setup() で開始済み、完了まで 500ms ごとにチェック）
     while (WiFi.status() != WL_CONNECTED) {
         delay(500);
         #ifdef DEBUG
@@ -756,6 +1391,8 @@ void serverTask(void *pvParameters) {
 
     // 3.2 `/send` で変数を更新
     server.on("/send", HTTP_GET, []() {
+        TRACE_SCOPE("http /send");
+        pauseTimetableForManualChange();
         web2gnum(&mode, "mode");
         web2gnum(&num_full, "full");
         web2gnum(&num_type, "type");
@@ -767,6 +1404,25 @@ void serverTask(void *pvParameters) {
     // 3.3 `/status` で現在の変数状態を取得 (JSON)
     server.on("/status", HTTP_GET, sendStatus);
 
+    // 3.3.1 `/metrics` で動作状況を取得 (Prometheus テキスト形式)
+    server.on("/metrics", HTTP_GET, sendMetrics);
+
+    // 3.3.2 `/trace` で処理のトレースを取得 (Chrome トレース JSON)
+    server.on("/trace", HTTP_GET, sendTrace);
+
+    // 3.3.3 `/timetable` で時刻表の再生を操作
+    server.on("/timetable", HTTP_GET, handleTimetable);
+
+    // 3.3.4 `/preset` でプリセットを保存・呼び出し
+    server.on("/preset", HTTP_GET, handlePreset);
+
+    // 3.3.5 `/upload` で画像・CSV などを書き込む（POST、multipart/form-data）
+    server.on("/upload", HTTP_POST, handleUploadDone, handleUploadData);
+
+    // 3.3.6 `/frame` で表示中のフレームを取得（RGB565 / PNG）、`/frame/stream` で差分を配信
+    server.on("/frame", HTTP_GET, handleFrame);
+    server.on("/frame/stream", HTTP_GET, handleFrameStream);
+
     // 3.4 `/test` でCSV表示用の `test_csv.html` を提供
     server.on("/test", HTTP_GET, []() {
         File file = LittleFS.open("/test_csv.html", "r");
@@ -862,12 +1518,59 @@ void setup() {
     // 3. LED パネルの初期化
     initPanel();
 
-    // 4. タスクの作成とコア割り当て
-    // 4.1 パネル描画処理（コア 1）
-    xTaskCreatePinnedToCore(panelTask, "Panel_Task", 4096, NULL, 1, &TaskPanel, 1);
+    // 3.1 前回の表示状態を復元し、保存したフレームをそのまま表示（CSV や BMP の準備を待たない）
+    restoreDisplayState();
+
+    // 3.2 WiFi の接続を開始（接続の完了は Web サーバーのタスクで待つ）
+    #ifdef DEBUG
+        Serial.println("デバッグモード：WiFi接続を開始します…");
+    #endif
+    WiFi.begin(ssid, password);
+
+    // 3.3 前回のアップロードで残った一時ファイルを削除
+    AssetUpload::cleanupStaging();
+
+    // 3.4 画像マニフェストを用意し、CSV が参照する画像を事前に確認
+    if (assetManifest.begin()) {
+        size_t missing = assetManifest.verifyCatalog("/list/list_full.csv")
+                       + assetManifest.verifyCatalog("/list/list_type.csv")
+                       + assetManifest.verifyCatalog("/list/list_dest.csv")
+                       + assetManifest.verifyCatalog("/list/list_next.csv");
+        if (missing > 0) {
+            Serial.printf("CSV が参照する画像のうち %u 件が見つからないか無効です。\n", (unsigned)missing);
+        }
+    }
+
+    // 3.5 フォントを開く（CSV の `text:...` の表示用、無い場合は画像のみ使用）
+    bitmapFont.begin();
+
+    // 3.6 CSV の各行のハッシュを記録（アップロードで書き換えられたとき、変わった行だけを作り直すため）
+    fullReader.reload();
+    typeReader.reload();
+    destReader.reload();
+    nextReader.reload();
+
+    // 3.7 路線図を読み込む（停車駅スクロールの途中駅・路線名の判別に使用）
+    routeGraph.load();
+
+    // 4. タスクの作成とコア割り当て（時刻表の操作キューを先に用意）
+    timetableQueue = xQueueCreate(TIMETABLE_QUEUE_LENGTH, sizeof(TimetableCommand));
+    presetQueue = xQueueCreate(PRESET_QUEUE_LENGTH, sizeof(PresetCommand));
+    uploadQueue = xQueueCreate(1, sizeof(uint8_t));
+    uploadResultQueue = xQueueCreate(1, sizeof(UploadResult));
+
+    // 4.1 パネル描画処理（コア 1）、画像の展開はコア 0 のワーカーと分担する
+    decodePool.begin();
+    frameStream.begin(panelWidth, panelHeight); // プレビュー用のフレーム配信（配信の送信はコア 0）
+    xTaskCreatePinnedToCore(panelTask, "Panel_Task", TASK_STACK_SIZE, NULL, 1, &TaskPanel, 1);
 
     // 4.2 HTTP 処理（コア 0）
-    xTaskCreatePinnedToCore(serverTask, "Server_Task", 4096, NULL, 1, &TaskServer, 0);
+    xTaskCreatePinnedToCore(serverTask, "Server_Task", TASK_STACK_SIZE, NULL, 1, &TaskServer, 0);
+
+    // 4.3 UART からのコマンド（コア 0、Web サーバーのタスクより優先）
+    if (!serialCommand.begin(Serial, handleSerialRequest)) {
+        Serial.println("シリアルコマンドのタスクを作成できませんでした。");
+    }
 
     #ifdef DEBUG
         Serial.println("Initialized");
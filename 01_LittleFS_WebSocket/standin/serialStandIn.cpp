@@ -0,0 +1,185 @@
+/*
+ * Custom License (自由利用ライセンス)
+ *
+ * Copyright (c) 2025 RChikamura
+ *
+ * このソフトウェアは自由に利用・改変・再配布できますが、
+ * 著作権は RChikamura に帰属します。
+ * 再配布時は、本ライセンス文を保持してください。
+ *
+ * 問い合わせには可能な範囲で対応しますが、全てのサポートを保証するものではありません。
+ * 本ソフトウェアは「現状のまま」提供され、いかなる保証も行いません。
+ * 利用に伴う損害について、作者は一切責任を負いません。
+ */
+// ===============================
+//      UART コマンドの代役（PC 上の疑似端末）
+// ===============================
+// 実機の代わりに疑似端末 (pty) を開き、src/SerialCommand.cpp で UART からのコマンドに応答する。
+// 列車制御側のプログラムや tools/serialCommand.py を、表示器をつながずに Linux 上で試すためのもの。
+//
+// 表示内容は変数で持つだけで描画はしない。パネル制御タスクの代わりに `--loop-ms` おきに
+// 表示を更新したものとして `presented()` を呼ぶ（`--draw-ms` で表示内容の作成にかかる時間を足せる）。
+//
+// 使い方:
+//   serialStandIn [--loop-ms <ms>] [--draw-ms <ms>] [--log]
+//
+// 起動すると接続先（/dev/pts/N）を表示する。`--log` を指定した場合は、実機と同じく
+// 同じ端末にログの文字列を混ぜて出力する（フレームの読み飛ばしの確認用）。
+
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+#include "SerialCommand.h"
+
+// ===============================
+//      疑似端末を Stream として扱う
+// ===============================
+class PtyStream : public Stream {
+public:
+    explicit PtyStream(int fd) : fd(fd) {}
+
+    int available() override {
+        if (peeked < 0) {
+            uint8_t byte;
+            if (::read(fd, &byte, 1) == 1) peeked = byte;
+        }
+        return peeked < 0 ? 0 : 1;
+    }
+
+    int read() override {
+        if (available() == 0) return -1;
+        int byte = peeked;
+        peeked = -1;
+        return byte;
+    }
+
+    size_t write(const uint8_t *data, size_t length) override {
+        size_t written = 0;
+        while (written < length) {
+            ssize_t n = ::write(fd, data + written, length - written);
+            if (n <= 0) break;
+            written += n;
+        }
+        return written;
+    }
+
+private:
+    int fd;
+    int peeked = -1; // 先に読んだ 1 バイト（無い場合は -1）
+};
+
+// ===============================
+//      表示内容（main.cpp の変数の代わり）
+// ===============================
+static unsigned short mode = 3;
+static unsigned short num_full = 0;
+static unsigned short num_type = 1;
+static unsigned short num_dest = 1;
+static unsigned short num_dep = 1;
+static unsigned short num_next = 1;
+
+// 実時間を仮想時計（millis / micros）に反映する
+static void syncClock() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    hostClockMicros = (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief 要求を処理する（main.cpp の handleSerialRequest と同じく SerialCommand の関数で処理、時刻表は無い）
+ */
+static uint8_t handleRequest(const SerialFrame &request, SerialFrame &reply, void *context) {
+    SerialDisplayTargets targets = { &mode, &num_full, &num_type, &num_dest, &num_dep, &num_next };
+    if (request.type == SERIAL_SET_STATE) {
+        SerialSetState state;
+        uint8_t status = SerialCommand::decodeSetState(request, state);
+        if (status != SERIAL_STATUS_OK) return status;
+        SerialCommand::applySetState(state, targets);
+        fprintf(stderr, "set-state: mode %u full %u type %u dest %u dep %u next %u\n",
+                mode, num_full, num_type, num_dest, num_dep, num_next);
+        return SERIAL_STATUS_OK;
+    }
+    if (request.type == SERIAL_QUERY_STATE) {
+        uint8_t flags = serialCommand.pending() ? 0 : 0x01;
+        return SerialCommand::encodeState(request, reply, targets, flags, serialCommand.lastLatencyUs());
+    }
+    return SERIAL_STATUS_BAD_TYPE;
+}
+
+int main(int argc, char **argv) {
+    // 1. コマンドライン引数の解析
+    unsigned long loopMs = 10;
+    unsigned long drawMs = 0;
+    bool log = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--loop-ms" && hasValue) loopMs = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--draw-ms" && hasValue) drawMs = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--log") log = true;
+        else {
+            printf("usage: %s [--loop-ms ms] [--draw-ms ms] [--log]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // 2. 疑似端末を開く（接続先は raw モードにし、改行の変換やエコーをしない）
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char *slavePath = ptsname(master);
+    int slave = open(slavePath, O_RDWR | O_NOCTTY); // 開いたままにし、接続先が閉じても読み書きを続ける
+    termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    tcgetattr(master, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(master, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    printf("%s\n", slavePath);
+    fflush(stdout);
+
+    // 3. 受信タスクの代わりに、このループで poll() を呼ぶ
+    PtyStream port(master);
+    syncClock();
+    serialCommand.begin(port, handleRequest); // ホストではタスクを作らない
+    unsigned long lastLoop = millis();
+    unsigned long lastLog = millis();
+    uint32_t drawingSequence = 0;
+    unsigned long drawStartedAt = 0;
+    bool drawing = false;
+    while (true) {
+        syncClock();
+        serialCommand.poll();
+
+        // 4. パネル制御タスクの代わり（変更があれば `--draw-ms` の後に表示したものとする）
+        if (millis() - lastLoop >= loopMs) {
+            lastLoop = millis();
+            uint32_t sequence = serialCommand.requestedSequence();
+            if (!drawing && serialCommand.pending()) {
+                drawing = true;
+                drawingSequence = sequence;
+                drawStartedAt = millis();
+            }
+            if (drawing && millis() - drawStartedAt >= drawMs) {
+                drawing = false;
+                serialCommand.presented(drawingSequence, micros());
+                fprintf(stderr, "presented: latency %u us\n", serialCommand.lastLatencyUs());
+            }
+        }
+
+        // 5. 実機と同じく、同じ端末にログを混ぜる
+        if (log && millis() - lastLog >= 500) {
+            lastLog = millis();
+            static const char message[] = "[log] 表示を更新しました。\xA5\xA5 (0xA5 を含む)\n";
+            port.write((const uint8_t *)message, sizeof(message) - 1);
+        }
+        usleep(1000);
+    }
+}
@@ -0,0 +1,103 @@
+import os
+import struct
+import argparse
+
+# ESP32 側（src/BMPDecoder.cpp の readBMPInfo）と同じ条件で検証する
+BMP_MAX_DIMENSION = 4096
+
+def read_bmp_info(path):
+    """
+    BMPヘッダーを読み取り、表示可能な形式なら情報を返す（無効ならエラーメッセージを返す）
+    """
+    size = os.path.getsize(path)
+    with open(path, "rb") as f:
+        header = f.read(54)
+    if len(header) != 54:
+        return None, "ヘッダーが短すぎます"
+    if header[0:2] != b"BM":
+        return None, "BMPファイルではありません"
+
+    offset, = struct.unpack_from("<I", header, 10)
+    dib_size, width, height, planes, bpp, compression = struct.unpack_from("<IiiHHI", header, 14)
+    if dib_size < 40 or planes != 1:
+        return None, "未対応の情報ヘッダーです"
+    if width <= 0 or width > BMP_MAX_DIMENSION or height == 0 or abs(height) > BMP_MAX_DIMENSION:
+        return None, f"画像サイズが不正です ({width} x {height})"
+    supported = {1: (0,), 4: (0, 2), 8: (0, 1), 16: (0, 3), 24: (0,), 32: (0, 3)}
+    is_rle = compression in (1, 2)
+    if compression not in supported.get(bpp, ()) or (is_rle and height < 0):
+        return None, f"未対応の形式です ({bpp} bit, 圧縮 {compression})"
+
+    # カラーパレット / ビットマスクの位置
+    colors = 0
+    extra_end = 14 + dib_size
+    if bpp <= 8:
+        colors, = struct.unpack_from("<I", header, 46)
+        if colors == 0 or colors > (1 << bpp):
+            colors = 1 << bpp
+        extra_end += colors * 4
+    elif compression == 3 and dib_size == 40:
+        extra_end += 12
+    if offset < extra_end:
+        return None, "パレット / ビットマスクが不正です"
+
+    # ピクセルデータの範囲（RLE は圧縮後のサイズで確認）
+    image_size, = struct.unpack_from("<I", header, 34)
+    pixel_bytes = image_size if is_rle else ((width * bpp + 31) // 32) * 4 * abs(height)
+    if offset >= size or offset + pixel_bytes > size:
+        return None, "ピクセルデータがファイルに収まっていません"
+
+    return {
+        "width": width,
+        "height": abs(height),
+        "offset": offset,
+        "bpp": bpp,
+        "compression": compression,
+        "topdown": 1 if height < 0 else 0,
+        "size": size,
+        "dib": dib_size,
+        "colors": colors,
+    }, None
+
+def build_manifest(data_dir, image_dir):
+    """
+    data_dir/image_dir 以下の BMP を走査し、(LittleFS 上のパス, 情報) のリストを返す
+    """
+    entries = []
+    invalid = 0
+    for root, _, files in os.walk(os.path.join(data_dir, image_dir)):
+        for file in files:
+            if not file.endswith(".bmp"):
+                continue
+            host_path = os.path.join(root, file)
+            fs_path = "/" + os.path.relpath(host_path, data_dir).replace(os.sep, "/")
+            info, error = read_bmp_info(host_path)
+            if info is None:
+                print(f"無効な画像: {fs_path} ({error})")
+                invalid += 1
+                continue
+            entries.append((fs_path, info))
+    entries.sort(key=lambda e: e[0].encode("utf-8"))  # ESP32 側の strcmp と同じ順序
+    return entries, invalid
+
+def main():
+    """
+    コマンドライン引数を解析し、マニフェスト（CSV）を書き出す
+    """
+    parser = argparse.ArgumentParser(description="画像マニフェスト (manifest.csv) を作成")
+    parser.add_argument("-d", "--data", default="data", help="LittleFS に書き込む data フォルダのパス")
+    parser.add_argument("-i", "--images", default="img", help="data フォルダ内の画像フォルダ")
+    parser.add_argument("-o", "--output", help="出力先（省略時は data/manifest.csv）")
+    args = parser.parse_args()
+
+    entries, invalid = build_manifest(args.data, args.images)
+    output = args.output or os.path.join(args.data, "manifest.csv")
+    with open(output, "w", newline="\n", encoding="utf-8") as f:
+        f.write("path,width,height,offset,bpp,compression,topdown,size,dib,colors\n")
+        for path, info in entries:
+            f.write(f"{path},{info['width']},{info['height']},{info['offset']},{info['bpp']},"
+                    f"{info['compression']},{info['topdown']},{info['size']},{info['dib']},{info['colors']}\n")
+    print(f"{output}: 有効 {len(entries)} 件 / 無効 {invalid} 件")
+
+if __name__ == "__main__":
+    main()
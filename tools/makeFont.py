@@ -0,0 +1,162 @@
+import os
+import struct
+import argparse
+
+# ESP32 側（src/BitmapFont.h）と同じ上限
+FONT_MAX_HEIGHT = 32
+FONT_MAX_WIDTH = 32
+
+def jis_to_unicode(code, charset):
+    """
+    BDF の ENCODING（JIS X 0208 / JIS X 0201 の区点コード）を Unicode に変換する（変換できなければ None）
+    """
+    try:
+        if charset.startswith("JISX0208"):
+            return ord(bytes([(code >> 8) | 0x80, (code & 0xFF) | 0x80]).decode("euc_jp"))
+        if charset.startswith("JISX0201"):
+            if code < 0x80:
+                return code
+            return ord(bytes([0x8E, code]).decode("euc_jp"))  # 半角カナ
+    except (UnicodeDecodeError, ValueError):
+        return None
+    return code  # ISO10646 / ISO8859-1 などはそのまま
+
+def read_bdf(path):
+    """
+    BDF フォントを読み込み、{Unicode: (幅, 行のビット列のリスト)} と文字の高さを返す
+    """
+    glyphs = {}
+    charset = ""
+    font_ascent = font_descent = 0
+    with open(path, "r", encoding="latin-1") as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        if words[0] == "CHARSET_REGISTRY":
+            charset = words[1].strip('"').upper()
+        elif words[0] == "FONT_ASCENT":
+            font_ascent = int(words[1])
+        elif words[0] == "FONT_DESCENT":
+            font_descent = int(words[1])
+        elif words[0] == "STARTCHAR":
+            encoding = -1
+            dwidth = bbx = None
+            rows = []
+            for line in lines:
+                words = line.split()
+                if not words:
+                    continue
+                if words[0] == "ENCODING":
+                    encoding = int(words[1])
+                elif words[0] == "DWIDTH":
+                    dwidth = int(words[1])
+                elif words[0] == "BBX":
+                    bbx = [int(w) for w in words[1:5]]
+                elif words[0] == "BITMAP":
+                    for line in lines:
+                        if line.strip() == "ENDCHAR":
+                            break
+                        rows.append(line.strip())
+                    break
+            code = jis_to_unicode(encoding, charset) if encoding >= 0 else None
+            if code is None or bbx is None:
+                continue
+            glyphs[code] = (dwidth if dwidth is not None else bbx[0], bbx, rows)
+
+    # 文字の高さはフォント全体の ascent + descent で揃える
+    height = font_ascent + font_descent
+    result = {}
+    for code, (advance, (bw, bh, bx, by), rows) in glyphs.items():
+        width = max(advance, 1)
+        bitmap = [0] * height
+        for i, row in enumerate(rows[:bh]):
+            y = font_ascent - (by + bh) + i  # ベースラインからの位置を行番号に変換
+            if y < 0 or y >= height or not row:
+                continue
+            bits = int(row, 16)
+            total = len(row) * 4
+            for x in range(bw):
+                if bits & (1 << (total - 1 - x)) and 0 <= bx + x < width:
+                    bitmap[y] |= 1 << (width - 1 - (bx + x))
+        result[code] = (width, bitmap)
+    return result, height
+
+def collect_chars(args):
+    """
+    収録する文字を集める（ASCII は常に収録、指定が無い場合はすべての文字）
+    """
+    if not args.chars_from and not args.chars:
+        return None
+    chars = set(range(0x20, 0x7F))
+    for path in args.chars_from or []:
+        with open(path, "r", encoding="utf-8") as f:
+            chars.update(ord(c) for c in f.read() if c >= " ")
+    chars.update(ord(c) for c in (args.chars or ""))
+    return chars
+
+def write_lfn(path, glyphs, height):
+    """
+    ESP32 が読み込むフォントファイル（.lfn）を書き出す
+    """
+    codes = sorted(glyphs)
+    max_width = max(glyphs[c][0] for c in codes)
+    data_offset = 12 + len(codes) * 8
+    index = bytearray()
+    data = bytearray()
+    for code in codes:
+        width, bitmap = glyphs[code]
+        row_bytes = (width + 7) // 8
+        index += struct.pack("<II", code, data_offset + len(data))
+        data.append(width)
+        for row in bitmap:
+            data += (row << (row_bytes * 8 - width)).to_bytes(row_bytes, "big")  # 左端を最上位ビットへ
+    with open(path, "wb") as f:
+        f.write(b"LFN1" + struct.pack("<BBHI", height, max_width, 0, len(codes)))
+        f.write(index)
+        f.write(data)
+    return len(codes), max_width, data_offset + len(data)
+
+def main():
+    """
+    コマンドライン引数を解析し、BDF フォントを .lfn に変換する
+    """
+    parser = argparse.ArgumentParser(description="BDF フォントを ESP32 用のフォントファイル (.lfn) に変換")
+    parser.add_argument("bdf", nargs="+", help="BDF フォント（複数指定時は先に指定したものを優先）")
+    parser.add_argument("-o", "--output", default="default.lfn", help="出力先（data/font/default.lfn に置くと起動時に読み込む）")
+    parser.add_argument("-c", "--chars-from", action="append", help="収録する文字を含むファイル（CSV など、複数指定可）")
+    parser.add_argument("--chars", help="収録する文字（直接指定）")
+    args = parser.parse_args()
+
+    # 1. BDF を読み込み、先に指定したフォントを優先して統合
+    glyphs = {}
+    height = None
+    for path in args.bdf:
+        font, font_height = read_bdf(path)
+        if height is None:
+            height = font_height
+        elif font_height != height:
+            parser.error(f"{path}: 文字の高さが一致しません ({font_height} / {height})")
+        for code, glyph in font.items():
+            glyphs.setdefault(code, glyph)
+    if not height or height > FONT_MAX_HEIGHT:
+        parser.error(f"文字の高さ {height} には対応していません（1～{FONT_MAX_HEIGHT}）")
+
+    # 2. 使う文字だけに絞る
+    chars = collect_chars(args)
+    if chars is not None:
+        missing = sorted(c for c in chars if c not in glyphs and c >= 0x7F)  # ASCII は無くても報告しない
+        if missing:
+            print("フォントに無い文字: " + "".join(chr(c) for c in missing))
+        glyphs = {c: g for c, g in glyphs.items() if c in chars}
+    glyphs = {c: g for c, g in glyphs.items() if g[0] <= FONT_MAX_WIDTH}
+    if not glyphs:
+        parser.error("収録する文字がありません")
+
+    # 3. 書き出し
+    count, max_width, size = write_lfn(args.output, glyphs, height)
+    print(f"{args.output}: {count} 文字 / 高さ {height} / 最大幅 {max_width} / {size} バイト")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+import os
+import struct
+import zlib
+import argparse
+import urllib.request
+import uuid
+
+# ESP32 側（src/AssetUpload.h）と同じ上限
+UPLOAD_PATH_MAX = 64
+UPLOAD_MAX_FILES = 256
+
+def collect_files(data_dir, targets):
+    """
+    data フォルダ内のファイル・フォルダを展開し、(LittleFS 上のパス, 実パス) のリストを返す
+    """
+    files = []
+    for target in targets:
+        host_path = os.path.join(data_dir, target.lstrip("/"))
+        if os.path.isdir(host_path):
+            for root, _, names in os.walk(host_path):
+                for name in sorted(names):
+                    files.append(os.path.join(root, name))
+        else:
+            files.append(host_path)
+    result = []
+    for host_path in files:
+        fs_path = "/" + os.path.relpath(host_path, data_dir).replace(os.sep, "/")
+        if len(fs_path.encode("utf-8")) >= UPLOAD_PATH_MAX:
+            raise SystemExit(f"パスが長すぎます: {fs_path}")
+        result.append((fs_path, host_path))
+    if not result or len(result) > UPLOAD_MAX_FILES:
+        raise SystemExit(f"ファイル数は 1～{UPLOAD_MAX_FILES} 件にしてください（{len(result)} 件）")
+    return result
+
+def build_pack(files):
+    """
+    パック（LPK1）を作成する
+    """
+    pack = bytearray(b"LPK1" + struct.pack("<I", len(files)))
+    for fs_path, host_path in files:
+        with open(host_path, "rb") as f:
+            data = f.read()
+        path = fs_path.encode("utf-8")
+        pack += struct.pack("<H", len(path)) + path
+        pack += struct.pack("<II", len(data), zlib.crc32(data) & 0xFFFFFFFF)
+        pack += data
+    return bytes(pack)
+
+def upload(url, filename, data):
+    """
+    multipart/form-data で ESP32 の /upload に送信し、応答を返す
+    """
+    boundary = uuid.uuid4().hex
+    body = (f"--{boundary}\r\n"
+            f"Content-Disposition: form-data; name=\"file\"; filename=\"{filename}\"\r\n"
+            f"Content-Type: application/octet-stream\r\n\r\n").encode("utf-8")
+    body += data + f"\r\n--{boundary}--\r\n".encode("utf-8")
+    request = urllib.request.Request(url, data=body, method="POST",
+                                     headers={"Content-Type": f"multipart/form-data; boundary={boundary}"})
+    with urllib.request.urlopen(request, timeout=120) as response:
+        return response.read().decode("utf-8")
+
+def main():
+    """
+    コマンドライン引数を解析し、パックを作成（または ESP32 へ送信）する
+    """
+    parser = argparse.ArgumentParser(description="画像・CSV をまとめたパック (.lpk) を作成し、ESP32 の /upload へ送信")
+    parser.add_argument("targets", nargs="+", help="data フォルダ内のファイル / フォルダ（例: img/Dest list/list_dest.csv）")
+    parser.add_argument("-d", "--data", default="data", help="LittleFS に書き込む data フォルダのパス")
+    parser.add_argument("-o", "--output", help="パックの保存先（省略時は保存しない）")
+    parser.add_argument("-u", "--upload", help="送信先の ESP32（例: 192.168.1.50）")
+    parser.add_argument("--crc", action="store_true",
+                        help="1 ファイルずつ送る場合の /upload の引数（path と crc32）を表示する")
+    args = parser.parse_args()
+    if not args.output and not args.upload and not args.crc:
+        parser.error("-o、-u または --crc を指定してください")
+
+    files = collect_files(args.data, args.targets)
+    if args.crc:
+        for fs_path, host_path in files:
+            with open(host_path, "rb") as f:
+                print(f"path={fs_path}&crc32={zlib.crc32(f.read()) & 0xFFFFFFFF:08x}")
+        if not args.output and not args.upload:
+            return
+    pack = build_pack(files)
+    print(f"{len(files)} 件 / {len(pack)} バイト")
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(pack)
+        print(f"{args.output} を作成しました。")
+    if args.upload:
+        print(upload(f"http://{args.upload}/upload", "assets.lpk", pack))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+import os
+import time
+import select
+import struct
+import termios
+import argparse
+
+# ESP32 側（src/SerialCommand.h）と同じ定義
+SYNC = b"\xA5\x5A"
+MAX_PAYLOAD = 32
+SET_STATE = 0x01
+QUERY_STATE = 0x02
+ACK = 0x81
+STATE = 0x82
+STATUS_NAMES = {0: "OK", 1: "BAD_LENGTH", 2: "BAD_TYPE", 3: "BAD_VALUE"}
+FIELDS = ["mode", "full", "type", "dest", "dep", "next"]  # SerialSetState::fields のビット順
+
+def crc16(data, crc=0xFFFF):
+    """
+    CRC-16/CCITT-FALSE（多項式 0x1021、初期値 0xFFFF）
+    """
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+def encode(frame_type, seq, payload=b""):
+    """
+    フレームを送信する形式に変換する（先頭 2 バイト + 種類・番号・長さ + 内容 + CRC）
+    """
+    body = bytes([frame_type, seq, len(payload)]) + payload
+    return SYNC + body + struct.pack("<H", crc16(body))
+
+def open_port(path, baud):
+    """
+    シリアルポート（または疑似端末）を raw モードで開く
+    """
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    attrs = termios.tcgetattr(fd)
+    attrs[0] = 0                                             # iflag
+    attrs[1] = 0                                             # oflag
+    attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL  # cflag
+    attrs[3] = 0                                             # lflag
+    speed = getattr(termios, f"B{baud}")
+    attrs[4] = attrs[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    termios.tcflush(fd, termios.TCIOFLUSH)
+    return fd
+
+class FrameReader:
+    """
+    受信したバイト列からフレームを取り出す（ログの文字列は先頭の 2 バイトと CRC で読み飛ばす）
+    """
+    def __init__(self, fd):
+        self.fd = fd
+        self.buffer = bytearray()
+        self.crc_errors = 0
+
+    def read(self, timeout):
+        deadline = time.monotonic() + timeout
+        while True:
+            frame = self._parse()
+            if frame:
+                return frame
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            ready, _, _ = select.select([self.fd], [], [], remaining)
+            if ready:
+                self.buffer += os.read(self.fd, 256)
+
+    def _parse(self):
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                del self.buffer[:max(0, len(self.buffer) - 1)]  # 末尾の 0xA5 は次の受信と合わせて確認
+                return None
+            del self.buffer[:start]
+            if len(self.buffer) < 5:
+                return None
+            frame_type, seq, length = self.buffer[2], self.buffer[3], self.buffer[4]
+            if length > MAX_PAYLOAD:
+                del self.buffer[:1]
+                continue
+            if len(self.buffer) < 7 + length:
+                return None
+            body = bytes(self.buffer[2:5 + length])
+            received, = struct.unpack_from("<H", self.buffer, 5 + length)
+            if received != crc16(body):
+                self.crc_errors += 1
+                del self.buffer[:1]
+                continue
+            del self.buffer[:7 + length]
+            return frame_type, seq, body[3:]
+
+def request(fd, reader, frame_type, seq, payload, timeout, retries):
+    """
+    要求を送り、同じ番号の応答を待つ（届かない場合は送り直す）
+    @return (応答の種類, 内容, 往復時間[秒]) または None
+    """
+    data = encode(frame_type, seq, payload)
+    for _ in range(retries + 1):
+        sent_at = time.monotonic()
+        os.write(fd, data)
+        while True:
+            frame = reader.read(timeout - (time.monotonic() - sent_at))
+            if frame is None:
+                break
+            reply_type, reply_seq, reply = frame
+            if reply_seq == seq and reply_type & 0x80:
+                return reply_type, reply, time.monotonic() - sent_at
+    return None
+
+def main():
+    """
+    コマンドライン引数を解析し、表示内容の変更（set）・問い合わせ（query）を送る
+    """
+    parser = argparse.ArgumentParser(description="ESP32 の UART へ表示内容の変更・問い合わせを送る")
+    parser.add_argument("-p", "--port", required=True, help="シリアルポート（例: /dev/ttyUSB0、代役の /dev/pts/N）")
+    parser.add_argument("-b", "--baud", type=int, default=115200, help="通信速度（既定: 115200）")
+    parser.add_argument("--timeout", type=float, default=0.2, help="応答を待つ時間（秒）")
+    parser.add_argument("--retries", type=int, default=2, help="応答が無い場合に送り直す回数")
+    commands = parser.add_subparsers(dest="command", required=True)
+    set_parser = commands.add_parser("set", help="表示内容の変更（指定した項目のみ）")
+    for name in FIELDS:
+        set_parser.add_argument(f"--{name}", type=int, help=f"{name} の値")
+    query_parser = commands.add_parser("query", help="表示内容の問い合わせ")
+    query_parser.add_argument("-n", "--count", type=int, default=1, help="問い合わせる回数（往復時間の計測用）")
+    args = parser.parse_args()
+
+    fd = open_port(args.port, args.baud)
+    reader = FrameReader(fd)
+    seq = int(time.monotonic() * 1000) & 0xFF
+
+    if args.command == "set":
+        fields = 0
+        values = []
+        for bit, name in enumerate(FIELDS):
+            value = getattr(args, name)
+            if value is not None:
+                fields |= 1 << bit
+            values.append(value or 0)
+        if fields == 0:
+            parser.error("変更する項目を 1 つ以上指定してください")
+        payload = struct.pack("<BBHHHHH", fields, *values)
+        result = request(fd, reader, SET_STATE, seq, payload, args.timeout, args.retries)
+        if result is None:
+            print("応答がありません")
+            exit(1)
+        reply_type, reply, rtt = result
+        status = reply[1] if reply_type == ACK and len(reply) == 2 else None
+        print(f"ack: {STATUS_NAMES.get(status, status)} ({rtt * 1000:.2f} ms)")
+        exit(0 if status == 0 else 1)
+
+    for i in range(args.count):
+        result = request(fd, reader, QUERY_STATE, (seq + i) & 0xFF, b"", args.timeout, args.retries)
+        if result is None:
+            print("応答がありません")
+            exit(1)
+        reply_type, reply, rtt = result
+        if reply_type != STATE or len(reply) != 16:
+            print(f"想定外の応答です (0x{reply_type:02X})")
+            exit(1)
+        mode, full, type_, dest, dep, next_, flags, latency = struct.unpack("<BHHHHHBI", reply)
+        print(f"mode {mode} full {full} type {type_} dest {dest} dep {dep} next {next_} "
+              f"displayed {'yes' if flags & 1 else 'no'} timetable {'playing' if flags & 2 else 'stopped'} "
+              f"latency {latency / 1000:.2f} ms (rtt {rtt * 1000:.2f} ms)")
+    if reader.crc_errors:
+        print(f"CRC が合わずに捨てたフレーム: {reader.crc_errors}")
+
+if __name__ == "__main__":
+    main()